@@ -0,0 +1,159 @@
+# frozen_string_literal: true
+
+require "json"
+require "tmpdir"
+require_relative "../lib/ruby_rpg"
+
+# Runs fixed scenes through the real game loop and reports CPU frame time
+# percentiles, GL traffic (GL::Stats) and allocations per frame, compared
+# against a stored baseline.
+#
+# Frame scenes are built by a block taking the object count. Each runs
+# WARMUP_FRAMES unmeasured frames, then `frames` measured ones, with a fixed
+# 1/60s timestep (Engine.fixed_delta_time) and Kernel#rand seeded with
+# SEED, so every run simulates the same thing. Tasks (scene loading, asset
+# import) are timed over a number of iterations outside the loop.
+#
+# Timings are noisy, counts are not: a run fails when a time grows by more
+# than TIME_TOLERANCE over the baseline or a count by more than
+# COUNT_TOLERANCE. Meant for software GL (Mesa llvmpipe under Xvfb, see
+# `rake bench`), where GPU speed doesn't leak into the CPU numbers.
+module EngineBench
+  SEED = 1234
+  FIXED_DELTA_TIME = 1.0 / 60
+  WARMUP_FRAMES = 30
+  TIME_TOLERANCE = 0.15
+  COUNT_TOLERANCE = 0.05
+
+  Scene = Struct.new(:name, :count, :frames, :build)
+  Task = Struct.new(:name, :iterations, :setup, :run)
+
+  # Counts measured frames and stops the loop once the scene is done
+  class Driver < Engine::Component
+    def update(delta_time)
+      @frame = (@frame || 0) + 1
+      if @frame == WARMUP_FRAMES
+        Engine::FrameProfiler.reset
+        Engine::GL::Stats.reset
+      elsif @frame == WARMUP_FRAMES + @frames
+        @on_finish.call
+        Engine.stop_game
+      end
+    end
+  end
+
+  @scenes = []
+  @tasks = []
+
+  class << self
+    attr_reader :scenes, :tasks
+
+    def scene(name, count:, frames: 300, &build)
+      @scenes << Scene.new(name, count, frames, build)
+    end
+
+    # setup runs once and its result is passed to every iteration of run
+    def task(name, iterations: 5, setup: -> {}, &run)
+      @tasks << Task.new(name, iterations, setup, run)
+    end
+
+    def run(only: nil)
+      Engine.open_window unless Engine.engine_started?
+      Engine.fixed_delta_time = FIXED_DELTA_TIME
+      Engine::FrameProfiler.enable
+      Engine::GL::Stats.enable
+
+      results = {}
+      @scenes.each do |scene|
+        next if only && !only.include?(scene.name)
+
+        results[scene.name] = run_scene(scene)
+        print_result(scene.name, results[scene.name])
+      end
+      @tasks.each do |task|
+        next if only && !only.include?(task.name)
+
+        results[task.name] = run_task(task)
+        print_result(task.name, results[task.name])
+      end
+      results
+    ensure
+      Engine.fixed_delta_time = nil
+      Engine::FrameProfiler.disable
+      Engine::GL::Stats.disable
+    end
+
+    # Regressions as [name, metric, baseline, current]
+    def compare(results, baseline)
+      results.flat_map do |name, metrics|
+        next [] unless baseline[name]
+
+        metrics.filter_map do |metric, value|
+          before = baseline[name][metric]
+          next unless before.is_a?(Numeric) && value.is_a?(Numeric)
+
+          tolerance = metric.end_with?("_ms") ? TIME_TOLERANCE : COUNT_TOLERANCE
+          [name, metric, before, value] if value > before * (1 + tolerance) && value - before > 0.01
+        end
+      end
+    end
+
+    private
+
+    def run_scene(scene)
+      srand(SEED)
+      result = nil
+      Engine.main_game_loop do
+        scene.build.call(scene.count)
+        on_finish = lambda do
+          summary = Engine::FrameProfiler.summary
+          frame_ms = summary[:frame_ms]
+          gl = Engine::GL::Stats.totals
+          gl_frames = [Engine::GL::Stats.frames, 1].max
+          result = {
+            "count" => scene.count,
+            "frames" => summary[:frames],
+            "p50_ms" => frame_ms[:p50], "p95_ms" => frame_ms[:p95], "p99_ms" => frame_ms[:p99],
+            "gl_calls_per_frame" => gl.call_count.fdiv(gl_frames),
+            "draw_calls_per_frame" => gl.draw_calls.fdiv(gl_frames),
+            "state_changes_per_frame" => gl.state_changes.fdiv(gl_frames),
+            "uniform_uploads_per_frame" => gl.uniform_uploads.fdiv(gl_frames),
+            "buffer_bytes_per_frame" => gl.buffer_bytes.fdiv(gl_frames),
+            "allocations_per_frame" => summary[:allocated_objects],
+            "gc_runs_per_frame" => summary[:gc_runs]
+          }
+        end
+        Engine::GameObject.create(
+          name: "Bench Driver",
+          components: [Driver.create(frames: scene.frames, on_finish: on_finish)]
+        )
+      end
+      result
+    end
+
+    def run_task(task)
+      srand(SEED)
+      input = task.setup.call
+      times = []
+      allocations = 0
+      task.iterations.times do
+        allocated = GC.stat(:total_allocated_objects)
+        started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        task.run.call(input)
+        times << (Process.clock_gettime(Process::CLOCK_MONOTONIC) - started) * 1000
+        allocations += GC.stat(:total_allocated_objects) - allocated
+      end
+      times.sort!
+      {
+        "iterations" => task.iterations,
+        "p50_ms" => times[(times.length - 1) / 2], "max_ms" => times.last,
+        "allocations_per_run" => allocations.fdiv(task.iterations)
+      }
+    end
+
+    def print_result(name, result)
+      metrics = result.map { |metric, value| "#{metric} #{value.is_a?(Float) ? format('%.2f', value) : value}" }
+      puts format("%-18s %s", name, metrics.join("  "))
+    end
+  end
+end
@@ -0,0 +1,47 @@
+# frozen_string_literal: true
+
+# ruby bench/run.rb [--only scene,task] [--baseline PATH] [--save-baseline] [--output PATH]
+#
+# Prints each scene's numbers, then any regression against the baseline
+# (bench/baseline.json by default) and exits non-zero if there is one.
+# --save-baseline writes this run as the new baseline instead.
+
+require "optparse"
+require_relative "engine_bench"
+require_relative "../lib/engine/importers/obj_importer"
+require_relative "scenes"
+
+options = { baseline: File.join(__dir__, "baseline.json") }
+OptionParser.new do |parser|
+  parser.on("--only NAMES", Array) { |names| options[:only] = names }
+  parser.on("--baseline PATH") { |path| options[:baseline] = path }
+  parser.on("--save-baseline") { options[:save_baseline] = true }
+  parser.on("--output PATH") { |path| options[:output] = path }
+end.parse!
+
+results = EngineBench.run(only: options[:only])
+Engine.terminate
+File.write(options[:output], JSON.pretty_generate(results)) if options[:output]
+
+if options[:save_baseline]
+  baseline = File.exist?(options[:baseline]) ? JSON.parse(File.read(options[:baseline])) : {}
+  File.write(options[:baseline], JSON.pretty_generate(baseline.merge(results)) + "\n")
+  puts "baseline written to #{options[:baseline]}"
+  exit
+end
+
+unless File.exist?(options[:baseline])
+  puts "no baseline at #{options[:baseline]}; record one with `rake bench:baseline`"
+  exit
+end
+
+regressions = EngineBench.compare(results, JSON.parse(File.read(options[:baseline])))
+if regressions.empty?
+  puts "no regressions against #{options[:baseline]}"
+else
+  puts "regressions against #{options[:baseline]}:"
+  regressions.each do |name, metric, before, after|
+    puts format("  %-18s %-24s %10.2f -> %10.2f (%+.1f%%)", name, metric, before, after, (after / before - 1) * 100)
+  end
+  exit 1
+end
@@ -0,0 +1,155 @@
+# frozen_string_literal: true
+
+# The scenes and tasks `rake bench` runs. Counts are sized to take a few
+# seconds each on llvmpipe; changing one invalidates its baseline entry.
+module EngineBench
+  class Spinner < Engine::Component
+    serialize :speed
+
+    def update(delta_time)
+      game_object.rotation *= Engine::Quaternion.from_euler(Vector[0, @speed, 0] * delta_time)
+    end
+  end
+
+  module Scenes
+    class << self
+      def camera(pos: Vector[0, 40, 120], rotation: Vector[-15, 0, 0])
+        Engine::GameObject.create(
+          name: "Camera",
+          pos: pos,
+          rotation: rotation,
+          components: [
+            Engine::Components::PerspectiveCamera.create(fov: 45.0, aspect: 16.0 / 9.0, near: 0.1, far: 1000.0)
+          ]
+        )
+      end
+
+      def sun(cast_shadows: false)
+        Engine::GameObject.create(
+          name: "Sun",
+          rotation: Vector[-60, 30, 0],
+          components: [Engine::Components::DirectionLight.create(colour: Vector[1, 1, 1], cast_shadows:)]
+        )
+      end
+
+      # count cubes on a square grid, spinning at seeded speeds
+      def cube_grid(count, spacing: 4.0)
+        side = Math.sqrt(count).ceil
+        Array.new(count) do |i|
+          Engine::StandardObjects::Cube.create(
+            pos: Vector[(i % side - side / 2) * spacing, 0, (i / side - side / 2) * spacing],
+            components: [Spinner.create(speed: rand(10.0..90.0))]
+          )
+        end
+      end
+
+      def ui_material
+        @ui_material ||= begin
+          material = Engine::Material.create(shader: Engine::Shader.ui_sprite)
+          material.set_vec4("spriteColor", [0.2, 0.2, 0.8, 0.5])
+          material.set_runtime_texture("image", Engine::Material.default_white_texture)
+          material
+        end
+      end
+    end
+  end
+
+  scene("instanced_cubes", count: 2_000) do |count|
+    Scenes.camera
+    Scenes.sun
+    Scenes.cube_grid(count)
+  end
+
+  scene("shadow_lights", count: 4) do |count|
+    Scenes.camera
+    Scenes.sun(cast_shadows: true)
+    Scenes.cube_grid(200)
+    Engine::StandardObjects::Plane.create(pos: Vector[0, -2, 0], scale: Vector[200, 1, 200])
+    count.times do |i|
+      angle = i * 2 * Math::PI / count
+      Engine::GameObject.create(
+        name: "Light",
+        pos: Vector[Math.cos(angle) * 30, 15, Math.sin(angle) * 30],
+        components: [Engine::Components::PointLight.create(range: 80, colour: [1.0, 0.9, 0.8], cast_shadows: true)]
+      )
+    end
+  end
+
+  scene("text", count: 200) do |count|
+    Scenes.camera(pos: Vector[0, 0, 150], rotation: Vector[0, 0, 0])
+    count.times do |i|
+      Engine::GameObject.create(
+        name: "Text",
+        pos: Vector[(i % 10 - 5) * 20, (i / 10 - 10) * 6, 0],
+        scale: Vector[4, 4, 4],
+        components: [Engine::Components::FontRenderer.create(font: Engine::Font.open_sans, string: "Label #{i}: #{rand(1000)}")]
+      )
+    end
+  end
+
+  scene("ui_rects", count: 500) do |count|
+    Scenes.camera
+    count.times do |i|
+      left = rand(0.0..0.9)
+      top = rand(0.0..0.9)
+      Engine::GameObject.create(
+        name: "Panel",
+        components: [
+          Engine::Components::UI::Rect.create(
+            left_ratio: left, right_ratio: 1.0 - left - 0.1,
+            top_ratio: top, bottom_ratio: 1.0 - top - 0.1,
+            z_layer: i
+          ),
+          Engine::Components::UI::SpriteRenderer.create(material: Scenes.ui_material)
+        ]
+      )
+    end
+  end
+
+  scene("physics_spheres", count: 500) do |count|
+    Scenes.camera
+    Scenes.sun
+    extent = Math.cbrt(count) * 3.0
+    count.times do
+      Engine::StandardObjects::Sphere.create(
+        pos: Vector[rand(-extent..extent), rand(-extent..extent), rand(-extent..extent)],
+        components: [
+          Engine::Physics::Components::Rigidbody.create(
+            velocity: Vector[rand(-5.0..5.0), rand(-5.0..5.0), rand(-5.0..5.0)],
+            gravity: Vector[0, 0, 0]
+          ),
+          Engine::Physics::Components::SphereCollider.create(radius: 1)
+        ]
+      )
+    end
+  end
+
+  task(
+    "scene_load",
+    setup: lambda do
+      path = File.join(Dir.mktmpdir, "bench.scene")
+      cubes = Scenes.cube_grid(500)
+      Engine::Serialization::YamlPersistence.save_all(cubes, path)
+      Engine::GameObject.destroy_all
+      Engine::Component.erase_destroyed_components
+      Engine::GameObject.erase_destroyed_objects
+      path
+    end
+  ) do |path|
+    Engine::Serialization::YamlPersistence.load_all([path])
+    Engine::GameObject.destroy_all
+    Engine::Component.erase_destroyed_components
+    Engine::GameObject.erase_destroyed_objects
+  end
+
+  task(
+    "asset_import",
+    setup: -> { Dir.glob(File.join(ENGINE_DIR, "assets", "*.obj")).map { |obj| obj.delete_suffix(".obj") } }
+  ) do |sources|
+    Dir.mktmpdir do |dir|
+      sources.each do |source|
+        Engine::ObjImporter.new(source, File.join(dir, "#{File.basename(source)}.mesh")).import
+      end
+    end
+  end
+end
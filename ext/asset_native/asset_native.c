@@ -0,0 +1,2385 @@
+#include <ruby.h>
+#include <ruby/thread.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Native helpers for loading imported assets.
+ *
+ * MappedFile maps a file read-only and hands out slices of it as Ruby
+ * strings that point straight into the mapping, so mesh data can go from
+ * disk to BufferData without being copied or turned into Ruby objects.
+ * Each slice holds its MappedFile in a hidden ivar, so the mapping stays
+ * alive as long as any slice (or a string sharing one) is reachable.
+ *
+ * Windows has no mmap here, so the file is read into one buffer instead.
+ *
+ * import_obj parses an .obj (and optional .mtl) in a single streaming pass
+ * without the GVL, so several files can be imported from parallel threads.
+ * optimize_mesh and depth_stream reorder the result for the vertex cache,
+ * and simplify builds LOD levels from it.
+ *
+ * decode_png, mipmaps and compress_bc turn PNGs into texture levels ready
+ * for upload (see Engine::TextureCache).
+ */
+
+/* Module and class references */
+static VALUE mAssetNative;
+static VALUE cMappedFile;
+static ID id_mapped_file;
+
+typedef struct {
+    char *data;
+    long size;
+} MappedFile;
+
+static void mapped_file_release(MappedFile *file) {
+    if (file->data == NULL) return;
+#ifdef _WIN32
+    xfree(file->data);
+#else
+    munmap(file->data, (size_t)file->size);
+#endif
+    file->data = NULL;
+    file->size = 0;
+}
+
+static void mapped_file_free(void *ptr) {
+    mapped_file_release((MappedFile *)ptr);
+    xfree(ptr);
+}
+
+static size_t mapped_file_memsize(const void *ptr) {
+    return sizeof(MappedFile);
+}
+
+static const rb_data_type_t mapped_file_type = {
+    "AssetNative::MappedFile",
+    {NULL, mapped_file_free, mapped_file_memsize},
+    NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static VALUE mapped_file_alloc(VALUE klass) {
+    MappedFile *file;
+    VALUE obj = TypedData_Make_Struct(klass, MappedFile, &mapped_file_type, file);
+    file->data = NULL;
+    file->size = 0;
+    return obj;
+}
+
+/* MappedFile.new(path) */
+static VALUE rb_mapped_file_initialize(VALUE self, VALUE path) {
+    MappedFile *file;
+    const char *cpath;
+
+    TypedData_Get_Struct(self, MappedFile, &mapped_file_type, file);
+    FilePathValue(path);
+    cpath = StringValueCStr(path);
+    mapped_file_release(file);
+
+#ifdef _WIN32
+    {
+        FILE *handle = fopen(cpath, "rb");
+        long size;
+        if (handle == NULL) rb_sys_fail(cpath);
+        fseek(handle, 0, SEEK_END);
+        size = ftell(handle);
+        fseek(handle, 0, SEEK_SET);
+        if (size > 0) {
+            file->data = ALLOC_N(char, size);
+            if (fread(file->data, 1, (size_t)size, handle) != (size_t)size) {
+                fclose(handle);
+                xfree(file->data);
+                file->data = NULL;
+                rb_raise(rb_eIOError, "short read from %s", cpath);
+            }
+        }
+        fclose(handle);
+        file->size = size;
+    }
+#else
+    {
+        struct stat info;
+        int fd = open(cpath, O_RDONLY);
+        if (fd < 0) rb_sys_fail(cpath);
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            rb_sys_fail(cpath);
+        }
+        if (info.st_size > 0) {
+            void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                rb_sys_fail(cpath);
+            }
+            file->data = (char *)data;
+        }
+        close(fd);
+        file->size = (long)info.st_size;
+    }
+#endif
+
+    return self;
+}
+
+/* size() -> bytes */
+static VALUE rb_mapped_file_size(VALUE self) {
+    MappedFile *file;
+    TypedData_Get_Struct(self, MappedFile, &mapped_file_type, file);
+    return LONG2NUM(file->size);
+}
+
+/* slice(offset, length) -> frozen binary String sharing the mapping */
+static VALUE rb_mapped_file_slice(VALUE self, VALUE offset_value, VALUE length_value) {
+    MappedFile *file;
+    long offset = NUM2LONG(offset_value);
+    long length = NUM2LONG(length_value);
+    VALUE slice;
+
+    TypedData_Get_Struct(self, MappedFile, &mapped_file_type, file);
+    if (offset < 0 || length < 0 || offset > file->size || length > file->size - offset) {
+        rb_raise(rb_eArgError, "slice %ld+%ld is outside the %ld byte file", offset, length, file->size);
+    }
+    if (length == 0) return rb_obj_freeze(rb_str_new(NULL, 0));
+
+    slice = rb_str_new_static(file->data + offset, length);
+    /* No @ prefix: invisible from Ruby, but marked with the slice */
+    rb_ivar_set(slice, id_mapped_file, self);
+    return rb_obj_freeze(slice);
+}
+
+
+/*
+ * OBJ import.
+ *
+ * Output vertices use the engine's interleaved 20 float layout: position(3),
+ * uv(2), normal(3), tangent(3), diffuse(3), specular(3), albedo(3). Corners
+ * with the same position, uv, normal and material are welded into one
+ * vertex. Tangents are accumulated per vertex from every triangle using it,
+ * then made orthogonal to the normal.
+ *
+ * Everything between reading the first line and building the result runs
+ * without the GVL, so it only uses malloc and reports errors as strings.
+ */
+
+#define OBJ_STRIDE 20
+#define MAX_MATERIAL_NAME 256
+
+typedef struct {
+    void *data;
+    size_t count;
+    size_t capacity;
+    size_t item_size;
+} Growable;
+
+static int array_reserve(Growable *array, size_t count) {
+    void *data;
+    size_t capacity;
+
+    if (count <= array->capacity) return 1;
+    capacity = array->capacity ? array->capacity : 64;
+    while (capacity < count) capacity *= 2;
+    data = realloc(array->data, capacity * array->item_size);
+    if (data == NULL) return 0;
+    array->data = data;
+    array->capacity = capacity;
+    return 1;
+}
+
+static void *array_push(Growable *array) {
+    if (!array_reserve(array, array->count + 1)) return NULL;
+    return (char *)array->data + array->item_size * array->count++;
+}
+
+#define ARRAY_INIT(type) {NULL, 0, 0, sizeof(type)}
+#define ARRAY_AT(array, type, i) (((type *)(array).data)[i])
+
+typedef struct {
+    char name[MAX_MATERIAL_NAME];
+    float diffuse[3];
+    float specular[3];
+    float albedo[3];
+} Material;
+
+/* One face corner: 0-based indices, -1 when absent */
+typedef struct {
+    long position;
+    long uv;
+    long normal;
+} Corner;
+
+typedef struct {
+    const char *obj_path;
+    const char *mtl_path;
+
+    Growable positions;  /* float[3] */
+    Growable uvs;        /* float[2] */
+    Growable normals;    /* float[3] */
+    Growable materials;  /* Material */
+    Growable vertices;   /* float[OBJ_STRIDE] */
+    Growable indices;    /* uint32_t */
+    Growable tangents;   /* double[3], per vertex */
+    Growable keys;       /* Corner + material, per vertex, for the weld table */
+
+    uint32_t *table;  /* open addressing, vertex index + 1, 0 = empty */
+    size_t table_size;
+
+    long material;    /* current usemtl, -1 for none */
+    char error[512];
+} ObjImport;
+
+typedef struct {
+    Corner corner;
+    long material;
+} VertexKey;
+
+static void obj_import_free(ObjImport *import) {
+    free(import->positions.data);
+    free(import->uvs.data);
+    free(import->normals.data);
+    free(import->materials.data);
+    free(import->vertices.data);
+    free(import->indices.data);
+    free(import->tangents.data);
+    free(import->keys.data);
+    free(import->table);
+}
+
+static int fail(ObjImport *import, const char *message) {
+    snprintf(import->error, sizeof(import->error), "%s", message);
+    return 0;
+}
+
+/* Reads a whole line of any length into *buffer; returns 0 at end of file */
+static int read_line(FILE *file, char **buffer, size_t *capacity) {
+    size_t length = 0;
+
+    if (*buffer == NULL) {
+        *capacity = 1024;
+        *buffer = malloc(*capacity);
+        if (*buffer == NULL) return 0;
+    }
+
+    for (;;) {
+        if (fgets(*buffer + length, (int)(*capacity - length), file) == NULL) {
+            return length > 0;
+        }
+        length += strlen(*buffer + length);
+        if (length > 0 && (*buffer)[length - 1] == '\n') return 1;
+        if (length + 1 < *capacity) return 1; /* last line without a newline */
+
+        {
+            char *grown = realloc(*buffer, *capacity * 2);
+            if (grown == NULL) return 0;
+            *buffer = grown;
+            *capacity *= 2;
+        }
+    }
+}
+
+static const char *skip_space(const char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    return s;
+}
+
+static int starts_with(const char *line, const char *keyword) {
+    size_t length = strlen(keyword);
+    return strncmp(line, keyword, length) == 0 && (line[length] == ' ' || line[length] == '\t');
+}
+
+/* Copies the next whitespace-delimited word (for material names) */
+static void read_name(const char *s, char *out, size_t size) {
+    size_t length = 0;
+    s = skip_space(s);
+    while (s[length] && s[length] != ' ' && s[length] != '\t' && s[length] != '\r' && s[length] != '\n' && length + 1 < size) {
+        out[length] = s[length];
+        length++;
+    }
+    out[length] = '\0';
+}
+
+static int read_floats(const char *s, float *out, int count) {
+    int i;
+    for (i = 0; i < count; i++) {
+        char *end;
+        out[i] = strtof(s, &end);
+        if (end == s) return i;
+        s = end;
+    }
+    return count;
+}
+
+static long find_material(ObjImport *import, const char *name) {
+    size_t i;
+    for (i = 0; i < import->materials.count; i++) {
+        if (strcmp(ARRAY_AT(import->materials, Material, i).name, name) == 0) return (long)i;
+    }
+    return -1;
+}
+
+static int parse_mtl(ObjImport *import) {
+    FILE *file;
+    char *line = NULL;
+    size_t capacity = 0;
+    Material *current = NULL;
+
+    if (import->mtl_path == NULL) return 1;
+    file = fopen(import->mtl_path, "r");
+    if (file == NULL) return 1;
+
+    while (read_line(file, &line, &capacity)) {
+        const char *s = skip_space(line);
+        if (starts_with(s, "newmtl")) {
+            current = array_push(&import->materials);
+            if (current == NULL) { fclose(file); free(line); return fail(import, "out of memory"); }
+            read_name(s + 6, current->name, sizeof(current->name));
+            current->diffuse[0] = current->diffuse[1] = current->diffuse[2] = 1.0f;
+            memcpy(current->specular, current->diffuse, sizeof(current->specular));
+            memcpy(current->albedo, current->diffuse, sizeof(current->albedo));
+        } else if (current && starts_with(s, "Kd")) {
+            read_floats(s + 2, current->diffuse, 3);
+        } else if (current && starts_with(s, "Ks")) {
+            read_floats(s + 2, current->specular, 3);
+        } else if (current && starts_with(s, "Ka")) {
+            read_floats(s + 2, current->albedo, 3);
+        }
+    }
+
+    fclose(file);
+    free(line);
+    return 1;
+}
+
+/* OBJ indices are 1-based, or negative to count back from the latest */
+static long resolve_index(long index, size_t count) {
+    if (index > 0) return index - 1;
+    if (index < 0) return (long)count + index;
+    return -1;
+}
+
+/* Parses "v", "v/vt", "v//vn" or "v/vt/vn"; returns the end or NULL */
+static const char *parse_corner(ObjImport *import, const char *s, Corner *corner) {
+    char *end;
+    long value;
+
+    corner->uv = corner->normal = -1;
+    value = strtol(s, &end, 10);
+    if (end == s) return NULL;
+    corner->position = resolve_index(value, import->positions.count);
+    s = end;
+
+    if (*s == '/') {
+        s++;
+        if (*s != '/') {
+            value = strtol(s, &end, 10);
+            if (end != s) corner->uv = resolve_index(value, import->uvs.count);
+            s = end;
+        }
+        if (*s == '/') {
+            s++;
+            value = strtol(s, &end, 10);
+            if (end != s) corner->normal = resolve_index(value, import->normals.count);
+            s = end;
+        }
+    }
+
+    if (corner->position < 0 || (size_t)corner->position >= import->positions.count) return NULL;
+    if (corner->uv >= (long)import->uvs.count) corner->uv = -1;
+    if (corner->normal >= (long)import->normals.count) corner->normal = -1;
+    return s;
+}
+
+static uint64_t hash_key(const VertexKey *key) {
+    uint64_t h = 1469598103934665603ULL;
+    h = (h ^ (uint64_t)key->corner.position) * 1099511628211ULL;
+    h = (h ^ (uint64_t)key->corner.uv) * 1099511628211ULL;
+    h = (h ^ (uint64_t)key->corner.normal) * 1099511628211ULL;
+    h = (h ^ (uint64_t)key->material) * 1099511628211ULL;
+    return h ^ (h >> 29);
+}
+
+static int grow_table(ObjImport *import) {
+    size_t size = import->table_size ? import->table_size * 2 : 4096;
+    uint32_t *table = calloc(size, sizeof(uint32_t));
+    size_t i;
+
+    if (table == NULL) return 0;
+    for (i = 0; i < import->keys.count; i++) {
+        size_t slot = hash_key(&ARRAY_AT(import->keys, VertexKey, i)) & (size - 1);
+        while (table[slot]) slot = (slot + 1) & (size - 1);
+        table[slot] = (uint32_t)(i + 1);
+    }
+    free(import->table);
+    import->table = table;
+    import->table_size = size;
+    return 1;
+}
+
+/* Index of the welded vertex for corner, adding it if it's new. face_normal
+ * stands in when the corner has no normal of its own. */
+static long weld(ObjImport *import, const Corner *corner, const float *face_normal) {
+    VertexKey key;
+    size_t slot;
+    float *vertex;
+    double *tangent;
+    const Material *material;
+    static const float white[3] = {1.0f, 1.0f, 1.0f};
+
+    key.corner = *corner;
+    key.material = import->material;
+
+    if (import->keys.count * 2 >= import->table_size && !grow_table(import)) return -1;
+
+    slot = hash_key(&key) & (import->table_size - 1);
+    while (import->table[slot]) {
+        const VertexKey *other = &ARRAY_AT(import->keys, VertexKey, import->table[slot] - 1);
+        if (memcmp(&other->corner, &key.corner, sizeof(Corner)) == 0 && other->material == key.material) {
+            return (long)import->table[slot] - 1;
+        }
+        slot = (slot + 1) & (import->table_size - 1);
+    }
+
+    if (import->keys.count >= UINT32_MAX - 1) return -1;
+    if (!array_reserve(&import->vertices, import->vertices.count + 1) ||
+        !array_reserve(&import->tangents, import->tangents.count + 1) ||
+        array_push(&import->keys) == NULL) {
+        return -1;
+    }
+    ARRAY_AT(import->keys, VertexKey, import->keys.count - 1) = key;
+    import->table[slot] = (uint32_t)import->keys.count;
+
+    vertex = (float *)array_push(&import->vertices);
+    tangent = (double *)array_push(&import->tangents);
+    memset(tangent, 0, sizeof(double) * 3);
+    memset(vertex, 0, sizeof(float) * OBJ_STRIDE);
+
+    memcpy(vertex, &ARRAY_AT(import->positions, float, corner->position * 3), sizeof(float) * 3);
+    if (corner->uv >= 0) memcpy(vertex + 3, &ARRAY_AT(import->uvs, float, corner->uv * 2), sizeof(float) * 2);
+    if (corner->normal >= 0) {
+        memcpy(vertex + 5, &ARRAY_AT(import->normals, float, corner->normal * 3), sizeof(float) * 3);
+    } else {
+        memcpy(vertex + 5, face_normal, sizeof(float) * 3);
+    }
+
+    material = import->material >= 0 ? &ARRAY_AT(import->materials, Material, import->material) : NULL;
+    memcpy(vertex + 11, material ? material->diffuse : white, sizeof(float) * 3);
+    memcpy(vertex + 14, material ? material->specular : white, sizeof(float) * 3);
+    memcpy(vertex + 17, material ? material->albedo : white, sizeof(float) * 3);
+
+    return (long)import->keys.count - 1;
+}
+
+static const float *corner_position(ObjImport *import, const Corner *corner) {
+    return &ARRAY_AT(import->positions, float, corner->position * 3);
+}
+
+/* Triangle tangent from positions and uvs, added to each vertex's sum */
+static void accumulate_tangent(ObjImport *import, const uint32_t *triangle) {
+    const float *v0 = &ARRAY_AT(import->vertices, float, (size_t)triangle[0] * OBJ_STRIDE);
+    const float *v1 = &ARRAY_AT(import->vertices, float, (size_t)triangle[1] * OBJ_STRIDE);
+    const float *v2 = &ARRAY_AT(import->vertices, float, (size_t)triangle[2] * OBJ_STRIDE);
+    double e1[3], e2[3], du1, dv1, du2, dv2, determinant, t[3];
+    int i, k;
+
+    du1 = v1[3] - v0[3]; dv1 = v1[4] - v0[4];
+    du2 = v2[3] - v0[3]; dv2 = v2[4] - v0[4];
+    determinant = du1 * dv2 - dv1 * du2;
+    if (determinant == 0) return;
+
+    for (k = 0; k < 3; k++) {
+        e1[k] = v1[k] - v0[k];
+        e2[k] = v2[k] - v0[k];
+        t[k] = (dv2 * e1[k] - dv1 * e2[k]) / determinant;
+    }
+    for (i = 0; i < 3; i++) {
+        double *sum = &ARRAY_AT(import->tangents, double, (size_t)triangle[i] * 3);
+        for (k = 0; k < 3; k++) sum[k] += t[k];
+    }
+}
+
+/* Newell normal of a polygon, unnormalized */
+static void polygon_normal(ObjImport *import, const Corner *corners, long count, double *normal) {
+    long i;
+    normal[0] = normal[1] = normal[2] = 0;
+    for (i = 0; i < count; i++) {
+        const float *a = corner_position(import, &corners[i]);
+        const float *b = corner_position(import, &corners[(i + 1) % count]);
+        normal[0] += ((double)a[1] - b[1]) * ((double)a[2] + b[2]);
+        normal[1] += ((double)a[2] - b[2]) * ((double)a[0] + b[0]);
+        normal[2] += ((double)a[0] - b[0]) * ((double)a[1] + b[1]);
+    }
+}
+
+static int emit_triangle(ObjImport *import, const Corner *a, const Corner *b, const Corner *c, const float *face_normal) {
+    uint32_t triangle[3];
+    const Corner *corners[3] = {a, b, c};
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        long index = weld(import, corners[i], face_normal);
+        if (index < 0) return fail(import, "out of memory");
+        triangle[i] = (uint32_t)index;
+    }
+    if (!array_reserve(&import->indices, import->indices.count + 3)) return fail(import, "out of memory");
+    memcpy((uint32_t *)import->indices.data + import->indices.count, triangle, sizeof(triangle));
+    import->indices.count += 3;
+    accumulate_tangent(import, triangle);
+    return 1;
+}
+
+/* Ear clipping in the plane of the polygon, keeping its winding. Convex
+ * faces come out as a fan; concave ones only clip ears with no other
+ * corner inside them. */
+static int triangulate(ObjImport *import, Corner *corners, long count) {
+    double normal[3], length;
+    float face_normal[3];
+    int drop, u_axis, v_axis;
+    long *remaining, left, guard, i;
+
+    polygon_normal(import, corners, count, normal);
+    length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    for (i = 0; i < 3; i++) face_normal[i] = length > 0 ? (float)(normal[i] / length) : 0.0f;
+
+    if (count == 3) return emit_triangle(import, &corners[0], &corners[1], &corners[2], face_normal);
+
+    /* Project onto the plane that drops the normal's largest axis */
+    drop = fabs(normal[0]) > fabs(normal[1]) ? (fabs(normal[0]) > fabs(normal[2]) ? 0 : 2) : (fabs(normal[1]) > fabs(normal[2]) ? 1 : 2);
+    u_axis = (drop + 1) % 3;
+    v_axis = (drop + 2) % 3;
+
+    remaining = malloc(sizeof(long) * count);
+    if (remaining == NULL) return fail(import, "out of memory");
+    for (i = 0; i < count; i++) remaining[i] = i;
+    left = count;
+    guard = count * count;
+
+    while (left > 3 && guard-- > 0) {
+        int clipped = 0;
+        for (i = 0; i < left && !clipped; i++) {
+            long ia = remaining[(i + left - 1) % left], ib = remaining[i], ic = remaining[(i + 1) % left];
+            const float *a = corner_position(import, &corners[ia]);
+            const float *b = corner_position(import, &corners[ib]);
+            const float *c = corner_position(import, &corners[ic]);
+            double cross = ((double)b[u_axis] - a[u_axis]) * ((double)c[v_axis] - a[v_axis]) -
+                           ((double)b[v_axis] - a[v_axis]) * ((double)c[u_axis] - a[u_axis]);
+            long j;
+            int ear = cross * normal[drop] > 0;
+
+            for (j = 0; j < left && ear; j++) {
+                long ip = remaining[j];
+                const float *p = corner_position(import, &corners[ip]);
+                double d1, d2, d3;
+                if (ip == ia || ip == ib || ip == ic) continue;
+                d1 = ((double)b[u_axis] - a[u_axis]) * ((double)p[v_axis] - a[v_axis]) - ((double)b[v_axis] - a[v_axis]) * ((double)p[u_axis] - a[u_axis]);
+                d2 = ((double)c[u_axis] - b[u_axis]) * ((double)p[v_axis] - b[v_axis]) - ((double)c[v_axis] - b[v_axis]) * ((double)p[u_axis] - b[u_axis]);
+                d3 = ((double)a[u_axis] - c[u_axis]) * ((double)p[v_axis] - c[v_axis]) - ((double)a[v_axis] - c[v_axis]) * ((double)p[u_axis] - c[u_axis]);
+                if ((d1 * normal[drop] >= 0) && (d2 * normal[drop] >= 0) && (d3 * normal[drop] >= 0)) ear = 0;
+            }
+            if (!ear) continue;
+
+            if (!emit_triangle(import, &corners[ia], &corners[ib], &corners[ic], face_normal)) {
+                free(remaining);
+                return 0;
+            }
+            memmove(&remaining[i], &remaining[i + 1], sizeof(long) * (left - i - 1));
+            left--;
+            clipped = 1;
+        }
+        /* Degenerate or self-intersecting: fall back to a fan */
+        if (!clipped) break;
+    }
+
+    for (i = 1; i + 1 < left; i++) {
+        if (!emit_triangle(import, &corners[remaining[0]], &corners[remaining[i]], &corners[remaining[i + 1]], face_normal)) {
+            free(remaining);
+            return 0;
+        }
+    }
+    free(remaining);
+    return 1;
+}
+
+static int parse_face(ObjImport *import, const char *s, Growable *corners) {
+    corners->count = 0;
+    for (;;) {
+        Corner *corner;
+        s = skip_space(s);
+        if (*s == '\0' || *s == '\r' || *s == '\n' || *s == '#') break;
+        corner = array_push(corners);
+        if (corner == NULL) return fail(import, "out of memory");
+        s = parse_corner(import, s, corner);
+        if (s == NULL) return fail(import, "face refers to a missing vertex");
+    }
+    if (corners->count < 3) return 1;
+    return triangulate(import, (Corner *)corners->data, (long)corners->count);
+}
+
+/* Gram-Schmidt each summed tangent against its vertex normal */
+static void finish_tangents(ObjImport *import) {
+    size_t i;
+    for (i = 0; i < import->vertices.count; i++) {
+        float *vertex = &ARRAY_AT(import->vertices, float, i * OBJ_STRIDE);
+        const double *sum = &ARRAY_AT(import->tangents, double, i * 3);
+        double n[3] = {vertex[5], vertex[6], vertex[7]}, t[3], along, length;
+        int k;
+
+        along = n[0] * sum[0] + n[1] * sum[1] + n[2] * sum[2];
+        for (k = 0; k < 3; k++) t[k] = sum[k] - n[k] * along;
+        length = sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+        for (k = 0; k < 3; k++) vertex[8 + k] = length > 1e-12 ? (float)(t[k] / length) : 0.0f;
+    }
+}
+
+typedef float Float2[2];
+typedef float Float3[3];
+typedef float Vertex[OBJ_STRIDE];
+typedef double Double3[3];
+
+static int parse_obj(ObjImport *import) {
+    FILE *file;
+    char *line = NULL, name[MAX_MATERIAL_NAME];
+    size_t capacity = 0;
+    Growable corners = ARRAY_INIT(Corner);
+    int ok = 1;
+
+    if (!parse_mtl(import)) return 0;
+
+    file = fopen(import->obj_path, "r");
+    if (file == NULL) {
+        snprintf(import->error, sizeof(import->error), "cannot open %s", import->obj_path);
+        return 0;
+    }
+
+    while (ok && read_line(file, &line, &capacity)) {
+        const char *s = skip_space(line);
+        float *values;
+
+        if (starts_with(s, "v")) {
+            values = array_push(&import->positions);
+            if (values == NULL) { ok = fail(import, "out of memory"); break; }
+            if (read_floats(s + 1, values, 3) != 3) ok = fail(import, "malformed v line");
+        } else if (starts_with(s, "vt")) {
+            values = array_push(&import->uvs);
+            if (values == NULL) { ok = fail(import, "out of memory"); break; }
+            values[0] = values[1] = 0.0f;
+            read_floats(s + 2, values, 2);
+        } else if (starts_with(s, "vn")) {
+            values = array_push(&import->normals);
+            if (values == NULL) { ok = fail(import, "out of memory"); break; }
+            if (read_floats(s + 2, values, 3) != 3) ok = fail(import, "malformed vn line");
+        } else if (starts_with(s, "f")) {
+            ok = parse_face(import, s + 1, &corners);
+        } else if (starts_with(s, "usemtl")) {
+            read_name(s + 6, name, sizeof(name));
+            import->material = find_material(import, name);
+        }
+    }
+
+    if (ok) finish_tangents(import);
+
+    fclose(file);
+    free(line);
+    free(corners.data);
+    return ok;
+}
+
+static void *parse_obj_without_gvl(void *data) {
+    ObjImport *import = data;
+    return parse_obj(import) ? import : NULL;
+}
+
+/* import_obj(obj_path, mtl_path = nil) -> [vertex_bytes, index_bytes, vertex_count]
+ * vertex_bytes: float32, 20 per vertex; index_bytes: uint32 triangle list */
+static VALUE rb_import_obj(int argc, VALUE *argv, VALUE self) {
+    VALUE obj_path, mtl_path, vertex_bytes, index_bytes;
+    ObjImport import;
+    void *result;
+    long vertex_count;
+
+    rb_scan_args(argc, argv, "11", &obj_path, &mtl_path);
+    FilePathValue(obj_path);
+    if (!NIL_P(mtl_path)) FilePathValue(mtl_path);
+
+    memset(&import, 0, sizeof(import));
+    import.positions.item_size = sizeof(Float3);
+    import.uvs.item_size = sizeof(Float2);
+    import.normals.item_size = sizeof(Float3);
+    import.materials.item_size = sizeof(Material);
+    import.vertices.item_size = sizeof(Vertex);
+    import.indices.item_size = sizeof(uint32_t);
+    import.tangents.item_size = sizeof(Double3);
+    import.keys.item_size = sizeof(VertexKey);
+    import.material = -1;
+    import.obj_path = StringValueCStr(obj_path);
+    import.mtl_path = NIL_P(mtl_path) ? NULL : StringValueCStr(mtl_path);
+
+    result = rb_thread_call_without_gvl(parse_obj_without_gvl, &import, NULL, NULL);
+    RB_GC_GUARD(obj_path);
+    RB_GC_GUARD(mtl_path);
+    if (result == NULL) {
+        VALUE message = rb_str_new_cstr(import.error);
+        obj_import_free(&import);
+        rb_raise(rb_eArgError, "%s: %" PRIsVALUE, RSTRING_PTR(obj_path), message);
+    }
+
+    vertex_count = (long)import.vertices.count;
+    vertex_bytes = rb_str_new((const char *)import.vertices.data, vertex_count * (long)sizeof(Vertex));
+    index_bytes = rb_str_new((const char *)import.indices.data, (long)(import.indices.count * sizeof(uint32_t)));
+    obj_import_free(&import);
+
+    return rb_ary_new_from_args(3, vertex_bytes, index_bytes, LONG2NUM(vertex_count));
+}
+
+/* vertex_bounds(vertex_bytes, stride) -> [min x y z, max x y z, center x y z, radius]
+ * over the first 3 floats of each vertex; the sphere is centred on the
+ * AABB and reaches the furthest vertex */
+static VALUE rb_vertex_bounds(VALUE self, VALUE bytes, VALUE stride_value) {
+    long stride = NUM2LONG(stride_value);
+    long count, i;
+    const float *data;
+    double min[3] = {0, 0, 0}, max[3] = {0, 0, 0}, center[3], radius_squared = 0;
+    VALUE result;
+    int k;
+
+    Check_Type(bytes, T_STRING);
+    if (stride < 3) rb_raise(rb_eArgError, "stride must be at least 3, got %ld", stride);
+    data = (const float *)RSTRING_PTR(bytes);
+    count = RSTRING_LEN(bytes) / (long)(stride * sizeof(float));
+
+    for (i = 0; i < count; i++) {
+        const float *p = data + i * stride;
+        for (k = 0; k < 3; k++) {
+            if (i == 0 || p[k] < min[k]) min[k] = p[k];
+            if (i == 0 || p[k] > max[k]) max[k] = p[k];
+        }
+    }
+    for (k = 0; k < 3; k++) center[k] = (min[k] + max[k]) / 2.0;
+    for (i = 0; i < count; i++) {
+        const float *p = data + i * stride;
+        double dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+        double distance_squared = dx * dx + dy * dy + dz * dz;
+        if (distance_squared > radius_squared) radius_squared = distance_squared;
+    }
+
+    result = rb_ary_new_capa(10);
+    for (k = 0; k < 3; k++) rb_ary_push(result, DBL2NUM(min[k]));
+    for (k = 0; k < 3; k++) rb_ary_push(result, DBL2NUM(max[k]));
+    for (k = 0; k < 3; k++) rb_ary_push(result, DBL2NUM(center[k]));
+    rb_ary_push(result, DBL2NUM(sqrt(radius_squared)));
+    return result;
+}
+
+/*
+ * Mesh optimization.
+ *
+ * optimize_mesh reorders triangles for the post-transform vertex cache
+ * (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"), then renumbers
+ * vertices in the order the new index list first uses them, so vertex
+ * fetches walk the buffer forwards. depth_stream welds vertices by position
+ * alone into a position-only copy for shadow passes, optimized the same way.
+ *
+ * Both work on malloc'd copies without the GVL.
+ */
+
+#define CACHE_SIZE 32
+#define CACHE_DECAY_POWER 1.5
+#define LAST_TRIANGLE_SCORE 0.75
+#define VALENCE_BOOST_SCALE 2.0
+#define VALENCE_BOOST_POWER 0.5
+
+typedef struct {
+    float *vertices;
+    uint32_t *indices;
+    size_t vertex_count;
+    size_t index_count;
+    long stride;
+    /* depth_stream: index count of each LOD level in indices, in order */
+    size_t *level_counts;
+    long level_count;
+    /* simplify: stop at this many indices, or past max_error (relative to
+     * the bounding radius, replaced with the error reached) */
+    size_t target_index_count;
+    double max_error;
+    int ok;
+} MeshJob;
+
+static float vertex_score(int cache_position, uint32_t remaining) {
+    float score = 0.0f;
+
+    if (remaining == 0) return -1.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            score = (float)LAST_TRIANGLE_SCORE;
+        } else {
+            float scale = 1.0f / (CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scale, (float)CACHE_DECAY_POWER);
+        }
+    }
+    return score + (float)VALENCE_BOOST_SCALE * powf((float)remaining, -(float)VALENCE_BOOST_POWER);
+}
+
+/* Reorders triangles in place; returns 0 when out of memory */
+static int optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count) {
+    size_t triangle_count = index_count / 3;
+    uint32_t *offsets, *remaining, *adjacency, *output;
+    float *scores, best_score = -1.0f;
+    unsigned char *added;
+    uint32_t cache[CACHE_SIZE + 3], next_cache[CACHE_SIZE + 3];
+    int cache_count = 0, next_count, k;
+    size_t i, written = 0, cursor = 0;
+    long best = -1;
+    int ok = 0;
+
+    if (triangle_count == 0) return 1;
+    offsets = calloc(vertex_count + 1, sizeof(uint32_t));
+    remaining = calloc(vertex_count, sizeof(uint32_t));
+    adjacency = malloc(index_count * sizeof(uint32_t));
+    output = malloc(index_count * sizeof(uint32_t));
+    scores = malloc(vertex_count * sizeof(float));
+    added = calloc(triangle_count, 1);
+    if (!offsets || !remaining || !adjacency || !output || !scores || !added) goto done;
+
+    /* Triangles using each vertex, packed per vertex */
+    for (i = 0; i < index_count; i++) remaining[indices[i]]++;
+    for (i = 0; i < vertex_count; i++) offsets[i + 1] = offsets[i] + remaining[i];
+    for (i = 0; i < vertex_count; i++) remaining[i] = 0;
+    for (i = 0; i < index_count; i++) {
+        uint32_t v = indices[i];
+        adjacency[offsets[v] + remaining[v]++] = (uint32_t)(i / 3);
+    }
+
+    for (i = 0; i < vertex_count; i++) scores[i] = vertex_score(-1, remaining[i]);
+    for (i = 0; i < triangle_count; i++) {
+        float score = scores[indices[i * 3]] + scores[indices[i * 3 + 1]] + scores[indices[i * 3 + 2]];
+        if (score > best_score) {
+            best_score = score;
+            best = (long)i;
+        }
+    }
+
+    while (written < triangle_count) {
+        const uint32_t *triangle;
+
+        /* Nothing in the cache touches an unadded triangle: take the next one in order */
+        if (best < 0) {
+            while (added[cursor]) cursor++;
+            best = (long)cursor;
+        }
+
+        triangle = indices + best * 3;
+        memcpy(output + written * 3, triangle, 3 * sizeof(uint32_t));
+        written++;
+        added[best] = 1;
+
+        /* Drop the triangle from its vertices' lists */
+        for (k = 0; k < 3; k++) {
+            uint32_t v = triangle[k], j, *list = adjacency + offsets[v];
+            for (j = 0; j < remaining[v]; j++) {
+                if (list[j] == (uint32_t)best) {
+                    list[j] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        /* LRU: the triangle's vertices move to the front */
+        next_count = 0;
+        for (k = 0; k < 3; k++) next_cache[next_count++] = triangle[k];
+        for (k = 0; k < cache_count; k++) {
+            uint32_t v = cache[k];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) next_cache[next_count++] = v;
+        }
+        for (k = CACHE_SIZE; k < next_count; k++) scores[next_cache[k]] = vertex_score(-1, remaining[next_cache[k]]);
+        cache_count = next_count < CACHE_SIZE ? next_count : CACHE_SIZE;
+        memcpy(cache, next_cache, cache_count * sizeof(uint32_t));
+        for (k = 0; k < cache_count; k++) scores[cache[k]] = vertex_score(k, remaining[cache[k]]);
+
+        /* The next triangle comes from those touching the cache */
+        best = -1;
+        best_score = -1.0f;
+        for (k = 0; k < cache_count; k++) {
+            uint32_t v = cache[k], j;
+            for (j = 0; j < remaining[v]; j++) {
+                uint32_t t = adjacency[offsets[v] + j];
+                float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                if (score > best_score) {
+                    best_score = score;
+                    best = (long)t;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, output, index_count * sizeof(uint32_t));
+    ok = 1;
+
+done:
+    free(offsets);
+    free(remaining);
+    free(adjacency);
+    free(output);
+    free(scores);
+    free(added);
+    return ok;
+}
+
+/* Renumbers vertices by first use and drops unreferenced ones; returns 0 when out of memory */
+static int optimize_vertex_fetch(MeshJob *job) {
+    uint32_t *remap = malloc(job->vertex_count * sizeof(uint32_t) + 1);
+    float *vertices = malloc(job->vertex_count * job->stride * sizeof(float) + 1);
+    uint32_t next = 0;
+    size_t i;
+
+    if (remap == NULL || vertices == NULL) {
+        free(remap);
+        free(vertices);
+        return 0;
+    }
+    for (i = 0; i < job->vertex_count; i++) remap[i] = UINT32_MAX;
+    for (i = 0; i < job->index_count; i++) {
+        uint32_t v = job->indices[i];
+        if (remap[v] == UINT32_MAX) {
+            memcpy(vertices + (size_t)next * job->stride, job->vertices + (size_t)v * job->stride, job->stride * sizeof(float));
+            remap[v] = next++;
+        }
+        job->indices[i] = remap[v];
+    }
+
+    free(job->vertices);
+    free(remap);
+    job->vertices = vertices;
+    job->vertex_count = next;
+    return 1;
+}
+
+static void *optimize_mesh_without_gvl(void *data) {
+    MeshJob *job = data;
+    job->ok = optimize_vertex_cache(job->indices, job->index_count, job->vertex_count) && optimize_vertex_fetch(job);
+    return NULL;
+}
+
+/* Replaces the job's vertices with their positions, welded by exact value,
+ * and drops triangles that collapse. Levels are optimized separately but
+ * share the vertex order, which follows the first (most detailed) level. */
+static void *depth_stream_without_gvl(void *data) {
+    MeshJob *job = data;
+    size_t table_size = 16, i, kept = 0, start;
+    long level;
+    uint32_t *table, *remap;
+    float *positions;
+    uint32_t count = 0;
+
+    while (table_size < job->vertex_count * 2) table_size *= 2;
+    table = calloc(table_size, sizeof(uint32_t));
+    remap = malloc(job->vertex_count * sizeof(uint32_t) + 1);
+    positions = malloc(job->vertex_count * 3 * sizeof(float) + 1);
+    job->ok = 0;
+    if (table == NULL || remap == NULL || positions == NULL) {
+        free(table);
+        free(remap);
+        free(positions);
+        return NULL;
+    }
+
+    for (i = 0; i < job->vertex_count; i++) {
+        const float *p = job->vertices + i * job->stride;
+        uint32_t bits[3], hash = 2166136261u;
+        size_t slot;
+        int k;
+
+        memcpy(bits, p, sizeof(bits));
+        for (k = 0; k < 3; k++) hash = (hash ^ bits[k]) * 16777619u;
+        slot = hash & (table_size - 1);
+        while (table[slot] && memcmp(positions + (table[slot] - 1) * 3, p, 3 * sizeof(float)) != 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (!table[slot]) {
+            memcpy(positions + (size_t)count * 3, p, 3 * sizeof(float));
+            table[slot] = ++count;
+        }
+        remap[i] = table[slot] - 1;
+    }
+
+    /* Each level keeps its own range, minus the triangles that collapsed */
+    for (level = 0, start = 0; level < job->level_count; level++) {
+        size_t level_start = kept;
+        for (i = start; i + 2 < start + job->level_counts[level]; i += 3) {
+            uint32_t a = remap[job->indices[i]], b = remap[job->indices[i + 1]], c = remap[job->indices[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            job->indices[kept++] = a;
+            job->indices[kept++] = b;
+            job->indices[kept++] = c;
+        }
+        start += job->level_counts[level];
+        job->level_counts[level] = kept - level_start;
+    }
+
+    free(table);
+    free(remap);
+    free(job->vertices);
+    job->vertices = positions;
+    job->vertex_count = count;
+    job->index_count = kept;
+    job->stride = 3;
+
+    for (level = 0, start = 0; level < job->level_count; level++) {
+        if (!optimize_vertex_cache(job->indices + start, job->level_counts[level], count)) return NULL;
+        start += job->level_counts[level];
+    }
+    job->ok = optimize_vertex_fetch(job);
+    return NULL;
+}
+
+/*
+ * Simplification for LOD chains.
+ *
+ * simplify collapses edges in order of quadric error (Garland and Heckbert,
+ * "Surface Simplification Using Quadric Error Metrics") until the index list
+ * is down to the target or the next collapse would move the surface further
+ * than max_error. Vertices only ever move onto a neighbour, so the result
+ * indexes the same vertex buffer and every level can share it.
+ *
+ * Collapses work on positions: vertices split by uv or normal seams share a
+ * position and move together, each onto the vertex across the edge that it
+ * shares a triangle with. Open borders only collapse along themselves, and
+ * collapses that would flip a triangle are skipped.
+ *
+ * Each pass sorts every edge by cost and applies the cheapest collapses
+ * whose neighbourhoods don't overlap, then rebuilds the topology.
+ */
+
+#define BORDER_WEIGHT 10.0
+#define MAX_SIMPLIFY_PASSES 64
+
+/* Symmetric 4x4 plane quadric: a2 ab ac ad b2 bc bd c2 cd d2, plus the
+ * total area it was built from */
+typedef struct {
+    double q[10];
+    double weight;
+} Quadric;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+} Collapse;
+
+static void quadric_add_plane(Quadric *quadric, const double *n, double d, double weight) {
+    double *q = quadric->q;
+
+    q[0] += weight * n[0] * n[0]; q[1] += weight * n[0] * n[1]; q[2] += weight * n[0] * n[2]; q[3] += weight * n[0] * d;
+    q[4] += weight * n[1] * n[1]; q[5] += weight * n[1] * n[2]; q[6] += weight * n[1] * d;
+    q[7] += weight * n[2] * n[2]; q[8] += weight * n[2] * d;
+    q[9] += weight * d * d;
+    quadric->weight += weight;
+}
+
+/* Mean squared distance from p to the planes in a + b */
+static double quadric_cost(const Quadric *a, const Quadric *b, const float *p) {
+    double q[10], x = p[0], y = p[1], z = p[2], weight = a->weight + b->weight, error;
+    int k;
+
+    for (k = 0; k < 10; k++) q[k] = a->q[k] + b->q[k];
+    error = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+          + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+          + q[7] * z * z + 2 * q[8] * z
+          + q[9];
+    if (error < 0) error = 0;
+    return weight > 0 ? error / weight : error;
+}
+
+static void triangle_normal(const float *a, const float *b, const float *c, double *n) {
+    double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static int compare_edges(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_collapses(const void *a, const void *b) {
+    double x = ((const Collapse *)a)->cost, y = ((const Collapse *)b)->cost;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    /* Per vertex */
+    uint32_t *position_of;     /* position class */
+    uint32_t *vertex_remap;
+    /* Per position class */
+    float *positions;
+    Quadric *quadrics;
+    uint32_t *class_remap;
+    unsigned char *border;
+    unsigned char *locked;
+    uint32_t *triangle_offsets; /* class -> triangles, rebuilt every pass */
+    uint32_t *triangle_lists;
+    /* Per pass */
+    uint64_t *edges;
+    Collapse *collapses;
+    size_t class_count;
+} Simplifier;
+
+static void simplifier_free(Simplifier *simplifier) {
+    free(simplifier->position_of);
+    free(simplifier->vertex_remap);
+    free(simplifier->positions);
+    free(simplifier->quadrics);
+    free(simplifier->class_remap);
+    free(simplifier->border);
+    free(simplifier->locked);
+    free(simplifier->triangle_offsets);
+    free(simplifier->triangle_lists);
+    free(simplifier->edges);
+    free(simplifier->collapses);
+}
+
+/* Groups vertices by exact position */
+static int build_position_classes(Simplifier *simplifier, const MeshJob *job) {
+    size_t table_size = 16, i;
+    uint32_t *table;
+
+    while (table_size < job->vertex_count * 2) table_size *= 2;
+    table = calloc(table_size, sizeof(uint32_t));
+    if (table == NULL) return 0;
+
+    for (i = 0; i < job->vertex_count; i++) {
+        const float *p = job->vertices + i * job->stride;
+        uint32_t bits[3], hash = 2166136261u;
+        size_t slot;
+        int k;
+
+        memcpy(bits, p, sizeof(bits));
+        for (k = 0; k < 3; k++) hash = (hash ^ bits[k]) * 16777619u;
+        slot = hash & (table_size - 1);
+        while (table[slot] && memcmp(simplifier->positions + (table[slot] - 1) * 3, p, 3 * sizeof(float)) != 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (!table[slot]) {
+            memcpy(simplifier->positions + simplifier->class_count * 3, p, 3 * sizeof(float));
+            table[slot] = (uint32_t)++simplifier->class_count;
+        }
+        simplifier->position_of[i] = table[slot] - 1;
+    }
+    free(table);
+    return 1;
+}
+
+/* Class-level triangle lists and unique edges for the current indices;
+ * returns the number of unique edges */
+static size_t build_topology(Simplifier *simplifier, const MeshJob *job) {
+    size_t triangle_count = job->index_count / 3, i, edge_count = 0, unique = 0;
+    const uint32_t *classes = simplifier->position_of;
+    uint32_t *fill = simplifier->triangle_offsets;
+    int k;
+
+    memset(simplifier->triangle_offsets, 0, (simplifier->class_count + 1) * sizeof(uint32_t));
+    for (i = 0; i < job->index_count; i++) simplifier->triangle_offsets[classes[job->indices[i]] + 1]++;
+    for (i = 0; i < simplifier->class_count; i++) simplifier->triangle_offsets[i + 1] += simplifier->triangle_offsets[i];
+    for (i = 0; i < job->index_count; i++) {
+        uint32_t c = classes[job->indices[i]];
+        simplifier->triangle_lists[fill[c]++] = (uint32_t)(i / 3);
+    }
+    /* fill[c] now holds the start of c + 1; shift back */
+    memmove(simplifier->triangle_offsets + 1, simplifier->triangle_offsets, simplifier->class_count * sizeof(uint32_t));
+    simplifier->triangle_offsets[0] = 0;
+
+    for (i = 0; i < triangle_count; i++) {
+        for (k = 0; k < 3; k++) {
+            uint64_t a = classes[job->indices[i * 3 + k]], b = classes[job->indices[i * 3 + (k + 1) % 3]];
+            simplifier->edges[edge_count++] = a < b ? (a << 32) | b : (b << 32) | a;
+        }
+    }
+    qsort(simplifier->edges, edge_count, sizeof(uint64_t), compare_edges);
+
+    /* Unique edges; an edge used by one triangle is an open border */
+    memset(simplifier->border, 0, simplifier->class_count);
+    for (i = 0; i < edge_count;) {
+        size_t run = 1;
+        while (i + run < edge_count && simplifier->edges[i + run] == simplifier->edges[i]) run++;
+        if (run == 1) {
+            simplifier->border[simplifier->edges[i] >> 32] = 1;
+            simplifier->border[simplifier->edges[i] & 0xffffffffu] = 1;
+            /* Mark border edges with the top bit of the low word */
+            simplifier->edges[unique++] = simplifier->edges[i] | 0x80000000u;
+        } else {
+            simplifier->edges[unique++] = simplifier->edges[i];
+        }
+        i += run;
+    }
+    return unique;
+}
+
+static void add_triangle_quadrics(Simplifier *simplifier, const MeshJob *job) {
+    size_t i;
+    const uint32_t *classes = simplifier->position_of;
+
+    for (i = 0; i < job->index_count; i += 3) {
+        uint32_t c[3] = {classes[job->indices[i]], classes[job->indices[i + 1]], classes[job->indices[i + 2]]};
+        const float *p = simplifier->positions + c[0] * 3;
+        double n[3], length, d;
+        int k;
+
+        triangle_normal(p, simplifier->positions + c[1] * 3, simplifier->positions + c[2] * 3, n);
+        length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0) continue;
+        for (k = 0; k < 3; k++) n[k] /= length;
+        d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+        for (k = 0; k < 3; k++) quadric_add_plane(&simplifier->quadrics[c[k]], n, d, length / 2);
+    }
+}
+
+/* A plane through each border edge, perpendicular to its triangle, keeps
+ * open borders from shrinking */
+static void add_border_quadrics(Simplifier *simplifier, const MeshJob *job, size_t edge_count) {
+    size_t e, i;
+    const uint32_t *classes = simplifier->position_of;
+
+    for (e = 0; e < edge_count; e++) {
+        uint32_t a, b, t;
+        uint32_t start, end;
+
+        if (!(simplifier->edges[e] & 0x80000000u)) continue;
+        a = (uint32_t)(simplifier->edges[e] >> 32);
+        b = (uint32_t)(simplifier->edges[e] & 0x7fffffffu);
+        start = simplifier->triangle_offsets[a];
+        end = simplifier->triangle_offsets[a + 1];
+
+        for (i = start; i < end; i++) {
+            const uint32_t *tri;
+            const float *pa = simplifier->positions + a * 3, *pb = simplifier->positions + b * 3;
+            double n[3], edge[3], plane[3], length, d;
+            int k, has_b = 0;
+
+            t = simplifier->triangle_lists[i];
+            tri = job->indices + t * 3;
+            for (k = 0; k < 3; k++) has_b |= classes[tri[k]] == b;
+            if (!has_b) continue;
+
+            triangle_normal(simplifier->positions + classes[tri[0]] * 3, simplifier->positions + classes[tri[1]] * 3,
+                            simplifier->positions + classes[tri[2]] * 3, n);
+            for (k = 0; k < 3; k++) edge[k] = pb[k] - pa[k];
+            plane[0] = edge[1] * n[2] - edge[2] * n[1];
+            plane[1] = edge[2] * n[0] - edge[0] * n[2];
+            plane[2] = edge[0] * n[1] - edge[1] * n[0];
+            length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length == 0) break;
+            for (k = 0; k < 3; k++) plane[k] /= length;
+            d = -(plane[0] * pa[0] + plane[1] * pa[1] + plane[2] * pa[2]);
+            length = sqrt(edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+            quadric_add_plane(&simplifier->quadrics[a], plane, d, BORDER_WEIGHT * length * length);
+            quadric_add_plane(&simplifier->quadrics[b], plane, d, BORDER_WEIGHT * length * length);
+            break;
+        }
+    }
+}
+
+/* Border classes may only slide along a border edge onto another border class */
+static int collapse_allowed(const Simplifier *simplifier, uint32_t from, uint32_t to, int border_edge) {
+    if (!simplifier->border[from]) return 1;
+    return simplifier->border[to] && border_edge;
+}
+
+/* True when moving from onto to leaves every surviving triangle facing the same way */
+static int collapse_keeps_orientation(const Simplifier *simplifier, const MeshJob *job, uint32_t from, uint32_t to) {
+    uint32_t i;
+
+    for (i = simplifier->triangle_offsets[from]; i < simplifier->triangle_offsets[from + 1]; i++) {
+        const uint32_t *tri = job->indices + simplifier->triangle_lists[i] * 3;
+        const float *before[3], *after[3];
+        double n0[3], n1[3];
+        int k, touches_to = 0;
+
+        for (k = 0; k < 3; k++) {
+            uint32_t c = simplifier->position_of[tri[k]];
+            touches_to |= c == to;
+            before[k] = simplifier->positions + c * 3;
+            after[k] = c == from ? simplifier->positions + to * 3 : before[k];
+        }
+        if (touches_to) continue;
+
+        triangle_normal(before[0], before[1], before[2], n0);
+        triangle_normal(after[0], after[1], after[2], n1);
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0) return 0;
+    }
+    return 1;
+}
+
+static void lock_neighbourhood(Simplifier *simplifier, const MeshJob *job, uint32_t c) {
+    uint32_t i;
+    int k;
+
+    for (i = simplifier->triangle_offsets[c]; i < simplifier->triangle_offsets[c + 1]; i++) {
+        const uint32_t *tri = job->indices + simplifier->triangle_lists[i] * 3;
+        for (k = 0; k < 3; k++) simplifier->locked[simplifier->position_of[tri[k]]] = 1;
+    }
+}
+
+/* The vertex of class to that v should become: one sharing a triangle with
+ * v across the collapsed edge, else the one with the closest attributes */
+static uint32_t collapse_target(const Simplifier *simplifier, const MeshJob *job, uint32_t v, uint32_t from, uint32_t to) {
+    uint32_t i, best = UINT32_MAX;
+    double best_distance = 0;
+    int k;
+
+    for (i = simplifier->triangle_offsets[from]; i < simplifier->triangle_offsets[from + 1]; i++) {
+        const uint32_t *tri = job->indices + simplifier->triangle_lists[i] * 3;
+        if (tri[0] != v && tri[1] != v && tri[2] != v) continue;
+        for (k = 0; k < 3; k++) {
+            if (simplifier->position_of[tri[k]] == to) return tri[k];
+        }
+    }
+
+    for (i = simplifier->triangle_offsets[to]; i < simplifier->triangle_offsets[to + 1]; i++) {
+        const uint32_t *tri = job->indices + simplifier->triangle_lists[i] * 3;
+        for (k = 0; k < 3; k++) {
+            uint32_t u = tri[k];
+            const float *a = job->vertices + (size_t)u * job->stride, *b = job->vertices + (size_t)v * job->stride;
+            double distance = 0;
+            long f;
+
+            if (simplifier->position_of[u] != to) continue;
+            for (f = 3; f < job->stride; f++) distance += (a[f] - b[f]) * (a[f] - b[f]);
+            if (best == UINT32_MAX || distance < best_distance) {
+                best = u;
+                best_distance = distance;
+            }
+        }
+    }
+    return best;
+}
+
+static void *simplify_without_gvl(void *data) {
+    MeshJob *job = data;
+    Simplifier simplifier;
+    size_t i, pass;
+    double radius = 0, max_cost, pass_cost, reached = 0, center[3] = {0, 0, 0}, min[3], max[3];
+    int k;
+
+    job->ok = 0;
+    memset(&simplifier, 0, sizeof(simplifier));
+    simplifier.position_of = malloc(job->vertex_count * sizeof(uint32_t) + 1);
+    simplifier.vertex_remap = malloc(job->vertex_count * sizeof(uint32_t) + 1);
+    simplifier.positions = malloc(job->vertex_count * 3 * sizeof(float) + 1);
+    simplifier.quadrics = calloc(job->vertex_count + 1, sizeof(Quadric));
+    simplifier.class_remap = malloc(job->vertex_count * sizeof(uint32_t) + 1);
+    simplifier.border = malloc(job->vertex_count + 1);
+    simplifier.locked = malloc(job->vertex_count + 1);
+    simplifier.triangle_offsets = malloc((job->vertex_count + 1) * sizeof(uint32_t));
+    simplifier.triangle_lists = malloc(job->index_count * sizeof(uint32_t) + 1);
+    simplifier.edges = malloc(job->index_count * sizeof(uint64_t) + 1);
+    simplifier.collapses = malloc(job->index_count * sizeof(Collapse) + 1);
+    if (!simplifier.position_of || !simplifier.vertex_remap || !simplifier.positions || !simplifier.quadrics ||
+        !simplifier.class_remap || !simplifier.border || !simplifier.locked || !simplifier.triangle_offsets ||
+        !simplifier.triangle_lists || !simplifier.edges || !simplifier.collapses || !build_position_classes(&simplifier, job)) {
+        simplifier_free(&simplifier);
+        return NULL;
+    }
+
+    /* Errors are relative to the bounding radius, so levels compare across meshes */
+    for (i = 0; i < simplifier.class_count; i++) {
+        for (k = 0; k < 3; k++) {
+            float value = simplifier.positions[i * 3 + k];
+            if (i == 0 || value < min[k]) min[k] = value;
+            if (i == 0 || value > max[k]) max[k] = value;
+        }
+    }
+    for (k = 0; k < 3 && simplifier.class_count > 0; k++) center[k] = (min[k] + max[k]) / 2;
+    for (i = 0; i < simplifier.class_count; i++) {
+        const float *p = simplifier.positions + i * 3;
+        double dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+        double distance = sqrt(dx * dx + dy * dy + dz * dz);
+        if (distance > radius) radius = distance;
+    }
+    max_cost = job->max_error * radius * job->max_error * radius;
+
+    add_triangle_quadrics(&simplifier, job);
+    add_border_quadrics(&simplifier, job, build_topology(&simplifier, job));
+
+    for (pass = 0; pass < MAX_SIMPLIFY_PASSES && job->index_count > job->target_index_count; pass++) {
+        size_t edge_count = build_topology(&simplifier, job), collapse_count = 0, applied = 0, removed = 0, kept = 0;
+        size_t remove_target = (job->index_count - job->target_index_count) / 3;
+
+        for (i = 0; i < edge_count; i++) {
+            uint32_t a = (uint32_t)(simplifier.edges[i] >> 32), b = (uint32_t)(simplifier.edges[i] & 0x7fffffffu);
+            int border_edge = (simplifier.edges[i] & 0x80000000u) != 0;
+            double cost_ab = -1, cost_ba = -1;
+            Collapse *collapse;
+
+            if (collapse_allowed(&simplifier, a, b, border_edge)) {
+                cost_ab = quadric_cost(&simplifier.quadrics[a], &simplifier.quadrics[b], simplifier.positions + b * 3);
+            }
+            if (collapse_allowed(&simplifier, b, a, border_edge)) {
+                cost_ba = quadric_cost(&simplifier.quadrics[a], &simplifier.quadrics[b], simplifier.positions + a * 3);
+            }
+            if (cost_ab < 0 && cost_ba < 0) continue;
+
+            collapse = simplifier.collapses + collapse_count++;
+            if (cost_ba < 0 || (cost_ab >= 0 && cost_ab <= cost_ba)) {
+                collapse->from = a;
+                collapse->to = b;
+                collapse->cost = cost_ab;
+            } else {
+                collapse->from = b;
+                collapse->to = a;
+                collapse->cost = cost_ba;
+            }
+        }
+        qsort(simplifier.collapses, collapse_count, sizeof(Collapse), compare_collapses);
+
+        /* Each collapse removes about two triangles. Locking skips some of
+         * the cheapest, so rather than reaching further down the list for
+         * expensive ones, stop a little past the goal's cost and go again. */
+        pass_cost = max_cost;
+        if (collapse_count > 0) {
+            size_t goal = remove_target / 2 < collapse_count ? remove_target / 2 : collapse_count - 1;
+            if (simplifier.collapses[goal].cost * 1.5 < pass_cost) pass_cost = simplifier.collapses[goal].cost * 1.5;
+        }
+
+        for (i = 0; i < simplifier.class_count; i++) simplifier.class_remap[i] = (uint32_t)i;
+        memset(simplifier.locked, 0, simplifier.class_count);
+
+        for (i = 0; i < collapse_count && removed < remove_target; i++) {
+            const Collapse *collapse = simplifier.collapses + i;
+            uint32_t t;
+
+            if (collapse->cost > pass_cost) break;
+            if (simplifier.locked[collapse->from] || simplifier.locked[collapse->to]) continue;
+            if (!collapse_keeps_orientation(&simplifier, job, collapse->from, collapse->to)) continue;
+
+            for (t = simplifier.triangle_offsets[collapse->from]; t < simplifier.triangle_offsets[collapse->from + 1]; t++) {
+                const uint32_t *tri = job->indices + simplifier.triangle_lists[t] * 3;
+                for (k = 0; k < 3; k++) {
+                    if (simplifier.position_of[tri[k]] == collapse->to) {
+                        removed++;
+                        break;
+                    }
+                }
+            }
+            lock_neighbourhood(&simplifier, job, collapse->from);
+            lock_neighbourhood(&simplifier, job, collapse->to);
+            simplifier.class_remap[collapse->from] = collapse->to;
+            for (k = 0; k < 10; k++) simplifier.quadrics[collapse->to].q[k] += simplifier.quadrics[collapse->from].q[k];
+            simplifier.quadrics[collapse->to].weight += simplifier.quadrics[collapse->from].weight;
+            if (collapse->cost > reached) reached = collapse->cost;
+            applied++;
+        }
+        if (applied == 0) break;
+
+        for (i = 0; i < job->vertex_count; i++) {
+            uint32_t from = simplifier.position_of[i], to = simplifier.class_remap[from];
+            simplifier.vertex_remap[i] = (uint32_t)i;
+            if (to != from) {
+                uint32_t target = collapse_target(&simplifier, job, (uint32_t)i, from, to);
+                if (target != UINT32_MAX) simplifier.vertex_remap[i] = target;
+            }
+        }
+
+        /* Triangles that lost a corner to the collapse are gone */
+        for (i = 0; i < job->index_count; i += 3) {
+            uint32_t a = simplifier.vertex_remap[job->indices[i]];
+            uint32_t b = simplifier.vertex_remap[job->indices[i + 1]];
+            uint32_t c = simplifier.vertex_remap[job->indices[i + 2]];
+            uint32_t ca = simplifier.position_of[a], cb = simplifier.position_of[b], cc = simplifier.position_of[c];
+
+            if (ca == cb || cb == cc || ca == cc) continue;
+            job->indices[kept++] = a;
+            job->indices[kept++] = b;
+            job->indices[kept++] = c;
+        }
+        job->index_count = kept;
+    }
+
+    simplifier_free(&simplifier);
+    job->max_error = radius > 0 ? sqrt(reached) / radius : 0;
+    job->ok = optimize_vertex_cache(job->indices, job->index_count, job->vertex_count);
+    return NULL;
+}
+
+static void mesh_job_free(MeshJob *job) {
+    free(job->vertices);
+    free(job->indices);
+    free(job->level_counts);
+}
+
+/* Copies the Ruby strings into a job, checking every index is in range */
+static void mesh_job_init(MeshJob *job, VALUE vertex_bytes, VALUE index_bytes, VALUE stride_value) {
+    size_t i;
+
+    Check_Type(vertex_bytes, T_STRING);
+    Check_Type(index_bytes, T_STRING);
+    memset(job, 0, sizeof(*job));
+    job->stride = NUM2LONG(stride_value);
+    if (job->stride < 3) rb_raise(rb_eArgError, "stride must be at least 3, got %ld", job->stride);
+    job->vertex_count = RSTRING_LEN(vertex_bytes) / (job->stride * sizeof(float));
+    job->index_count = RSTRING_LEN(index_bytes) / sizeof(uint32_t) / 3 * 3;
+
+    job->vertices = malloc(job->vertex_count * job->stride * sizeof(float) + 1);
+    job->indices = malloc(job->index_count * sizeof(uint32_t) + 1);
+    if (job->vertices == NULL || job->indices == NULL) {
+        mesh_job_free(job);
+        rb_raise(rb_eNoMemError, "out of memory copying mesh");
+    }
+    memcpy(job->vertices, RSTRING_PTR(vertex_bytes), job->vertex_count * job->stride * sizeof(float));
+    memcpy(job->indices, RSTRING_PTR(index_bytes), job->index_count * sizeof(uint32_t));
+
+    for (i = 0; i < job->index_count; i++) {
+        if (job->indices[i] >= job->vertex_count) {
+            uint32_t index = job->indices[i];
+            mesh_job_free(job);
+            rb_raise(rb_eArgError, "index %u is past the last vertex (%lu)", index, (unsigned long)job->vertex_count);
+        }
+    }
+}
+
+static VALUE mesh_job_result(MeshJob *job) {
+    VALUE vertex_bytes, index_bytes;
+
+    if (!job->ok) {
+        mesh_job_free(job);
+        rb_raise(rb_eNoMemError, "out of memory optimizing mesh");
+    }
+    vertex_bytes = rb_str_new((const char *)job->vertices, (long)(job->vertex_count * job->stride * sizeof(float)));
+    index_bytes = rb_str_new((const char *)job->indices, (long)(job->index_count * sizeof(uint32_t)));
+    mesh_job_free(job);
+    return rb_ary_new_from_args(2, vertex_bytes, index_bytes);
+}
+
+/* optimize_mesh(vertex_bytes, index_bytes, stride) -> [vertex_bytes, index_bytes]
+ * index_bytes: uint32 triangle list, in and out */
+static VALUE rb_optimize_mesh(VALUE self, VALUE vertex_bytes, VALUE index_bytes, VALUE stride) {
+    MeshJob job;
+
+    mesh_job_init(&job, vertex_bytes, index_bytes, stride);
+    rb_thread_call_without_gvl(optimize_mesh_without_gvl, &job, NULL, NULL);
+    return mesh_job_result(&job);
+}
+
+/* depth_stream(vertex_bytes, [index_bytes, ...], stride) -> [position_bytes, [index_bytes, ...]]
+ * position_bytes: float32 xyz per welded vertex; one uint32 index list per
+ * LOD level, all indexing the same positions */
+static VALUE rb_depth_stream(VALUE self, VALUE vertex_bytes, VALUE levels, VALUE stride) {
+    MeshJob job;
+    VALUE combined, result, level_indices;
+    size_t *level_counts, start = 0;
+    long level, level_count;
+
+    Check_Type(levels, T_ARRAY);
+    level_count = RARRAY_LEN(levels);
+    combined = rb_str_buf_new(0);
+    for (level = 0; level < level_count; level++) {
+        VALUE indices = rb_ary_entry(levels, level);
+        Check_Type(indices, T_STRING);
+        if (RSTRING_LEN(indices) % (3 * sizeof(uint32_t)) != 0) {
+            rb_raise(rb_eArgError, "level %ld is not a whole number of uint32 triangles", level);
+        }
+        rb_str_buf_append(combined, indices);
+    }
+
+    mesh_job_init(&job, vertex_bytes, combined, stride);
+    level_counts = malloc(level_count * sizeof(size_t) + 1);
+    if (level_counts == NULL) {
+        mesh_job_free(&job);
+        rb_raise(rb_eNoMemError, "out of memory copying mesh");
+    }
+    for (level = 0; level < level_count; level++) {
+        level_counts[level] = RSTRING_LEN(rb_ary_entry(levels, level)) / sizeof(uint32_t);
+    }
+    job.level_counts = level_counts;
+    job.level_count = level_count;
+
+    rb_thread_call_without_gvl(depth_stream_without_gvl, &job, NULL, NULL);
+
+    /* Split the levels back out before mesh_job_result frees the counts */
+    level_indices = rb_ary_new_capa(level_count);
+    if (job.ok) {
+        for (level = 0; level < level_count; level++) {
+            rb_ary_push(level_indices, rb_str_new((const char *)(job.indices + start), (long)(job.level_counts[level] * sizeof(uint32_t))));
+            start += job.level_counts[level];
+        }
+    }
+    result = mesh_job_result(&job);
+    rb_ary_store(result, 1, level_indices);
+    return result;
+}
+
+/* simplify(vertex_bytes, index_bytes, stride, target_index_count, max_error) -> [index_bytes, error]
+ * index_bytes: uint32, into the same vertices, ordered for the vertex
+ * cache. Errors are relative to the mesh's bounding radius. */
+static VALUE rb_simplify(VALUE self, VALUE vertex_bytes, VALUE index_bytes, VALUE stride,
+                         VALUE target_index_count, VALUE max_error) {
+    MeshJob job;
+    VALUE result;
+    double error;
+
+    mesh_job_init(&job, vertex_bytes, index_bytes, stride);
+    job.target_index_count = NUM2SIZET(target_index_count);
+    job.max_error = NUM2DBL(max_error);
+    rb_thread_call_without_gvl(simplify_without_gvl, &job, NULL, NULL);
+    error = job.max_error;
+    result = mesh_job_result(&job);
+    return rb_ary_new_from_args(2, rb_ary_entry(result, 1), DBL2NUM(error));
+}
+
+/* acmr(index_bytes, cache_size = 16) -> Float
+ * Average cache miss ratio: vertices transformed per triangle through a
+ * FIFO post-transform cache, from 3.0 (no reuse) down towards 0.5 */
+static VALUE rb_acmr(int argc, VALUE *argv, VALUE self) {
+    VALUE index_bytes, cache_size_value;
+    const uint32_t *indices;
+    long index_count, cache_size, i, misses = 0, head = 0, filled = 0, j;
+    uint32_t *cache;
+
+    rb_scan_args(argc, argv, "11", &index_bytes, &cache_size_value);
+    Check_Type(index_bytes, T_STRING);
+    cache_size = NIL_P(cache_size_value) ? 16 : NUM2LONG(cache_size_value);
+    if (cache_size < 1) rb_raise(rb_eArgError, "cache_size must be positive, got %ld", cache_size);
+    indices = (const uint32_t *)RSTRING_PTR(index_bytes);
+    index_count = RSTRING_LEN(index_bytes) / (long)sizeof(uint32_t) / 3 * 3;
+    if (index_count == 0) return DBL2NUM(0.0);
+
+    cache = ALLOC_N(uint32_t, cache_size);
+    for (i = 0; i < index_count; i++) {
+        int hit = 0;
+        for (j = 0; j < filled; j++) {
+            if (cache[j] == indices[i]) { hit = 1; break; }
+        }
+        if (hit) continue;
+        misses++;
+        cache[head] = indices[i];
+        head = (head + 1) % cache_size;
+        if (filled < cache_size) filled++;
+    }
+    xfree(cache);
+    return DBL2NUM((double)misses / (index_count / 3));
+}
+
+/*
+ * Textures
+ *
+ * decode_png turns a PNG into 8 bit RGBA with its rows bottom-up, the order
+ * TexImage2D expects for V=0 at the bottom. Every colour type and bit
+ * depth is handled (16 bit channels keep their high byte); interlaced files
+ * are rejected so callers can fall back to a slower decoder. It needs
+ * zlib, and is left out when the extension is built without it. Input is
+ * untrusted: chunk lengths are checked against the file, inflate can't
+ * write past the image it declared, and malformed files raise ArgumentError.
+ *
+ * mipmaps and compress_bc prepare decoded images for upload: the first
+ * builds the chain down to 1x1, the second encodes a level as BC1 (opaque)
+ * or BC3 blocks. Each copies its input and runs without the GVL.
+ *
+ * encode_png and flip_rgba go the other way, for framebuffer readbacks
+ * (bottom-up RGBA from ReadPixels): the first writes a PNG, the second
+ * turns the rows top-down for ChunkyPNG.
+ */
+
+typedef struct {
+    unsigned char *input;
+    size_t input_size;
+    uint32_t width, height;
+    unsigned char *rgba;
+    int with_alpha;
+    Growable levels;
+    char error[128];
+} ImageJob;
+
+static void image_job_free(ImageJob *job) {
+    size_t i;
+
+    free(job->input);
+    free(job->rgba);
+    for (i = 0; i < job->levels.count; i++) free(ARRAY_AT(job->levels, unsigned char *, i));
+    free(job->levels.data);
+}
+
+static int image_fail(ImageJob *job, const char *message) {
+    snprintf(job->error, sizeof(job->error), "%s", message);
+    return 0;
+}
+
+/* Copies a Ruby string into a job's input */
+static void image_job_init(ImageJob *job, VALUE bytes) {
+    Check_Type(bytes, T_STRING);
+    memset(job, 0, sizeof(*job));
+    job->levels.item_size = sizeof(unsigned char *);
+    job->input_size = (size_t)RSTRING_LEN(bytes);
+    job->input = malloc(job->input_size + 1);
+    if (job->input == NULL) rb_raise(rb_eNoMemError, "out of memory copying image");
+    memcpy(job->input, RSTRING_PTR(bytes), job->input_size);
+}
+
+/* Checks an RGBA image's size against width x height */
+static void image_job_dimensions(ImageJob *job, VALUE width, VALUE height) {
+    long w = NUM2LONG(width), h = NUM2LONG(height);
+
+    if (w < 1 || h < 1 || (size_t)w * (size_t)h * 4 != job->input_size) {
+        image_job_free(job);
+        rb_raise(rb_eArgError, "expected %ldx%ld RGBA bytes", w, h);
+    }
+    job->width = (uint32_t)w;
+    job->height = (uint32_t)h;
+}
+
+#ifdef HAVE_ZLIB_H
+
+static const unsigned char PNG_SIGNATURE[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+
+enum { PNG_GRAY = 0, PNG_RGB = 2, PNG_PALETTE = 3, PNG_GRAY_ALPHA = 4, PNG_RGBA = 6 };
+
+typedef struct {
+    int depth, color_type, channels;
+    size_t row_bytes, pixel_bytes;
+    unsigned char palette[256][4];
+    int has_key;
+    unsigned key[3];
+} PngFormat;
+
+static uint32_t read_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int png_channels(int color_type) {
+    switch (color_type) {
+    case PNG_GRAY: case PNG_PALETTE: return 1;
+    case PNG_GRAY_ALPHA: return 2;
+    case PNG_RGB: return 3;
+    case PNG_RGBA: return 4;
+    default: return 0;
+    }
+}
+
+static int png_depth_allowed(int color_type, int depth) {
+    switch (color_type) {
+    case PNG_GRAY: return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+    case PNG_PALETTE: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+    default: return depth == 8 || depth == 16;
+    }
+}
+
+static unsigned png_sample(const unsigned char *row, uint32_t x, int channel, const PngFormat *format) {
+    size_t bit;
+
+    if (format->depth == 8) return row[x * format->channels + channel];
+    if (format->depth == 16) {
+        const unsigned char *p = row + ((size_t)x * format->channels + channel) * 2;
+        return ((unsigned)p[0] << 8) | p[1];
+    }
+    bit = ((size_t)x * format->channels + channel) * format->depth;
+    return (row[bit >> 3] >> (8 - format->depth - (bit & 7))) & ((1u << format->depth) - 1);
+}
+
+/* Scales a sample of any depth to 8 bits */
+static unsigned char png_sample8(unsigned sample, int depth) {
+    if (depth == 16) return (unsigned char)(sample >> 8);
+    if (depth == 8) return (unsigned char)sample;
+    return (unsigned char)(sample * 255 / ((1u << depth) - 1));
+}
+
+static unsigned char paeth(unsigned char a, unsigned char b, unsigned char c) {
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+static int png_unfilter(ImageJob *job, unsigned char *row, const unsigned char *previous, const PngFormat *format) {
+    size_t i, n = format->row_bytes, bpp = format->pixel_bytes;
+    unsigned char filter = row[-1];
+
+    for (i = 0; i < n; i++) {
+        unsigned char a = i >= bpp ? row[i - bpp] : 0;
+        unsigned char b = previous ? previous[i] : 0;
+        unsigned char c = previous && i >= bpp ? previous[i - bpp] : 0;
+
+        switch (filter) {
+        case 0: break;
+        case 1: row[i] += a; break;
+        case 2: row[i] += b; break;
+        case 3: row[i] += (unsigned char)((a + b) / 2); break;
+        case 4: row[i] += paeth(a, b, c); break;
+        default: return image_fail(job, "unknown row filter");
+        }
+    }
+    return 1;
+}
+
+static void png_expand_row(const unsigned char *row, unsigned char *out, uint32_t width, const PngFormat *format) {
+    uint32_t x;
+
+    for (x = 0; x < width; x++, out += 4) {
+        unsigned s0 = png_sample(row, x, 0, format), s1, s2;
+
+        switch (format->color_type) {
+        case PNG_PALETTE:
+            memcpy(out, format->palette[s0], 4);
+            break;
+        case PNG_GRAY:
+            out[0] = out[1] = out[2] = png_sample8(s0, format->depth);
+            out[3] = format->has_key && s0 == format->key[0] ? 0 : 255;
+            break;
+        case PNG_GRAY_ALPHA:
+            out[0] = out[1] = out[2] = png_sample8(s0, format->depth);
+            out[3] = png_sample8(png_sample(row, x, 1, format), format->depth);
+            break;
+        case PNG_RGB:
+            s1 = png_sample(row, x, 1, format);
+            s2 = png_sample(row, x, 2, format);
+            out[0] = png_sample8(s0, format->depth);
+            out[1] = png_sample8(s1, format->depth);
+            out[2] = png_sample8(s2, format->depth);
+            out[3] = format->has_key && s0 == format->key[0] && s1 == format->key[1] && s2 == format->key[2] ? 0 : 255;
+            break;
+        default:
+            out[0] = png_sample8(s0, format->depth);
+            out[1] = png_sample8(png_sample(row, x, 1, format), format->depth);
+            out[2] = png_sample8(png_sample(row, x, 2, format), format->depth);
+            out[3] = png_sample8(png_sample(row, x, 3, format), format->depth);
+        }
+    }
+}
+
+static int png_read_header(ImageJob *job, const unsigned char *data, uint32_t length, PngFormat *format) {
+    int i;
+
+    if (length != 13) return image_fail(job, "malformed IHDR");
+    job->width = read_be32(data);
+    job->height = read_be32(data + 4);
+    format->depth = data[8];
+    format->color_type = data[9];
+    format->channels = png_channels(format->color_type);
+    if (job->width == 0 || job->height == 0 || job->width > 32768 || job->height > 32768) {
+        return image_fail(job, "image size out of range");
+    }
+    if (format->channels == 0 || !png_depth_allowed(format->color_type, format->depth)) {
+        return image_fail(job, "unsupported colour type");
+    }
+    if (data[10] != 0 || data[11] != 0) return image_fail(job, "unknown compression or filter method");
+    if (data[12] != 0) return image_fail(job, "interlaced PNGs are not supported");
+
+    format->row_bytes = ((size_t)job->width * format->channels * format->depth + 7) / 8;
+    format->pixel_bytes = format->channels * format->depth >= 8 ? (size_t)format->channels * format->depth / 8 : 1;
+    for (i = 0; i < 256; i++) {
+        format->palette[i][0] = format->palette[i][1] = format->palette[i][2] = 0;
+        format->palette[i][3] = 255;
+    }
+    return 1;
+}
+
+static void png_read_transparency(const unsigned char *data, uint32_t length, PngFormat *format) {
+    uint32_t i;
+
+    if (format->color_type == PNG_PALETTE) {
+        for (i = 0; i < length && i < 256; i++) format->palette[i][3] = data[i];
+    } else if (format->color_type == PNG_GRAY && length >= 2) {
+        format->has_key = 1;
+        format->key[0] = ((unsigned)data[0] << 8) | data[1];
+    } else if (format->color_type == PNG_RGB && length >= 6) {
+        format->has_key = 1;
+        for (i = 0; i < 3; i++) format->key[i] = ((unsigned)data[i * 2] << 8) | data[i * 2 + 1];
+    }
+}
+
+static int decode_png(ImageJob *job) {
+    const unsigned char *p = job->input, *end = job->input + job->input_size;
+    PngFormat format;
+    z_stream stream;
+    unsigned char *raw = NULL;
+    size_t raw_size = 0, y;
+    int have_header = 0, inflating = 0, finished = 0, ok = 1;
+
+    memset(&format, 0, sizeof(format));
+    memset(&stream, 0, sizeof(stream));
+    if (job->input_size < 8 || memcmp(p, PNG_SIGNATURE, 8) != 0) return image_fail(job, "not a PNG file");
+    p += 8;
+
+    while (ok && end - p >= 12) {
+        uint32_t length = read_be32(p);
+        const unsigned char *type = p + 4, *data = p + 8;
+
+        if ((size_t)(end - data) < (size_t)length + 4) { ok = image_fail(job, "truncated chunk"); break; }
+        p = data + length + 4;
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (have_header) { ok = image_fail(job, "duplicate IHDR"); break; }
+            ok = png_read_header(job, data, length, &format);
+            if (!ok) break;
+            have_header = 1;
+            raw_size = (format.row_bytes + 1) * job->height;
+            /* zlib counts output in uInt */
+            if (raw_size > UINT_MAX) { ok = image_fail(job, "image size out of range"); break; }
+            raw = malloc(raw_size);
+            if (raw == NULL || inflateInit(&stream) != Z_OK) { ok = image_fail(job, "out of memory"); break; }
+            inflating = 1;
+            stream.next_out = raw;
+            stream.avail_out = (uInt)raw_size;
+        } else if (!have_header) {
+            ok = image_fail(job, "missing IHDR");
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            uint32_t i;
+            for (i = 0; i < length / 3 && i < 256; i++) memcpy(format.palette[i], data + i * 3, 3);
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            png_read_transparency(data, length, &format);
+        } else if (memcmp(type, "IDAT", 4) == 0 && !finished) {
+            int status;
+            stream.next_in = (Bytef *)data;
+            stream.avail_in = length;
+            status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) finished = 1;
+            else if (status != Z_OK && status != Z_BUF_ERROR) ok = image_fail(job, "corrupt image data");
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+    }
+
+    if (ok && (!have_header || stream.total_out != raw_size)) ok = image_fail(job, "image data is incomplete");
+    if (ok) {
+        size_t out_row = (size_t)job->width * 4;
+        job->rgba = malloc(out_row * job->height);
+        if (job->rgba == NULL) ok = image_fail(job, "out of memory");
+        for (y = 0; ok && y < job->height; y++) {
+            unsigned char *row = raw + y * (format.row_bytes + 1) + 1;
+            const unsigned char *previous = y > 0 ? row - format.row_bytes - 1 : NULL;
+            ok = png_unfilter(job, row, previous, &format);
+            if (ok) png_expand_row(row, job->rgba + (job->height - 1 - y) * out_row, job->width, &format);
+        }
+    }
+
+    if (inflating) inflateEnd(&stream);
+    free(raw);
+    return ok;
+}
+
+static void *decode_png_without_gvl(void *data) {
+    ImageJob *job = data;
+    return decode_png(job) ? job : NULL;
+}
+
+/* decode_png(png_bytes) -> [width, height, rgba_bytes]
+ * rgba_bytes: 8 bits per channel, rows bottom-up */
+static VALUE rb_decode_png(VALUE self, VALUE png_bytes) {
+    ImageJob job;
+    VALUE rgba;
+
+    image_job_init(&job, png_bytes);
+    if (rb_thread_call_without_gvl(decode_png_without_gvl, &job, NULL, NULL) == NULL) {
+        VALUE message = rb_str_new_cstr(job.error);
+        image_job_free(&job);
+        rb_raise(rb_eArgError, "%" PRIsVALUE, message);
+    }
+    rgba = rb_str_new((const char *)job.rgba, (long)job.width * job.height * 4);
+    image_job_free(&job);
+    return rb_ary_new_from_args(3, UINT2NUM(job.width), UINT2NUM(job.height), rgba);
+}
+
+/* Writes one PNG chunk (length, type, data, CRC) at out, returning the end */
+static unsigned char *png_write_chunk(unsigned char *out, const char *type, const unsigned char *data, uint32_t length) {
+    uLong crc;
+    int i;
+
+    for (i = 0; i < 4; i++) out[i] = (unsigned char)(length >> (24 - i * 8));
+    memcpy(out + 4, type, 4);
+    if (length > 0) memmove(out + 8, data, length);
+    crc = crc32(crc32(0L, Z_NULL, 0), out + 4, length + 4);
+    for (i = 0; i < 4; i++) out[8 + length + i] = (unsigned char)(crc >> (24 - i * 8));
+    return out + 12 + length;
+}
+
+/* Filters every row with Sub, which suits rendered frames and keeps the
+ * encoder a single pass, then deflates the lot into one IDAT */
+static int encode_png(ImageJob *job, int level) {
+    int channels = job->with_alpha ? 4 : 3;
+    size_t row_bytes = (size_t)job->width * channels, raw_size = (row_bytes + 1) * job->height;
+    unsigned char *raw = malloc(raw_size), *out, header[13];
+    uLongf deflated_size = compressBound((uLong)raw_size);
+    uint32_t x, y;
+    int i;
+
+    if (raw == NULL) return image_fail(job, "out of memory");
+    for (y = 0; y < job->height; y++) {
+        const unsigned char *src = job->input + (size_t)(job->height - 1 - y) * job->width * 4;
+        unsigned char *row = raw + y * (row_bytes + 1);
+
+        row[0] = 1;
+        for (x = 0; x < job->width; x++) {
+            for (i = 0; i < channels; i++) {
+                unsigned char left = x > 0 ? src[(x - 1) * 4 + i] : 0;
+                row[1 + x * channels + i] = (unsigned char)(src[x * 4 + i] - left);
+            }
+        }
+    }
+
+    /* signature, IHDR, IDAT and IEND with 12 bytes of framing each */
+    job->rgba = malloc(sizeof(PNG_SIGNATURE) + 25 + 12 + deflated_size + 12);
+    if (job->rgba == NULL) { free(raw); return image_fail(job, "out of memory"); }
+    out = job->rgba + sizeof(PNG_SIGNATURE) + 25 + 8;
+    if (compress2(out, &deflated_size, raw, (uLong)raw_size, level) != Z_OK) {
+        free(raw);
+        return image_fail(job, "deflate failed");
+    }
+    free(raw);
+
+    for (i = 0; i < 4; i++) {
+        header[i] = (unsigned char)(job->width >> (24 - i * 8));
+        header[4 + i] = (unsigned char)(job->height >> (24 - i * 8));
+    }
+    header[8] = 8;
+    header[9] = job->with_alpha ? PNG_RGBA : PNG_RGB;
+    header[10] = header[11] = header[12] = 0;
+
+    memcpy(job->rgba, PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+    out = png_write_chunk(job->rgba + sizeof(PNG_SIGNATURE), "IHDR", header, sizeof(header));
+    /* the IDAT payload was deflated in place, so only its framing is written */
+    out = png_write_chunk(out, "IDAT", out + 8, (uint32_t)deflated_size);
+    out = png_write_chunk(out, "IEND", NULL, 0);
+    job->input_size = (size_t)(out - job->rgba);
+    return 1;
+}
+
+typedef struct {
+    ImageJob *job;
+    int level;
+} EncodeJob;
+
+static void *encode_png_without_gvl(void *data) {
+    EncodeJob *encode = data;
+    return encode_png(encode->job, encode->level) ? encode : NULL;
+}
+
+/* encode_png(rgba_bytes, width, height, with_alpha, level) -> png_bytes
+ * rgba_bytes rows bottom-up, as ReadPixels returns them; without alpha the
+ * PNG is RGB. level is the zlib level, 1 (fastest) to 9 */
+static VALUE rb_encode_png(VALUE self, VALUE rgba_bytes, VALUE width, VALUE height, VALUE with_alpha, VALUE level) {
+    ImageJob job;
+    EncodeJob encode;
+    VALUE png;
+
+    image_job_init(&job, rgba_bytes);
+    image_job_dimensions(&job, width, height);
+    job.with_alpha = RTEST(with_alpha);
+    encode.job = &job;
+    encode.level = NUM2INT(level);
+    if (rb_thread_call_without_gvl(encode_png_without_gvl, &encode, NULL, NULL) == NULL) {
+        VALUE message = rb_str_new_cstr(job.error);
+        image_job_free(&job);
+        rb_raise(rb_eRuntimeError, "%" PRIsVALUE, message);
+    }
+    png = rb_str_new((const char *)job.rgba, (long)job.input_size);
+    image_job_free(&job);
+    return png;
+}
+
+#endif
+
+/* Halves an RGBA level with a 2x2 box filter weighted by alpha, so fully
+ * transparent texels don't bleed their colour into the level below */
+static void downsample(const unsigned char *src, uint32_t width, uint32_t height, unsigned char *dst) {
+    uint32_t next_width = width > 1 ? width / 2 : 1, next_height = height > 1 ? height / 2 : 1, x, y;
+    int c;
+
+    for (y = 0; y < next_height; y++) {
+        uint32_t y0 = y * 2, y1 = y0 + 1 < height ? y0 + 1 : y0;
+        for (x = 0; x < next_width; x++) {
+            uint32_t x0 = x * 2, x1 = x0 + 1 < width ? x0 + 1 : x0;
+            const unsigned char *texels[4] = {
+                src + ((size_t)y0 * width + x0) * 4, src + ((size_t)y0 * width + x1) * 4,
+                src + ((size_t)y1 * width + x0) * 4, src + ((size_t)y1 * width + x1) * 4
+            };
+            unsigned char *out = dst + ((size_t)y * next_width + x) * 4;
+            unsigned alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+
+            for (c = 0; c < 3; c++) {
+                if (alpha > 0) {
+                    unsigned sum = texels[0][c] * texels[0][3] + texels[1][c] * texels[1][3] +
+                                   texels[2][c] * texels[2][3] + texels[3][c] * texels[3][3];
+                    out[c] = (unsigned char)((sum + alpha / 2) / alpha);
+                } else {
+                    out[c] = (unsigned char)((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                }
+            }
+            out[3] = (unsigned char)((alpha + 2) / 4);
+        }
+    }
+}
+
+static void *mipmaps_without_gvl(void *data) {
+    ImageJob *job = data;
+    const unsigned char *level = job->input;
+    uint32_t width = job->width, height = job->height;
+
+    while (width > 1 || height > 1) {
+        uint32_t next_width = width > 1 ? width / 2 : 1, next_height = height > 1 ? height / 2 : 1;
+        unsigned char *next = malloc((size_t)next_width * next_height * 4);
+        unsigned char **slot;
+
+        if (next == NULL) return NULL;
+        slot = array_push(&job->levels);
+        if (slot == NULL) { free(next); return NULL; }
+        *slot = next;
+        downsample(level, width, height, next);
+        level = next;
+        width = next_width;
+        height = next_height;
+    }
+    return job;
+}
+
+/* mipmaps(rgba_bytes, width, height) -> [rgba_bytes per level]
+ * every level below the given one, halving down to 1x1 */
+static VALUE rb_mipmaps(VALUE self, VALUE rgba_bytes, VALUE width_value, VALUE height_value) {
+    ImageJob job;
+    VALUE levels;
+    uint32_t width, height;
+    size_t i;
+
+    image_job_init(&job, rgba_bytes);
+    image_job_dimensions(&job, width_value, height_value);
+    if (rb_thread_call_without_gvl(mipmaps_without_gvl, &job, NULL, NULL) == NULL) {
+        image_job_free(&job);
+        rb_raise(rb_eNoMemError, "out of memory building mipmaps");
+    }
+
+    levels = rb_ary_new_capa((long)job.levels.count);
+    width = job.width;
+    height = job.height;
+    for (i = 0; i < job.levels.count; i++) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        rb_ary_push(levels, rb_str_new((const char *)ARRAY_AT(job.levels, unsigned char *, i), (long)width * height * 4));
+    }
+    image_job_free(&job);
+    return levels;
+}
+
+/* RGB565 and back, replicating the high bits into the low ones like the GPU */
+static uint16_t pack565(const int rgb[3]) {
+    return (uint16_t)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+}
+
+static void unpack565(uint16_t packed, int rgb[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/* BC1 colour block from the texels' bounding box, inset by 1/16 per side
+ * to keep outliers from stretching the endpoints */
+static void encode_color_block(unsigned char texels[16][4], unsigned char *out) {
+    int min[3] = {255, 255, 255}, max[3] = {0, 0, 0}, palette[4][3], c, i;
+    uint16_t c0, c1;
+    uint32_t indices = 0;
+
+    for (i = 0; i < 16; i++) {
+        for (c = 0; c < 3; c++) {
+            if (texels[i][c] < min[c]) min[c] = texels[i][c];
+            if (texels[i][c] > max[c]) max[c] = texels[i][c];
+        }
+    }
+    for (c = 0; c < 3; c++) {
+        int inset = (max[c] - min[c]) >> 4;
+        min[c] += inset;
+        max[c] -= inset;
+    }
+    /* Each channel of max is >= min's, so c0 >= c1: the four colour mode */
+    c0 = pack565(max);
+    c1 = pack565(min);
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    if (c0 != c1) {
+        for (i = 0; i < 16; i++) {
+            int best = 0, best_distance = INT32_MAX, k;
+            for (k = 0; k < 4; k++) {
+                int distance = 0;
+                for (c = 0; c < 3; c++) distance += (texels[i][c] - palette[k][c]) * (texels[i][c] - palette[k][c]);
+                if (distance < best_distance) { best_distance = distance; best = k; }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+
+    out[0] = c0 & 0xff; out[1] = c0 >> 8;
+    out[2] = c1 & 0xff; out[3] = c1 >> 8;
+    for (i = 0; i < 4; i++) out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+/* BC3 alpha block: two endpoints and six values between them */
+static void encode_alpha_block(unsigned char texels[16][4], unsigned char *out) {
+    int min = 255, max = 0, palette[8], i, k;
+    uint64_t indices = 0;
+
+    for (i = 0; i < 16; i++) {
+        if (texels[i][3] < min) min = texels[i][3];
+        if (texels[i][3] > max) max = texels[i][3];
+    }
+    palette[0] = max;
+    palette[1] = min;
+    for (k = 1; k < 7; k++) palette[k + 1] = ((7 - k) * max + k * min) / 7;
+
+    if (max != min) {
+        for (i = 0; i < 16; i++) {
+            int best = 0, best_distance = 256;
+            for (k = 0; k < 8; k++) {
+                int distance = abs(texels[i][3] - palette[k]);
+                if (distance < best_distance) { best_distance = distance; best = k; }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+
+    out[0] = (unsigned char)max;
+    out[1] = (unsigned char)min;
+    for (i = 0; i < 6; i++) out[2 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+static void *compress_without_gvl(void *data) {
+    ImageJob *job = data;
+    uint32_t blocks_x = (job->width + 3) / 4, blocks_y = (job->height + 3) / 4, bx, by, x, y;
+    size_t block_size = job->with_alpha ? 16 : 8;
+    unsigned char texels[16][4];
+
+    job->rgba = malloc((size_t)blocks_x * blocks_y * block_size);
+    if (job->rgba == NULL) return NULL;
+
+    for (by = 0; by < blocks_y; by++) {
+        for (bx = 0; bx < blocks_x; bx++) {
+            unsigned char *out = job->rgba + ((size_t)by * blocks_x + bx) * block_size;
+            /* Edge blocks repeat the last row and column */
+            for (y = 0; y < 4; y++) {
+                uint32_t sy = by * 4 + y < job->height ? by * 4 + y : job->height - 1;
+                for (x = 0; x < 4; x++) {
+                    uint32_t sx = bx * 4 + x < job->width ? bx * 4 + x : job->width - 1;
+                    memcpy(texels[y * 4 + x], job->input + ((size_t)sy * job->width + sx) * 4, 4);
+                }
+            }
+            if (job->with_alpha) {
+                encode_alpha_block(texels, out);
+                out += 8;
+            }
+            encode_color_block(texels, out);
+        }
+    }
+    return job;
+}
+
+/* compress_bc(rgba_bytes, width, height, with_alpha) -> block_bytes
+ * BC3 (DXT5) blocks with alpha, BC1 (DXT1) blocks without */
+static VALUE rb_compress_bc(VALUE self, VALUE rgba_bytes, VALUE width, VALUE height, VALUE with_alpha) {
+    ImageJob job;
+    VALUE blocks;
+    long size;
+
+    image_job_init(&job, rgba_bytes);
+    image_job_dimensions(&job, width, height);
+    job.with_alpha = RTEST(with_alpha);
+    if (rb_thread_call_without_gvl(compress_without_gvl, &job, NULL, NULL) == NULL) {
+        image_job_free(&job);
+        rb_raise(rb_eNoMemError, "out of memory compressing texture");
+    }
+    size = (long)((job.width + 3) / 4) * ((job.height + 3) / 4) * (job.with_alpha ? 16 : 8);
+    blocks = rb_str_new((const char *)job.rgba, size);
+    image_job_free(&job);
+    return blocks;
+}
+
+/* opaque?(rgba_bytes) -> true when every alpha byte is 255 */
+static VALUE rb_opaque(VALUE self, VALUE rgba_bytes) {
+    const unsigned char *data;
+    long i, length;
+
+    Check_Type(rgba_bytes, T_STRING);
+    data = (const unsigned char *)RSTRING_PTR(rgba_bytes);
+    length = RSTRING_LEN(rgba_bytes) / 4 * 4;
+    for (i = 3; i < length; i += 4) {
+        if (data[i] != 255) return Qfalse;
+    }
+    return Qtrue;
+}
+
+static void *flip_rgba_without_gvl(void *data) {
+    ImageJob *job = data;
+    size_t row_bytes = (size_t)job->width * 4, i;
+    uint32_t y;
+
+    job->rgba = malloc(job->input_size);
+    if (job->rgba == NULL) return NULL;
+    for (y = 0; y < job->height; y++) {
+        memcpy(job->rgba + (size_t)y * row_bytes, job->input + (size_t)(job->height - 1 - y) * row_bytes, row_bytes);
+    }
+    if (!job->with_alpha) {
+        for (i = 3; i < job->input_size; i += 4) job->rgba[i] = 255;
+    }
+    return job;
+}
+
+/* flip_rgba(rgba_bytes, width, height, opaque) -> rgba_bytes with the rows
+ * in the opposite order; opaque sets every alpha byte to 255 */
+static VALUE rb_flip_rgba(VALUE self, VALUE rgba_bytes, VALUE width, VALUE height, VALUE opaque) {
+    ImageJob job;
+    VALUE flipped;
+
+    image_job_init(&job, rgba_bytes);
+    image_job_dimensions(&job, width, height);
+    job.with_alpha = !RTEST(opaque);
+    if (rb_thread_call_without_gvl(flip_rgba_without_gvl, &job, NULL, NULL) == NULL) {
+        image_job_free(&job);
+        rb_raise(rb_eNoMemError, "out of memory flipping image");
+    }
+    flipped = rb_str_new((const char *)job.rgba, (long)job.input_size);
+    image_job_free(&job);
+    return flipped;
+}
+
+/* Extension init */
+void Init_asset_native(void) {
+    mAssetNative = rb_define_module("AssetNative");
+
+    cMappedFile = rb_define_class_under(mAssetNative, "MappedFile", rb_cObject);
+    id_mapped_file = rb_intern("__mapped_file__");
+    rb_define_alloc_func(cMappedFile, mapped_file_alloc);
+    rb_define_method(cMappedFile, "initialize", rb_mapped_file_initialize, 1);
+    rb_define_method(cMappedFile, "size", rb_mapped_file_size, 0);
+    rb_define_method(cMappedFile, "slice", rb_mapped_file_slice, 2);
+
+    rb_define_module_function(mAssetNative, "import_obj", rb_import_obj, -1);
+    rb_define_module_function(mAssetNative, "vertex_bounds", rb_vertex_bounds, 2);
+    rb_define_module_function(mAssetNative, "optimize_mesh", rb_optimize_mesh, 3);
+    rb_define_module_function(mAssetNative, "depth_stream", rb_depth_stream, 3);
+    rb_define_module_function(mAssetNative, "simplify", rb_simplify, 5);
+    rb_define_module_function(mAssetNative, "acmr", rb_acmr, -1);
+
+#ifdef HAVE_ZLIB_H
+    rb_define_module_function(mAssetNative, "decode_png", rb_decode_png, 1);
+    rb_define_module_function(mAssetNative, "encode_png", rb_encode_png, 5);
+#endif
+    rb_define_module_function(mAssetNative, "mipmaps", rb_mipmaps, 3);
+    rb_define_module_function(mAssetNative, "compress_bc", rb_compress_bc, 4);
+    rb_define_module_function(mAssetNative, "opaque?", rb_opaque, 1);
+    rb_define_module_function(mAssetNative, "flip_rgba", rb_flip_rgba, 4);
+}
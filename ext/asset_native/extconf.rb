@@ -0,0 +1,11 @@
+# frozen_string_literal: true
+
+require 'mkmf'
+
+# Pure C (no GL dependency) - asset file access and decoding
+$CFLAGS << " -O3" unless RUBY_PLATFORM =~ /mswin/
+
+# PNG decoding needs zlib; without it Texture falls back to ChunkyPNG
+have_library('z', 'inflate') && have_header('zlib.h')
+
+create_makefile('asset_native')
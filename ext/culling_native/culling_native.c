@@ -0,0 +1,292 @@
+#include <ruby.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+
+/*
+ * Frustum culling for instanced batches.
+ *
+ * Input is an InstanceRenderer's packed instance data: float32 model
+ * matrices in the engine's row-vector convention (v' = v * M), stored
+ * row-major. Each instance's world bounding sphere is tested against a set
+ * of planes and the matrices of the visible instances are copied, in order,
+ * into an output string ready to upload as a compacted instance buffer.
+ *
+ * The work is split into passes over structure-of-arrays scratch storage so
+ * the plane tests run as straight-line loops the compiler can vectorize.
+ *
+ * Batches whose mesh has LOD levels keep one level byte per instance.
+ * select_lods updates them from each sphere's size on screen, and
+ * cull_spheres can then split the visible matrices into one output per
+ * level, optionally biased coarser (for shadow passes).
+ */
+
+#define FLOATS_PER_MATRIX 16
+#define BYTES_PER_MATRIX (FLOATS_PER_MATRIX * sizeof(float))
+#define FLOATS_PER_PLANE 4
+#define MAX_PLANES 8
+#define MAX_LODS 8
+#define FLOATS_PER_VIEW 5
+
+/* Module reference */
+static VALUE mCullingNative;
+
+/* Scratch storage, grown to the largest batch seen */
+static float *center_x, *center_y, *center_z, *radius;
+static uint8_t *visible;
+static long scratch_capacity = 0;
+
+static void ensure_scratch(long count) {
+    if (count <= scratch_capacity) return;
+
+    long new_capacity = scratch_capacity > 0 ? scratch_capacity : 1024;
+    while (new_capacity < count) new_capacity *= 2;
+
+    REALLOC_N(center_x, float, new_capacity);
+    REALLOC_N(center_y, float, new_capacity);
+    REALLOC_N(center_z, float, new_capacity);
+    REALLOC_N(radius, float, new_capacity);
+    REALLOC_N(visible, uint8_t, new_capacity);
+    scratch_capacity = new_capacity;
+}
+
+/* Moves the local sphere into world space. Rows 0-2 are the scaled axes, so
+ * the largest row length bounds any non-uniform scale. */
+static void transform_spheres(const float *matrices, long count, float cx, float cy, float cz, float r) {
+    for (long i = 0; i < count; i++) {
+        const float *m = matrices + i * FLOATS_PER_MATRIX;
+
+        center_x[i] = cx * m[0] + cy * m[4] + cz * m[8] + m[12];
+        center_y[i] = cx * m[1] + cy * m[5] + cz * m[9] + m[13];
+        center_z[i] = cx * m[2] + cy * m[6] + cz * m[10] + m[14];
+
+        float sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+        float sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+        float sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+        float s = sx > sy ? sx : sy;
+        s = s > sz ? s : sz;
+        radius[i] = r * sqrtf(s);
+    }
+}
+
+/* Planes are normalized, so the signed distance is in world units */
+static void test_planes(long count, const float *planes, long plane_count) {
+    const float *restrict xs = center_x;
+    const float *restrict ys = center_y;
+    const float *restrict zs = center_z;
+    const float *restrict rs = radius;
+    uint8_t *restrict mask = visible;
+
+    memset(mask, 1, count);
+
+    for (long p = 0; p < plane_count; p++) {
+        const float a = planes[p * FLOATS_PER_PLANE];
+        const float b = planes[p * FLOATS_PER_PLANE + 1];
+        const float c = planes[p * FLOATS_PER_PLANE + 2];
+        const float d = planes[p * FLOATS_PER_PLANE + 3];
+
+        for (long i = 0; i < count; i++) {
+            float distance = a * xs[i] + b * ys[i] + c * zs[i] + d;
+            mask[i] &= (uint8_t)(distance >= -rs[i]);
+        }
+    }
+}
+
+static void check_instances(VALUE matrices, long count) {
+    Check_Type(matrices, T_STRING);
+    if (count < 0 || count * (long)BYTES_PER_MATRIX > RSTRING_LEN(matrices)) {
+        rb_raise(rb_eArgError, "%ld instances do not fit in %ld bytes", count, RSTRING_LEN(matrices));
+    }
+}
+
+static void check_lods(VALUE lods, long count) {
+    Check_Type(lods, T_STRING);
+    if (RSTRING_LEN(lods) < count) {
+        rb_raise(rb_eArgError, "%ld instances need %ld level bytes, got %ld", count, count, RSTRING_LEN(lods));
+    }
+}
+
+/* Makes out empty with room for bytes without reallocating each pass */
+static void reserve_output(VALUE out, long bytes) {
+    rb_str_modify(out);
+    if ((long)rb_str_capacity(out) < bytes) {
+        rb_str_modify_expand(out, bytes - RSTRING_LEN(out));
+    }
+    rb_str_set_len(out, 0);
+}
+
+/* Copies the visible matrices of each level into its output string */
+static long split_by_level(const float *source, long count, const uint8_t *lods, long bias, VALUE outs) {
+    long level_count = RARRAY_LEN(outs), counts[MAX_LODS] = {0}, level, i, total = 0;
+    char *destinations[MAX_LODS];
+
+    for (i = 0; i < count; i++) {
+        if (!visible[i]) continue;
+        level = lods[i] + bias;
+        counts[level < level_count ? level : level_count - 1]++;
+    }
+    for (level = 0; level < level_count; level++) {
+        VALUE out = RARRAY_AREF(outs, level);
+        reserve_output(out, counts[level] * (long)BYTES_PER_MATRIX);
+        rb_str_set_len(out, counts[level] * (long)BYTES_PER_MATRIX);
+        destinations[level] = RSTRING_PTR(out);
+        total += counts[level];
+    }
+    for (i = 0; i < count; i++) {
+        if (!visible[i]) continue;
+        level = lods[i] + bias;
+        level = level < level_count ? level : level_count - 1;
+        memcpy(destinations[level], source + i * FLOATS_PER_MATRIX, BYTES_PER_MATRIX);
+        destinations[level] += BYTES_PER_MATRIX;
+    }
+    return total;
+}
+
+/* cull_spheres(matrices, count, center_x, center_y, center_z, radius, planes, out, lods = nil, bias = 0) -> visible count
+ * planes: packed float32 (a, b, c, d) per plane, normals pointing inwards
+ * out: replaced with the visible instances' matrices
+ * With lods (one level byte per instance, see select_lods), out is an array
+ * with a string per level; each instance goes to its level plus bias,
+ * clamped to the coarsest. */
+static VALUE rb_cull_spheres(int argc, VALUE *argv, VALUE self) {
+    VALUE matrices, count_value, cx, cy, cz, radius_value, planes, out, lods, bias_value;
+
+    rb_scan_args(argc, argv, "82", &matrices, &count_value, &cx, &cy, &cz, &radius_value, &planes, &out, &lods, &bias_value);
+
+    long count = NUM2LONG(count_value);
+    float local_x = (float)NUM2DBL(cx);
+    float local_y = (float)NUM2DBL(cy);
+    float local_z = (float)NUM2DBL(cz);
+    float local_radius = (float)NUM2DBL(radius_value);
+    long bias = NIL_P(bias_value) ? 0 : NUM2LONG(bias_value);
+
+    check_instances(matrices, count);
+    Check_Type(planes, T_STRING);
+    if (NIL_P(lods)) {
+        Check_Type(out, T_STRING);
+    } else {
+        check_lods(lods, count);
+        Check_Type(out, T_ARRAY);
+        if (RARRAY_LEN(out) < 1 || RARRAY_LEN(out) > MAX_LODS) {
+            rb_raise(rb_eArgError, "expected 1 to %d level outputs, got %ld", MAX_LODS, RARRAY_LEN(out));
+        }
+        for (long level = 0; level < RARRAY_LEN(out); level++) Check_Type(RARRAY_AREF(out, level), T_STRING);
+        if (bias < 0) rb_raise(rb_eArgError, "bias must not be negative, got %ld", bias);
+    }
+
+    long plane_bytes = RSTRING_LEN(planes);
+    long plane_count = plane_bytes / (long)(FLOATS_PER_PLANE * sizeof(float));
+    if (plane_bytes % (long)(FLOATS_PER_PLANE * sizeof(float)) != 0 || plane_count > MAX_PLANES) {
+        rb_raise(rb_eArgError, "expected up to %d packed planes, got %ld bytes", MAX_PLANES, plane_bytes);
+    }
+
+    if (count == 0) {
+        if (NIL_P(lods)) {
+            reserve_output(out, 0);
+        } else {
+            for (long level = 0; level < RARRAY_LEN(out); level++) reserve_output(RARRAY_AREF(out, level), 0);
+        }
+        return INT2FIX(0);
+    }
+
+    ensure_scratch(count);
+
+    const float *source = (const float *)RSTRING_PTR(matrices);
+    transform_spheres(source, count, local_x, local_y, local_z, local_radius);
+    test_planes(count, (const float *)RSTRING_PTR(planes), plane_count);
+
+    if (!NIL_P(lods)) {
+        return LONG2NUM(split_by_level(source, count, (const uint8_t *)RSTRING_PTR(lods), bias, out));
+    }
+
+    /* Grow only: the same output string is reused every pass */
+    reserve_output(out, count * (long)BYTES_PER_MATRIX);
+
+    char *destination = RSTRING_PTR(out);
+    long visible_count = 0;
+    for (long i = 0; i < count; i++) {
+        if (!visible[i]) continue;
+
+        memcpy(destination + visible_count * BYTES_PER_MATRIX, source + i * FLOATS_PER_MATRIX, BYTES_PER_MATRIX);
+        visible_count++;
+    }
+    rb_str_set_len(out, visible_count * (long)BYTES_PER_MATRIX);
+
+    return LONG2NUM(visible_count);
+}
+
+/* select_lods(matrices, count, center_x, center_y, center_z, radius, view, lod_errors, pixel_error, hysteresis, lods) -> lods
+ * view: packed float32 eye x, y, z, pixels per world unit (at distance 1
+ * when perspective) and perspective (1 or 0)
+ * lod_errors: packed float32 per level, as a fraction of the local radius
+ * lods: one byte per instance, the level drawn last frame, updated in place
+ *
+ * Each instance takes the coarsest level whose error stays under
+ * pixel_error on screen. Hysteresis keeps the current level until a
+ * coarser one is under pixel_error * (1 - hysteresis), so instances near a
+ * threshold don't flicker between levels. */
+static VALUE rb_select_lods(VALUE self, VALUE matrices, VALUE count_value,
+                            VALUE cx, VALUE cy, VALUE cz, VALUE radius_value,
+                            VALUE view, VALUE lod_errors, VALUE pixel_error_value,
+                            VALUE hysteresis_value, VALUE lods) {
+    long count = NUM2LONG(count_value);
+    float pixel_error = (float)NUM2DBL(pixel_error_value);
+    float switch_error = pixel_error * (1.0f - (float)NUM2DBL(hysteresis_value));
+
+    check_instances(matrices, count);
+    check_lods(lods, count);
+    Check_Type(view, T_STRING);
+    Check_Type(lod_errors, T_STRING);
+    if (RSTRING_LEN(view) != FLOATS_PER_VIEW * (long)sizeof(float)) {
+        rb_raise(rb_eArgError, "expected %d packed view floats, got %ld bytes", FLOATS_PER_VIEW, RSTRING_LEN(view));
+    }
+    long level_count = RSTRING_LEN(lod_errors) / (long)sizeof(float);
+    if (level_count < 1 || level_count > MAX_LODS) {
+        rb_raise(rb_eArgError, "expected 1 to %d level errors, got %ld", MAX_LODS, level_count);
+    }
+    rb_str_modify(lods);
+    if (count == 0) return lods;
+
+    const float *eye = (const float *)RSTRING_PTR(view);
+    const float scale = eye[3];
+    const int perspective = eye[4] != 0.0f;
+    const float *errors = (const float *)RSTRING_PTR(lod_errors);
+    uint8_t *levels = (uint8_t *)RSTRING_PTR(lods);
+
+    ensure_scratch(count);
+    transform_spheres((const float *)RSTRING_PTR(matrices), count,
+                      (float)NUM2DBL(cx), (float)NUM2DBL(cy), (float)NUM2DBL(cz), (float)NUM2DBL(radius_value));
+
+    for (long i = 0; i < count; i++) {
+        float pixels = radius[i] * scale;
+
+        if (perspective) {
+            float dx = center_x[i] - eye[0], dy = center_y[i] - eye[1], dz = center_z[i] - eye[2];
+            float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+            /* Inside the sphere the mesh fills the screen */
+            pixels = distance > radius[i] ? pixels / distance : INFINITY;
+        }
+
+        long allowed = 0, coarser = 0;
+        for (long level = 1; level < level_count; level++) {
+            float error = errors[level] * pixels;
+            if (error <= pixel_error) allowed = level;
+            if (error <= switch_error) coarser = level;
+        }
+
+        long current = levels[i] < level_count ? levels[i] : level_count - 1;
+        if (current > allowed) current = allowed;
+        if (current < coarser) current = coarser;
+        levels[i] = (uint8_t)current;
+    }
+
+    return lods;
+}
+
+/* Extension init */
+void Init_culling_native(void) {
+    mCullingNative = rb_define_module("CullingNative");
+
+    rb_define_module_function(mCullingNative, "cull_spheres", rb_cull_spheres, -1);
+    rb_define_module_function(mCullingNative, "select_lods", rb_select_lods, 11);
+}
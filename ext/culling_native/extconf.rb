@@ -0,0 +1,9 @@
+# frozen_string_literal: true
+
+require 'mkmf'
+
+# Pure C (no GL dependency) - culling only reads packed matrices.
+# -fno-math-errno lets sqrtf inline so the sphere loop vectorizes.
+$CFLAGS << " -O3 -fno-math-errno" unless RUBY_PLATFORM =~ /mswin/
+
+create_makefile('culling_native')
@@ -1,4 +1,6 @@
 #include <ruby.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifdef __APPLE__
 #include <OpenGL/gl3.h>
@@ -33,6 +35,12 @@ static VALUE rb_gl_bind_buffer(VALUE self, VALUE target, VALUE buffer) {
     return Qnil;
 }
 
+/* BindBufferBase(target, index, buffer) */
+static VALUE rb_gl_bind_buffer_base(VALUE self, VALUE target, VALUE index, VALUE buffer) {
+    glBindBufferBase((GLenum)NUM2INT(target), (GLuint)NUM2UINT(index), (GLuint)NUM2UINT(buffer));
+    return Qnil;
+}
+
 /* BindTexture(target, texture) */
 static VALUE rb_gl_bind_texture(VALUE self, VALUE target, VALUE texture) {
     glBindTexture((GLenum)NUM2INT(target), (GLuint)NUM2UINT(texture));
@@ -123,6 +131,46 @@ static VALUE rb_gl_uniform1i(VALUE self, VALUE location, VALUE v0) {
     return Qnil;
 }
 
+/* Uniform1fv(location, count, value) */
+static VALUE rb_gl_uniform1fv(VALUE self, VALUE location, VALUE count, VALUE value) {
+    /* value should be a String containing packed floats */
+    Check_Type(value, T_STRING);
+    glUniform1fv((GLint)NUM2INT(location), (GLsizei)NUM2INT(count), (const GLfloat *)RSTRING_PTR(value));
+    return Qnil;
+}
+
+/* Uniform2fv(location, count, value) */
+static VALUE rb_gl_uniform2fv(VALUE self, VALUE location, VALUE count, VALUE value) {
+    /* value should be a String containing packed floats */
+    Check_Type(value, T_STRING);
+    glUniform2fv((GLint)NUM2INT(location), (GLsizei)NUM2INT(count), (const GLfloat *)RSTRING_PTR(value));
+    return Qnil;
+}
+
+/* Uniform3fv(location, count, value) */
+static VALUE rb_gl_uniform3fv(VALUE self, VALUE location, VALUE count, VALUE value) {
+    /* value should be a String containing packed floats */
+    Check_Type(value, T_STRING);
+    glUniform3fv((GLint)NUM2INT(location), (GLsizei)NUM2INT(count), (const GLfloat *)RSTRING_PTR(value));
+    return Qnil;
+}
+
+/* Uniform4fv(location, count, value) */
+static VALUE rb_gl_uniform4fv(VALUE self, VALUE location, VALUE count, VALUE value) {
+    /* value should be a String containing packed floats */
+    Check_Type(value, T_STRING);
+    glUniform4fv((GLint)NUM2INT(location), (GLsizei)NUM2INT(count), (const GLfloat *)RSTRING_PTR(value));
+    return Qnil;
+}
+
+/* Uniform1iv(location, count, value) */
+static VALUE rb_gl_uniform1iv(VALUE self, VALUE location, VALUE count, VALUE value) {
+    /* value should be a String containing packed ints */
+    Check_Type(value, T_STRING);
+    glUniform1iv((GLint)NUM2INT(location), (GLsizei)NUM2INT(count), (const GLint *)RSTRING_PTR(value));
+    return Qnil;
+}
+
 /* UniformMatrix4fv(location, count, transpose, value) */
 static VALUE rb_gl_uniform_matrix4fv(VALUE self, VALUE location, VALUE count, VALUE transpose, VALUE value) {
     /* value should be a String containing packed floats */
@@ -132,6 +180,12 @@ static VALUE rb_gl_uniform_matrix4fv(VALUE self, VALUE location, VALUE count, VA
     return Qnil;
 }
 
+/* UniformBlockBinding(program, block_index, binding) */
+static VALUE rb_gl_uniform_block_binding(VALUE self, VALUE program, VALUE block_index, VALUE binding) {
+    glUniformBlockBinding((GLuint)NUM2UINT(program), (GLuint)NUM2UINT(block_index), (GLuint)NUM2UINT(binding));
+    return Qnil;
+}
+
 /* BlitFramebuffer(...) */
 static VALUE rb_gl_blit_framebuffer(VALUE self, VALUE src_x0, VALUE src_y0, VALUE src_x1, VALUE src_y1,
                                      VALUE dst_x0, VALUE dst_y0, VALUE dst_x1, VALUE dst_y1,
@@ -176,6 +230,87 @@ static VALUE rb_gl_buffer_sub_data(VALUE self, VALUE target, VALUE offset, VALUE
     return Qnil;
 }
 
+/* BufferStorage(target, size, data, flags) - OpenGL 4.4 / ARB_buffer_storage */
+static VALUE rb_gl_buffer_storage(VALUE self, VALUE target, VALUE size, VALUE data, VALUE flags) {
+#ifdef __APPLE__
+    rb_raise(rb_eNotImpError, "glBufferStorage is not available on macOS");
+#else
+    const void *ptr = NIL_P(data) ? NULL : (const void *)RSTRING_PTR(data);
+    glBufferStorage((GLenum)NUM2INT(target), (GLsizeiptr)NUM2LONG(size), ptr, (GLbitfield)NUM2UINT(flags));
+#endif
+    return Qnil;
+}
+
+/* BufferStorageSupported() - whether immutable, persistently mappable storage is available */
+static VALUE rb_gl_buffer_storage_supported(VALUE self) {
+#if defined(_WIN32) || defined(__MINGW32__) || defined(__linux__)
+    return (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) ? Qtrue : Qfalse;
+#else
+    return Qfalse;
+#endif
+}
+
+/* MapBufferRange(target, offset, length, access) -> address of the mapping */
+static VALUE rb_gl_map_buffer_range(VALUE self, VALUE target, VALUE offset, VALUE length, VALUE access) {
+    void *ptr = glMapBufferRange((GLenum)NUM2INT(target), (GLintptr)NUM2LONG(offset), (GLsizeiptr)NUM2LONG(length), (GLbitfield)NUM2UINT(access));
+    return ULL2NUM((unsigned long long)(uintptr_t)ptr);
+}
+
+/* UnmapBuffer(target) */
+static VALUE rb_gl_unmap_buffer(VALUE self, VALUE target) {
+    return glUnmapBuffer((GLenum)NUM2INT(target)) ? Qtrue : Qfalse;
+}
+
+/* WriteMappedBuffer(address, offset, data, data_offset, length) - memcpy into a mapped buffer */
+static VALUE rb_gl_write_mapped_buffer(VALUE self, VALUE address, VALUE offset, VALUE data, VALUE data_offset, VALUE length) {
+    char *dst = (char *)(uintptr_t)NUM2ULL(address);
+    long src_offset = NUM2LONG(data_offset);
+    long len = NUM2LONG(length);
+
+    Check_Type(data, T_STRING);
+    if (dst == NULL) rb_raise(rb_eArgError, "buffer is not mapped");
+    if (src_offset < 0 || len < 0 || src_offset + len > RSTRING_LEN(data)) {
+        rb_raise(rb_eIndexError, "source range out of bounds");
+    }
+    memcpy(dst + NUM2LONG(offset), RSTRING_PTR(data) + src_offset, (size_t)len);
+    return Qnil;
+}
+
+/* ReadMappedBuffer(address, offset, length) -> String copied out of a mapped buffer */
+static VALUE rb_gl_read_mapped_buffer(VALUE self, VALUE address, VALUE offset, VALUE length) {
+    const char *src = (const char *)(uintptr_t)NUM2ULL(address);
+    long len = NUM2LONG(length);
+
+    if (src == NULL) rb_raise(rb_eArgError, "buffer is not mapped");
+    if (len < 0) rb_raise(rb_eArgError, "negative length");
+    return rb_str_new(src + NUM2LONG(offset), len);
+}
+
+/* FenceSync(condition, flags) -> sync handle */
+static VALUE rb_gl_fence_sync(VALUE self, VALUE condition, VALUE flags) {
+    GLsync sync = glFenceSync((GLenum)NUM2INT(condition), (GLbitfield)NUM2UINT(flags));
+    return ULL2NUM((unsigned long long)(uintptr_t)sync);
+}
+
+/* ClientWaitSync(sync, flags, timeout) -> wait status */
+static VALUE rb_gl_client_wait_sync(VALUE self, VALUE sync, VALUE flags, VALUE timeout) {
+    GLenum result = glClientWaitSync((GLsync)(uintptr_t)NUM2ULL(sync), (GLbitfield)NUM2UINT(flags), (GLuint64)NUM2ULL(timeout));
+    return INT2NUM(result);
+}
+
+/* DeleteSync(sync) */
+static VALUE rb_gl_delete_sync(VALUE self, VALUE sync) {
+    glDeleteSync((GLsync)(uintptr_t)NUM2ULL(sync));
+    return Qnil;
+}
+
+/* DeleteBuffers(n, buffers) */
+static VALUE rb_gl_delete_buffers(VALUE self, VALUE n, VALUE buffers) {
+    const GLuint *ptr = (const GLuint *)RSTRING_PTR(buffers);
+    glDeleteBuffers((GLsizei)NUM2INT(n), ptr);
+    return Qnil;
+}
+
 /* CheckFramebufferStatus(target) */
 static VALUE rb_gl_check_framebuffer_status(VALUE self, VALUE target) {
     GLenum result = glCheckFramebufferStatus((GLenum)NUM2INT(target));
@@ -261,6 +396,12 @@ static VALUE rb_gl_finish(VALUE self) {
     return Qnil;
 }
 
+/* FramebufferTexture(target, attachment, texture, level) - layered when texture is an array or cubemap */
+static VALUE rb_gl_framebuffer_texture(VALUE self, VALUE target, VALUE attachment, VALUE texture, VALUE level) {
+    glFramebufferTexture((GLenum)NUM2INT(target), (GLenum)NUM2INT(attachment), (GLuint)NUM2UINT(texture), (GLint)NUM2INT(level));
+    return Qnil;
+}
+
 /* FramebufferTexture2D(target, attachment, textarget, texture, level) */
 static VALUE rb_gl_framebuffer_texture_2d(VALUE self, VALUE target, VALUE attachment, VALUE textarget, VALUE texture, VALUE level) {
     glFramebufferTexture2D((GLenum)NUM2INT(target), (GLenum)NUM2INT(attachment), (GLenum)NUM2INT(textarget), (GLuint)NUM2UINT(texture), (GLint)NUM2INT(level));
@@ -320,6 +461,13 @@ static VALUE rb_gl_get_error(VALUE self) {
     return INT2NUM(error);
 }
 
+/* GetInteger64v(pname, params) */
+static VALUE rb_gl_get_integer64v(VALUE self, VALUE pname, VALUE params) {
+    GLint64 *ptr = (GLint64 *)RSTRING_PTR(params);
+    glGetInteger64v((GLenum)NUM2INT(pname), ptr);
+    return Qnil;
+}
+
 /* GetProgramInfoLog(program, max_length, length, info_log) */
 static VALUE rb_gl_get_program_info_log(VALUE self, VALUE program, VALUE max_length, VALUE length, VALUE info_log) {
     GLsizei *len_ptr = (GLsizei *)RSTRING_PTR(length);
@@ -364,12 +512,25 @@ static VALUE rb_gl_get_uniform_location(VALUE self, VALUE program, VALUE name) {
     return INT2NUM(location);
 }
 
+/* GetUniformBlockIndex(program, name) */
+static VALUE rb_gl_get_uniform_block_index(VALUE self, VALUE program, VALUE name) {
+    const char *name_str = StringValueCStr(name);
+    GLuint index = glGetUniformBlockIndex((GLuint)NUM2UINT(program), name_str);
+    return UINT2NUM(index);
+}
+
 /* LinkProgram(program) */
 static VALUE rb_gl_link_program(VALUE self, VALUE program) {
     glLinkProgram((GLuint)NUM2UINT(program));
     return Qnil;
 }
 
+/* QueryCounter(id, target) */
+static VALUE rb_gl_query_counter(VALUE self, VALUE id, VALUE target) {
+    glQueryCounter((GLuint)NUM2UINT(id), (GLenum)NUM2INT(target));
+    return Qnil;
+}
+
 /* ReadBuffer(mode) */
 static VALUE rb_gl_read_buffer(VALUE self, VALUE mode) {
     glReadBuffer((GLenum)NUM2INT(mode));
@@ -377,8 +538,9 @@ static VALUE rb_gl_read_buffer(VALUE self, VALUE mode) {
 }
 
 /* ReadPixels(x, y, width, height, format, type, data) */
+/* data is a String, or a byte offset into the bound PIXEL_PACK_BUFFER */
 static VALUE rb_gl_read_pixels(VALUE self, VALUE x, VALUE y, VALUE width, VALUE height, VALUE format, VALUE type, VALUE data) {
-    void *ptr = (void *)RSTRING_PTR(data);
+    void *ptr = RB_INTEGER_TYPE_P(data) ? (void *)(uintptr_t)NUM2ULL(data) : (void *)RSTRING_PTR(data);
     glReadPixels((GLint)NUM2INT(x), (GLint)NUM2INT(y), (GLsizei)NUM2INT(width), (GLsizei)NUM2INT(height), (GLenum)NUM2INT(format), (GLenum)NUM2INT(type), ptr);
     return Qnil;
 }
@@ -411,6 +573,16 @@ static VALUE rb_gl_stencil_op(VALUE self, VALUE sfail, VALUE dpfail, VALUE dppas
     return Qnil;
 }
 
+/* CompressedTexImage2D(target, level, internalformat, width, height, border, data) */
+static VALUE rb_gl_compressed_tex_image_2d(VALUE self, VALUE target, VALUE level, VALUE internalformat,
+                                            VALUE width, VALUE height, VALUE border, VALUE data) {
+    Check_Type(data, T_STRING);
+    glCompressedTexImage2D((GLenum)NUM2INT(target), (GLint)NUM2INT(level), (GLenum)NUM2INT(internalformat),
+                           (GLsizei)NUM2INT(width), (GLsizei)NUM2INT(height), (GLint)NUM2INT(border),
+                           (GLsizei)RSTRING_LEN(data), (const void *)RSTRING_PTR(data));
+    return Qnil;
+}
+
 /* TexImage2D(target, level, internalformat, width, height, border, format, type, data) */
 static VALUE rb_gl_tex_image_2d(VALUE self, VALUE target, VALUE level, VALUE internalformat,
                                  VALUE width, VALUE height, VALUE border, VALUE format,
@@ -446,6 +618,17 @@ static VALUE rb_gl_tex_parameteri(VALUE self, VALUE target, VALUE pname, VALUE p
     return Qnil;
 }
 
+/* TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, data) */
+static VALUE rb_gl_tex_sub_image_2d(VALUE self, VALUE target, VALUE level, VALUE xoffset,
+                                     VALUE yoffset, VALUE width, VALUE height, VALUE format,
+                                     VALUE type, VALUE data) {
+    Check_Type(data, T_STRING);
+    glTexSubImage2D((GLenum)NUM2INT(target), (GLint)NUM2INT(level), (GLint)NUM2INT(xoffset),
+                    (GLint)NUM2INT(yoffset), (GLsizei)NUM2INT(width), (GLsizei)NUM2INT(height),
+                    (GLenum)NUM2INT(format), (GLenum)NUM2INT(type), (const void *)RSTRING_PTR(data));
+    return Qnil;
+}
+
 /* VertexAttribDivisor(index, divisor) */
 static VALUE rb_gl_vertex_attrib_divisor(VALUE self, VALUE index, VALUE divisor) {
     glVertexAttribDivisor((GLuint)NUM2UINT(index), (GLuint)NUM2UINT(divisor));
@@ -490,6 +673,107 @@ static VALUE rb_gl_memory_barrier(VALUE self, VALUE barriers) {
     return Qnil;
 }
 
+/* Command buffers
+ *
+ * Engine::GL::CommandBuffer records calls as packed 32-bit words: an opcode
+ * followed by its fixed number of arguments (floats are stored as their bit
+ * pattern). execute() replays a whole buffer in one Ruby -> C transition.
+ * Opcodes must stay in sync with Engine::GL::CommandBuffer.
+ */
+enum {
+    CMD_BIND_VERTEX_ARRAY = 1,    /* array */
+    CMD_BIND_BUFFER = 2,          /* target, buffer */
+    CMD_USE_PROGRAM = 3,          /* program */
+    CMD_BIND_TEXTURE = 4,         /* texture_unit, target, texture */
+    CMD_UNIFORM1I = 5,            /* location, v0 */
+    CMD_UNIFORM1F = 6,            /* location, v0 */
+    CMD_UNIFORM3F = 7,            /* location, v0, v1, v2 */
+    CMD_UNIFORM_MATRIX4FV = 8,    /* location, 16 floats */
+    CMD_DRAW_ELEMENTS_INSTANCED = 9 /* mode, count, type, indices, instance_count */
+};
+
+static long command_argc(uint32_t op) {
+    switch (op) {
+        case CMD_BIND_VERTEX_ARRAY: return 1;
+        case CMD_BIND_BUFFER: return 2;
+        case CMD_USE_PROGRAM: return 1;
+        case CMD_BIND_TEXTURE: return 3;
+        case CMD_UNIFORM1I: return 2;
+        case CMD_UNIFORM1F: return 2;
+        case CMD_UNIFORM3F: return 4;
+        case CMD_UNIFORM_MATRIX4FV: return 17;
+        case CMD_DRAW_ELEMENTS_INSTANCED: return 5;
+        default: return -1;
+    }
+}
+
+static float command_float(uint32_t word) {
+    float value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+/* Execute(commands) -> number of commands replayed */
+static VALUE rb_gl_execute(VALUE self, VALUE commands) {
+    const uint32_t *words;
+    long count, i = 0, executed = 0;
+
+    Check_Type(commands, T_STRING);
+    if (RSTRING_LEN(commands) % 4 != 0) {
+        rb_raise(rb_eArgError, "command buffer length must be a multiple of 4 bytes");
+    }
+    words = (const uint32_t *)RSTRING_PTR(commands);
+    count = RSTRING_LEN(commands) / 4;
+
+    while (i < count) {
+        uint32_t op = words[i];
+        long argc = command_argc(op);
+        const uint32_t *a = &words[i + 1];
+
+        if (argc < 0 || i + 1 + argc > count) {
+            rb_raise(rb_eArgError, "malformed command buffer at word %ld (opcode %u)", i, op);
+        }
+
+        switch (op) {
+            case CMD_BIND_VERTEX_ARRAY:
+                glBindVertexArray((GLuint)a[0]);
+                break;
+            case CMD_BIND_BUFFER:
+                glBindBuffer((GLenum)a[0], (GLuint)a[1]);
+                break;
+            case CMD_USE_PROGRAM:
+                glUseProgram((GLuint)a[0]);
+                break;
+            case CMD_BIND_TEXTURE:
+                glActiveTexture((GLenum)a[0]);
+                glBindTexture((GLenum)a[1], (GLuint)a[2]);
+                break;
+            case CMD_UNIFORM1I:
+                glUniform1i((GLint)a[0], (GLint)a[1]);
+                break;
+            case CMD_UNIFORM1F:
+                glUniform1f((GLint)a[0], command_float(a[1]));
+                break;
+            case CMD_UNIFORM3F:
+                glUniform3f((GLint)a[0], command_float(a[1]), command_float(a[2]), command_float(a[3]));
+                break;
+            case CMD_UNIFORM_MATRIX4FV: {
+                GLfloat matrix[16];
+                memcpy(matrix, &a[1], sizeof(matrix));
+                glUniformMatrix4fv((GLint)a[0], 1, GL_FALSE, matrix);
+                break;
+            }
+            case CMD_DRAW_ELEMENTS_INSTANCED:
+                glDrawElementsInstanced((GLenum)a[0], (GLsizei)a[1], (GLenum)a[2],
+                                        (const void *)(uintptr_t)a[3], (GLsizei)a[4]);
+                break;
+        }
+        i += 1 + argc;
+        executed++;
+    }
+    return LONG2NUM(executed);
+}
+
 /* Initialize GLEW (Windows and Linux) */
 static VALUE rb_gl_init_glew(VALUE self) {
 #if defined(_WIN32) || defined(__MINGW32__) || defined(__linux__)
@@ -508,6 +792,7 @@ void Init_gl_native(void) {
     rb_define_module_function(mGLNative, "bind_framebuffer", rb_gl_bind_framebuffer, 2);
     rb_define_module_function(mGLNative, "bind_vertex_array", rb_gl_bind_vertex_array, 1);
     rb_define_module_function(mGLNative, "bind_buffer", rb_gl_bind_buffer, 2);
+    rb_define_module_function(mGLNative, "bind_buffer_base", rb_gl_bind_buffer_base, 3);
     rb_define_module_function(mGLNative, "bind_texture", rb_gl_bind_texture, 2);
     rb_define_module_function(mGLNative, "active_texture", rb_gl_active_texture, 1);
     rb_define_module_function(mGLNative, "use_program", rb_gl_use_program, 1);
@@ -523,17 +808,34 @@ void Init_gl_native(void) {
     rb_define_module_function(mGLNative, "uniform3f", rb_gl_uniform3f, 4);
     rb_define_module_function(mGLNative, "uniform4f", rb_gl_uniform4f, 5);
     rb_define_module_function(mGLNative, "uniform1i", rb_gl_uniform1i, 2);
+    rb_define_module_function(mGLNative, "uniform1fv", rb_gl_uniform1fv, 3);
+    rb_define_module_function(mGLNative, "uniform2fv", rb_gl_uniform2fv, 3);
+    rb_define_module_function(mGLNative, "uniform3fv", rb_gl_uniform3fv, 3);
+    rb_define_module_function(mGLNative, "uniform4fv", rb_gl_uniform4fv, 3);
+    rb_define_module_function(mGLNative, "uniform1iv", rb_gl_uniform1iv, 3);
     rb_define_module_function(mGLNative, "uniform_matrix4fv", rb_gl_uniform_matrix4fv, 4);
+    rb_define_module_function(mGLNative, "uniform_block_binding", rb_gl_uniform_block_binding, 3);
     rb_define_module_function(mGLNative, "blit_framebuffer", rb_gl_blit_framebuffer, 10);
     rb_define_module_function(mGLNative, "attach_shader", rb_gl_attach_shader, 2);
     rb_define_module_function(mGLNative, "begin_query", rb_gl_begin_query, 2);
     rb_define_module_function(mGLNative, "blend_func", rb_gl_blend_func, 2);
     rb_define_module_function(mGLNative, "buffer_data", rb_gl_buffer_data, 4);
     rb_define_module_function(mGLNative, "buffer_sub_data", rb_gl_buffer_sub_data, 4);
+    rb_define_module_function(mGLNative, "buffer_storage", rb_gl_buffer_storage, 4);
+    rb_define_module_function(mGLNative, "buffer_storage_supported", rb_gl_buffer_storage_supported, 0);
+    rb_define_module_function(mGLNative, "map_buffer_range", rb_gl_map_buffer_range, 4);
+    rb_define_module_function(mGLNative, "unmap_buffer", rb_gl_unmap_buffer, 1);
+    rb_define_module_function(mGLNative, "write_mapped_buffer", rb_gl_write_mapped_buffer, 5);
+    rb_define_module_function(mGLNative, "read_mapped_buffer", rb_gl_read_mapped_buffer, 3);
+    rb_define_module_function(mGLNative, "fence_sync", rb_gl_fence_sync, 2);
+    rb_define_module_function(mGLNative, "client_wait_sync", rb_gl_client_wait_sync, 3);
+    rb_define_module_function(mGLNative, "delete_sync", rb_gl_delete_sync, 1);
+    rb_define_module_function(mGLNative, "delete_buffers", rb_gl_delete_buffers, 2);
     rb_define_module_function(mGLNative, "check_framebuffer_status", rb_gl_check_framebuffer_status, 1);
     rb_define_module_function(mGLNative, "clear_color", rb_gl_clear_color, 4);
     rb_define_module_function(mGLNative, "color_mask", rb_gl_color_mask, 4);
     rb_define_module_function(mGLNative, "compile_shader", rb_gl_compile_shader, 1);
+    rb_define_module_function(mGLNative, "compressed_tex_image_2d", rb_gl_compressed_tex_image_2d, 7);
     rb_define_module_function(mGLNative, "create_program", rb_gl_create_program, 0);
     rb_define_module_function(mGLNative, "create_shader", rb_gl_create_shader, 1);
     rb_define_module_function(mGLNative, "cull_face", rb_gl_cull_face, 1);
@@ -544,6 +846,7 @@ void Init_gl_native(void) {
     rb_define_module_function(mGLNative, "enable_vertex_attrib_array", rb_gl_enable_vertex_attrib_array, 1);
     rb_define_module_function(mGLNative, "end_query", rb_gl_end_query, 1);
     rb_define_module_function(mGLNative, "finish", rb_gl_finish, 0);
+    rb_define_module_function(mGLNative, "framebuffer_texture", rb_gl_framebuffer_texture, 4);
     rb_define_module_function(mGLNative, "framebuffer_texture_2d", rb_gl_framebuffer_texture_2d, 5);
     rb_define_module_function(mGLNative, "framebuffer_texture_layer", rb_gl_framebuffer_texture_layer, 5);
     rb_define_module_function(mGLNative, "gen_buffers", rb_gl_gen_buffers, 2);
@@ -553,13 +856,16 @@ void Init_gl_native(void) {
     rb_define_module_function(mGLNative, "gen_textures", rb_gl_gen_textures, 2);
     rb_define_module_function(mGLNative, "gen_vertex_arrays", rb_gl_gen_vertex_arrays, 2);
     rb_define_module_function(mGLNative, "get_error", rb_gl_get_error, 0);
+    rb_define_module_function(mGLNative, "get_integer64v", rb_gl_get_integer64v, 2);
     rb_define_module_function(mGLNative, "get_program_info_log", rb_gl_get_program_info_log, 4);
     rb_define_module_function(mGLNative, "get_programiv", rb_gl_get_programiv, 3);
     rb_define_module_function(mGLNative, "get_query_objectui64v", rb_gl_get_query_objectui64v, 3);
     rb_define_module_function(mGLNative, "get_shader_info_log", rb_gl_get_shader_info_log, 4);
     rb_define_module_function(mGLNative, "get_string", rb_gl_get_string, 1);
     rb_define_module_function(mGLNative, "get_uniform_location", rb_gl_get_uniform_location, 2);
+    rb_define_module_function(mGLNative, "get_uniform_block_index", rb_gl_get_uniform_block_index, 2);
     rb_define_module_function(mGLNative, "link_program", rb_gl_link_program, 1);
+    rb_define_module_function(mGLNative, "query_counter", rb_gl_query_counter, 2);
     rb_define_module_function(mGLNative, "read_buffer", rb_gl_read_buffer, 1);
     rb_define_module_function(mGLNative, "read_pixels", rb_gl_read_pixels, 7);
     rb_define_module_function(mGLNative, "shader_source", rb_gl_shader_source, 4);
@@ -570,6 +876,7 @@ void Init_gl_native(void) {
     rb_define_module_function(mGLNative, "tex_image_3d", rb_gl_tex_image_3d, 10);
     rb_define_module_function(mGLNative, "tex_parameterfv", rb_gl_tex_parameterfv, 3);
     rb_define_module_function(mGLNative, "tex_parameteri", rb_gl_tex_parameteri, 3);
+    rb_define_module_function(mGLNative, "tex_sub_image_2d", rb_gl_tex_sub_image_2d, 9);
     rb_define_module_function(mGLNative, "vertex_attrib_divisor", rb_gl_vertex_attrib_divisor, 2);
     rb_define_module_function(mGLNative, "vertex_attrib_ipointer", rb_gl_vertex_attrib_ipointer, 5);
     rb_define_module_function(mGLNative, "vertex_attrib_pointer", rb_gl_vertex_attrib_pointer, 6);
@@ -579,6 +886,9 @@ void Init_gl_native(void) {
     rb_define_module_function(mGLNative, "dispatch_compute", rb_gl_dispatch_compute, 3);
     rb_define_module_function(mGLNative, "memory_barrier", rb_gl_memory_barrier, 1);
 
+    /* Command buffers */
+    rb_define_module_function(mGLNative, "execute", rb_gl_execute, 1);
+
     /* GLEW initialization (Windows and Linux, no-op on macOS) */
     rb_define_module_function(mGLNative, "init_glew", rb_gl_init_glew, 0);
 }
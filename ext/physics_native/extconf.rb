@@ -0,0 +1,8 @@
+# frozen_string_literal: true
+
+require 'mkmf'
+
+# Pure C (no GL dependency) - rigidbody integration only
+$CFLAGS << " -O3" unless RUBY_PLATFORM =~ /mswin/
+
+create_makefile('physics_native')
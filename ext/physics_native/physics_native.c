@@ -0,0 +1,652 @@
+#include <ruby.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Rigidbody integration kernel.
+ *
+ * State for every body lives in packed arrays indexed by a slot handle:
+ * position, rotation quaternion (w, x, y, z), linear and angular velocity,
+ * constant acceleration, mass and a row-major inertia tensor, plus the
+ * impulses accumulated since the last step. step() integrates every live
+ * body with semi-implicit Euler, matching what Rigidbody#update used to do
+ * with Vector math. Angular velocity is in degrees per second, like the
+ * rest of the engine's rotations.
+ *
+ * The state before the last step is kept so callers can interpolate
+ * between steps when rendering.
+ *
+ * The contact functions at the end are the narrowphase for box colliders.
+ * They are stateless and only report geometry; CubeCollider and
+ * SphereCollider turn contacts into impulses.
+ */
+
+/* Module reference */
+static VALUE mPhysicsNative;
+
+static double *position;          /* 3 per slot */
+static double *rotation;          /* 4 per slot */
+static double *previous_position; /* 3 per slot */
+static double *previous_rotation; /* 4 per slot */
+static double *velocity;          /* 3 per slot */
+static double *angular_velocity;  /* 3 per slot */
+static double *acceleration;      /* 3 per slot */
+static double *impulse;           /* 3 per slot */
+static double *angular_impulse;   /* 3 per slot */
+static double *inertia;           /* 9 per slot */
+static double *mass;
+static long *free_list;
+static uint8_t *alive;
+
+static long capacity = 0;
+static long high_water = 0;
+static long free_count = 0;
+
+static void grow(long new_capacity) {
+    REALLOC_N(position, double, new_capacity * 3);
+    REALLOC_N(rotation, double, new_capacity * 4);
+    REALLOC_N(previous_position, double, new_capacity * 3);
+    REALLOC_N(previous_rotation, double, new_capacity * 4);
+    REALLOC_N(velocity, double, new_capacity * 3);
+    REALLOC_N(angular_velocity, double, new_capacity * 3);
+    REALLOC_N(acceleration, double, new_capacity * 3);
+    REALLOC_N(impulse, double, new_capacity * 3);
+    REALLOC_N(angular_impulse, double, new_capacity * 3);
+    REALLOC_N(inertia, double, new_capacity * 9);
+    REALLOC_N(mass, double, new_capacity);
+    REALLOC_N(free_list, long, new_capacity);
+    REALLOC_N(alive, uint8_t, new_capacity);
+    capacity = new_capacity;
+}
+
+static long check_slot(VALUE slot) {
+    long i = NUM2LONG(slot);
+    if (i < 0 || i >= high_water || !alive[i]) {
+        rb_raise(rb_eIndexError, "invalid body slot %ld", i);
+    }
+    return i;
+}
+
+static void set3(double *array, long i, VALUE x, VALUE y, VALUE z) {
+    array[i * 3] = NUM2DBL(x);
+    array[i * 3 + 1] = NUM2DBL(y);
+    array[i * 3 + 2] = NUM2DBL(z);
+}
+
+static VALUE get3(const double *array, long i) {
+    return rb_ary_new_from_args(3, DBL2NUM(array[i * 3]), DBL2NUM(array[i * 3 + 1]), DBL2NUM(array[i * 3 + 2]));
+}
+
+static double length3(const double *v) {
+    return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+/* direction . (inertia * direction) */
+static double moment_about(long i, const double *direction) {
+    const double *t = &inertia[i * 9];
+    return direction[0] * (t[0] * direction[0] + t[1] * direction[1] + t[2] * direction[2]) +
+           direction[1] * (t[3] * direction[0] + t[4] * direction[1] + t[5] * direction[2]) +
+           direction[2] * (t[6] * direction[0] + t[7] * direction[1] + t[8] * direction[2]);
+}
+
+/* Turns the impulses gathered since the last step into velocity changes.
+ * Angular impulses use the moment of inertia about the current spin axis,
+ * or about the impulse itself for a body that is not spinning yet. */
+static void apply_impulses(long i) {
+    double *v = &velocity[i * 3];
+    double *w = &angular_velocity[i * 3];
+    double *j = &impulse[i * 3];
+    double *aj = &angular_impulse[i * 3];
+    double angular_length = length3(aj);
+    int k;
+
+    for (k = 0; k < 3; k++) v[k] += j[k] / mass[i];
+
+    if (angular_length > 0) {
+        double spin = length3(w);
+        double direction[3];
+        double moment;
+
+        if (spin > 0) {
+            for (k = 0; k < 3; k++) direction[k] = w[k] / spin;
+        } else {
+            for (k = 0; k < 3; k++) direction[k] = aj[k] / angular_length;
+        }
+        moment = moment_about(i, direction);
+        for (k = 0; k < 3; k++) w[k] += aj[k] / moment;
+    }
+
+    memset(j, 0, sizeof(double) * 3);
+    memset(aj, 0, sizeof(double) * 3);
+}
+
+/* rotation = angle_axis(|w| * dt, w) * rotation */
+static void rotate(long i, double dt) {
+    const double *w = &angular_velocity[i * 3];
+    double *q = &rotation[i * 4];
+    double spin = length3(w);
+    double half_angle, s, a[4], b[4], n;
+
+    if (spin <= 0) return;
+
+    half_angle = spin * dt * M_PI / 180.0 / 2.0;
+    s = sin(half_angle);
+    a[0] = cos(half_angle);
+    a[1] = w[0] / spin * s;
+    a[2] = w[1] / spin * s;
+    a[3] = w[2] / spin * s;
+    memcpy(b, q, sizeof(b));
+
+    q[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    q[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    q[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    q[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+
+    /* Keep long simulations from drifting off the unit sphere */
+    n = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (n > 0) {
+        q[0] /= n; q[1] /= n; q[2] /= n; q[3] /= n;
+    }
+}
+
+/* Velocity from acceleration, then any impulses, then position and
+ * rotation - the order Rigidbody#update has always used */
+static void integrate(long i, double dt, int with_impulses) {
+    double *p = &position[i * 3];
+    double *v = &velocity[i * 3];
+    const double *a = &acceleration[i * 3];
+    int k;
+
+    for (k = 0; k < 3; k++) v[k] += a[k] * dt;
+    if (with_impulses) apply_impulses(i);
+    for (k = 0; k < 3; k++) p[k] += v[k] * dt;
+    rotate(i, dt);
+}
+
+/* Impulses land once per step, on the first sub-step */
+static void step_body(long i, double dt, long sub_steps) {
+    double h = dt / (double)sub_steps;
+    long s;
+
+    memcpy(&previous_position[i * 3], &position[i * 3], sizeof(double) * 3);
+    memcpy(&previous_rotation[i * 4], &rotation[i * 4], sizeof(double) * 4);
+
+    for (s = 0; s < sub_steps; s++) integrate(i, h, s == 0);
+}
+
+static long check_sub_steps(VALUE sub_steps) {
+    long n = NUM2LONG(sub_steps);
+    if (n < 1) rb_raise(rb_eArgError, "sub_steps must be at least 1, got %ld", n);
+    return n;
+}
+
+/* alloc() -> slot */
+static VALUE rb_physics_alloc(VALUE self) {
+    long i;
+
+    if (free_count > 0) {
+        i = free_list[--free_count];
+    } else {
+        if (high_water >= capacity) grow(capacity == 0 ? 256 : capacity * 2);
+        i = high_water++;
+    }
+
+    memset(&position[i * 3], 0, sizeof(double) * 3);
+    memset(&velocity[i * 3], 0, sizeof(double) * 3);
+    memset(&angular_velocity[i * 3], 0, sizeof(double) * 3);
+    memset(&acceleration[i * 3], 0, sizeof(double) * 3);
+    memset(&impulse[i * 3], 0, sizeof(double) * 3);
+    memset(&angular_impulse[i * 3], 0, sizeof(double) * 3);
+    memset(&inertia[i * 9], 0, sizeof(double) * 9);
+    inertia[i * 9] = inertia[i * 9 + 4] = inertia[i * 9 + 8] = 1.0;
+    rotation[i * 4] = 1.0;
+    rotation[i * 4 + 1] = rotation[i * 4 + 2] = rotation[i * 4 + 3] = 0.0;
+    memcpy(&previous_position[i * 3], &position[i * 3], sizeof(double) * 3);
+    memcpy(&previous_rotation[i * 4], &rotation[i * 4], sizeof(double) * 4);
+    mass[i] = 1.0;
+    alive[i] = 1;
+    return LONG2NUM(i);
+}
+
+/* release(slot) */
+static VALUE rb_physics_release(VALUE self, VALUE slot) {
+    long i = check_slot(slot);
+    alive[i] = 0;
+    free_list[free_count++] = i;
+    return Qnil;
+}
+
+/* set_position(slot, x, y, z) - also resets the interpolation start */
+static VALUE rb_physics_set_position(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    set3(position, i, x, y, z);
+    memcpy(&previous_position[i * 3], &position[i * 3], sizeof(double) * 3);
+    return Qnil;
+}
+
+/* set_rotation(slot, w, x, y, z) - also resets the interpolation start */
+static VALUE rb_physics_set_rotation(VALUE self, VALUE slot, VALUE w, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    rotation[i * 4] = NUM2DBL(w);
+    rotation[i * 4 + 1] = NUM2DBL(x);
+    rotation[i * 4 + 2] = NUM2DBL(y);
+    rotation[i * 4 + 3] = NUM2DBL(z);
+    memcpy(&previous_rotation[i * 4], &rotation[i * 4], sizeof(double) * 4);
+    return Qnil;
+}
+
+/* set_velocity(slot, x, y, z) */
+static VALUE rb_physics_set_velocity(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    set3(velocity, check_slot(slot), x, y, z);
+    return Qnil;
+}
+
+/* set_angular_velocity(slot, x, y, z) - degrees per second */
+static VALUE rb_physics_set_angular_velocity(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    set3(angular_velocity, check_slot(slot), x, y, z);
+    return Qnil;
+}
+
+/* set_acceleration(slot, x, y, z) - force / mass, constant between steps */
+static VALUE rb_physics_set_acceleration(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    set3(acceleration, check_slot(slot), x, y, z);
+    return Qnil;
+}
+
+/* set_mass(slot, mass) */
+static VALUE rb_physics_set_mass(VALUE self, VALUE slot, VALUE value) {
+    long i = check_slot(slot);
+    double m = NUM2DBL(value);
+    if (m <= 0) rb_raise(rb_eArgError, "mass must be positive, got %f", m);
+    mass[i] = m;
+    return Qnil;
+}
+
+/* set_inertia(slot, tensor) - 9 packed doubles, row-major */
+static VALUE rb_physics_set_inertia(VALUE self, VALUE slot, VALUE tensor) {
+    long i = check_slot(slot);
+    Check_Type(tensor, T_STRING);
+    if (RSTRING_LEN(tensor) != (long)(9 * sizeof(double))) {
+        rb_raise(rb_eArgError, "expected 9 packed doubles, got %ld bytes", RSTRING_LEN(tensor));
+    }
+    memcpy(&inertia[i * 9], RSTRING_PTR(tensor), 9 * sizeof(double));
+    return Qnil;
+}
+
+/* apply_impulse(slot, x, y, z) - accumulated until the next step */
+static VALUE rb_physics_apply_impulse(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    impulse[i * 3] += NUM2DBL(x);
+    impulse[i * 3 + 1] += NUM2DBL(y);
+    impulse[i * 3 + 2] += NUM2DBL(z);
+    return Qnil;
+}
+
+/* apply_angular_impulse(slot, x, y, z) - accumulated until the next step */
+static VALUE rb_physics_apply_angular_impulse(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    angular_impulse[i * 3] += NUM2DBL(x);
+    angular_impulse[i * 3 + 1] += NUM2DBL(y);
+    angular_impulse[i * 3 + 2] += NUM2DBL(z);
+    return Qnil;
+}
+
+/* step(dt, sub_steps) -> number of bodies integrated */
+static VALUE rb_physics_step(VALUE self, VALUE dt, VALUE sub_steps) {
+    double h = NUM2DBL(dt);
+    long n = check_sub_steps(sub_steps);
+    long i, count = 0;
+
+    for (i = 0; i < high_water; i++) {
+        if (!alive[i]) continue;
+        step_body(i, h, n);
+        count++;
+    }
+    return LONG2NUM(count);
+}
+
+/* step_body(slot, dt, sub_steps) - one body on its own */
+static VALUE rb_physics_step_body(VALUE self, VALUE slot, VALUE dt, VALUE sub_steps) {
+    step_body(check_slot(slot), NUM2DBL(dt), check_sub_steps(sub_steps));
+    return Qnil;
+}
+
+/* position(slot) -> [x, y, z] */
+static VALUE rb_physics_position(VALUE self, VALUE slot) {
+    return get3(position, check_slot(slot));
+}
+
+/* rotation(slot) -> [w, x, y, z] */
+static VALUE rb_physics_rotation(VALUE self, VALUE slot) {
+    long i = check_slot(slot);
+    return rb_ary_new_from_args(4, DBL2NUM(rotation[i * 4]), DBL2NUM(rotation[i * 4 + 1]),
+                                DBL2NUM(rotation[i * 4 + 2]), DBL2NUM(rotation[i * 4 + 3]));
+}
+
+/* velocity(slot) -> [x, y, z] */
+static VALUE rb_physics_velocity(VALUE self, VALUE slot) {
+    return get3(velocity, check_slot(slot));
+}
+
+/* angular_velocity(slot) -> [x, y, z] */
+static VALUE rb_physics_angular_velocity(VALUE self, VALUE slot) {
+    return get3(angular_velocity, check_slot(slot));
+}
+
+/* interpolated_position(slot, alpha) -> [x, y, z] between the last two steps */
+static VALUE rb_physics_interpolated_position(VALUE self, VALUE slot, VALUE alpha_value) {
+    long i = check_slot(slot);
+    double alpha = NUM2DBL(alpha_value);
+    const double *a = &previous_position[i * 3];
+    const double *b = &position[i * 3];
+
+    return rb_ary_new_from_args(3, DBL2NUM(a[0] + (b[0] - a[0]) * alpha),
+                                DBL2NUM(a[1] + (b[1] - a[1]) * alpha),
+                                DBL2NUM(a[2] + (b[2] - a[2]) * alpha));
+}
+
+/* interpolated_rotation(slot, alpha) -> [w, x, y, z], normalized lerp along the short arc */
+static VALUE rb_physics_interpolated_rotation(VALUE self, VALUE slot, VALUE alpha_value) {
+    long i = check_slot(slot);
+    double alpha = NUM2DBL(alpha_value);
+    const double *a = &previous_rotation[i * 4];
+    const double *b = &rotation[i * 4];
+    double sign = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]) < 0 ? -1.0 : 1.0;
+    double q[4], n;
+    int k;
+
+    for (k = 0; k < 4; k++) q[k] = a[k] + (sign * b[k] - a[k]) * alpha;
+    n = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (n > 0) {
+        for (k = 0; k < 4; k++) q[k] /= n;
+    }
+    return rb_ary_new_from_args(4, DBL2NUM(q[0]), DBL2NUM(q[1]), DBL2NUM(q[2]), DBL2NUM(q[3]));
+}
+
+/* count() -> live bodies */
+static VALUE rb_physics_count(VALUE self) {
+    return LONG2NUM(high_water - free_count);
+}
+
+/*
+ * Narrowphase contacts.
+ *
+ * Boxes arrive as 10 packed doubles: center (x, y, z), rotation (w, x, y, z)
+ * and half extents (x, y, z). A contact is returned as
+ * [normal_x, normal_y, normal_z, depth, point_x, point_y, point_z] with the
+ * normal pointing from the first shape to the second and the point halfway
+ * through the overlap, or nil when the shapes are apart.
+ */
+
+#define DOUBLES_PER_BOX 10
+#define PARALLEL_EPSILON 1e-9
+/* Edge axes must beat face axes by this much, so resting faces stay faces */
+#define EDGE_BIAS 1e-4
+
+typedef struct {
+    double center[3];
+    double axis[3][3];
+    double half[3];
+} Box;
+
+static double dot3(const double *a, const double *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cross3(const double *a, const double *b, double *out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/* Axis i is row i of the rotation block, as transform_native builds it */
+static void unpack_box(VALUE packed, Box *box) {
+    const double *d;
+    double w, x, y, z, x2, y2, z2;
+
+    Check_Type(packed, T_STRING);
+    if (RSTRING_LEN(packed) != (long)(DOUBLES_PER_BOX * sizeof(double))) {
+        rb_raise(rb_eArgError, "expected %d packed doubles per box, got %ld bytes", DOUBLES_PER_BOX, RSTRING_LEN(packed));
+    }
+    d = (const double *)RSTRING_PTR(packed);
+
+    memcpy(box->center, d, sizeof(double) * 3);
+    memcpy(box->half, d + 7, sizeof(double) * 3);
+
+    w = d[3]; x = d[4]; y = d[5]; z = d[6];
+    x2 = x + x; y2 = y + y; z2 = z + z;
+    box->axis[0][0] = 1 - (y * y2 + z * z2); box->axis[0][1] = x * y2 - w * z2;       box->axis[0][2] = x * z2 + w * y2;
+    box->axis[1][0] = x * y2 + w * z2;       box->axis[1][1] = 1 - (x * x2 + z * z2); box->axis[1][2] = y * z2 - w * x2;
+    box->axis[2][0] = x * z2 - w * y2;       box->axis[2][1] = y * z2 + w * x2;       box->axis[2][2] = 1 - (x * x2 + y * y2);
+}
+
+static VALUE contact_result(const double *normal, double depth, const double *point) {
+    return rb_ary_new_from_args(7, DBL2NUM(normal[0]), DBL2NUM(normal[1]), DBL2NUM(normal[2]), DBL2NUM(depth),
+                                DBL2NUM(point[0]), DBL2NUM(point[1]), DBL2NUM(point[2]));
+}
+
+/* Half the box's extent projected onto axis */
+static double projected_radius(const Box *box, const double *axis) {
+    return box->half[0] * fabs(dot3(box->axis[0], axis)) +
+           box->half[1] * fabs(dot3(box->axis[1], axis)) +
+           box->half[2] * fabs(dot3(box->axis[2], axis));
+}
+
+/* Average of the box's vertices furthest against direction (its contact
+ * feature: a vertex, edge midpoint or face center) */
+static void deepest_feature(const Box *box, const double *direction, double *out) {
+    double vertices[8][3], projection[8], deepest = INFINITY;
+    double tolerance = 1e-6 * (box->half[0] + box->half[1] + box->half[2]);
+    int v, k, count = 0;
+
+    for (v = 0; v < 8; v++) {
+        for (k = 0; k < 3; k++) {
+            vertices[v][k] = box->center[k] +
+                             ((v & 1) ? 1 : -1) * box->half[0] * box->axis[0][k] +
+                             ((v & 2) ? 1 : -1) * box->half[1] * box->axis[1][k] +
+                             ((v & 4) ? 1 : -1) * box->half[2] * box->axis[2][k];
+        }
+        projection[v] = dot3(vertices[v], direction);
+        if (projection[v] < deepest) deepest = projection[v];
+    }
+
+    out[0] = out[1] = out[2] = 0;
+    for (v = 0; v < 8; v++) {
+        if (projection[v] > deepest + tolerance) continue;
+        for (k = 0; k < 3; k++) out[k] += vertices[v][k];
+        count++;
+    }
+    for (k = 0; k < 3; k++) out[k] /= count;
+}
+
+/* Clamps point into box on every axis but skip_axis */
+static void clamp_to_face(const Box *box, int skip_axis, double *point) {
+    double offset[3], local;
+    int i, k;
+
+    for (k = 0; k < 3; k++) offset[k] = point[k] - box->center[k];
+    for (i = 0; i < 3; i++) {
+        if (i == skip_axis) continue;
+        local = dot3(offset, box->axis[i]);
+        if (local > box->half[i]) {
+            for (k = 0; k < 3; k++) point[k] -= (local - box->half[i]) * box->axis[i][k];
+        } else if (local < -box->half[i]) {
+            for (k = 0; k < 3; k++) point[k] -= (local + box->half[i]) * box->axis[i][k];
+        }
+    }
+}
+
+/* Midpoint of the edge parallel to axis edge_axis that lies furthest along direction */
+static void support_edge(const Box *box, int edge_axis, const double *direction, double *midpoint) {
+    int i, k;
+
+    memcpy(midpoint, box->center, sizeof(double) * 3);
+    for (i = 0; i < 3; i++) {
+        double sign;
+        if (i == edge_axis) continue;
+        sign = dot3(box->axis[i], direction) >= 0 ? 1.0 : -1.0;
+        for (k = 0; k < 3; k++) midpoint[k] += sign * box->half[i] * box->axis[i][k];
+    }
+}
+
+/* Closest points between segments p + s*u and q + t*v, |s| <= a, |t| <= b */
+static void closest_between_edges(const double *p, const double *u, double a,
+                                  const double *q, const double *v, double b, double *midpoint) {
+    double r[3], uv, ur, vr, denominator, s = 0, t;
+    int k;
+
+    for (k = 0; k < 3; k++) r[k] = q[k] - p[k];
+    uv = dot3(u, v);
+    ur = dot3(u, r);
+    vr = dot3(v, r);
+    denominator = 1 - uv * uv;
+    if (denominator > PARALLEL_EPSILON) s = (ur - uv * vr) / denominator;
+    if (s > a) s = a;
+    if (s < -a) s = -a;
+    t = s * uv - vr;
+    if (t > b) t = b;
+    if (t < -b) t = -b;
+    s = ur + t * uv;
+    if (s > a) s = a;
+    if (s < -a) s = -a;
+
+    for (k = 0; k < 3; k++) midpoint[k] = (p[k] + s * u[k] + q[k] + t * v[k]) / 2;
+}
+
+/* box_box_contact(box_a, box_b) -> contact or nil
+ * Separating axis test over both boxes' face normals and the nine edge
+ * cross products; the axis of least overlap is the contact normal. */
+static VALUE rb_physics_box_box_contact(VALUE self, VALUE packed_a, VALUE packed_b) {
+    Box a, b;
+    double offset[3], normal[3] = {0, 0, 0}, point[3], depth = INFINITY;
+    int best = 0, n, k;
+
+    unpack_box(packed_a, &a);
+    unpack_box(packed_b, &b);
+    for (k = 0; k < 3; k++) offset[k] = b.center[k] - a.center[k];
+
+    /* 0-2: A's faces, 3-5: B's faces, 6-14: A's edge (n - 6) / 3 x B's edge (n - 6) % 3 */
+    for (n = 0; n < 15; n++) {
+        double axis[3], length, overlap, distance;
+        int edge = n >= 6;
+
+        if (n < 3) {
+            memcpy(axis, a.axis[n], sizeof(axis));
+        } else if (n < 6) {
+            memcpy(axis, b.axis[n - 3], sizeof(axis));
+        } else {
+            cross3(a.axis[(n - 6) / 3], b.axis[(n - 6) % 3], axis);
+            length = sqrt(dot3(axis, axis));
+            if (length < PARALLEL_EPSILON) continue;
+            for (k = 0; k < 3; k++) axis[k] /= length;
+        }
+
+        distance = dot3(offset, axis);
+        overlap = projected_radius(&a, axis) + projected_radius(&b, axis) - fabs(distance);
+        if (overlap < 0) return Qnil;
+        if (edge ? overlap + EDGE_BIAS < depth : overlap < depth) {
+            depth = overlap;
+            best = n;
+            for (k = 0; k < 3; k++) normal[k] = distance < 0 ? -axis[k] : axis[k];
+        }
+    }
+
+    if (best < 3) {
+        /* B's deepest feature against A's face */
+        deepest_feature(&b, normal, point);
+        clamp_to_face(&a, best, point);
+        for (k = 0; k < 3; k++) point[k] += normal[k] * depth / 2;
+    } else if (best < 6) {
+        double reversed[3] = {-normal[0], -normal[1], -normal[2]};
+        deepest_feature(&a, reversed, point);
+        clamp_to_face(&b, best - 3, point);
+        for (k = 0; k < 3; k++) point[k] -= normal[k] * depth / 2;
+    } else {
+        double reversed[3] = {-normal[0], -normal[1], -normal[2]};
+        int edge_a = (best - 6) / 3, edge_b = (best - 6) % 3;
+        double midpoint_a[3], midpoint_b[3];
+        support_edge(&a, edge_a, normal, midpoint_a);
+        support_edge(&b, edge_b, reversed, midpoint_b);
+        closest_between_edges(midpoint_a, a.axis[edge_a], a.half[edge_a],
+                              midpoint_b, b.axis[edge_b], b.half[edge_b], point);
+    }
+
+    return contact_result(normal, depth, point);
+}
+
+/* box_sphere_contact(box, x, y, z, radius) -> contact or nil */
+static VALUE rb_physics_box_sphere_contact(VALUE self, VALUE packed, VALUE x, VALUE y, VALUE z, VALUE radius_value) {
+    Box box;
+    double sphere[3], offset[3], local[3], closest[3], normal[3], point[3];
+    double radius = NUM2DBL(radius_value), distance, depth;
+    int inside = 1, k, i;
+
+    unpack_box(packed, &box);
+    sphere[0] = NUM2DBL(x);
+    sphere[1] = NUM2DBL(y);
+    sphere[2] = NUM2DBL(z);
+    for (k = 0; k < 3; k++) offset[k] = sphere[k] - box.center[k];
+
+    for (i = 0; i < 3; i++) {
+        local[i] = dot3(offset, box.axis[i]);
+        if (local[i] > box.half[i]) { local[i] = box.half[i]; inside = 0; }
+        else if (local[i] < -box.half[i]) { local[i] = -box.half[i]; inside = 0; }
+    }
+
+    if (inside) {
+        /* Center inside the box: push out through the nearest face */
+        int face = 0;
+        double face_distance = INFINITY;
+        for (i = 0; i < 3; i++) {
+            double d = box.half[i] - fabs(local[i]);
+            if (d < face_distance) { face_distance = d; face = i; }
+        }
+        for (k = 0; k < 3; k++) normal[k] = local[face] < 0 ? -box.axis[face][k] : box.axis[face][k];
+        depth = radius + face_distance;
+        for (k = 0; k < 3; k++) point[k] = sphere[k] + normal[k] * (face_distance - radius) / 2;
+        return contact_result(normal, depth, point);
+    }
+
+    for (k = 0; k < 3; k++) {
+        closest[k] = box.center[k] + local[0] * box.axis[0][k] + local[1] * box.axis[1][k] + local[2] * box.axis[2][k];
+        normal[k] = sphere[k] - closest[k];
+    }
+    distance = sqrt(dot3(normal, normal));
+    if (distance >= radius) return Qnil;
+
+    depth = radius - distance;
+    for (k = 0; k < 3; k++) {
+        normal[k] /= distance;
+        point[k] = closest[k] - normal[k] * depth / 2;
+    }
+    return contact_result(normal, depth, point);
+}
+
+/* Extension init */
+void Init_physics_native(void) {
+    mPhysicsNative = rb_define_module("PhysicsNative");
+
+    rb_define_module_function(mPhysicsNative, "alloc", rb_physics_alloc, 0);
+    rb_define_module_function(mPhysicsNative, "release", rb_physics_release, 1);
+    rb_define_module_function(mPhysicsNative, "set_position", rb_physics_set_position, 4);
+    rb_define_module_function(mPhysicsNative, "set_rotation", rb_physics_set_rotation, 5);
+    rb_define_module_function(mPhysicsNative, "set_velocity", rb_physics_set_velocity, 4);
+    rb_define_module_function(mPhysicsNative, "set_angular_velocity", rb_physics_set_angular_velocity, 4);
+    rb_define_module_function(mPhysicsNative, "set_acceleration", rb_physics_set_acceleration, 4);
+    rb_define_module_function(mPhysicsNative, "set_mass", rb_physics_set_mass, 2);
+    rb_define_module_function(mPhysicsNative, "set_inertia", rb_physics_set_inertia, 2);
+    rb_define_module_function(mPhysicsNative, "apply_impulse", rb_physics_apply_impulse, 4);
+    rb_define_module_function(mPhysicsNative, "apply_angular_impulse", rb_physics_apply_angular_impulse, 4);
+    rb_define_module_function(mPhysicsNative, "step", rb_physics_step, 2);
+    rb_define_module_function(mPhysicsNative, "step_body", rb_physics_step_body, 3);
+    rb_define_module_function(mPhysicsNative, "position", rb_physics_position, 1);
+    rb_define_module_function(mPhysicsNative, "rotation", rb_physics_rotation, 1);
+    rb_define_module_function(mPhysicsNative, "velocity", rb_physics_velocity, 1);
+    rb_define_module_function(mPhysicsNative, "angular_velocity", rb_physics_angular_velocity, 1);
+    rb_define_module_function(mPhysicsNative, "interpolated_position", rb_physics_interpolated_position, 2);
+    rb_define_module_function(mPhysicsNative, "interpolated_rotation", rb_physics_interpolated_rotation, 2);
+    rb_define_module_function(mPhysicsNative, "count", rb_physics_count, 0);
+    rb_define_module_function(mPhysicsNative, "box_box_contact", rb_physics_box_box_contact, 2);
+    rb_define_module_function(mPhysicsNative, "box_sphere_contact", rb_physics_box_sphere_contact, 5);
+}
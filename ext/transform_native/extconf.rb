@@ -0,0 +1,8 @@
+# frozen_string_literal: true
+
+require 'mkmf'
+
+# Pure C (no GL dependency) - the transform store only does math
+$CFLAGS << " -O3" unless RUBY_PLATFORM =~ /mswin/
+
+create_makefile('transform_native')
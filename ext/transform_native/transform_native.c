@@ -0,0 +1,336 @@
+#include <ruby.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Transform store for GameObjects.
+ *
+ * Local TRS for every GameObject lives in contiguous structure-of-arrays
+ * storage indexed by a slot handle. World matrices are derived lazily (per
+ * slot, walking up the parent chain) or in one batched pass over the whole
+ * store, visited in depth order so parents are always resolved before their
+ * children.
+ *
+ * Matrices use the engine's row-vector convention (v' = v * M) and are
+ * stored row-major, which is exactly the layout InstanceRenderer uploads
+ * as a column-major mat4.
+ */
+
+/* Module reference */
+static VALUE mTransformNative;
+
+/* Local TRS (structure of arrays) */
+static double *pos_x, *pos_y, *pos_z;
+static double *rot_w, *rot_x, *rot_y, *rot_z;
+static double *scale_x, *scale_y, *scale_z;
+
+/* Hierarchy and bookkeeping */
+static long *parent;
+static long *depth;
+static long *order;
+static long *free_list;
+static uint8_t *alive;
+static uint8_t *local_dirty;
+
+/* stamp[i] changes every time slot i's world matrix is recomputed.
+ * parent_stamp[i] records the parent's stamp that world[i] was built from. */
+static uint64_t *stamp;
+static uint64_t *parent_stamp;
+static uint64_t next_stamp = 0;
+
+/* World matrices, 16 doubles per slot */
+static double *world;
+
+static long capacity = 0;
+static long high_water = 0;
+static long free_count = 0;
+static long order_count = 0;
+static int hierarchy_dirty = 0;
+
+static void grow(long new_capacity) {
+    REALLOC_N(pos_x, double, new_capacity);
+    REALLOC_N(pos_y, double, new_capacity);
+    REALLOC_N(pos_z, double, new_capacity);
+    REALLOC_N(rot_w, double, new_capacity);
+    REALLOC_N(rot_x, double, new_capacity);
+    REALLOC_N(rot_y, double, new_capacity);
+    REALLOC_N(rot_z, double, new_capacity);
+    REALLOC_N(scale_x, double, new_capacity);
+    REALLOC_N(scale_y, double, new_capacity);
+    REALLOC_N(scale_z, double, new_capacity);
+    REALLOC_N(parent, long, new_capacity);
+    REALLOC_N(depth, long, new_capacity);
+    REALLOC_N(order, long, new_capacity);
+    REALLOC_N(free_list, long, new_capacity);
+    REALLOC_N(alive, uint8_t, new_capacity);
+    REALLOC_N(local_dirty, uint8_t, new_capacity);
+    REALLOC_N(stamp, uint64_t, new_capacity);
+    REALLOC_N(parent_stamp, uint64_t, new_capacity);
+    REALLOC_N(world, double, new_capacity * 16);
+    capacity = new_capacity;
+}
+
+static long check_slot(VALUE slot) {
+    long i = NUM2LONG(slot);
+    if (i < 0 || i >= high_water || !alive[i]) {
+        rb_raise(rb_eIndexError, "invalid transform slot %ld", i);
+    }
+    return i;
+}
+
+/* Builds the local matrix from TRS. Row i of the rotation block is scaled by
+ * scale[i]; the rotation comes straight from the quaternion (no euler trip). */
+static void compute_local(long i, double *m) {
+    double x = rot_x[i], y = rot_y[i], z = rot_z[i], w = rot_w[i];
+    double x2 = x + x, y2 = y + y, z2 = z + z;
+    double xx = x * x2, xy = x * y2, xz = x * z2;
+    double yy = y * y2, yz = y * z2, zz = z * z2;
+    double wx = w * x2, wy = w * y2, wz = w * z2;
+    double sx = scale_x[i], sy = scale_y[i], sz = scale_z[i];
+
+    m[0] = sx * (1 - (yy + zz)); m[1] = sx * (xy - wz);       m[2] = sx * (xz + wy);        m[3] = 0;
+    m[4] = sy * (xy + wz);       m[5] = sy * (1 - (xx + zz)); m[6] = sy * (yz - wx);        m[7] = 0;
+    m[8] = sz * (xz - wy);       m[9] = sz * (yz + wx);       m[10] = sz * (1 - (xx + yy)); m[11] = 0;
+    m[12] = pos_x[i];            m[13] = pos_y[i];            m[14] = pos_z[i];             m[15] = 1;
+}
+
+static void multiply(const double *a, const double *b, double *out) {
+    int r, c;
+    for (r = 0; r < 4; r++) {
+        for (c = 0; c < 4; c++) {
+            out[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] +
+                             a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+        }
+    }
+}
+
+static int needs_update(long i) {
+    long p = parent[i];
+    return local_dirty[i] || (p >= 0 && parent_stamp[i] != stamp[p]);
+}
+
+static void compute_world(long i) {
+    long p = parent[i];
+    double local[16];
+
+    compute_local(i, local);
+    if (p >= 0) {
+        multiply(local, &world[p * 16], &world[i * 16]);
+        parent_stamp[i] = stamp[p];
+    } else {
+        memcpy(&world[i * 16], local, sizeof(local));
+        parent_stamp[i] = 0;
+    }
+    stamp[i] = ++next_stamp;
+    local_dirty[i] = 0;
+}
+
+/* Lazy path: bring a single slot (and its ancestors) up to date */
+static void resolve(long i) {
+    if (parent[i] >= 0) resolve(parent[i]);
+    if (needs_update(i)) compute_world(i);
+}
+
+static long depth_of(long i) {
+    if (depth[i] >= 0) return depth[i];
+    depth[i] = parent[i] >= 0 ? depth_of(parent[i]) + 1 : 0;
+    return depth[i];
+}
+
+/* Rebuild the parent-before-child visiting order with a counting sort on depth */
+static void rebuild_order(void) {
+    long i, max_depth = 0;
+    long *counts;
+
+    for (i = 0; i < high_water; i++) depth[i] = -1;
+    for (i = 0; i < high_water; i++) {
+        if (alive[i] && depth_of(i) > max_depth) max_depth = depth[i];
+    }
+
+    counts = ALLOC_N(long, max_depth + 2);
+    memset(counts, 0, sizeof(long) * (max_depth + 2));
+    for (i = 0; i < high_water; i++) {
+        if (alive[i]) counts[depth[i] + 1]++;
+    }
+    for (i = 1; i <= max_depth + 1; i++) counts[i] += counts[i - 1];
+
+    order_count = 0;
+    for (i = 0; i < high_water; i++) {
+        if (alive[i]) {
+            order[counts[depth[i]]++] = i;
+            order_count++;
+        }
+    }
+    xfree(counts);
+    hierarchy_dirty = 0;
+}
+
+static void write_floats(long i, float *out) {
+    const double *m = &world[i * 16];
+    int k;
+    for (k = 0; k < 16; k++) out[k] = (float)m[k];
+}
+
+/* alloc() -> slot */
+static VALUE rb_transform_alloc(VALUE self) {
+    long i;
+
+    if (free_count > 0) {
+        i = free_list[--free_count];
+    } else {
+        if (high_water >= capacity) grow(capacity == 0 ? 1024 : capacity * 2);
+        i = high_water++;
+    }
+
+    pos_x[i] = pos_y[i] = pos_z[i] = 0.0;
+    rot_w[i] = 1.0;
+    rot_x[i] = rot_y[i] = rot_z[i] = 0.0;
+    scale_x[i] = scale_y[i] = scale_z[i] = 1.0;
+    parent[i] = -1;
+    alive[i] = 1;
+    local_dirty[i] = 1;
+    stamp[i] = 0;
+    parent_stamp[i] = 0;
+    hierarchy_dirty = 1;
+    return LONG2NUM(i);
+}
+
+/* release(slot) */
+static VALUE rb_transform_release(VALUE self, VALUE slot) {
+    long i = check_slot(slot);
+    alive[i] = 0;
+    parent[i] = -1;
+    free_list[free_count++] = i;
+    hierarchy_dirty = 1;
+    return Qnil;
+}
+
+/* set_position(slot, x, y, z) */
+static VALUE rb_transform_set_position(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    pos_x[i] = NUM2DBL(x);
+    pos_y[i] = NUM2DBL(y);
+    pos_z[i] = NUM2DBL(z);
+    local_dirty[i] = 1;
+    return Qnil;
+}
+
+/* set_rotation(slot, w, x, y, z) - quaternion */
+static VALUE rb_transform_set_rotation(VALUE self, VALUE slot, VALUE w, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    rot_w[i] = NUM2DBL(w);
+    rot_x[i] = NUM2DBL(x);
+    rot_y[i] = NUM2DBL(y);
+    rot_z[i] = NUM2DBL(z);
+    local_dirty[i] = 1;
+    return Qnil;
+}
+
+/* set_scale(slot, x, y, z) */
+static VALUE rb_transform_set_scale(VALUE self, VALUE slot, VALUE x, VALUE y, VALUE z) {
+    long i = check_slot(slot);
+    scale_x[i] = NUM2DBL(x);
+    scale_y[i] = NUM2DBL(y);
+    scale_z[i] = NUM2DBL(z);
+    local_dirty[i] = 1;
+    return Qnil;
+}
+
+/* set_parent(slot, parent_slot) - pass -1 to detach */
+static VALUE rb_transform_set_parent(VALUE self, VALUE slot, VALUE parent_slot) {
+    long i = check_slot(slot);
+    long p = NUM2LONG(parent_slot);
+    long ancestor;
+
+    if (p >= 0) {
+        check_slot(parent_slot);
+        for (ancestor = p; ancestor >= 0; ancestor = parent[ancestor]) {
+            if (ancestor == i) rb_raise(rb_eArgError, "transform slot %ld cannot be parented to its own descendant", i);
+        }
+    }
+    parent[i] = p < 0 ? -1 : p;
+    local_dirty[i] = 1;
+    hierarchy_dirty = 1;
+    return Qnil;
+}
+
+/* update_all() -> number of world matrices recomputed */
+static VALUE rb_transform_update_all(VALUE self) {
+    long k, updated = 0;
+
+    if (hierarchy_dirty) rebuild_order();
+    for (k = 0; k < order_count; k++) {
+        long i = order[k];
+        if (needs_update(i)) {
+            compute_world(i);
+            updated++;
+        }
+    }
+    return LONG2NUM(updated);
+}
+
+/* world_version(slot) -> Integer that changes whenever the world matrix does */
+static VALUE rb_transform_world_version(VALUE self, VALUE slot) {
+    long i = check_slot(slot);
+    resolve(i);
+    return ULL2NUM(stamp[i]);
+}
+
+/* world_matrix(slot) -> Array of 16 Floats, row-major */
+static VALUE rb_transform_world_matrix(VALUE self, VALUE slot) {
+    long i = check_slot(slot);
+    VALUE result = rb_ary_new_capa(16);
+    int k;
+
+    resolve(i);
+    for (k = 0; k < 16; k++) rb_ary_push(result, DBL2NUM(world[i * 16 + k]));
+    return result;
+}
+
+/* packed_world_matrix(slot) -> 64 byte String of float32, ready for upload */
+static VALUE rb_transform_packed_world_matrix(VALUE self, VALUE slot) {
+    long i = check_slot(slot);
+    VALUE result = rb_str_new(NULL, 16 * sizeof(float));
+
+    resolve(i);
+    write_floats(i, (float *)RSTRING_PTR(result));
+    return result;
+}
+
+/* write_world_matrix(slot, buffer, byte_offset) - writes float32 in place */
+static VALUE rb_transform_write_world_matrix(VALUE self, VALUE slot, VALUE buffer, VALUE byte_offset) {
+    long i = check_slot(slot);
+    long offset = NUM2LONG(byte_offset);
+
+    Check_Type(buffer, T_STRING);
+    rb_str_modify(buffer);
+    if (offset < 0 || offset + (long)(16 * sizeof(float)) > RSTRING_LEN(buffer)) {
+        rb_raise(rb_eIndexError, "byte offset %ld out of range", offset);
+    }
+    resolve(i);
+    write_floats(i, (float *)(RSTRING_PTR(buffer) + offset));
+    return buffer;
+}
+
+/* count() -> number of live slots */
+static VALUE rb_transform_count(VALUE self) {
+    return LONG2NUM(high_water - free_count);
+}
+
+/* Extension init */
+void Init_transform_native(void) {
+    mTransformNative = rb_define_module("TransformNative");
+
+    rb_define_module_function(mTransformNative, "alloc", rb_transform_alloc, 0);
+    rb_define_module_function(mTransformNative, "release", rb_transform_release, 1);
+    rb_define_module_function(mTransformNative, "set_position", rb_transform_set_position, 4);
+    rb_define_module_function(mTransformNative, "set_rotation", rb_transform_set_rotation, 5);
+    rb_define_module_function(mTransformNative, "set_scale", rb_transform_set_scale, 4);
+    rb_define_module_function(mTransformNative, "set_parent", rb_transform_set_parent, 2);
+    rb_define_module_function(mTransformNative, "update_all", rb_transform_update_all, 0);
+    rb_define_module_function(mTransformNative, "world_version", rb_transform_world_version, 1);
+    rb_define_module_function(mTransformNative, "world_matrix", rb_transform_world_matrix, 1);
+    rb_define_module_function(mTransformNative, "packed_world_matrix", rb_transform_packed_world_matrix, 1);
+    rb_define_module_function(mTransformNative, "write_world_matrix", rb_transform_write_world_matrix, 3);
+    rb_define_module_function(mTransformNative, "count", rb_transform_count, 0);
+}
@@ -0,0 +1,212 @@
+# frozen_string_literal: true
+
+module Engine
+  # Loads meshes, textures, fonts and shaders on worker threads and finishes
+  # them on the main thread within a per-frame budget, so the first use of
+  # an asset doesn't stall the game loop.
+  #
+  # A streamable asset defines load_asset, which runs on a worker and must
+  # not touch GL, and upload_asset(payload), which runs on the main thread
+  # and returns the bytes it sent to the GPU. Until then the asset stands in
+  # with a placeholder (textures bind a white texel, meshes aren't drawn),
+  # and when_ready defers anything that needs the real thing. finish
+  # completes an asset on the spot for callers that can't wait.
+  #
+  # update runs once per frame and uploads loaded assets until
+  # upload_budget_ms or upload_budget_bytes is spent. The first upload of a
+  # frame always goes through, so one large asset can't block the queue.
+  #
+  # Streaming is off unless enabled (Engine.start(stream_assets: true));
+  # while off, stream loads and uploads straight away.
+  module AssetStreamer
+    DEFAULT_WORKER_COUNT = 2
+    DEFAULT_UPLOAD_BUDGET_MS = 2.0
+    DEFAULT_UPLOAD_BUDGET_BYTES = 8 * 1024 * 1024
+
+    # state moves :queued -> :loading -> :loaded -> :ready, or to :failed
+    # when loading or uploading raised; a failed asset stays pending. reset
+    # cancels jobs still in flight, which are then dropped instead of uploaded
+    class Job
+      attr_reader :asset, :callbacks
+      attr_accessor :state, :payload, :error, :cancelled
+
+      def initialize(asset)
+        @asset = asset
+        @callbacks = []
+        @state = :queued
+      end
+    end
+
+    # Shared with the workers, so created up front rather than on first use
+    @jobs = {}.compare_by_identity
+    @load_queue = Thread::Queue.new
+    @upload_queue = Thread::Queue.new
+    @mutex = Thread::Mutex.new
+    @loaded = Thread::ConditionVariable.new
+
+    class << self
+      attr_writer :enabled, :worker_count, :upload_budget_ms, :upload_budget_bytes
+
+      def enabled
+        @enabled || false
+      end
+
+      def worker_count
+        @worker_count ||= DEFAULT_WORKER_COUNT
+      end
+
+      def upload_budget_ms
+        @upload_budget_ms ||= DEFAULT_UPLOAD_BUDGET_MS
+      end
+
+      def upload_budget_bytes
+        @upload_budget_bytes ||= DEFAULT_UPLOAD_BUDGET_BYTES
+      end
+
+      def stream(asset)
+        return asset.upload_asset(asset.load_asset) unless enabled
+
+        job = Job.new(asset)
+        mutex.synchronize { jobs[asset] = job }
+        start_workers
+        load_queue << job
+        nil
+      end
+
+      def ready?(asset)
+        !mutex.synchronize { jobs.key?(asset) }
+      end
+
+      # Runs the block once asset is uploaded; straight away if it already is
+      def when_ready(asset, &block)
+        job = mutex.synchronize { jobs[asset] }
+        return block.call unless job
+
+        job.callbacks << block
+        nil
+      end
+
+      def pending_count
+        mutex.synchronize { jobs.size }
+      end
+
+      # Loads and uploads asset now, outside the budget, if it is still pending
+      def finish(asset)
+        job = mutex.synchronize { jobs[asset] }
+        return unless job
+
+        if claim(job)
+          load_job(job)
+        else
+          mutex.synchronize { loaded.wait(mutex) while job.state == :loading }
+        end
+        upload_job(job) unless job.state == :ready
+      end
+
+      def finish_all
+        mutex.synchronize { jobs.values }.each { |job| finish(job.asset) }
+      end
+
+      # Uploads loaded assets until this frame's budget is spent; returns
+      # how many went up
+      def update
+        started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        bytes = 0
+        uploaded = 0
+
+        until upload_queue.empty?
+          if uploaded > 0
+            elapsed_ms = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - started) * 1000
+            break if elapsed_ms >= upload_budget_ms || bytes >= upload_budget_bytes
+          end
+
+          job = upload_queue.pop
+          next if job.state == :ready || job.state == :failed || job.cancelled
+
+          bytes += upload_job(job).to_i
+          uploaded += 1
+        end
+        uploaded
+      end
+
+      # Forgets pending assets; workers stay up for the next stream. Jobs a
+      # worker is still loading are cancelled, so they are never uploaded and
+      # their when_ready blocks (for a torn down scene) never run
+      def reset
+        load_queue.clear
+        upload_queue.clear
+        mutex.synchronize do
+          jobs.each_value { |job| job.cancelled = true }
+          jobs.clear
+        end
+      end
+
+      private
+
+      def start_workers
+        @workers ||= Array.new(worker_count) do |index|
+          Thread.new do
+            Thread.current.name = "asset-streamer-#{index}"
+            while (job = load_queue.pop)
+              load_job(job) if claim(job)
+            end
+          end
+        end
+      end
+
+      # True for the one caller that gets to load a queued job
+      def claim(job)
+        mutex.synchronize do
+          next false unless job.state == :queued
+
+          job.state = :loading
+          true
+        end
+      end
+
+      def load_job(job)
+        begin
+          payload = job.asset.load_asset
+        rescue StandardError => e
+          error = e
+        end
+
+        mutex.synchronize do
+          job.payload = payload
+          job.error = error
+          job.state = :loaded
+          loaded.broadcast
+        end
+        upload_queue << job unless job.cancelled
+      end
+
+      # Errors from the worker surface here, on the main thread. The asset
+      # only becomes ready once upload_asset succeeds; a failed one stays
+      # pending (ready? is false, callbacks wait) and finish raises again
+      def upload_job(job)
+        return if job.cancelled
+
+        begin
+          raise job.error if job.error
+
+          bytes = job.asset.upload_asset(job.payload)
+        rescue StandardError => e
+          mutex.synchronize do
+            job.error = e
+            job.state = :failed
+          end
+          raise
+        end
+
+        mutex.synchronize do
+          jobs.delete(job.asset) if jobs[job.asset].equal?(job)
+          job.state = :ready
+        end
+        job.callbacks.each(&:call)
+        bytes
+      end
+
+      attr_reader :jobs, :load_queue, :upload_queue, :mutex, :loaded
+    end
+  end
+end
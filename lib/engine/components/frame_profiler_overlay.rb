@@ -0,0 +1,71 @@
+# frozen_string_literal: true
+
+module Engine::Components
+  # Top-left text readout of FrameProfiler.summary: frame time percentiles,
+  # GC and allocations, the costliest loop phases and component classes,
+  # and last frame's draw calls and state changes when GL::Stats is on.
+  # Added by FrameProfiler.show_overlay; refreshed every REFRESH_INTERVAL
+  # seconds rather than every frame, since rebuilding the text isn't free.
+  class FrameProfilerOverlay < Engine::Component
+    LINE_COUNT = 9
+    LINE_HEIGHT = 18
+    MARGIN = 8
+    Z_LAYER = 1000
+    REFRESH_INTERVAL = 0.5
+    PHASES_SHOWN = 4
+
+    def start
+      @since_refresh = REFRESH_INTERVAL
+      @lines = Array.new(LINE_COUNT) do |index|
+        top = MARGIN + index * LINE_HEIGHT
+        renderer = UI::FontRenderer.create(font: Engine::Font.jetbrains_mono, string: " ")
+        Engine::GameObject.create(
+          name: "Frame Profiler Line",
+          parent: game_object,
+          components: [
+            UI::Rect.create(
+              left_offset: MARGIN, top_offset: top,
+              bottom_ratio: 1.0, bottom_offset: -(top + LINE_HEIGHT),
+              z_layer: Z_LAYER
+            ),
+            renderer
+          ]
+        )
+        renderer
+      end
+    end
+
+    def update(delta_time)
+      @since_refresh += delta_time
+      return if @since_refresh < REFRESH_INTERVAL
+
+      @since_refresh = 0
+      text = lines(Engine::FrameProfiler.summary)
+      @lines.each_with_index { |renderer, index| renderer.update_string(text[index] || " ") }
+    end
+
+    private
+
+    def lines(summary)
+      frame_ms = summary[:frame_ms]
+      phases = summary[:phases_ms].max_by(PHASES_SHOWN) { |_, ms| ms }
+      lines = [
+        format("frame p50 %.1f p95 %.1f p99 %.1f max %.1f ms", frame_ms[:p50], frame_ms[:p95], frame_ms[:p99], frame_ms[:max]),
+        format("alloc %d/frame  gc %.2f/frame", summary[:allocated_objects], summary[:gc_runs]),
+        phases.map { |name, ms| format("%s %.2f", name, ms) }.join("  ")
+      ]
+      lines << gl_line(Engine::GL::Stats.last_frame) if Engine::GL::Stats.enabled?
+      lines + summary[:components].first(LINE_COUNT - lines.length).map do |name, stats|
+        format("%-28s %6.2f ms x%d", name.split("::").last, stats[:ms], stats[:calls].round)
+      end
+    end
+
+    def gl_line(stats)
+      format(
+        "gl %d calls  %d draws  %d tris  state %d (+%d skipped)  %d KB",
+        stats.call_count, stats.draw_calls, stats.triangles, stats.state_changes, stats.redundant_state_changes,
+        (stats.buffer_bytes + stats.texture_bytes) / 1024
+      )
+    end
+  end
+end
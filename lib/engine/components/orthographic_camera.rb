@@ -49,6 +49,15 @@ module Engine::Components
       ortho(-half_w, half_w, -half_h, half_h, @near, @far)
     end
 
+    # Pixels per world unit, for LOD selection
+    def screen_scale
+      Engine::Window.framebuffer_height / @height.to_f
+    end
+
+    def perspective?
+      false
+    end
+
     def update(delta_time)
       if game_object.world_transform_version != @cached_transform_version
         @matrix = nil
@@ -50,6 +50,15 @@ module Engine::Components
       perspective(fov_radians, @aspect, @near, @far)
     end
 
+    # Pixels one world unit covers at distance 1, for LOD selection
+    def screen_scale
+      Engine::Window.framebuffer_height / (2 * Math.tan(@fov * Math::PI / 360.0))
+    end
+
+    def perspective?
+      true
+    end
+
     def view_matrix
       right = game_object.right
       up = game_object.up
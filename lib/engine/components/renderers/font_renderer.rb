@@ -8,12 +8,12 @@ module Engine::Components
 
     private
 
-    def shader
-      @shader ||= Engine::Shader.text
+    def text_pass
+      :world
     end
 
-    def set_shader_camera_matrix
-      shader.set_mat4("camera", Engine::Camera.instance.matrix)
+    def packed_model_matrix
+      TransformNative.packed_world_matrix(game_object.transform_slot)
     end
   end
 end
@@ -5,6 +5,8 @@ module Engine::Components
     serialize :mesh, :material, :static
 
     attr_reader :mesh, :material, :static
+    # Handle into the InstanceRenderer batch, assigned while this renderer is drawn
+    attr_accessor :instance_handle
 
     def awake
       @static = false if @static.nil?
@@ -13,19 +15,25 @@ module Engine::Components
     end
 
     def renderer_key
-      @renderer_key ||= [mesh, material].freeze
+      @renderer_key ||= [mesh, material, static].freeze
     end
 
     def renderer?
       true
     end
 
+    # A streaming mesh is drawn from when it arrives
     def start
-      Rendering::RenderPipeline.add_instance(self)
+      Engine::AssetStreamer.when_ready(mesh) do
+        next if destroyed?
+
+        @added = true
+        Rendering::RenderPipeline.add_instance(self)
+      end
     end
 
     def sync_transform
-      return if static
+      return if static || !@added
 
       version = game_object.world_transform_version
       return if @last_synced_version == version
@@ -35,7 +43,7 @@ module Engine::Components
     end
 
     def destroy
-      Rendering::RenderPipeline.remove_instance(self)
+      Rendering::RenderPipeline.remove_instance(self) if @added
     end
   end
 end
@@ -16,22 +16,11 @@ module Engine::Components
 
       private
 
-      def shader
-        @shader ||= Engine::Shader.ui_text
+      def text_pass
+        :ui
       end
 
-      def set_shader_camera_matrix
-        # Y-down coordinate system: (0,0) at top-left, Y increases downward
-        camera_matrix = Matrix[
-          [2.0 / Engine::Window.framebuffer_width, 0, 0, 0],
-          [0, -2.0 / Engine::Window.framebuffer_height, 0, 0],
-          [0, 0, 1, 0],
-          [-1, 1, 0, 1]
-        ]
-        shader.set_mat4("camera", camera_matrix)
-      end
-
-      def set_shader_model_matrix
+      def packed_model_matrix
         rect = @ui_rect.computed_rect
 
         # Scale text to match rect height
@@ -43,14 +32,12 @@ module Engine::Components
         x = rect.left + (scale * 0.5)
         y = rect.top + (scale * 0.5)
 
-        model_matrix = Matrix[
-          [scale, 0, 0, 0],
-          [0, scale, 0, 0],
-          [0, 0, 1, 0],
-          [x, y, 0, 1]
-        ]
-
-        shader.set_mat4("model", model_matrix)
+        [
+          scale, 0, 0, 0,
+          0, scale, 0, 0,
+          0, 0, 1, 0,
+          x, y, 0, 1
+        ].pack('F16')
       end
     end
   end
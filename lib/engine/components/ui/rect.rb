@@ -20,8 +20,13 @@ module Engine::Components
       def self.draw_all
         rects.each do |rect|
           Rendering::UI::StencilManager.setup_for_rect(rect)
-          rect.game_object.ui_renderers.each(&:draw)
+          rect.game_object.ui_renderers.each do |renderer|
+            # Batched draws go out first so they stay under other renderers
+            Rendering::UI::Batcher.flush unless renderer.is_a?(FontRendererBase) || renderer.is_a?(UI::SpriteRenderer)
+            renderer.draw
+          end
         end
+        Rendering::UI::Batcher.flush
         Rendering::UI::StencilManager.reset
       end
 
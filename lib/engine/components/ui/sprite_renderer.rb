@@ -2,10 +2,16 @@
 
 module Engine::Components
   module UI
+    # Sprites whose material uses Shader.ui_sprite and whose image fits in
+    # Rendering::UI::SpriteAtlas are drawn by Rendering::UI::SpriteBatch;
+    # any other material is drawn on its own with a quad per sprite.
     class SpriteRenderer < Engine::Component
       serialize :material
 
-      attr_reader :material
+      attr_reader :material, :sprite_instance
+
+      # Colour of a ui_sprite material with no spriteColor set (the uniform's zero)
+      NO_COLOUR = [0, 0, 0, 0].freeze
 
       def ui_renderer?
         true
@@ -15,13 +21,47 @@ module Engine::Components
         @ui_rect = game_object.component(UI::Rect)
         raise "UI::SpriteRenderer requires a UI::Rect component on the same GameObject" unless @ui_rect
 
-        setup_vertex_attribute_buffer
-        setup_index_buffer
-        setup_vertex_buffer
-        Engine::GL.BindVertexArray(0)
+        # Packs the image into the atlas while the scene loads
+        atlas_region
       end
 
       def draw
+        return if Rendering::UI::SpriteBatch.instance.queue(self)
+
+        # Drawn straight away, so whatever is queued goes under it first
+        Rendering::UI::Batcher.flush
+        draw_unbatched
+      end
+
+      # Called by SpriteBatch once per frame; true when the instance changed.
+      # sprite_instance is nil when the material can't be batched
+      def refresh_sprite_instance
+        instance = batch_instance
+        return false if instance == @sprite_instance
+
+        @sprite_instance = instance
+        true
+      end
+
+      private
+
+      def batch_instance
+        region = atlas_region
+        return unless region
+
+        rect = @ui_rect.computed_rect
+        colour = material.vec4("spriteColor") || NO_COLOUR
+        [rect.left, rect.top, rect.right, rect.bottom, *region, *colour].pack('F*')
+      end
+
+      def atlas_region
+        return unless material.shader.equal?(Engine::Shader.ui_sprite)
+
+        Rendering::UI::SpriteAtlas.instance.region_for(material.texture_value("image"))
+      end
+
+      def draw_unbatched
+        setup_buffers unless @vao
         rect = @ui_rect.computed_rect
 
         Engine::GL.BindVertexArray(@vao)
@@ -33,7 +73,13 @@ module Engine::Components
         Engine::GL.DrawElements(Engine::GL::TRIANGLES, 6, Engine::GL::UNSIGNED_INT, 0)
       end
 
-      private
+      # Only sprites that are ever drawn unbatched need their own quad
+      def setup_buffers
+        setup_vertex_attribute_buffer
+        setup_index_buffer
+        setup_vertex_buffer
+        Engine::GL.BindVertexArray(0)
+      end
 
       def set_material_per_frame_data
         set_camera_matrix
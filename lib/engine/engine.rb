@@ -4,11 +4,15 @@ GAME_DIR = File.expand_path(File.dirname($PROGRAM_NAME))
 ENGINE_DIR = File.expand_path(File.dirname(__FILE__))
 
 module Engine
-  def self.start(close_key: Input::KEY_ESCAPE, debug_key: nil, fullscreen_key: nil, opengl_version: nil, &first_frame_block)
+  # stream_assets loads assets in the background and uploads them within
+  # a per-frame budget (see AssetStreamer)
+  def self.start(close_key: Input::KEY_ESCAPE, debug_key: nil, fullscreen_key: nil, opengl_version: nil,
+                 stream_assets: false, &first_frame_block)
     Engine::AutoLoader.load
     return if ENV["BUILDING"] == "true"
 
     Window.opengl_version = opengl_version if opengl_version
+    AssetStreamer.enabled = stream_assets
     Input.close_key = close_key
     Input.debug_key = debug_key
     Input.fullscreen_key = fullscreen_key
@@ -18,6 +22,16 @@ module Engine
     terminate
   end
 
+  # Seconds each frame advances by instead of the wall clock, for
+  # deterministic runs such as bench/; nil uses real time
+  def self.fixed_delta_time=(seconds)
+    @fixed_delta_time = seconds
+  end
+
+  def self.fixed_delta_time
+    @fixed_delta_time
+  end
+
   def self.engine_started?
     @engine_started
   end
@@ -31,7 +45,9 @@ module Engine
     Engine::GL.InitGLEW
 
     Input.init
-    Rendering::GpuTimer.enable if ENV['GPU_PROFILE']
+    FrameProfiler.enable if ENV['FRAME_PROFILE']
+    GL::Stats.enable if ENV['GL_STATS']
+    Rendering::GpuTimer.enable(report: !ENV['GPU_PROFILE'].nil?) if ENV['GPU_PROFILE'] || ENV['GPU_TRACE']
 
     set_opengl_blend_mode
     @engine_started = true
@@ -52,6 +68,7 @@ module Engine
     Engine::GL.Clear(Engine::GL::COLOR_BUFFER_BIT | Engine::GL::DEPTH_BUFFER_BIT)
 
     until GLFW.WindowShouldClose(Window.window) == GLFW::TRUE || @game_stopped
+      FrameProfiler.begin_frame
       if first_frame_block
         first_frame_block.call
         first_frame_block = nil
@@ -59,19 +76,17 @@ module Engine
 
       @old_time = @time || Time.now
       @time = Time.now
-      delta_time = @time - @old_time
+      delta_time = @fixed_delta_time || @time - @old_time
 
       print_fps(delta_time)
-      Physics::PhysicsResolver.resolve
-      GameObject.update_all(delta_time)
+      FrameProfiler.phase(:physics) { Physics::PhysicsWorld.simulate(delta_time) }
+      FrameProfiler.phase(:update) { GameObject.update_all(delta_time) }
 
-      @swap_buffers_promise.wait! if @swap_buffers_promise
+      FrameProfiler.phase(:swap_wait) { @swap_buffers_promise.wait! } if @swap_buffers_promise
 
-      Rendering::RenderPipeline.draw unless @game_stopped
-
-      if Screenshoter.scheduled_screenshot
-        Screenshoter.take_screenshot
-      end
+      FrameProfiler.phase(:asset_uploads) { AssetStreamer.update }
+      FrameProfiler.phase(:draw) { Rendering::RenderPipeline.draw } unless @game_stopped
+      FrameProfiler.phase(:screenshots) { Screenshoter.update(delta_time) }
 
       Window.get_framebuffer_size
 
@@ -84,12 +99,16 @@ module Engine
       else
         # GLX requires SwapBuffers on the thread owning the context, so
         # Windows and Linux swap synchronously
-        GLFW.SwapBuffers(Window.window)
+        FrameProfiler.phase(:swap) { GLFW.SwapBuffers(Window.window) }
       end
 
       Engine::Input.update_key_states
-      GLFW.PollEvents
+      FrameProfiler.phase(:events) { GLFW.PollEvents }
+      GL::Stats.end_frame
+      FrameProfiler.end_frame
     end
+
+    Screenshoter.finish
   end
 
   def self.fps
@@ -109,11 +128,14 @@ module Engine
     GameObject.destroy_all
     Component.erase_destroyed_components
     GameObject.erase_destroyed_objects
+    Physics::PhysicsWorld.reset
   end
 
   private
 
   def self.terminate
+    FrameProfiler.dump(ENV['FRAME_PROFILE_DUMP']) if ENV['FRAME_PROFILE_DUMP'] && FrameProfiler.enabled?
+    Rendering::GpuTimer.export_trace(ENV['GPU_TRACE']) if ENV['GPU_TRACE'] && Rendering::GpuTimer.enabled?
     GLFW.DestroyWindow(Window.window)
     GLFW.Terminate
   end
@@ -11,6 +11,10 @@ module Engine
     TEXTURE_SIZE = 1024
     GLYPH_COUNT = 16
     CELL_SIZE = TEXTURE_SIZE / GLYPH_COUNT
+    ADVANCE_SCALE = 30 / (1024.0 * 2)
+    LAYOUT_CACHE_SIZE = 512
+
+    Layout = Struct.new(:glyph_count, :instance_data)
 
     def self.for(font_file_path, source: :game)
       cache_key = [font_file_path, source]
@@ -57,6 +61,29 @@ module Engine
       { font_file_path: @font_file_path, source: @source }
     end
 
+    # While streaming, the metrics and atlas load in the background;
+    # otherwise both load on first use
+    def awake
+      return unless AssetStreamer.enabled
+
+      texture
+      AssetStreamer.stream(self)
+    end
+
+    def load_asset
+      JSON.parse(File.read(resolve_font_json_path))
+    end
+
+    def upload_asset(metrics)
+      @font_metrics = metrics
+      0
+    end
+
+    def font_metrics
+      AssetStreamer.finish(self)
+      @font_metrics ||= load_asset
+    end
+
     def texture
       @texture ||=
         begin
@@ -65,33 +92,32 @@ module Engine
         end
     end
 
-    def vertex_data(string)
-      text_indices = string_indices(string)
-      offsets = string_offsets(string)
-      text_indices.zip(offsets).flatten
+    # Glyph instances for a string, as drawn by Rendering::TextBatch:
+    # glyph_count and packed [atlas index (int32), x, y (float32)] per glyph.
+    # Cached per string, since HUD text mostly cycles through the same values.
+    def layout(string)
+      layouts[string] ||= begin
+        layouts.shift if layouts.length >= LAYOUT_CACHE_SIZE
+        build_layout(string)
+      end
     end
 
     def string_indices(string)
-      string.chars.reject{|c| c == "\n"}.map { |char| index_table[char] }
+      string.chars.reject{|c| c == "\n"}.map { |char| glyph_index(char) }
     end
 
     def string_offsets(string)
       offsets = []
-      scale_factor = 1 / (1024.0 * 2)
       horizontal_offset = 0.0
       vertical_offset = 0.0
-      font_path = resolve_font_json_path
-      font_metrics = JSON.parse File.read(font_path)
-      string.chars.each do |char|
+      string.each_char do |char|
         if char == "\n"
           vertical_offset -= 1.0
           horizontal_offset = 0.0
           next
         end
         offsets << [horizontal_offset, vertical_offset]
-        idx = index_table[char]
-        original_idx = (idx / GLYPH_COUNT) * GLYPH_COUNT + (GLYPH_COUNT - 1 - idx % GLYPH_COUNT)
-        horizontal_offset += 30 * scale_factor * font_metrics[original_idx.to_s]["width"]
+        horizontal_offset += advances[glyph_index(char)]
       end
       offsets
     end
@@ -106,6 +132,51 @@ module Engine
 
     private
 
+    def layouts
+      @layouts ||= {}
+    end
+
+    def build_layout(string)
+      values = []
+      horizontal_offset = 0.0
+      vertical_offset = 0.0
+      string.each_char do |char|
+        if char == "\n"
+          vertical_offset -= 1.0
+          horizontal_offset = 0.0
+          next
+        end
+        index = glyph_index(char)
+        values.push(index, horizontal_offset, vertical_offset)
+        horizontal_offset += advances[index]
+      end
+      glyph_count = values.length / 3
+      Layout.new(glyph_count, values.pack("lFF" * glyph_count).freeze).freeze
+    end
+
+    # Horizontal advance per atlas index, read from the metrics once. The
+    # metrics are keyed by unflipped index, the atlas by flipped index.
+    def advances
+      @advances ||= Array.new(GLYPH_COUNT * GLYPH_COUNT) do |index|
+        original_index = (index / GLYPH_COUNT) * GLYPH_COUNT + (GLYPH_COUNT - 1 - index % GLYPH_COUNT)
+        width = font_metrics.dig(original_index.to_s, "width")
+        width && ADVANCE_SCALE * width
+      end.freeze
+    end
+
+    def glyph_index(char)
+      glyph_indices[char.ord]
+    end
+
+    # index_table by codepoint, for lookups without hashing a String
+    def glyph_indices
+      @glyph_indices ||= begin
+        indices = []
+        index_table.each { |char, index| indices[char.ord] = index }
+        indices.freeze
+      end
+    end
+
     def character(index)
       (index + 1).chr
     end
@@ -0,0 +1,177 @@
+# frozen_string_literal: true
+
+require "json"
+
+module Engine
+  # CPU time per game loop phase and per component class, for finding out
+  # what made a frame spike.
+  #
+  # The loop wraps physics, component updates, asset uploads, transform
+  # sync, drawing, screenshots and the buffer swap in phase blocks; phases
+  # nest, so physics_resolve is also counted in physics. While enabled,
+  # GameObject.update_all times every component's update, summed per class
+  # with a call count. end_frame closes the frame with its total time and
+  # GC.stat deltas: objects allocated and minor/major collections.
+  #
+  # The last HISTORY frames are kept. summary gives p50/p95/p99 frame times
+  # and per-phase and per-component averages over them, dump writes them as
+  # CSV or JSON, and show_overlay draws the summary with the UI font
+  # renderer.
+  #
+  # Off unless enabled (FRAME_PROFILE=1); while off, phase is a bare yield
+  # and update_all keeps its plain loop.
+  module FrameProfiler
+    HISTORY = 600
+    PERCENTILES = [50, 95, 99].freeze
+
+    Frame = Struct.new(:number, :frame_ms, :phases, :components, :allocated_objects, :minor_gc, :major_gc)
+
+    @frames = []
+
+    class << self
+      def enabled?
+        @enabled || false
+      end
+
+      def enable
+        @enabled = true
+        reset
+      end
+
+      def disable
+        @enabled = false
+        @current = nil
+      end
+
+      def reset
+        @frames = []
+        @frame_number = 0
+        @current = nil
+      end
+
+      def frames
+        @frames
+      end
+
+      def begin_frame
+        return unless enabled?
+
+        @frame_number += 1
+        @current = Frame.new(@frame_number, 0.0, Hash.new(0.0), {}, *gc_counters)
+        @frame_started = now
+      end
+
+      def end_frame
+        return unless enabled? && @current
+
+        frame = @current
+        @current = nil
+        frame.frame_ms = (now - @frame_started) * 1000
+        allocated, minor, major = gc_counters
+        frame.allocated_objects = allocated - frame.allocated_objects
+        frame.minor_gc = minor - frame.minor_gc
+        frame.major_gc = major - frame.major_gc
+
+        @frames << frame
+        @frames.shift if @frames.length > HISTORY
+        frame
+      end
+
+      def phase(name)
+        return yield unless @current
+
+        started = now
+        begin
+          yield
+        ensure
+          @current.phases[name] += (now - started) * 1000
+        end
+      end
+
+      def component_update(component, delta_time)
+        started = now
+        component.update(delta_time)
+      ensure
+        if @current
+          stats = @current.components[component.class] ||= [0.0, 0]
+          stats[0] += (now - started) * 1000
+          stats[1] += 1
+        end
+      end
+
+      # Nearest-rank percentile of the kept frame times
+      def percentile(percent)
+        return 0.0 if @frames.empty?
+
+        sorted = @frames.map(&:frame_ms).sort
+        sorted[[(percent / 100.0 * sorted.length).ceil - 1, 0].max]
+      end
+
+      def summary
+        count = [@frames.length, 1].max
+        phases = Hash.new(0.0)
+        components = Hash.new { |hash, key| hash[key] = { ms: 0.0, calls: 0 } }
+        @frames.each do |frame|
+          frame.phases.each { |name, ms| phases[name] += ms }
+          frame.components.each do |klass, (ms, calls)|
+            components[klass.to_s][:ms] += ms
+            components[klass.to_s][:calls] += calls
+          end
+        end
+
+        {
+          frames: @frames.length,
+          frame_ms: PERCENTILES.to_h { |p| [:"p#{p}", percentile(p)] }.merge(max: @frames.map(&:frame_ms).max || 0.0),
+          phases_ms: phases.transform_values { |ms| ms / count },
+          components: components.sort_by { |_, stats| -stats[:ms] }.to_h do |name, stats|
+            [name, { ms: stats[:ms] / count, calls: stats[:calls].fdiv(count) }]
+          end,
+          allocated_objects: @frames.sum(&:allocated_objects).fdiv(count),
+          gc_runs: @frames.sum { |frame| frame.minor_gc + frame.major_gc }.fdiv(count)
+        }
+      end
+
+      # CSV for .csv paths, JSON otherwise
+      def dump(path)
+        File.write(path, File.extname(path) == ".csv" ? csv : json)
+      end
+
+      def csv
+        phase_names = @frames.flat_map { |frame| frame.phases.keys }.uniq
+        lines = [["frame", "frame_ms", *phase_names, "allocated_objects", "minor_gc", "major_gc"].join(",")]
+        @frames.each do |frame|
+          phase_ms = phase_names.map { |name| format("%.3f", frame.phases.fetch(name, 0.0)) }
+          lines << [frame.number, format("%.3f", frame.frame_ms), *phase_ms,
+                    frame.allocated_objects, frame.minor_gc, frame.major_gc].join(",")
+        end
+        lines.join("\n") << "\n"
+      end
+
+      def json
+        JSON.pretty_generate(
+          summary: summary,
+          frames: @frames.map do |frame|
+            frame.to_h.merge(components: frame.components.to_h do |klass, (ms, calls)|
+              [klass.to_s, { ms:, calls: }]
+            end)
+          end
+        )
+      end
+
+      def show_overlay
+        enable unless enabled?
+        GameObject.create(name: "Frame Profiler", components: [Components::FrameProfilerOverlay.create])
+      end
+
+      private
+
+      def gc_counters
+        [GC.stat(:total_allocated_objects), GC.stat(:minor_gc_count), GC.stat(:major_gc_count)]
+      end
+
+      def now
+        Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      end
+    end
+  end
+end
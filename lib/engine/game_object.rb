@@ -1,4 +1,5 @@
 require "matrix"
+require "transform_native"
 
 module Engine
   class GameObject
@@ -31,6 +32,7 @@ module Engine
 
       # Normalize pos to ensure 3 components
       @pos = Vector[@pos[0], @pos[1], @pos[2] || 0]
+      sync_native_transform
 
       # Split components by type (handles both .create with mixed array and deserialization with separate arrays)
       all_components = (@components || []) + (@renderers || []) + (@ui_renderers || [])
@@ -90,17 +92,20 @@ module Engine
       @parent.children.delete(self) if @parent
       @parent = parent
       @local_version += 1
+      TransformNative.set_parent(transform_slot, parent ? parent.transform_slot : -1)
       parent.children << self if parent
     end
 
     def pos=(value)
       @pos = value
       @local_version += 1
+      TransformNative.set_position(transform_slot, value[0], value[1], value[2] || 0)
     end
 
     def scale=(value)
       @scale = value
       @local_version += 1
+      TransformNative.set_scale(transform_slot, value[0], value[1], value[2])
     end
 
     def rotation
@@ -112,6 +117,7 @@ module Engine
 
       @rotation_quaternion = value
       @local_version += 1
+      TransformNative.set_rotation(transform_slot, value.w, value.x, value.y, value.z)
     end
 
     def euler_angles
@@ -123,8 +129,7 @@ module Engine
     end
 
     def x=(value)
-      @pos = Vector[value, y, z]
-      @local_version += 1
+      self.pos = Vector[value, y, z]
     end
 
     def y
@@ -132,8 +137,7 @@ module Engine
     end
 
     def y=(value)
-      @pos = Vector[x, value, z]
-      @local_version += 1
+      self.pos = Vector[x, value, z]
     end
 
     def z
@@ -141,8 +145,7 @@ module Engine
     end
 
     def z=(value)
-      @pos = Vector[x, y, value]
-      @local_version += 1
+      self.pos = Vector[x, y, value]
     end
 
     def world_pos
@@ -172,8 +175,15 @@ module Engine
       self.rotation = rotation_quaternion * rotation
     end
 
+    # Index of this object's TRS in the native transform store. World
+    # matrices for every object are resolved there, either lazily per object
+    # or in one batched pass per frame (see RenderPipeline.sync_transforms).
+    def transform_slot
+      @transform_slot ||= TransformNative.alloc
+    end
+
     def world_transform_version
-      @local_version + (@parent&.world_transform_version || 0)
+      TransformNative.world_version(transform_slot)
     end
 
     def model_matrix
@@ -187,35 +197,14 @@ module Engine
       @cached_forward = nil
 
       @cached_world_version = current_version
-      @cached_world_matrix = compute_world_matrix
+      @cached_world_matrix = Matrix.rows(TransformNative.world_matrix(transform_slot).each_slice(4).to_a, false)
     end
 
-    private def compute_local_matrix
-      rot = euler_angles * Math::PI / 180
-
-      cos_x = Math.cos(rot[0])
-      cos_y = Math.cos(rot[1])
-      cos_z = Math.cos(rot[2])
-
-      sin_x = Math.sin(rot[0])
-      sin_y = Math.sin(rot[1])
-      sin_z = Math.sin(rot[2])
-
-      Matrix[
-        [scale[0] * (cos_y * cos_z), scale[0] * (-cos_y * sin_z), scale[0] * sin_y, 0],
-        [scale[1] * (cos_x * sin_z + sin_x * sin_y * cos_z), scale[1] * (cos_x * cos_z - sin_x * sin_y * sin_z), scale[1] * -sin_x * cos_y, 0],
-        [scale[2] * (sin_x * sin_z - cos_x * sin_y * cos_z), scale[2] * (sin_x * cos_z + cos_x * sin_y * sin_z), scale[2] * cos_x * cos_y, 0],
-        [x, y, z, 1]
-      ]
-    end
-
-    private def compute_world_matrix
-      local = compute_local_matrix
-      if parent
-        local * parent.model_matrix
-      else
-        local
-      end
+    private def sync_native_transform
+      TransformNative.set_position(transform_slot, @pos[0], @pos[1], @pos[2])
+      TransformNative.set_rotation(transform_slot, @rotation_quaternion.w, @rotation_quaternion.x, @rotation_quaternion.y, @rotation_quaternion.z)
+      TransformNative.set_scale(transform_slot, @scale[0], @scale[1], @scale[2])
+      TransformNative.set_parent(transform_slot, @parent ? @parent.transform_slot : -1)
     end
 
     def destroyed?
@@ -237,6 +226,7 @@ module Engine
     def _erase!
       GameObject.objects.delete(self)
       parent.children.delete(self) if parent
+      TransformNative.release(@transform_slot) if @transform_slot
       name = @name
       self.class.instance_variable_get(:@methods).each do |method|
         singleton_class.send(:undef_method, method)
@@ -273,8 +263,14 @@ module Engine
     end
 
     def self.update_all(delta_time)
-      GameObject.objects.each do |object|
-        object.components.each { |component| component.update(delta_time) }
+      if FrameProfiler.enabled?
+        GameObject.objects.each do |object|
+          object.components.each { |component| FrameProfiler.component_update(component, delta_time) }
+        end
+      else
+        GameObject.objects.each do |object|
+          object.components.each { |component| component.update(delta_time) }
+        end
       end
 
       Component.erase_destroyed_components
@@ -6,17 +6,18 @@ module Engine
     def self.InitGLEW
       GLNative.init_glew
     end
-    # Cached methods - avoid redundant GL state changes
+    # Cached methods - avoid redundant GL state changes (GL::Stats counts
+    # the skipped calls)
 
     def self.Enable(flag)
-      return if enable_flag_cache[flag] == true
+      return Stats.skipped(:Enable) if enable_flag_cache[flag] == true
 
       enable_flag_cache[flag] = true
       GLNative.enable(flag)
     end
 
     def self.Disable(flag)
-      return if enable_flag_cache[flag] == false
+      return Stats.skipped(:Disable) if enable_flag_cache[flag] == false
 
       enable_flag_cache[flag] = false
       GLNative.disable(flag)
@@ -27,14 +28,14 @@ module Engine
     end
 
     def self.UseProgram(program)
-      return if @current_program == program
+      return Stats.skipped(:UseProgram) if @current_program == program
 
       @current_program = program
       GLNative.use_program(program)
     end
 
     def self.ActiveTexture(texture_unit)
-      return if @current_texture_unit == texture_unit
+      return Stats.skipped(:ActiveTexture) if @current_texture_unit == texture_unit
 
       @current_texture_unit = texture_unit
       GLNative.active_texture(texture_unit)
@@ -42,7 +43,7 @@ module Engine
 
     def self.BindTexture(target, texture_id)
       cache_key = [@current_texture_unit, target]
-      return if bound_textures[cache_key] == texture_id
+      return Stats.skipped(:BindTexture) if bound_textures[cache_key] == texture_id
 
       bound_textures[cache_key] = texture_id
       GLNative.bind_texture(target, texture_id)
@@ -52,6 +53,21 @@ module Engine
       @bound_textures ||= {}
     end
 
+    # Replays a CommandBuffer natively, then brings the caches above in line
+    # with the bindings it left behind
+    def self.Execute(commands)
+      return 0 if commands.empty?
+
+      executed = GLNative.execute(commands.data)
+      Stats.replayed(commands) if Stats.enabled?
+      @current_vertex_array = commands.vertex_array unless commands.vertex_array.nil?
+      @current_program = commands.program unless commands.program.nil?
+      bound_buffers.merge!(commands.buffers)
+      @current_texture_unit = commands.texture_unit unless commands.texture_unit.nil?
+      commands.textures.each { |(unit, target), texture| bound_textures[[unit, target]] = texture }
+      executed
+    end
+
     # Pass-through methods
 
     def self.AttachShader(program, shader)
@@ -63,7 +79,7 @@ module Engine
     end
 
     def self.BindBuffer(target, buffer)
-      return if bound_buffers[target] == buffer
+      return Stats.skipped(:BindBuffer) if bound_buffers[target] == buffer
 
       bound_buffers[target] = buffer
       GLNative.bind_buffer(target, buffer)
@@ -73,6 +89,12 @@ module Engine
       @bound_buffers ||= {}
     end
 
+    # Also binds the generic target, so keep the BindBuffer cache in step
+    def self.BindBufferBase(target, index, buffer)
+      bound_buffers[target] = buffer
+      GLNative.bind_buffer_base(target, index, buffer)
+    end
+
     def self.BindFramebuffer(target, framebuffer)
       GLNative.bind_framebuffer(target, framebuffer)
     end
@@ -82,7 +104,7 @@ module Engine
     end
 
     def self.BindVertexArray(array)
-      return if @current_vertex_array == array
+      return Stats.skipped(:BindVertexArray) if @current_vertex_array == array
 
       @current_vertex_array = array
       GLNative.bind_vertex_array(array)
@@ -104,6 +126,18 @@ module Engine
       GLNative.buffer_sub_data(target, offset, size, data)
     end
 
+    def self.BufferStorage(target, size, data, flags)
+      GLNative.buffer_storage(target, size, data, flags)
+    end
+
+    def self.BufferStorageSupported
+      GLNative.buffer_storage_supported
+    end
+
+    def self.ClientWaitSync(sync, flags, timeout)
+      GLNative.client_wait_sync(sync, flags, timeout)
+    end
+
     def self.CheckFramebufferStatus(target)
       GLNative.check_framebuffer_status(target)
     end
@@ -124,6 +158,10 @@ module Engine
       GLNative.compile_shader(shader)
     end
 
+    def self.CompressedTexImage2D(target, level, internalformat, width, height, border, data)
+      GLNative.compressed_tex_image_2d(target, level, internalformat, width, height, border, data)
+    end
+
     def self.CreateProgram
       GLNative.create_program
     end
@@ -136,6 +174,16 @@ module Engine
       GLNative.cull_face(mode)
     end
 
+    def self.DeleteBuffers(n, buffers)
+      ids = buffers.unpack("L#{n}")
+      bound_buffers.delete_if { |_target, buffer| ids.include?(buffer) }
+      GLNative.delete_buffers(n, buffers)
+    end
+
+    def self.DeleteSync(sync)
+      GLNative.delete_sync(sync)
+    end
+
     def self.DepthFunc(func)
       GLNative.depth_func(func)
     end
@@ -172,10 +220,18 @@ module Engine
       GLNative.end_query(target)
     end
 
+    def self.FenceSync(condition, flags)
+      GLNative.fence_sync(condition, flags)
+    end
+
     def self.Finish
       GLNative.finish
     end
 
+    def self.FramebufferTexture(target, attachment, texture, level)
+      GLNative.framebuffer_texture(target, attachment, texture, level)
+    end
+
     def self.FramebufferTexture2D(target, attachment, textarget, texture, level)
       GLNative.framebuffer_texture_2d(target, attachment, textarget, texture, level)
     end
@@ -212,6 +268,10 @@ module Engine
       GLNative.get_error
     end
 
+    def self.GetInteger64v(pname, params)
+      GLNative.get_integer64v(pname, params)
+    end
+
     def self.GetProgramInfoLog(program, max_length, length, info_log)
       GLNative.get_program_info_log(program, max_length, length, info_log)
     end
@@ -232,6 +292,10 @@ module Engine
       GLNative.get_string(name)
     end
 
+    def self.GetUniformBlockIndex(program, name)
+      GLNative.get_uniform_block_index(program, name)
+    end
+
     def self.GetUniformLocation(program, name)
       GLNative.get_uniform_location(program, name)
     end
@@ -244,14 +308,26 @@ module Engine
       GLNative.link_program(program)
     end
 
+    def self.MapBufferRange(target, offset, length, access)
+      GLNative.map_buffer_range(target, offset, length, access)
+    end
+
     def self.MemoryBarrier(barriers)
       GLNative.memory_barrier(barriers)
     end
 
+    def self.QueryCounter(id, target)
+      GLNative.query_counter(id, target)
+    end
+
     def self.ReadBuffer(mode)
       GLNative.read_buffer(mode)
     end
 
+    def self.ReadMappedBuffer(address, offset, length)
+      GLNative.read_mapped_buffer(address, offset, length)
+    end
+
     def self.ReadPixels(x, y, width, height, format, type, data)
       GLNative.read_pixels(x, y, width, height, format, type, data)
     end
@@ -288,6 +364,14 @@ module Engine
       GLNative.tex_parameteri(target, pname, param)
     end
 
+    def self.TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, data)
+      GLNative.tex_sub_image_2d(target, level, xoffset, yoffset, width, height, format, type, data)
+    end
+
+    def self.UnmapBuffer(target)
+      GLNative.unmap_buffer(target)
+    end
+
     def self.Uniform1f(location, v0)
       GLNative.uniform1f(location, v0)
     end
@@ -308,10 +392,34 @@ module Engine
       GLNative.uniform4f(location, v0, v1, v2, v3)
     end
 
+    def self.Uniform1fv(location, count, value)
+      GLNative.uniform1fv(location, count, value)
+    end
+
+    def self.Uniform2fv(location, count, value)
+      GLNative.uniform2fv(location, count, value)
+    end
+
+    def self.Uniform3fv(location, count, value)
+      GLNative.uniform3fv(location, count, value)
+    end
+
+    def self.Uniform4fv(location, count, value)
+      GLNative.uniform4fv(location, count, value)
+    end
+
+    def self.Uniform1iv(location, count, value)
+      GLNative.uniform1iv(location, count, value)
+    end
+
     def self.UniformMatrix4fv(location, count, transpose, value)
       GLNative.uniform_matrix4fv(location, count, transpose, value)
     end
 
+    def self.UniformBlockBinding(program, block_index, binding)
+      GLNative.uniform_block_binding(program, block_index, binding)
+    end
+
     def self.VertexAttribDivisor(index, divisor)
       GLNative.vertex_attrib_divisor(index, divisor)
     end
@@ -324,9 +432,13 @@ module Engine
       GLNative.vertex_attrib_pointer(index, size, type, normalized, stride, pointer)
     end
 
+    def self.WriteMappedBuffer(address, offset, data, data_offset, length)
+      GLNative.write_mapped_buffer(address, offset, data, data_offset, length)
+    end
+
     def self.Viewport(x, y, width, height)
       viewport = [x, y, width, height]
-      return if @current_viewport == viewport
+      return Stats.skipped(:Viewport) if @current_viewport == viewport
 
       @current_viewport = viewport
       GLNative.viewport(x, y, width, height)
@@ -334,6 +446,7 @@ module Engine
 
     # Constants (hardcoded OpenGL values)
 
+    ALREADY_SIGNALED = 0x911A
     ALWAYS = 0x0207
     ARRAY_BUFFER = 0x8892
     BACK = 0x0405
@@ -343,7 +456,10 @@ module Engine
     COLOR_ATTACHMENT0 = 0x8CE0
     COLOR_ATTACHMENT1 = 0x8CE1
     COLOR_BUFFER_BIT = 0x4000
+    COMPRESSED_RGB_S3TC_DXT1_EXT = 0x83F0
+    COMPRESSED_RGBA_S3TC_DXT5_EXT = 0x83F3
     COMPUTE_SHADER = 0x91B9
+    CONDITION_SATISFIED = 0x911C
     CULL_FACE = 0x0B44
     DEPTH24_STENCIL8 = 0x88F0
     DEPTH_ATTACHMENT = 0x8D00
@@ -356,6 +472,7 @@ module Engine
     DEPTH_TEST = 0x0B71
     DRAW_FRAMEBUFFER = 0x8CA9
     DYNAMIC_DRAW = 0x88E8
+    DYNAMIC_STORAGE_BIT = 0x0100
     ELEMENT_ARRAY_BUFFER = 0x8893
     EQUAL = 0x0202
     FALSE = 0
@@ -363,17 +480,25 @@ module Engine
     FRAGMENT_SHADER = 0x8B30
     FRAMEBUFFER = 0x8D40
     FRAMEBUFFER_COMPLETE = 0x8CD5
+    GEOMETRY_SHADER = 0x8DD9
     INCR = 0x1E02
     INT = 0x1404
+    INVALID_INDEX = 0xFFFFFFFF
     KEEP = 0x1E00
     LESS = 0x0201
     LINEAR = 0x2601
     LINES = 0x0001
     LINK_STATUS = 0x8B82
+    MAP_COHERENT_BIT = 0x0080
+    MAP_PERSISTENT_BIT = 0x0040
+    MAP_READ_BIT = 0x0001
+    MAP_WRITE_BIT = 0x0002
     NEAREST = 0x2600
     NONE = 0
     ONE_MINUS_SRC_ALPHA = 0x0303
+    PIXEL_PACK_BUFFER = 0x88EB
     QUERY_RESULT = 0x8866
+    QUERY_RESULT_AVAILABLE = 0x8867
     READ_FRAMEBUFFER = 0x8CA8
     READ_WRITE = 0x88BA
     REPEAT = 0x2901
@@ -384,12 +509,17 @@ module Engine
     RGBA = 0x1908
     RGBA16F = 0x881A
     RGBA32F = 0x8814
+    RGBA8 = 0x8058
     SHADER_IMAGE_ACCESS_BARRIER_BIT = 0x00000020
     SHADING_LANGUAGE_VERSION = 0x8B8C
     SRC_ALPHA = 0x0302
     STATIC_DRAW = 0x88E4
     STENCIL_BUFFER_BIT = 0x0400
     STENCIL_TEST = 0x0B90
+    STREAM_DRAW = 0x88E0
+    STREAM_READ = 0x88E1
+    SYNC_FLUSH_COMMANDS_BIT = 0x00000001
+    SYNC_GPU_COMMANDS_COMPLETE = 0x9117
     TEXTURE_2D = 0x0DE1
     TEXTURE_2D_ARRAY = 0x8C1A
     TEXTURE_BORDER_COLOR = 0x1004
@@ -398,20 +528,26 @@ module Engine
     TEXTURE_CUBE_MAP_ARRAY = 0x9009
     TEXTURE_CUBE_MAP_POSITIVE_X = 0x8515
     TEXTURE_MAG_FILTER = 0x2800
+    TEXTURE_MAX_LEVEL = 0x813D
     TEXTURE_MIN_FILTER = 0x2801
     TEXTURE_RECTANGLE = 0x84F5
     TEXTURE_WRAP_R = 0x8072
     TEXTURE_WRAP_S = 0x2802
     TEXTURE_WRAP_T = 0x2803
+    TIMEOUT_EXPIRED = 0x911B
     TIME_ELAPSED = 0x88BF
+    TIMESTAMP = 0x8E28
     TRIANGLES = 0x0004
     TRUE = 1
+    UNIFORM_BUFFER = 0x8A11
     UNSIGNED_BYTE = 0x1401
     UNSIGNED_INT = 0x1405
     UNSIGNED_INT_24_8 = 0x84FA
+    UNSIGNED_SHORT = 0x1403
     VENDOR = 0x1F00
     VERTEX_SHADER = 0x8B31
     VERSION = 0x1F02
+    WAIT_FAILED = 0x911D
 
     # Texture units
     TEXTURE0 = 0x84C0
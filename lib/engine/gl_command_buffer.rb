@@ -0,0 +1,124 @@
+# frozen_string_literal: true
+
+module Engine
+  module GL
+    # Records GL calls as packed opcodes so a whole pass can be replayed with
+    # one GLNative.execute instead of a Ruby -> C call per command. Opcodes and
+    # argument counts must match the enum in ext/gl_native/gl_native.c.
+    #
+    # Replaying bypasses Engine::GL's state caches, so Engine::GL.Execute
+    # updates them to the bindings the buffer leaves behind. Recorded uniforms
+    # bypass Shader's uniform caches too; only record uniforms a pass owns.
+    #
+    # opcode_counts, instance_count and triangle_count tally what was
+    # recorded, for GL::Stats.
+    class CommandBuffer
+      BIND_VERTEX_ARRAY = 1
+      BIND_BUFFER = 2
+      USE_PROGRAM = 3
+      BIND_TEXTURE = 4
+      UNIFORM1I = 5
+      UNIFORM1F = 6
+      UNIFORM3F = 7
+      UNIFORM_MATRIX4FV = 8
+      DRAW_ELEMENTS_INSTANCED = 9
+
+      attr_reader :data, :command_count, :vertex_array, :program, :buffers, :texture_unit, :textures,
+                  :opcode_counts, :instance_count, :triangle_count
+
+      def initialize
+        @data = String.new(encoding: Encoding::BINARY)
+        clear
+      end
+
+      def clear
+        @data.clear
+        @command_count = 0
+        @vertex_array = nil
+        @program = nil
+        @buffers = {}
+        @texture_unit = nil
+        @textures = {}
+        @opcode_counts = Array.new(DRAW_ELEMENTS_INSTANCED + 1, 0)
+        @instance_count = 0
+        @triangle_count = 0
+        self
+      end
+
+      def empty?
+        @command_count.zero?
+      end
+
+      def BindVertexArray(array)
+        @vertex_array = array
+        record(BIND_VERTEX_ARRAY, [BIND_VERTEX_ARRAY, array].pack('L2'))
+      end
+
+      def BindBuffer(target, buffer)
+        @buffers[target] = buffer
+        record(BIND_BUFFER, [BIND_BUFFER, target, buffer].pack('L3'))
+      end
+
+      def UseProgram(program)
+        @program = program
+        record(USE_PROGRAM, [USE_PROGRAM, program].pack('L2'))
+      end
+
+      # Activates texture_unit then binds, so the command stands on its own
+      def BindTexture(texture_unit, target, texture)
+        @texture_unit = texture_unit
+        @textures[[texture_unit, target]] = texture
+        record(BIND_TEXTURE, [BIND_TEXTURE, texture_unit, target, texture].pack('L4'))
+      end
+
+      def Uniform1i(location, v0)
+        record(UNIFORM1I, [UNIFORM1I, location, v0].pack('Ll2'))
+      end
+
+      def Uniform1f(location, v0)
+        record(UNIFORM1F, [UNIFORM1F, location].pack('Ll') << [v0].pack('F'))
+      end
+
+      def Uniform3f(location, v0, v1, v2)
+        record(UNIFORM3F, [UNIFORM3F, location].pack('Ll') << [v0, v1, v2].pack('F3'))
+      end
+
+      # value: 16 packed floats, as passed to Engine::GL.UniformMatrix4fv
+      def UniformMatrix4fv(location, value)
+        raise ArgumentError, "expected 64 bytes of matrix data, got #{value.bytesize}" unless value.bytesize == 64
+
+        record(UNIFORM_MATRIX4FV, [UNIFORM_MATRIX4FV, location].pack('Ll') << value)
+      end
+
+      def DrawElementsInstanced(mode, count, type, indices, instance_count)
+        @instance_count += instance_count
+        @triangle_count += count / 3 * instance_count if mode == TRIANGLES
+        record(DRAW_ELEMENTS_INSTANCED, [DRAW_ELEMENTS_INSTANCED, mode, count, type, indices, instance_count].pack('L6'))
+      end
+
+      # Appends another buffer's commands (and the bindings they leave behind)
+      def append(other)
+        @data << other.data
+        @command_count += other.command_count
+        @vertex_array = other.vertex_array unless other.vertex_array.nil?
+        @program = other.program unless other.program.nil?
+        @buffers.merge!(other.buffers)
+        @texture_unit = other.texture_unit unless other.texture_unit.nil?
+        @textures.merge!(other.textures)
+        other.opcode_counts.each_with_index { |count, opcode| @opcode_counts[opcode] += count }
+        @instance_count += other.instance_count
+        @triangle_count += other.triangle_count
+        self
+      end
+
+      private
+
+      def record(opcode, bytes)
+        @data << bytes
+        @command_count += 1
+        @opcode_counts[opcode] += 1
+        self
+      end
+    end
+  end
+end
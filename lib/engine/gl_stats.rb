@@ -0,0 +1,179 @@
+# frozen_string_literal: true
+
+module Engine
+  module GL
+    # One frame of GL traffic. calls counts what reached the driver per
+    # GLNative entry point (commands replayed by Execute included);
+    # redundant counts calls Engine::GL's state caches swallowed, per
+    # Engine::GL method.
+    FrameStats = Struct.new(
+      :calls, :redundant, :draw_calls, :instances, :triangles,
+      :uniform_uploads, :buffer_bytes, :texture_bytes
+    ) do
+      def self.empty
+        new(Hash.new(0), Hash.new(0), 0, 0, 0, 0, 0, 0)
+      end
+
+      def call_count
+        calls.sum { |_, count| count }
+      end
+
+      def state_changes
+        Stats::STATE_CALLS.sum { |name| calls[name] }
+      end
+
+      def redundant_state_changes
+        redundant.sum { |_, count| count }
+      end
+
+      def add(other)
+        other.calls.each { |name, count| calls[name] += count }
+        other.redundant.each { |name, count| redundant[name] += count }
+        self.draw_calls += other.draw_calls
+        self.instances += other.instances
+        self.triangles += other.triangles
+        self.uniform_uploads += other.uniform_uploads
+        self.buffer_bytes += other.buffer_bytes
+        self.texture_bytes += other.texture_bytes
+        self
+      end
+    end
+
+    # Counts GL traffic per frame: calls per entry point, issued vs
+    # redundant state changes, draw calls, instances and triangles, uniform
+    # uploads, and bytes sent through BufferData/BufferSubData/BufferStorage,
+    # WriteMappedBuffer and the TexImage/TexSubImage calls.
+    #
+    # enable wraps every GLNative function in a counting method, so only the
+    # calls that reach the driver are counted; the caching methods in
+    # Engine::GL report the calls they skip. Commands replayed from a
+    # CommandBuffer are counted from the buffer's per-opcode tallies.
+    #
+    # The game loop calls end_frame once per frame; last_frame is the
+    # previous frame's FrameStats and totals sums frames since reset.
+    # Off unless enabled (GL_STATS=1); once installed the wrappers stay, but
+    # cost one ivar check while disabled.
+    module Stats
+      # GLNative functions that change state Engine::GL caches
+      STATE_CALLS = %i[
+        active_texture bind_buffer bind_texture bind_vertex_array disable enable use_program viewport
+      ].freeze
+
+      UNIFORM_CALLS = %i[
+        uniform1f uniform2f uniform3f uniform4f uniform1i
+        uniform1fv uniform2fv uniform3fv uniform4fv uniform1iv uniform_matrix4fv
+      ].freeze
+
+      REPLAYED_UNIFORMS = [
+        CommandBuffer::UNIFORM1I, CommandBuffer::UNIFORM1F, CommandBuffer::UNIFORM3F, CommandBuffer::UNIFORM_MATRIX4FV
+      ].freeze
+
+      # GLNative functions each CommandBuffer opcode replays
+      REPLAYED_CALLS = {
+        CommandBuffer::BIND_VERTEX_ARRAY => %i[bind_vertex_array],
+        CommandBuffer::BIND_BUFFER => %i[bind_buffer],
+        CommandBuffer::USE_PROGRAM => %i[use_program],
+        CommandBuffer::BIND_TEXTURE => %i[active_texture bind_texture],
+        CommandBuffer::UNIFORM1I => %i[uniform1i],
+        CommandBuffer::UNIFORM1F => %i[uniform1f],
+        CommandBuffer::UNIFORM3F => %i[uniform3f],
+        CommandBuffer::UNIFORM_MATRIX4FV => %i[uniform_matrix4fv],
+        CommandBuffer::DRAW_ELEMENTS_INSTANCED => %i[draw_elements_instanced]
+      }.freeze
+
+      class << self
+        attr_reader :current, :last_frame, :totals, :frames
+
+        def enabled?
+          !@current.nil?
+        end
+
+        def enable
+          install
+          reset
+          @current = FrameStats.empty
+        end
+
+        def disable
+          @current = nil
+        end
+
+        def reset
+          @current = FrameStats.empty if @current
+          @last_frame = FrameStats.empty
+          @totals = FrameStats.empty
+          @frames = 0
+        end
+
+        def end_frame
+          return unless @current
+
+          @last_frame = @current
+          @totals.add(@current)
+          @frames += 1
+          @current = FrameStats.empty
+          @last_frame
+        end
+
+        # Called by the GLNative wrappers before each native call
+        def issued(name, args)
+          stats = @current
+          stats.calls[name] += 1
+          case name
+          when :draw_arrays then drawn(stats, args[0], args[2], 1)
+          when :draw_elements then drawn(stats, args[0], args[1], 1)
+          when :draw_elements_instanced then drawn(stats, args[0], args[1], args[4])
+          when :buffer_data, :buffer_storage then stats.buffer_bytes += args[1] unless args[2].nil?
+          when :buffer_sub_data then stats.buffer_bytes += args[2]
+          when :write_mapped_buffer then stats.buffer_bytes += args[4]
+          when :tex_image_2d, :tex_image_3d, :tex_sub_image_2d, :compressed_tex_image_2d
+            stats.texture_bytes += args.last.bytesize unless args.last.nil?
+          when *UNIFORM_CALLS then stats.uniform_uploads += 1
+          end
+        end
+
+        # Called by Engine::GL when its cache makes a call redundant
+        def skipped(name)
+          @current.redundant[name] += 1 if @current
+          nil
+        end
+
+        def replayed(commands)
+          stats = @current
+          commands.opcode_counts.each_with_index do |count, opcode|
+            next if count.zero?
+
+            REPLAYED_CALLS[opcode].each { |name| stats.calls[name] += count }
+          end
+          stats.uniform_uploads += REPLAYED_UNIFORMS.sum { |opcode| commands.opcode_counts[opcode] }
+          stats.draw_calls += commands.opcode_counts[CommandBuffer::DRAW_ELEMENTS_INSTANCED]
+          stats.instances += commands.instance_count
+          stats.triangles += commands.triangle_count
+        end
+
+        private
+
+        def drawn(stats, mode, count, instances)
+          stats.draw_calls += 1
+          stats.instances += instances
+          stats.triangles += count / 3 * instances if mode == TRIANGLES
+        end
+
+        def install
+          return if @installed
+
+          @installed = true
+          counter = Module.new do
+            GLNative.singleton_methods(false).each do |name|
+              define_method(name) do |*args|
+                Stats.issued(name, args) if Stats.enabled?
+                super(*args)
+              end
+            end
+          end
+          GLNative.singleton_class.prepend(counter)
+        end
+      end
+    end
+  end
+end
@@ -9,6 +9,9 @@ module Engine
     # Cache texture slot constants to avoid const_get every frame
     TEXTURE_SLOTS = Array.new(32) { |i| Object.const_get("Engine::GL::TEXTURE#{i}") }
 
+    # Uniform values a caller could change in place after setting them
+    MUTABLE_VALUES = [Array, Hash, Vector, Matrix].freeze
+
     def self.bind_texture(slot, target, texture_id)
       Engine::GL.ActiveTexture(TEXTURE_SLOTS[slot])
       Engine::GL.BindTexture(target, texture_id)
@@ -41,115 +44,127 @@ module Engine
     end
 
     def set_mat4(name, value)
-      mat4s[name] = value
+      store_uniform(mat4s, name, value)
     end
 
     def set_vec2(name, value)
-      vec2s[name] = value
+      store_uniform(vec2s, name, value)
     end
 
     def set_vec3(name, value)
-      vec3s[name] = value
+      store_uniform(vec3s, name, value)
     end
 
     def set_vec4(name, value)
-      vec4s[name] = value
+      store_uniform(vec4s, name, value)
     end
 
     def set_float(name, value)
-      floats[name] = value
+      store_uniform(floats, name, value)
     end
 
     def set_int(name, value)
-      ints[name] = value
+      store_uniform(ints, name, value)
     end
 
     def set_texture(name, texture)
-      textures[name] = texture
+      store_uniform(textures, name, texture)
     end
 
     # TODO: Runtime textures are not serializable. We need to revisit this
     # to make render targets serializable or find another approach.
     def set_runtime_texture(name, gl_id)
-      runtime_textures[name] = gl_id
+      store_uniform(runtime_textures, name, gl_id)
     end
 
     def set_cubemap(name, value)
-      cubemaps[name] = value
+      store_uniform(cubemaps, name, value)
     end
 
     def set_texture_array(name, value)
-      texture_arrays[name] = value
+      store_uniform(texture_arrays, name, value)
     end
 
     def set_cubemap_array(name, value)
-      cubemap_arrays[name] = value
+      store_uniform(cubemap_arrays, name, value)
+    end
+
+    def vec4(name)
+      vec4s[name]
+    end
+
+    # What a texture uniform is set to: a Texture, a runtime texture id, or
+    # nil when the shader's fallback is used
+    def texture_value(name)
+      runtime_textures.key?(name) ? runtime_textures[name] : textures[name]
     end
 
     def update_shader
       shader.use
-
-      mat4s.each do |name, value|
-        shader.set_mat4(name, value)
-      end
-      vec2s.each do |name, value|
-        shader.set_vec2(name, value)
-      end
-      vec3s.each do |name, value|
-        shader.set_vec3(name, value)
-      end
-      vec4s.each do |name, value|
-        shader.set_vec4(name, value)
-      end
-      floats.each do |name, value|
-        shader.set_float(name, value)
-      end
-      ints.each do |name, value|
-        shader.set_int(name, value)
-      end
-      # Start with shader's expected textures (defaulting to nil for fallbacks)
-      expected = shader.expected_textures.each_with_object({}) { |name, h| h[name] = nil }
-      all_textures = expected.merge(textures).merge(runtime_textures)
-      all_textures.each.with_index do |(name, value), slot|
-        texture_id = if value.is_a?(Texture)
-                       value.texture
-                     elsif value
-                       value
-                     else
-                       fallback_texture_for(name)
-                     end
-        Material.bind_texture(slot, Engine::GL::TEXTURE_2D, texture_id)
-        shader.set_int(name, slot)
+      uniform_plan.upload(uniform_revision)
+      uniform_plan.samplers.each do |sampler|
+        Material.bind_texture(sampler.slot, sampler.target, sampler_texture_id(sampler))
       end
+    end
 
-      # Cubemaps start after regular textures
-      cubemap_start_slot = all_textures.size
-      cubemaps.each.with_index do |(name, value), i|
-        slot = cubemap_start_slot + i
-        texture_id = value || fallback_cubemap_for(name)
-        Material.bind_texture(slot, Engine::GL::TEXTURE_CUBE_MAP, texture_id)
-        shader.set_int(name, slot)
-      end
+    private
 
-      # Texture arrays start after cubemaps
-      texture_array_start_slot = cubemap_start_slot + cubemaps.size
-      texture_arrays.each.with_index do |(name, value), i|
-        slot = texture_array_start_slot + i
-        Material.bind_texture(slot, Engine::GL::TEXTURE_2D_ARRAY, value || 0)
-        shader.set_int(name, slot)
+    # Equal values are ignored so per-frame setters don't invalidate the
+    # plan; a new name changes the plan's layout and forces a rebuild.
+    # Mutable values are stored as frozen copies, so a caller mutating its
+    # Array (or Vector, Matrix) and setting it again is seen as a change.
+    def store_uniform(values, name, value)
+      mutable = MUTABLE_VALUES.any? { |type| value.is_a?(type) }
+      if values.key?(name)
+        return if value.equal?(values[name]) || (mutable && value == values[name])
+      else
+        @uniform_plan = nil
       end
 
-      # Cubemap arrays start after texture arrays
-      cubemap_array_start_slot = texture_array_start_slot + texture_arrays.size
-      cubemap_arrays.each.with_index do |(name, value), i|
-        slot = cubemap_array_start_slot + i
-        Material.bind_texture(slot, Engine::GL::TEXTURE_CUBE_MAP_ARRAY, value || 0)
-        shader.set_int(name, slot)
+      values[name] = mutable && !value.frozen? ? value.dup.freeze : value
+      @uniform_revision = uniform_revision + 1
+    end
+
+    def uniform_revision
+      @uniform_revision ||= 0
+    end
+
+    def uniform_plan
+      return @uniform_plan if @uniform_plan&.shader.equal?(shader)
+
+      @uniform_plan = UniformPlan.new(
+        shader,
+        { mat4: mat4s, vec2: vec2s, vec3: vec3s, vec4: vec4s, float: floats, int: ints },
+        # Shader's expected textures first (nil values use fallbacks), then
+        # cubemaps, texture arrays and cubemap arrays, each in its own slots
+        {
+          texture: (shader.expected_textures + textures.keys + runtime_textures.keys).uniq,
+          cubemap: cubemaps.keys,
+          texture_array: texture_arrays.keys,
+          cubemap_array: cubemap_arrays.keys
+        }
+      )
+    end
+
+    def sampler_texture_id(sampler)
+      name = sampler.name
+      case sampler.kind
+      when :texture
+        value = texture_value(name)
+        if value.is_a?(Texture)
+          value.texture
+        else
+          value || fallback_texture_for(name)
+        end
+      when :cubemap
+        cubemaps[name] || fallback_cubemap_for(name)
+      when :texture_array
+        texture_arrays[name] || 0
+      when :cubemap_array
+        cubemap_arrays[name] || 0
       end
     end
 
-    private
-
     def fallback_texture_for(name)
       case shader.texture_fallback(name)
       when :normal then self.class.default_normal_texture
@@ -4,6 +4,8 @@ module Engine
   class Mesh
     include Serializable
 
+    VERTEX_STRIDE = 20
+
     attr_reader :mesh_file, :source
 
     def self.from_serializable_data(data)
@@ -14,12 +16,92 @@ module Engine
       { mesh_file: @mesh_file, source: @source }
     end
 
+    # Otherwise the mesh loads on first use
+    def awake
+      AssetStreamer.stream(self) if AssetStreamer.enabled
+    end
+
+    # Maps or parses the mesh off the main thread. Buffers are made per
+    # InstanceRenderer, which MeshRenderer only creates once this is done.
+    def load_asset
+      vertex_bytes
+      index_bytes
+      depth_index_bytes
+      bounding_sphere
+      nil
+    end
+
+    # Returns the bytes the mesh's buffers will take
+    def upload_asset(_payload)
+      [vertex_bytes, index_bytes, depth_vertex_bytes, depth_index_bytes].sum(&:bytesize)
+    end
+
     def vertex_data
-      @vertex_data ||= Mesh.load_vertex(base_path)
+      @vertex_data ||= binary_mesh ? binary_mesh.vertex_data : Mesh.load_vertex(base_path)
     end
 
     def index_data
-      @index_data ||= Mesh.load_index(base_path)
+      @index_data ||= binary_mesh ? binary_mesh.index_data : Mesh.load_index(base_path)
+    end
+
+    # float32 vertex data ready for BufferData; straight from the mapped file
+    # for binary meshes
+    def vertex_bytes
+      binary_mesh ? binary_mesh.vertex_bytes : (@vertex_bytes ||= vertex_data.pack('F*'))
+    end
+
+    def index_bytes
+      binary_mesh ? binary_mesh.index_bytes : (@index_bytes ||= index_data.pack('I*'))
+    end
+
+    # GL index type of index_bytes
+    def index_type
+      binary_mesh ? binary_mesh.index_type : MeshFile::UNSIGNED_INT
+    end
+
+    # Indices in the full detail level
+    def index_count
+      lods.first.index_count
+    end
+
+    # MeshFile::Lod ranges into index_bytes and depth_index_bytes, from full
+    # detail down. Legacy meshes only have the one level.
+    def lods
+      return binary_mesh.lods if binary_mesh
+
+      @lods ||= [MeshFile::Lod.new(0, index_data.length, 0, legacy_depth_stream[1].bytesize / 4, 0.0)]
+    end
+
+    # Position-only float32 xyz stream welded across uv and normal seams, for
+    # depth passes. Imported with the mesh; built on load for legacy meshes.
+    def depth_vertex_bytes
+      binary_mesh ? binary_mesh.depth_vertex_bytes : legacy_depth_stream[0]
+    end
+
+    def depth_index_bytes
+      binary_mesh ? binary_mesh.depth_index_bytes : legacy_depth_stream[1]
+    end
+
+    def depth_index_type
+      binary_mesh ? binary_mesh.depth_index_type : MeshFile::UNSIGNED_INT
+    end
+
+    def depth_index_count
+      lods.first.depth_index_count
+    end
+
+    # Local space [min, max] corners over every vertex position
+    def aabb
+      return binary_mesh.aabb if binary_mesh
+
+      @aabb ||= [Vector[*legacy_bounds[0, 3]], Vector[*legacy_bounds[3, 3]]]
+    end
+
+    # [center, radius] around the AABB centre, tight to the furthest vertex
+    def bounding_sphere
+      return binary_mesh.bounding_sphere if binary_mesh
+
+      @bounding_sphere ||= [Vector[*legacy_bounds[6, 3]], legacy_bounds[9]]
     end
 
     def self.for(mesh_file, source: :game)
@@ -31,6 +113,17 @@ module Engine
       @mesh_cache ||= {}
     end
 
+    # The imported .mesh file, or nil for meshes still in the legacy text format
+    def self.load_binary(base_path)
+      binary_cache[base_path + ".mesh"]
+    end
+
+    def self.binary_cache
+      @binary_cache ||= Hash.new do |hash, key|
+        hash[key] = File.exist?(key) ? MeshFile.read(key) : nil
+      end
+    end
+
     def self.load_vertex(base_path)
       vertex_cache[base_path + ".vertex_data"]
     end
@@ -57,6 +150,23 @@ module Engine
 
     private
 
+    def legacy_depth_stream
+      @legacy_depth_stream ||= begin
+        positions, (indices,) = AssetNative.depth_stream(vertex_bytes, [index_bytes], VERTEX_STRIDE)
+        [positions, indices]
+      end
+    end
+
+    def legacy_bounds
+      @legacy_bounds ||= AssetNative.vertex_bounds(vertex_bytes, VERTEX_STRIDE)
+    end
+
+    def binary_mesh
+      return @binary_mesh if defined?(@binary_mesh)
+
+      @binary_mesh = @mesh_file && Mesh.load_binary(base_path)
+    end
+
     def base_path
       @base_path ||= if @source == :engine
         File.join(ENGINE_DIR, "assets", "_imported", @mesh_file)
@@ -0,0 +1,154 @@
+# frozen_string_literal: true
+
+require "asset_native"
+
+module Engine
+  # Binary mesh container written by ObjImporter (`_imported/*.mesh`).
+  #
+  # Layout, all little-endian:
+  #   header (80 bytes)
+  #     magic "RMSH", version (uint32)
+  #     vertex_stride in floats, vertex_count, index_count (uint32)
+  #     index_type (uint32, the GL enum: UNSIGNED_SHORT or UNSIGNED_INT)
+  #     depth_vertex_count, depth_index_count, depth_index_type, lod_count (uint32)
+  #     aabb min xyz, aabb max xyz, sphere center xyz, sphere radius (float32)
+  #   lod table, lod_count entries of 20 bytes
+  #     index_offset, index_count, depth_index_offset, depth_index_count (uint32)
+  #     error, relative to the bounding radius (float32)
+  #   vertex data (float32, vertex_count * vertex_stride)
+  #   index data (uint16 or uint32, index_count)
+  #   depth vertex data (float32 xyz, depth_vertex_count)
+  #   depth index data (uint16 or uint32, depth_index_count)
+  #
+  # LOD 0 is the full mesh. Coarser levels are further index ranges into the
+  # same vertices (see AssetNative.simplify). The depth stream is the mesh
+  # welded by position alone, for shadow passes that never read the other
+  # attributes, with a range per level (see AssetNative.depth_stream).
+  #
+  # Reading maps the file and slices it without copying (see
+  # AssetNative::MappedFile), so the slices can go straight to BufferData.
+  class MeshFile
+    MAGIC = "RMSH"
+    VERSION = 3
+    HEADER_FORMAT = 'a4V9e10'
+    HEADER_SIZE = 80
+    LOD_FORMAT = 'V4e'
+    LOD_SIZE = 20
+
+    # GL enums, so the value can be passed straight to DrawElements
+    UNSIGNED_SHORT = 0x1403
+    UNSIGNED_INT = 0x1405
+    INDEX_SIZES = { UNSIGNED_SHORT => 2, UNSIGNED_INT => 4 }.freeze
+
+    class FormatError < StandardError; end
+
+    # Offsets and counts are in indices, not bytes
+    Lod = Struct.new(:index_offset, :index_count, :depth_index_offset, :depth_index_count, :error)
+
+    attr_reader :vertex_stride, :vertex_count, :index_count, :index_type, :aabb, :bounding_sphere,
+                :vertex_bytes, :index_bytes,
+                :depth_vertex_count, :depth_index_count, :depth_index_type, :depth_vertex_bytes, :depth_index_bytes,
+                :lods
+
+    def self.read(path)
+      new(AssetNative::MappedFile.new(path), path)
+    end
+
+    def self.write(path, vertex_data, index_data, vertex_stride:)
+      write_packed(path, vertex_data.pack('e*'), index_data.pack('V*'), vertex_stride:)
+    end
+
+    # vertex_bytes: float32, vertex_stride per vertex; index_bytes: uint32.
+    # lods: [index_bytes, error] for each level after the full mesh.
+    # Indices are stored as uint16 whenever every vertex is reachable with them.
+    def self.write_packed(path, vertex_bytes, index_bytes, vertex_stride:, lods: [])
+      vertex_count = vertex_bytes.bytesize / (vertex_stride * 4)
+      levels = [index_bytes, *lods.map(&:first)]
+      depth_vertex_bytes, depth_levels = AssetNative.depth_stream(vertex_bytes, levels, vertex_stride)
+      lod_table = lod_table(levels, depth_levels, [0.0, *lods.map(&:last)])
+      index_type, index_bytes = narrow_indices(levels.join, vertex_count)
+      depth_index_type, depth_index_bytes = narrow_indices(depth_levels.join, depth_vertex_bytes.bytesize / 12)
+
+      header = [
+        MAGIC, VERSION, vertex_stride, vertex_count, index_bytes.bytesize / INDEX_SIZES[index_type], index_type,
+        depth_vertex_bytes.bytesize / 12, depth_index_bytes.bytesize / INDEX_SIZES[depth_index_type], depth_index_type,
+        levels.length, *AssetNative.vertex_bounds(vertex_bytes, vertex_stride)
+      ].pack(HEADER_FORMAT)
+
+      File.open(path, "wb") do |file|
+        file.write(header.ljust(HEADER_SIZE, "\0"))
+        lod_table.each { |lod| file.write(lod.to_a.pack(LOD_FORMAT)) }
+        file.write(vertex_bytes)
+        file.write(index_bytes)
+        file.write(depth_vertex_bytes)
+        file.write(depth_index_bytes)
+      end
+    end
+
+    # [index_type, bytes] for uint32 index_bytes
+    def self.narrow_indices(index_bytes, vertex_count)
+      return [UNSIGNED_INT, index_bytes] if vertex_count > 65_536
+
+      [UNSIGNED_SHORT, index_bytes.unpack('V*').pack('v*')]
+    end
+    private_class_method :narrow_indices
+
+    def self.lod_table(levels, depth_levels, errors)
+      index_offset = depth_index_offset = 0
+      levels.zip(depth_levels, errors).map do |indices, depth_indices, error|
+        Lod.new(index_offset, indices.bytesize / 4, depth_index_offset, depth_indices.bytesize / 4, error).tap do |lod|
+          index_offset += lod.index_count
+          depth_index_offset += lod.depth_index_count
+        end
+      end
+    end
+    private_class_method :lod_table
+
+    def initialize(mapped_file, path)
+      @mapped_file = mapped_file
+      raise FormatError, "#{path} is too short for a mesh header" if mapped_file.size < HEADER_SIZE
+
+      magic, version, @vertex_stride, @vertex_count, @index_count, @index_type,
+        @depth_vertex_count, @depth_index_count, @depth_index_type, lod_count, *floats =
+        mapped_file.slice(0, HEADER_SIZE).unpack(HEADER_FORMAT)
+      raise FormatError, "#{path} is not a mesh file" unless magic == MAGIC
+      unless version == VERSION
+        raise FormatError, "#{path} is mesh version #{version}, expected #{VERSION}; run bin/import again"
+      end
+
+      lod_table_size = lod_count * LOD_SIZE
+      sizes = [
+        @vertex_count * @vertex_stride * 4,
+        @index_count * index_size(@index_type, path),
+        @depth_vertex_count * 12,
+        @depth_index_count * index_size(@depth_index_type, path)
+      ]
+      expected_size = HEADER_SIZE + lod_table_size + sizes.sum
+      raise FormatError, "#{path} is #{mapped_file.size} bytes, expected #{expected_size}" unless mapped_file.size == expected_size
+
+      @lods = Array.new(lod_count) do |level|
+        Lod.new(*mapped_file.slice(HEADER_SIZE + level * LOD_SIZE, LOD_SIZE).unpack(LOD_FORMAT)).freeze
+      end.freeze
+      offset = HEADER_SIZE + lod_table_size
+      @vertex_bytes, @index_bytes, @depth_vertex_bytes, @depth_index_bytes = sizes.map do |size|
+        mapped_file.slice(offset, size).tap { offset += size }
+      end
+      @aabb = [Vector[*floats[0, 3]], Vector[*floats[3, 3]]]
+      @bounding_sphere = [Vector[*floats[6, 3]], floats[9]]
+    end
+
+    def vertex_data
+      @vertex_bytes.unpack('e*')
+    end
+
+    def index_data
+      @index_bytes.unpack(@index_type == UNSIGNED_SHORT ? 'v*' : 'V*')
+    end
+
+    private
+
+    def index_size(index_type, path)
+      INDEX_SIZES[index_type] or raise FormatError, "#{path} has unknown index type 0x#{index_type.to_s(16)}"
+    end
+  end
+end
@@ -0,0 +1,90 @@
+# frozen_string_literal: true
+
+module Engine::Physics::Components
+  # Base for collider shapes. Handles broadphase registration and turns a
+  # contact into the impulse PhysicsResolver applies to this collider's
+  # rigidbody. Subclasses implement `collision_for`, plus `center` and
+  # `bounding_radius` for the broadphase (see SpatialHash).
+  class Collider < Engine::Component
+    def start
+      Engine::Physics::PhysicsResolver.register_collider(self)
+    end
+
+    def destroy
+      Engine::Physics::PhysicsResolver.unregister_collider(self)
+    end
+
+    def static?
+      rigidbody.nil?
+    end
+
+    def inverse_mass
+      1.0 / rigidbody.mass
+    end
+
+    def velocity(pos)
+      rigidbody&.velocity_at_point(pos) || Vector[0, 0, 0]
+    end
+
+    def rigidbody
+      game_object.component(Rigidbody)
+    end
+
+    private
+
+    # direction: unit contact normal pointing from this collider to the other
+    def collision_response(other_collider, direction, collision_point)
+      magnitude = normal_impulse_magnitude(direction, other_collider, collision_point)
+
+      return nil if magnitude <= 0
+
+      normal_impulse = -direction * magnitude
+      tangential_impulse = tangential_impulse(other_collider, normal_impulse, collision_point)
+
+      Engine::Physics::Collision.new(normal_impulse + tangential_impulse, collision_point)
+    end
+
+    # [normal, point] from a PhysicsNative contact array
+    def unpack_contact(contact)
+      [Vector[contact[0], contact[1], contact[2]], Vector[contact[4], contact[5], contact[6]]]
+    end
+
+    def combined_coefficient_of_restitution(other_collider)
+      return rigidbody.coefficient_of_restitution if other_collider.static?
+
+      rigidbody.coefficient_of_restitution * other_collider.rigidbody.coefficient_of_restitution
+    end
+
+    def combined_coefficient_of_friction(other_collider)
+      return rigidbody.coefficient_of_friction if other_collider.static?
+
+      rigidbody.coefficient_of_friction * other_collider.rigidbody.coefficient_of_friction
+    end
+
+    def normal_impulse_magnitude(direction, other_collider, collision_point)
+      (
+        if other_collider.static?
+          v_r = velocity(collision_point)
+          (v_r.dot(direction) * 2) / inverse_mass
+        else
+          v_r = velocity(collision_point) - other_collider.velocity(collision_point)
+          (v_r.dot(direction) * 2) / (inverse_mass + other_collider.inverse_mass)
+        end) * combined_coefficient_of_restitution(other_collider)
+    end
+
+    def tangential_impulse(other_collider, normal_impulse, collision_point)
+      normal_direction = normal_impulse.normalize
+      v_t = if other_collider.static?
+              velocity(collision_point)
+            else
+              velocity(collision_point) - other_collider.velocity(collision_point)
+            end
+
+      v_t_without_normal = -((v_t - v_t.dot(normal_direction) * normal_direction))
+      return Vector[0, 0, 0] if v_t_without_normal.magnitude == 0
+
+      relevant_speed = [v_t_without_normal.magnitude, normal_impulse.magnitude * combined_coefficient_of_friction(other_collider)].min
+      v_t_without_normal.normalize * relevant_speed / 2
+    end
+  end
+end
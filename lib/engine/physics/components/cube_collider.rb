@@ -1,6 +1,51 @@
 # frozen_string_literal: true
 
 module Engine::Physics::Components
-  class CubeCollider < Engine::Component
+  # Oriented box: `size` is the full edge length on each local axis, centred
+  # on the GameObject and turned by its rotation. Scale is not applied, as
+  # with SphereCollider's radius. Contacts come from physics_native's
+  # separating axis test (box vs box) and closest point test (box vs sphere).
+  class CubeCollider < Collider
+    serialize :size
+
+    attr_accessor :size
+
+    def awake
+      @size ||= Vector[1, 1, 1]
+    end
+
+    def collision_for(other_collider)
+      contact =
+        if other_collider.is_a?(CubeCollider)
+          PhysicsNative.box_box_contact(box_data, other_collider.box_data)
+        else
+          pos = other_collider.game_object.pos
+          PhysicsNative.box_sphere_contact(box_data, pos[0], pos[1], pos[2], other_collider.radius)
+        end
+      return nil unless contact
+
+      normal, point = unpack_contact(contact)
+      collision_response(other_collider, normal, point)
+    end
+
+    # Broadphase bounds (see SpatialHash)
+    def center
+      game_object.pos
+    end
+
+    def bounding_radius
+      @size.magnitude / 2
+    end
+
+    # Center, rotation and half extents packed for PhysicsNative
+    def box_data
+      pos = game_object.pos
+      rotation = game_object.rotation
+      [
+        pos[0], pos[1], pos[2],
+        rotation.w, rotation.x, rotation.y, rotation.z,
+        @size[0] / 2.0, @size[1] / 2.0, @size[2] / 2.0
+      ].pack('D10')
+    end
   end
 end
@@ -5,12 +5,8 @@ module Engine::Physics::Components
     serialize :velocity, :angular_velocity, :mass, :inertia_tensor, :gravity,
               :coefficient_of_restitution, :coefficient_of_friction
 
-    attr_accessor :velocity,
-                  :angular_velocity,
-                  :force,
-                  :impulses,
-                  :mass,
-                  :coefficient_of_restitution,
+    attr_reader :velocity, :angular_velocity, :force, :mass
+    attr_accessor :coefficient_of_restitution,
                   :coefficient_of_friction
 
     def awake
@@ -26,50 +22,115 @@ module Engine::Physics::Components
         [0, 0, 1]
       ] * @mass
       @force = @gravity * @mass
-      @impulses = []
-      @angular_impulses = []
     end
 
     def start
+      body_slot
       Engine::Physics::PhysicsResolver.register_rigidbody(self)
     end
 
     def destroy
       Engine::Physics::PhysicsResolver.unregister_rigidbody(self)
+      PhysicsNative.release(@body_slot) if @body_slot
+      @body_slot = nil
     end
 
+    # Once PhysicsWorld is simulating it steps every body at a fixed rate;
+    # until then each update is a single step of delta_time
     def update(delta_time)
-      @velocity += acceleration * delta_time
-      @velocity += @impulses.reduce(Vector[0, 0, 0]) { |acc, impulse| acc + impulse } / @mass
-      @impulses = []
-      @game_object.pos += @velocity * delta_time
-
-      total_angular_impulse = @angular_impulses.reduce(Vector[0, 0, 0]) { |acc, impulse| acc + impulse }
-      if total_angular_impulse.magnitude > 0
-        angular_inertia =
-          if moment_of_inertia == 0
-            impulse_direction = total_angular_impulse.normalize
-            impulse_direction.dot(@inertia_tensor * impulse_direction)
-          else
-            moment_of_inertia
-          end
-        @angular_velocity += total_angular_impulse / angular_inertia
-      end
-      @angular_impulses = []
-      @game_object.rotate_around(angular_velocity, delta_time * angular_velocity.magnitude) if angular_velocity.magnitude > 0
+      return if Engine::Physics::PhysicsWorld.running?
+
+      pull_transform
+      PhysicsNative.step_body(body_slot, delta_time, 1)
+      push_to_transform
+    end
+
+    def velocity=(value)
+      @velocity = value
+      PhysicsNative.set_velocity(@body_slot, value[0], value[1], value[2]) if @body_slot
     end
 
+    def angular_velocity=(value)
+      @angular_velocity = value
+      PhysicsNative.set_angular_velocity(@body_slot, value[0], value[1], value[2]) if @body_slot
+    end
+
+    def force=(value)
+      @force = value
+      push_acceleration if @body_slot
+    end
+
+    def mass=(value)
+      @mass = value
+      return unless @body_slot
+
+      PhysicsNative.set_mass(@body_slot, value)
+      push_acceleration
+    end
+
+    # Impulses accumulate natively and are applied on the next step
     def apply_impulse(impulse, point)
-      @impulses << impulse
-      @angular_impulses << (game_object.pos - point).cross(impulse)
+      PhysicsNative.apply_impulse(body_slot, impulse[0], impulse[1], impulse[2])
+      apply_angular_impulse((game_object.pos - point).cross(impulse))
     end
 
     def apply_angular_impulse(impulse)
-      @angular_impulses << impulse
+      PhysicsNative.apply_angular_impulse(body_slot, impulse[0], impulse[1], impulse[2])
+    end
+
+    # Index of this body's state in the physics_native store
+    def body_slot
+      @body_slot ||= begin
+        slot = PhysicsNative.alloc
+        PhysicsNative.set_mass(slot, @mass)
+        PhysicsNative.set_inertia(slot, @inertia_tensor.to_a.flatten.pack('D9'))
+        PhysicsNative.set_velocity(slot, @velocity[0], @velocity[1], @velocity[2])
+        PhysicsNative.set_angular_velocity(slot, @angular_velocity[0], @angular_velocity[1], @angular_velocity[2])
+        @body_slot = slot
+        push_acceleration
+        slot
+      end
+    end
+
+    # Sends transform edits made outside physics (teleports, editor moves)
+    # to the native body. Anything else is what push_to_transform wrote.
+    def pull_transform
+      pos = game_object.pos
+      unless pos.equal?(@written_pos)
+        PhysicsNative.set_position(body_slot, pos[0], pos[1], pos[2] || 0)
+        @written_pos = pos
+      end
+
+      rotation = game_object.rotation
+      unless rotation.equal?(@written_rotation)
+        PhysicsNative.set_rotation(body_slot, rotation.w, rotation.x, rotation.y, rotation.z)
+        @written_rotation = rotation
+      end
+    end
+
+    # Copies the stepped state back, or a blend between the last two steps
+    # when alpha is given. The transform is only touched when it changed.
+    def push_to_transform(alpha = nil)
+      slot = body_slot
+      @velocity = Vector[*PhysicsNative.velocity(slot)]
+      @angular_velocity = Vector[*PhysicsNative.angular_velocity(slot)]
+
+      position = alpha ? PhysicsNative.interpolated_position(slot, alpha) : PhysicsNative.position(slot)
+      unless position == @written_pos.to_a
+        @written_pos = Vector[*position]
+        game_object.pos = @written_pos
+      end
+
+      w, x, y, z = alpha ? PhysicsNative.interpolated_rotation(slot, alpha) : PhysicsNative.rotation(slot)
+      written = @written_rotation
+      unless w == written.w && x == written.x && y == written.y && z == written.z
+        @written_rotation = Engine::Quaternion.new(w, x, y, z)
+        game_object.rotation = @written_rotation
+      end
     end
 
     def colliders
-      @game_object.components.select { |c| c.is_a?(SphereCollider) }
+      @game_object.components_of_type(Collider)
     end
 
     def kinetic_energy
@@ -96,6 +157,11 @@ module Engine::Physics::Components
       @force / @mass
     end
 
+    def push_acceleration
+      a = acceleration
+      PhysicsNative.set_acceleration(@body_slot, a[0], a[1], a[2])
+    end
+
     def moment_of_inertia
       return 0 if @angular_velocity.magnitude == 0
 
@@ -3,11 +3,24 @@
 module Engine::Physics
   module PhysicsResolver
     def self.resolve
+      # Re-bucket anything that moved before pairing, so candidates are current
+      colliders.each { |collider| broadphase.update(collider) }
+
       rigidbodies.each do |rb|
         apply_collisions(rb)
       end
     end
 
+    def self.broadphase
+      @broadphase ||= SpatialHash.new
+    end
+
+    # Roughly the diameter of a typical collider; rebuilds the broadphase
+    def self.cell_size=(size)
+      @broadphase = SpatialHash.new(size)
+      colliders.each { |collider| broadphase.update(collider) }
+    end
+
     def self.rigidbodies
       @cached_rigidbodies ||= []
     end
@@ -26,23 +39,27 @@ module Engine::Physics
 
     def self.register_collider(collider)
       colliders << collider
+      broadphase.update(collider)
     end
 
     def self.unregister_collider(collider)
       colliders.delete(collider)
+      broadphase.remove(collider)
     end
 
     private
 
+    # Only pairs that share a broadphase cell reach collision_for
     def self.apply_collisions(rigidbody)
-      other_colliders = colliders.reject { |c| rigidbody.colliders.include?(c) }
-
-      rigidbody.colliders.map do |collider|
-        other_colliders.map do |other_collider|
-          collider.collision_for(other_collider)
-        end.compact
-      end.flatten.each do |collision|
-        rigidbody.apply_impulse(collision.impulse, collision.point)
+      own_colliders = rigidbody.colliders
+
+      own_colliders.each do |collider|
+        broadphase.each_candidate(collider) do |other_collider|
+          next if own_colliders.include?(other_collider)
+
+          collision = collider.collision_for(other_collider)
+          rigidbody.apply_impulse(collision.impulse, collision.point) if collision
+        end
       end
     end
   end
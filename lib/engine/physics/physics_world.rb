@@ -0,0 +1,108 @@
+# frozen_string_literal: true
+
+require "physics_native"
+
+module Engine::Physics
+  # Steps every Rigidbody at a fixed rate, whatever the frame rate. Rigidbody
+  # state lives in the physics_native extension; each frame the variable
+  # delta_time is banked in an accumulator and spent in whole fixed steps,
+  # each split into `sub_steps` integrations.
+  #
+  # Collisions are resolved before every step, against the state the last
+  # step left (never a blended one), and their impulses land on that step.
+  # So a scene plays out the same whatever the frame rate.
+  #
+  # With `interpolate` on, transforms are blended between the last two steps
+  # by the time left in the accumulator, so motion stays smooth when the
+  # frame rate and step rate don't line up. Rendering then trails the
+  # simulation by up to one step.
+  module PhysicsWorld
+    DEFAULT_TIMESTEP = 1.0 / 60
+    DEFAULT_MAX_STEPS_PER_FRAME = 8
+
+    def self.fixed_timestep
+      @fixed_timestep ||= DEFAULT_TIMESTEP
+    end
+
+    def self.fixed_timestep=(seconds)
+      raise ArgumentError, "fixed_timestep must be positive, got #{seconds}" unless seconds.positive?
+
+      @fixed_timestep = seconds.to_f
+    end
+
+    def self.sub_steps
+      @sub_steps ||= 1
+    end
+
+    def self.sub_steps=(count)
+      raise ArgumentError, "sub_steps must be at least 1, got #{count}" unless count >= 1
+
+      @sub_steps = count
+    end
+
+    # Caps catch-up after a long frame so a slow frame can't snowball
+    def self.max_steps_per_frame
+      @max_steps_per_frame ||= DEFAULT_MAX_STEPS_PER_FRAME
+    end
+
+    def self.max_steps_per_frame=(count)
+      @max_steps_per_frame = count
+    end
+
+    def self.interpolate?
+      @interpolate || false
+    end
+
+    def self.interpolate=(value)
+      @interpolate = value
+    end
+
+    # True once simulate has run; Rigidbody#update leaves stepping to the world
+    def self.running?
+      @running || false
+    end
+
+    def self.accumulator
+      @accumulator ||= 0.0
+    end
+
+    # Fraction of a step banked but not yet simulated
+    def self.alpha
+      accumulator / fixed_timestep
+    end
+
+    # Returns the number of fixed steps taken
+    def self.simulate(delta_time)
+      @running = true
+      @accumulator = accumulator + delta_time
+
+      rigidbodies = PhysicsResolver.rigidbodies
+      rigidbodies.each(&:pull_transform)
+
+      steps = 0
+      while @accumulator >= fixed_timestep && steps < max_steps_per_frame
+        # Colliders read the GameObjects: bring them up to the last step,
+        # replacing last frame's blend
+        rigidbodies.each(&:push_to_transform) if steps > 0 || interpolate?
+        Engine::FrameProfiler.phase(:physics_resolve) { PhysicsResolver.resolve }
+        PhysicsNative.step(fixed_timestep, sub_steps)
+        @accumulator -= fixed_timestep
+        steps += 1
+      end
+      @accumulator %= fixed_timestep if steps == max_steps_per_frame
+
+      if interpolate?
+        blend = alpha
+        rigidbodies.each { |rigidbody| rigidbody.push_to_transform(blend) }
+      elsif steps > 0
+        rigidbodies.each(&:push_to_transform)
+      end
+      steps
+    end
+
+    def self.reset
+      @running = false
+      @accumulator = 0.0
+    end
+  end
+end
@@ -0,0 +1,133 @@
+# frozen_string_literal: true
+
+module Engine::Physics
+  # Broadphase over collider bounding boxes: a uniform grid keyed by packed
+  # cell coordinates. Each collider is listed in every cell its box touches,
+  # and only colliders sharing a cell are handed to the narrowphase.
+  #
+  # Colliders answer `center` and `bounding_radius`. `update` recomputes a
+  # collider's cell range and only re-buckets it when the range changed, so
+  # colliders that stay within their cells cost one comparison per frame.
+  # Anything spanning more than MAX_CELLS cells (ground planes, huge
+  # triggers) is kept in an oversized list that pairs with everything.
+  class SpatialHash
+    DEFAULT_CELL_SIZE = 2.0
+    MAX_CELLS = 64
+
+    # 21 bits per axis, so cell coordinates wrap at +/- 2^20
+    AXIS_BITS = 21
+    AXIS_MASK = (1 << AXIS_BITS) - 1
+
+    attr_reader :cell_size
+
+    def initialize(cell_size = DEFAULT_CELL_SIZE)
+      @cell_size = cell_size.to_f
+      @cells = {}
+      @ranges = {}.compare_by_identity
+      @oversized = []
+    end
+
+    def include?(collider)
+      @ranges.key?(collider)
+    end
+
+    def size
+      @ranges.size
+    end
+
+    def update(collider)
+      center = collider.center
+      radius = collider.bounding_radius
+      x0 = ((center[0] - radius) / @cell_size).floor
+      y0 = ((center[1] - radius) / @cell_size).floor
+      z0 = ((center[2] - radius) / @cell_size).floor
+      x1 = ((center[0] + radius) / @cell_size).floor
+      y1 = ((center[1] + radius) / @cell_size).floor
+      z1 = ((center[2] + radius) / @cell_size).floor
+
+      range = @ranges[collider]
+      return if range && range[0] == x0 && range[1] == y0 && range[2] == z0 &&
+                range[3] == x1 && range[4] == y1 && range[5] == z1
+
+      remove(collider) if range
+      range = [x0, y0, z0, x1, y1, z1]
+      @ranges[collider] = range
+
+      if cell_count(range) > MAX_CELLS
+        @oversized << collider
+      else
+        each_cell_key(range) { |key| (@cells[key] ||= []) << collider }
+      end
+    end
+
+    def remove(collider)
+      range = @ranges.delete(collider)
+      return unless range
+
+      if cell_count(range) > MAX_CELLS
+        @oversized.delete(collider)
+        return
+      end
+
+      each_cell_key(range) do |key|
+        cell = @cells[key]
+        cell.delete(collider)
+        @cells.delete(key) if cell.empty?
+      end
+    end
+
+    # Yields every other collider sharing a cell with collider, once each
+    def each_candidate(collider)
+      range = @ranges[collider]
+      return unless range
+
+      if cell_count(range) > MAX_CELLS
+        @ranges.each_key { |other| yield other unless other.equal?(collider) }
+        return
+      end
+
+      @oversized.each { |other| yield other }
+
+      if range[0] == range[3] && range[1] == range[4] && range[2] == range[5]
+        @cells[cell_key(range[0], range[1], range[2])].each { |other| yield other unless other.equal?(collider) }
+        return
+      end
+
+      seen = {}.compare_by_identity
+      each_cell_key(range) do |key|
+        @cells[key].each do |other|
+          next if other.equal?(collider) || seen.key?(other)
+
+          seen[other] = true
+          yield other
+        end
+      end
+    end
+
+    def candidates(collider)
+      result = []
+      each_candidate(collider) { |other| result << other }
+      result
+    end
+
+    private
+
+    def cell_count(range)
+      (range[3] - range[0] + 1) * (range[4] - range[1] + 1) * (range[5] - range[2] + 1)
+    end
+
+    def cell_key(x, y, z)
+      ((x & AXIS_MASK) << (AXIS_BITS * 2)) | ((y & AXIS_MASK) << AXIS_BITS) | (z & AXIS_MASK)
+    end
+
+    def each_cell_key(range)
+      (range[0]..range[3]).each do |x|
+        (range[1]..range[4]).each do |y|
+          (range[2]..range[5]).each do |z|
+            yield cell_key(x, y, z)
+          end
+        end
+      end
+    end
+  end
+end
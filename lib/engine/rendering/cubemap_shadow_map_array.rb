@@ -12,7 +12,7 @@ module Rendering
       check_framebuffer_complete
     end
 
-    def bind_face(layer_index, face_index)
+    def bind_face(layer_index, face_index, clear: true)
       raise "Layer index #{layer_index} out of bounds" if layer_index >= @layer_count
       raise "Face index #{face_index} out of bounds" if face_index >= 6
 
@@ -21,7 +21,34 @@ module Rendering
       array_layer = layer_index * 6 + face_index
       Engine::GL.FramebufferTextureLayer(Engine::GL::FRAMEBUFFER, Engine::GL::DEPTH_ATTACHMENT, @depth_texture, 0, array_layer)
       Engine::GL.Viewport(0, 0, @size, @size)
-      Engine::GL.Clear(Engine::GL::DEPTH_BUFFER_BIT)
+      Engine::GL.Clear(Engine::GL::DEPTH_BUFFER_BIT) if clear
+    end
+
+    # Attaches the whole array as a layered target so one pass can fill all
+    # six faces, with the geometry shader choosing each face via gl_Layer.
+    # Clearing a layered attachment would wipe every light, so this light's
+    # faces are cleared one at a time first.
+    def bind_cube(layer_index, clear: true)
+      raise "Layer index #{layer_index} out of bounds" if layer_index >= @layer_count
+
+      6.times { |face_index| bind_face(layer_index, face_index) } if clear
+      Engine::GL.BindFramebuffer(Engine::GL::FRAMEBUFFER, @framebuffer)
+      Engine::GL.FramebufferTexture(Engine::GL::FRAMEBUFFER, Engine::GL::DEPTH_ATTACHMENT, @depth_texture, 0)
+      Engine::GL.Viewport(0, 0, @size, @size)
+    end
+
+    # Same-sized array holding static casters' depth (see ShadowCache)
+    def static_cache
+      @static_cache ||= CubemapShadowMapArray.new(size: @size, layer_count: @layer_count)
+    end
+
+    def copy_layer_from(source, layer_index)
+      6.times do |face_index|
+        ShadowMapArray.blit_depth_layer(
+          source.framebuffer, source.depth_texture, @framebuffer, @depth_texture,
+          layer_index * 6 + face_index, @size, @size
+        )
+      end
     end
 
     private
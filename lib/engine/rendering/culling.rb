@@ -0,0 +1,65 @@
+# frozen_string_literal: true
+
+require "culling_native"
+
+module Rendering
+  # Frustum culling for instanced batches. Planes come from a pass's
+  # view-projection matrix (or a box around a point light's range) and
+  # CullingNative compacts each batch down to the instances whose world
+  # bounding sphere touches them. Visible/total counts are kept per pass and
+  # reported by GpuTimer.
+  module Culling
+    class << self
+      # Gribb-Hartmann extraction. Matrices here are row-vector (clip = v * M),
+      # so each clip plane is column 3 plus or minus column 0, 1 or 2.
+      def frustum_planes(matrix)
+        rows = matrix.to_a
+        column = ->(j) { rows.map { |row| row[j] } }
+        w = column.call(3)
+
+        planes = (0..2).flat_map do |i|
+          axis = column.call(i)
+          [w.zip(axis).map { |a, b| a + b }, w.zip(axis).map { |a, b| a - b }]
+        end
+        pack_planes(planes)
+      end
+
+      # Axis aligned box around a point light; cheaper than six face frusta
+      # and shared by every face of its cubemap
+      def box_planes(center, half_extent)
+        x, y, z = center[0], center[1], center[2]
+        pack_planes([
+          [1, 0, 0, half_extent - x], [-1, 0, 0, half_extent + x],
+          [0, 1, 0, half_extent - y], [0, -1, 0, half_extent + y],
+          [0, 0, 1, half_extent - z], [0, 0, -1, half_extent + z]
+        ])
+      end
+
+      def stats
+        @stats ||= {}
+      end
+
+      def record(pass, visible, total)
+        return unless GpuTimer.enabled?
+
+        counts = stats[pass] ||= { visible: 0, total: 0 }
+        counts[:visible] += visible
+        counts[:total] += total
+      end
+
+      def reset_stats
+        @stats = {}
+      end
+
+      private
+
+      # Normalized so CullingNative can compare distances against radii
+      def pack_planes(planes)
+        planes.filter_map do |a, b, c, d|
+          length = Math.sqrt(a * a + b * b + c * c)
+          [a / length, b / length, c / length, d / length] if length > 0
+        end.flatten.pack('F*')
+      end
+    end
+  end
+end
@@ -0,0 +1,103 @@
+# frozen_string_literal: true
+
+module Rendering
+  # Asynchronous framebuffer reads through a ring of pixel pack buffers.
+  #
+  # `request` starts a ReadPixels into the next free buffer and fences it;
+  # the GPU finishes the copy while the CPU moves on. `poll` is called once
+  # per frame and hands back every read whose fence has signalled, usually
+  # a frame or two later, so nothing waits on the GPU. `finish` blocks until
+  # all reads are in, for shutdown; `dispose` drops them and frees the
+  # buffers and fences. Pixels are RGBA, rows bottom-up.
+  class FrameReadback
+    RING_SIZE = 3
+    FENCE_TIMEOUT_NS = 1_000_000_000
+    SIGNALED = [Engine::GL::ALREADY_SIGNALED, Engine::GL::CONDITION_SATISFIED].freeze
+
+    Read = Struct.new(:buffer, :fence, :width, :height, :payload)
+
+    def initialize
+      @buffers = Array.new(RING_SIZE) { generate_buffer }
+      @capacities = Array.new(RING_SIZE, 0)
+      @next = 0
+      @pending = []
+    end
+
+    def pending_count
+      @pending.length
+    end
+
+    def full?
+      @pending.length == RING_SIZE
+    end
+
+    # Reads the bound framebuffer; payload comes back with the pixels.
+    # When every buffer is in flight the oldest read is waited for first
+    def request(width, height, payload = nil, &on_read)
+      finish_read(@pending.first, FENCE_TIMEOUT_NS, &on_read) if full?
+
+      index = @next
+      @next = (@next + 1) % RING_SIZE
+      size = width * height * 4
+
+      Engine::GL.BindBuffer(Engine::GL::PIXEL_PACK_BUFFER, @buffers[index])
+      if size > @capacities[index]
+        Engine::GL.BufferData(Engine::GL::PIXEL_PACK_BUFFER, size, nil, Engine::GL::STREAM_READ)
+        @capacities[index] = size
+      end
+      Engine::GL.ReadPixels(0, 0, width, height, Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, 0)
+      Engine::GL.BindBuffer(Engine::GL::PIXEL_PACK_BUFFER, 0)
+
+      fence = Engine::GL.FenceSync(Engine::GL::SYNC_GPU_COMMANDS_COMPLETE, 0)
+      @pending << Read.new(@buffers[index], fence, width, height, payload)
+    end
+
+    # Yields pixels, width, height and payload for each completed read, oldest first
+    def poll(&block)
+      finish_read(@pending.first, 0, &block) while @pending.any? && signaled?(@pending.first)
+    end
+
+    def finish(&block)
+      finish_read(@pending.first, FENCE_TIMEOUT_NS, &block) while @pending.any?
+    end
+
+    # Drops reads in flight and frees the fences and buffers; the readback
+    # can't be used afterwards
+    def dispose
+      @pending.each { |read| Engine::GL.DeleteSync(read.fence) }
+      @pending.clear
+      Engine::GL.DeleteBuffers(RING_SIZE, @buffers.pack('L*'))
+      @buffers = nil
+    end
+
+    private
+
+    # Fences signal in submission order, so the oldest read gates the rest.
+    # The flush bit makes sure the fence reaches the GPU on the first check
+    def signaled?(read)
+      status = Engine::GL.ClientWaitSync(read.fence, Engine::GL::SYNC_FLUSH_COMMANDS_BIT, 0)
+      SIGNALED.include?(status)
+    end
+
+    def finish_read(read, timeout)
+      Engine::GL.ClientWaitSync(read.fence, Engine::GL::SYNC_FLUSH_COMMANDS_BIT, timeout) if timeout > 0
+      Engine::GL.DeleteSync(read.fence)
+      @pending.shift
+
+      size = read.width * read.height * 4
+      Engine::GL.BindBuffer(Engine::GL::PIXEL_PACK_BUFFER, read.buffer)
+      address = Engine::GL.MapBufferRange(Engine::GL::PIXEL_PACK_BUFFER, 0, size, Engine::GL::MAP_READ_BIT)
+      pixels = Engine::GL.ReadMappedBuffer(address, 0, size)
+      Engine::GL.UnmapBuffer(Engine::GL::PIXEL_PACK_BUFFER)
+      Engine::GL.BindBuffer(Engine::GL::PIXEL_PACK_BUFFER, 0)
+
+      yield pixels, read.width, read.height, read.payload
+    end
+
+    def generate_buffer
+      buf = ' ' * 4
+      Engine::GL.GenBuffers(1, buf)
+      buf.unpack1('L')
+    end
+  end
+end
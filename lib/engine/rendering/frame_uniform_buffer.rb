@@ -0,0 +1,111 @@
+# frozen_string_literal: true
+
+module Rendering
+  # Camera and light data for the FrameUniforms block in
+  # shaders/lighting/frame_uniforms.glsl. Packed (std140) and uploaded once per
+  # frame, then read by every lit shader through a fixed binding point instead
+  # of per-material light uniforms.
+  class FrameUniformBuffer
+    BLOCK_NAME = "FrameUniforms"
+    BINDING_POINT = 0
+
+    MAX_POINT_LIGHTS = 16
+    MAX_DIRECTION_LIGHTS = 4
+    MAX_SPOT_LIGHTS = 8
+
+    # std140 layouts; the x padding keeps every vec3 and mat4 on a 16 byte boundary
+    HEADER_LAYOUT = 'F16 F3 x4'
+    POINT_LIGHT_LAYOUT = 'F3 F F3 l l F x8'
+    DIRECTION_LIGHT_LAYOUT = 'F3 x4 F3 x4 F16 l x12'
+    SPOT_LIGHT_LAYOUT = 'F3 x4 F3 F F3 F F x12 F16 l F F x4'
+
+    HEADER_SIZE = 80
+    POINT_LIGHT_SIZE = 48
+    DIRECTION_LIGHT_SIZE = 112
+    SPOT_LIGHT_SIZE = 144
+    SIZE = HEADER_SIZE +
+           MAX_POINT_LIGHTS * POINT_LIGHT_SIZE +
+           MAX_DIRECTION_LIGHTS * DIRECTION_LIGHT_SIZE +
+           MAX_SPOT_LIGHTS * SPOT_LIGHT_SIZE
+
+    IDENTITY = Array.new(16) { |i| i % 5 == 0 ? 1.0 : 0.0 }.freeze
+
+    attr_reader :data
+
+    def initialize
+      @data = String.new(capacity: SIZE, encoding: Encoding::BINARY)
+
+      buf = ' ' * 4
+      Engine::GL.GenBuffers(1, buf)
+      @buffer = buf.unpack1('L')
+      Engine::GL.BindBuffer(Engine::GL::UNIFORM_BUFFER, @buffer)
+      Engine::GL.BufferData(Engine::GL::UNIFORM_BUFFER, SIZE, nil, Engine::GL::DYNAMIC_DRAW)
+      Engine::GL.BindBufferBase(Engine::GL::UNIFORM_BUFFER, BINDING_POINT, @buffer)
+    end
+
+    # Points a program's FrameUniforms block (if it has one) at the shared buffer
+    def self.bind_program(program)
+      block_index = Engine::GL.GetUniformBlockIndex(program, BLOCK_NAME)
+      return if block_index == Engine::GL::INVALID_INDEX
+
+      Engine::GL.UniformBlockBinding(program, block_index, BINDING_POINT)
+    end
+
+    def update(camera)
+      pack(camera)
+      Engine::GL.BindBuffer(Engine::GL::UNIFORM_BUFFER, @buffer)
+      Engine::GL.BufferSubData(Engine::GL::UNIFORM_BUFFER, 0, SIZE, @data)
+    end
+
+    def pack(camera)
+      @data.clear
+      @data << [*camera.matrix.to_a.flatten, *vec3(camera.game_object.pos)].pack(HEADER_LAYOUT)
+
+      pack_lights(Engine::Components::PointLight.point_lights, MAX_POINT_LIGHTS, POINT_LIGHT_SIZE) do |light|
+        has_shadow = light.cast_shadows && !light.shadow_layer_index.nil?
+        [
+          *vec3(light.position), light.range * light.range, *vec3(light.colour),
+          has_shadow ? 1 : 0, light.shadow_layer_index || 0, has_shadow ? light.shadow_far : 0
+        ].pack(POINT_LIGHT_LAYOUT)
+      end
+
+      pack_lights(Engine::Components::DirectionLight.direction_lights, MAX_DIRECTION_LIGHTS, DIRECTION_LIGHT_SIZE) do |light|
+        has_shadow = light.cast_shadows && !light.shadow_layer_index.nil?
+        [
+          *vec3(light.direction), *vec3(light.colour),
+          *matrix_values(has_shadow ? light.light_space_matrix : nil), has_shadow ? 1 : 0
+        ].pack(DIRECTION_LIGHT_LAYOUT)
+      end
+
+      pack_lights(Engine::Components::SpotLight.spot_lights, MAX_SPOT_LIGHTS, SPOT_LIGHT_SIZE) do |light|
+        has_shadow = light.cast_shadows && !light.shadow_layer_index.nil?
+        [
+          *vec3(light.position), *vec3(light.direction), light.range * light.range,
+          *vec3(light.colour), light.inner_cutoff, light.outer_cutoff,
+          *matrix_values(has_shadow ? light.light_space_matrix : nil), has_shadow ? 1 : 0,
+          has_shadow ? light.shadow_near : 0, has_shadow ? light.shadow_far : 0
+        ].pack(SPOT_LIGHT_LAYOUT)
+      end
+
+      @data
+    end
+
+    private
+
+    # Unused slots are zeroed; the shader loops stop at the first empty light
+    def pack_lights(lights, max, size)
+      count = [lights.length, max].min
+      lights.first(count).each { |light| @data << yield(light) }
+      @data << ("\0" * ((max - count) * size))
+    end
+
+    def vec3(value)
+      value.is_a?(Hash) ? [value[:r], value[:g], value[:b]] : [value[0], value[1], value[2]]
+    end
+
+    # Row-major, matching the layout Shader#set_mat4 uploads
+    def matrix_values(matrix)
+      matrix ? matrix.to_a.flatten : IDENTITY
+    end
+  end
+end
@@ -1,18 +1,62 @@
 # frozen_string_literal: true
 
+require "json"
+
 module Rendering
+  # Per-stage GPU and CPU timings that don't stall the pipeline.
+  #
+  # measure brackets a stage with two TIMESTAMP queries and reads the CPU
+  # clock around it; scopes nest. end_frame, once per frame after drawing,
+  # collects the frames whose last query has its result available, usually
+  # two or three frames back, and never waits on the rest. Frames still
+  # unavailable after MAX_PENDING_FRAMES are dropped. Query objects are
+  # pooled and reused once their frame is collected.
+  #
+  # Collected scopes go into a ring of the last TRACE_CAPACITY events, which
+  # export_trace writes as Chrome trace JSON (chrome://tracing, Perfetto)
+  # with CPU and GPU on separate tracks. GPU times are moved onto the CPU
+  # clock with an offset sampled each frame, so the overlap lines up.
+  #
+  # GPU_PROFILE prints averages every REPORT_INTERVAL frames; GPU_TRACE=path
+  # records without printing and writes the trace on exit.
   class GpuTimer
+    REPORT_INTERVAL = 60
+    MAX_PENDING_FRAMES = 4
+    TRACE_CAPACITY = 16_384
+
+    Scope = Struct.new(:name, :depth, :cpu_start, :cpu_end, :start_query, :end_query)
+    Frame = Struct.new(:number, :scopes, :gpu_offset, :last_query)
+    # track is :cpu or :gpu; times are CPU clock nanoseconds
+    Event = Struct.new(:name, :track, :depth, :start_ns, :duration_ns, :frame)
+
     class << self
+      attr_reader :dropped_frames
+
       def enabled?
         @enabled ||= false
       end
 
-      def enable
+      def enable(report: true)
         @enabled = true
-        @frame_count = 0
-        @stages = []
-        @queries = {}
-        puts "GPU Profiler: ON"
+        @report = report
+        @frame_number = 0
+        @open = []
+        @pending = []
+        @free_queries = []
+        @trace = Array.new(TRACE_CAPACITY)
+        @trace_head = 0
+        @trace_count = 0
+        @dropped_frames = 0
+        reset_totals
+        @frame = new_frame
+        Engine::Shader.reset_uniform_stats
+        Culling.reset_stats
+        RenderPipeline.shadow_cache.reset_stats
+        puts "GPU Profiler: ON" if report
+      end
+
+      def disable
+        @enabled = false
       end
 
       def measure(stage)
@@ -20,48 +64,150 @@ module Rendering
           return yield
         end
 
-        query_id = query_for(stage)
-        Engine::GL.BeginQuery(Engine::GL::TIME_ELAPSED, query_id)
-        result = yield
-        Engine::GL.EndQuery(Engine::GL::TIME_ELAPSED)
-        result
+        scope = Scope.new(stage, @open.length, now_ns, nil, timestamp, nil)
+        @frame.scopes << scope
+        @open.push(scope)
+        begin
+          yield
+        ensure
+          scope.end_query = timestamp
+          scope.cpu_end = now_ns
+          @open.pop
+        end
       end
 
-      def print_results
+      def end_frame
         return unless enabled?
 
-        @frame_count += 1
-        return unless (@frame_count % 60) == 0
+        @pending << @frame
+        @frame = new_frame
+        collect_available
+        report if @report && (@frame_number % REPORT_INTERVAL) == 0
+      end
+
+      # Oldest first
+      def trace_events
+        start = (@trace_head - @trace_count) % TRACE_CAPACITY
+        Array.new(@trace_count) { |i| @trace[(start + i) % TRACE_CAPACITY] }
+      end
 
-        results = {}
-        @stages.each do |stage|
-          buf = ' ' * 8
-          Engine::GL.GetQueryObjectui64v(@queries[stage], Engine::GL::QUERY_RESULT, buf)
-          results[stage] = buf.unpack1('Q') / 1_000_000.0
+      def export_trace(path)
+        tracks = { cpu: 1, gpu: 2 }
+        events = tracks.map do |track, tid|
+          { name: "thread_name", ph: "M", pid: 1, tid:, args: { name: track.to_s.upcase } }
         end
+        trace_events.each do |event|
+          events << {
+            name: event.name.to_s, cat: event.track.to_s, ph: "X", pid: 1, tid: tracks[event.track],
+            ts: event.start_ns / 1000.0, dur: event.duration_ns / 1000.0, args: { frame: event.frame }
+          }
+        end
+        File.write(path, JSON.generate({ traceEvents: events, displayTimeUnit: "ms" }))
+      end
+
+      private
+
+      def new_frame
+        @frame_number += 1
+        buf = ' ' * 8
+        Engine::GL.GetInteger64v(Engine::GL::TIMESTAMP, buf)
+        Frame.new(@frame_number, [], now_ns - buf.unpack1('q'), nil)
+      end
+
+      def timestamp
+        query = @free_queries.pop || generate_query
+        Engine::GL.QueryCounter(query, Engine::GL::TIMESTAMP)
+        @frame.last_query = query
+        query
+      end
 
-        total = results.values.sum
-        puts "\n=== GPU Timing ==="
-        @stages.each do |stage|
-          ms = results[stage]
+      # Timestamps complete in order, so the frame's last one stands for all
+      def collect_available
+        while (frame = @pending.first) && (frame.last_query.nil? || query_value(frame.last_query, Engine::GL::QUERY_RESULT_AVAILABLE) != 0)
+          collect(@pending.shift)
+        end
+        while @pending.length > MAX_PENDING_FRAMES
+          release(@pending.shift)
+          @dropped_frames += 1
+        end
+      end
+
+      def collect(frame)
+        frame.scopes.each do |scope|
+          gpu_start = query_value(scope.start_query, Engine::GL::QUERY_RESULT)
+          gpu_ns = query_value(scope.end_query, Engine::GL::QUERY_RESULT) - gpu_start
+          cpu_ns = scope.cpu_end - scope.cpu_start
+
+          push_event(Event.new(scope.name, :cpu, scope.depth, scope.cpu_start, cpu_ns, frame.number))
+          push_event(Event.new(scope.name, :gpu, scope.depth, gpu_start + frame.gpu_offset, gpu_ns, frame.number))
+
+          totals = @totals[scope.name] ||= { gpu: 0, cpu: 0, depth: scope.depth }
+          totals[:gpu] += gpu_ns
+          totals[:cpu] += cpu_ns
+        end
+        @collected_frames += 1
+        release(frame)
+      end
+
+      def release(frame)
+        frame.scopes.each { |scope| @free_queries.push(scope.start_query, scope.end_query) }
+      end
+
+      def push_event(event)
+        @trace[@trace_head] = event
+        @trace_head = (@trace_head + 1) % TRACE_CAPACITY
+        @trace_count = [@trace_count + 1, TRACE_CAPACITY].min
+      end
+
+      def reset_totals
+        @totals = {}
+        @collected_frames = 0
+      end
+
+      def report
+        frames = [@collected_frames, 1].max
+        # Nested scopes are already inside their parent's time
+        total = @totals.values.select { |t| t[:depth] == 0 }.sum { |t| t[:gpu] } / frames / 1_000_000.0
+
+        puts "\n=== GPU Timing (avg of #{@collected_frames} frames, #{@dropped_frames} dropped) ==="
+        @totals.each do |stage, t|
+          ms = t[:gpu] / frames / 1_000_000.0
+          cpu_ms = t[:cpu] / frames / 1_000_000.0
           pct = total > 0 ? (ms / total * 100).round(1) : 0
           bar = "█" * (pct / 5).to_i
-          puts format("%-20s %6.2f ms (%5.1f%%) %s", stage, ms, pct, bar)
+          puts format("%-20s %6.2f ms (%5.1f%%) cpu %6.2f ms %s", "#{'  ' * t[:depth]}#{stage}", ms, pct, cpu_ms, bar)
         end
         puts format("%-20s %6.2f ms", "TOTAL", total)
+        reset_totals
+
+        uniforms = Engine::Shader.uniform_stats
+        puts format("%-20s %6d sent, %d skipped per frame", "uniforms", uniforms[:sent] / REPORT_INTERVAL, uniforms[:skipped] / REPORT_INTERVAL)
+        Engine::Shader.reset_uniform_stats
+        Culling.stats.each do |pass, counts|
+          culled = counts[:total] - counts[:visible]
+          puts format("%-20s %6d drawn, %d culled per frame", "culling #{pass}", counts[:visible] / REPORT_INTERVAL, culled / REPORT_INTERVAL)
+        end
+        Culling.reset_stats
+        shadows = RenderPipeline.shadow_cache.stats
+        puts format("%-20s %6d rendered, %d cached per frame", "shadow layers", shadows[:rendered] / REPORT_INTERVAL, shadows[:cached] / REPORT_INTERVAL)
+        RenderPipeline.shadow_cache.reset_stats
         puts "===================="
       end
 
-      private
+      def query_value(query, pname)
+        buf = ' ' * 8
+        Engine::GL.GetQueryObjectui64v(query, pname, buf)
+        buf.unpack1('Q')
+      end
 
-      def query_for(stage)
-        return @queries[stage] if @queries[stage]
+      def now_ns
+        Process.clock_gettime(Process::CLOCK_MONOTONIC, :nanosecond)
+      end
 
+      def generate_query
         buf = ' ' * 4
         Engine::GL.GenQueries(1, buf)
-        @queries[stage] = buf.unpack1('L')
-        @stages << stage
-        @queries[stage]
+        buf.unpack1('L')
       end
     end
   end
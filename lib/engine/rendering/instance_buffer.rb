@@ -0,0 +1,136 @@
+# frozen_string_literal: true
+
+module Rendering
+  # GPU copy of an InstanceRenderer's packed per-instance data.
+  #
+  # Writers mutate `data` and report the touched bytes with `mark_dirty`;
+  # `upload` is called once per frame and only sends the dirty ranges. Where
+  # ARB_buffer_storage is available the buffer is a persistently mapped ring
+  # of RING_SIZE regions guarded by fences, so the CPU never writes into a
+  # region the GPU may still be reading. Elsewhere (macOS) it falls back to
+  # BufferSubData on a single buffer.
+  class InstanceBuffer
+    RING_SIZE = 3
+    MIN_CAPACITY = 64 * 64
+    FENCE_TIMEOUT_NS = 1_000_000_000
+    SIGNALED = [Engine::GL::ALREADY_SIGNALED, Engine::GL::CONDITION_SATISFIED].freeze
+
+    attr_reader :data, :buffer, :offset
+
+    def initialize
+      @data = String.new(encoding: Encoding::BINARY)
+      @capacity = 0
+      @offset = 0
+      @persistent = Engine::GL.BufferStorageSupported
+      @region = 0
+      @fences = Array.new(RING_SIZE)
+      @dirty_ranges = Array.new(RING_SIZE)
+      @buffer = generate_buffer
+    end
+
+    def persistent?
+      @persistent
+    end
+
+    def mark_dirty(byte_offset, byte_size)
+      return if byte_size <= 0
+
+      byte_end = byte_offset + byte_size
+      @dirty_ranges.each_with_index do |range, i|
+        @dirty_ranges[i] = range ? [[range[0], byte_offset].min, [range[1], byte_end].max] : [byte_offset, byte_end]
+      end
+    end
+
+    def upload
+      return if @data.empty?
+
+      ensure_capacity(@data.bytesize)
+      persistent? ? upload_persistent : upload_sub_data
+    end
+
+    private
+
+    def upload_sub_data
+      range = @dirty_ranges[0]
+      @dirty_ranges.fill(nil)
+      start, finish = clamp_range(range) if range
+      return unless start && finish > start
+
+      Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, @buffer)
+      Engine::GL.BufferSubData(Engine::GL::ARRAY_BUFFER, start, finish - start, @data.byteslice(start, finish - start))
+    end
+
+    def upload_persistent
+      # The current region already holds the latest data: keep drawing from it
+      return unless @dirty_ranges[@region]
+
+      # Fence the draws that read from the current region before moving on
+      @fences[@region] = Engine::GL.FenceSync(Engine::GL::SYNC_GPU_COMMANDS_COMPLETE, 0)
+      @region = (@region + 1) % RING_SIZE
+      unless wait_for_region(@region)
+        # The GPU may still be reading the region: orphan the whole ring
+        # instead (GL frees the old storage once its draws are done)
+        reallocate_persistent
+        mark_dirty(0, @data.bytesize)
+      end
+
+      start, finish = clamp_range(@dirty_ranges[@region])
+      @dirty_ranges[@region] = nil
+      @offset = @region * @capacity
+      Engine::GL.WriteMappedBuffer(@mapping, @offset + start, @data, start, finish - start) if finish > start
+    end
+
+    # False when the fence timed out or the wait failed, so the region may
+    # still be in use
+    def wait_for_region(region)
+      fence = @fences[region]
+      return true unless fence
+
+      status = Engine::GL.ClientWaitSync(fence, Engine::GL::SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS)
+      return false unless SIGNALED.include?(status)
+
+      Engine::GL.DeleteSync(fence)
+      @fences[region] = nil
+      true
+    end
+
+    def clamp_range(range)
+      size = @data.bytesize
+      [[range[0], size].min, [range[1], size].min]
+    end
+
+    def ensure_capacity(size)
+      return if size <= @capacity
+
+      @capacity = [size * 2, MIN_CAPACITY].max
+      persistent? ? reallocate_persistent : reallocate_dynamic
+      mark_dirty(0, @data.bytesize)
+    end
+
+    def reallocate_dynamic
+      Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, @buffer)
+      Engine::GL.BufferData(Engine::GL::ARRAY_BUFFER, @capacity, nil, Engine::GL::DYNAMIC_DRAW)
+    end
+
+    # Immutable storage cannot be resized, so growing means a fresh buffer
+    def reallocate_persistent
+      @fences.each { |fence| Engine::GL.DeleteSync(fence) if fence }
+      @fences.fill(nil)
+      Engine::GL.DeleteBuffers(1, [@buffer].pack('L'))
+      @buffer = generate_buffer
+
+      flags = Engine::GL::MAP_WRITE_BIT | Engine::GL::MAP_PERSISTENT_BIT | Engine::GL::MAP_COHERENT_BIT
+      Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, @buffer)
+      Engine::GL.BufferStorage(Engine::GL::ARRAY_BUFFER, @capacity * RING_SIZE, nil, flags)
+      @mapping = Engine::GL.MapBufferRange(Engine::GL::ARRAY_BUFFER, 0, @capacity * RING_SIZE, flags)
+      @region = 0
+      @offset = 0
+    end
+
+    def generate_buffer
+      buf = ' ' * 4
+      Engine::GL.GenBuffers(1, buf)
+      buf.unpack1('L')
+    end
+  end
+end
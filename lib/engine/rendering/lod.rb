@@ -0,0 +1,40 @@
+# frozen_string_literal: true
+
+module Rendering
+  # Level of detail selection for meshes imported with LOD levels (see
+  # MeshFile). Once per frame every batch picks a level per instance from its
+  # bounding sphere's size on screen (CullingNative.select_lods): the coarsest
+  # level whose simplification error stays under pixel_error pixels.
+  #
+  # An instance only switches coarser once the error drops below
+  # pixel_error * (1 - hysteresis), so objects sitting at a threshold don't
+  # flicker between levels. Shadow passes draw shadow_bias levels coarser
+  # than the camera sees, since shadow maps rarely resolve the difference.
+  module Lod
+    DEFAULT_PIXEL_ERROR = 1.0
+    DEFAULT_HYSTERESIS = 0.25
+    DEFAULT_SHADOW_BIAS = 1
+
+    class << self
+      attr_writer :pixel_error, :hysteresis, :shadow_bias
+
+      def pixel_error
+        @pixel_error ||= DEFAULT_PIXEL_ERROR
+      end
+
+      def hysteresis
+        @hysteresis ||= DEFAULT_HYSTERESIS
+      end
+
+      def shadow_bias
+        @shadow_bias ||= DEFAULT_SHADOW_BIAS
+      end
+
+      # The camera packed for CullingNative.select_lods
+      def view(camera)
+        position = camera.position
+        [position[0], position[1], position[2], camera.screen_scale, camera.perspective? ? 1 : 0].pack('F5')
+      end
+    end
+  end
+end
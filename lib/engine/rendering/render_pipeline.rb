@@ -7,7 +7,7 @@ module Rendering
       return if Engine::Window.framebuffer_width <= 0 || Engine::Window.framebuffer_height <= 0
 
       update_render_texture_size
-      sync_transforms
+      Engine::FrameProfiler.phase(:sync_transforms) { sync_transforms }
       SkyboxRenderer.render_cubemap
       reset_viewport
 
@@ -47,7 +47,7 @@ module Rendering
         blit_to_screen(current_texture.color_texture)
       end
 
-      GpuTimer.print_results
+      GpuTimer.end_frame
     end
 
     def self.draw_shadow_maps
@@ -93,34 +93,141 @@ module Rendering
       @point_shadow_map_array ||= CubemapShadowMapArray.new(layer_count: 4)
     end
 
+    def self.frame_uniform_buffer
+      @frame_uniform_buffer ||= FrameUniformBuffer.new
+    end
+
+    def self.shadow_cache
+      @shadow_cache ||= ShadowCache.new
+    end
+
+    # Cache static casters' shadow depth separately from dynamic ones
+    def self.split_static_shadows=(value)
+      shadow_cache.split_static = value
+    end
+
     def self.render_shadow_map_to_layer(shadow_map_array, layer_index, light_space_matrix)
-      shadow_map_array.bind_layer(layer_index)
-      instance_renderers.values.each do |renderer|
-        renderer.draw_depth_only(light_space_matrix)
+      planes = Culling.frustum_planes(light_space_matrix)
+
+      render_cached_shadow(shadow_map_array, layer_index, [light_space_matrix], planes) do |target, clear|
+        target.bind_layer(layer_index, clear: clear)
+        shadow_shader = Engine::Shader.shadow
+        shadow_shader.use
+        shadow_shader.set_mat4("lightSpaceMatrix", light_space_matrix)
+        Engine::GL.Execute(depth_draw_commands)
       end
     end
 
     def self.render_point_shadow_to_layer(layer_index, light)
       light_pos = light.position
       far_plane = light.shadow_far
-      matrices = light.light_space_matrices
+      planes = Culling.box_planes(light_pos, far_plane)
+
+      render_cached_shadow(point_shadow_map_array, layer_index, [light_pos, far_plane], planes) do |target, clear|
+        # All six faces in one draw per batch; the geometry shader routes each face to its layer
+        target.bind_cube(layer_index, clear: clear)
+        shader = Engine::Shader.point_shadow
+        shader.use
+        shader.set_vec3("lightPos", light_pos)
+        shader.set_float("farPlane", far_plane)
+        shader.set_int("cubemapLayer", layer_index)
+        light.light_space_matrices.each_with_index do |matrix, face_index|
+          shader.set_mat4("faceMatrices[#{face_index}]", matrix)
+        end
+        Engine::GL.Execute(depth_draw_commands)
+      end
+    end
 
-      6.times do |face_index|
-        point_shadow_map_array.bind_face(layer_index, face_index)
-        instance_renderers.values.each do |renderer|
-          renderer.draw_point_light_depth(matrices[face_index], light_pos, far_plane)
+    # Culls every batch against a light and only redraws its layer when the
+    # light or its visible casters changed (see ShadowCache). The block binds
+    # and draws depth_draw_commands into the given array's layer.
+    def self.render_cached_shadow(shadow_map_array, layer_index, light_state, planes, &draw)
+      key = [shadow_map_array, layer_index]
+
+      unless shadow_cache.split_static
+        casters = cull_casters(instance_renderers.values, planes)
+        rendered = shadow_cache.stale?(key, [light_state, caster_signature(casters)])
+        if rendered
+          record_depth_draws(casters)
+          draw.call(shadow_map_array, true)
         end
+        return shadow_cache.record(rendered)
+      end
+
+      static_batches, dynamic_batches = instance_renderers.values.partition(&:static)
+      static_casters = cull_casters(static_batches, planes)
+      dynamic_casters = cull_casters(dynamic_batches, planes)
+      static_stale = shadow_cache.stale?([*key, :static], [light_state, caster_signature(static_casters)])
+      dynamic_stale = shadow_cache.stale?([*key, :dynamic], caster_signature(dynamic_casters))
+      rendered = static_stale || dynamic_stale
+      shadow_cache.record(rendered)
+      return unless rendered
+
+      if static_stale
+        record_depth_draws(static_casters)
+        draw.call(shadow_map_array.static_cache, true)
+      end
+      shadow_map_array.copy_layer_from(shadow_map_array.static_cache, layer_index)
+      record_depth_draws(dynamic_casters)
+      draw.call(shadow_map_array, false)
+    end
+
+    def self.cull_casters(renderers, planes)
+      renderers.select do |renderer|
+        visible = renderer.cull(planes, Lod.shadow_bias)
+        Culling.record(:shadows, visible, renderer.instance_count)
+        visible > 0
+      end
+    end
+
+    def self.caster_signature(casters)
+      casters.map { |renderer| [renderer, renderer.visible_signature] }
+    end
+
+    # The current shadow layer's visible draws, from the batches' last cull
+    def self.depth_draw_commands
+      @depth_draw_commands ||= Engine::GL::CommandBuffer.new
+    end
+
+    def self.record_depth_draws(casters)
+      depth_draw_commands.clear
+      casters.each do |renderer|
+        renderer.record_culled_depth_draw(depth_draw_commands)
       end
     end
 
     def self.sync_transforms
+      # Resolve every dirty world matrix in one parent-before-child pass so the
+      # per-renderer checks below only read already computed results
+      TransformNative.update_all
+
       Engine::GameObject.mesh_renderers.each do |renderer|
         renderer.sync_transform if renderer.respond_to?(:sync_transform)
       end
+
+      # One upload per renderer per frame, shared by the shadow and main passes
+      instance_renderers.values.each(&:upload_instances)
+      TextBatch.prepare_world
+      UI::Batcher.prepare
+      select_lods
+    end
+
+    # LOD levels come from the main camera once per frame, before the shadow
+    # passes, which draw Lod.shadow_bias levels coarser
+    def self.select_lods
+      camera = Engine::Camera.instance
+      return unless camera
+
+      view = Lod.view(camera)
+      instance_renderers.values.each { |renderer| renderer.select_lods(view) }
     end
 
     def self.draw_3d
-      instance_renderers.values.each(&:draw_all)
+      # Shadow layer indices are assigned by draw_shadow_maps, so lights are packed after it
+      frame_uniform_buffer.update(Engine::Camera.instance)
+      planes = Culling.frustum_planes(Engine::Camera.instance.matrix)
+      instance_renderers.values.each { |renderer| renderer.draw_all(planes) }
+      TextBatch.draw_world
     end
 
     def self.draw_ui
@@ -267,7 +374,7 @@ module Rendering
 
     def self.instance_renderers
       @instance_renderers ||= Hash.new do |hash, key|
-        hash[key] = InstanceRenderer.new(key[0], key[1])
+        hash[key] = InstanceRenderer.new(key[0], key[1], key[2])
       end
     end
   end
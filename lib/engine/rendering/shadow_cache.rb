@@ -0,0 +1,53 @@
+# frozen_string_literal: true
+
+module Rendering
+  # Remembers what each shadow layer was last rendered from, so a layer
+  # whose light and casters are unchanged keeps last frame's depth instead of
+  # being redrawn.
+  #
+  # A signature is the light's state plus InstanceRenderer#visible_signature
+  # for every batch after culling against the light. Casters moving inside
+  # the light's volume, or entering or leaving it, re-render the layer;
+  # anything outside it does not.
+  #
+  # With split_static, batches of static MeshRenderers are rendered into the
+  # shadow array's static_cache and only redrawn when they change. Frames
+  # where just dynamic casters changed copy the cached static depth back and
+  # draw the dynamic casters on top.
+  class ShadowCache
+    attr_reader :split_static, :stats
+
+    def initialize
+      @signatures = {}
+      @split_static = false
+      reset_stats
+    end
+
+    def split_static=(value)
+      @split_static = value
+      invalidate
+    end
+
+    # True (and remembers the signature) when key was last rendered from something else
+    def stale?(key, signature)
+      return false if @signatures[key] == signature
+
+      @signatures[key] = signature
+      true
+    end
+
+    def invalidate
+      @signatures.clear
+    end
+
+    def record(rendered)
+      return unless GpuTimer.enabled?
+
+      @stats[rendered ? :rendered : :cached] += 1
+    end
+
+    def reset_stats
+      @stats = { rendered: 0, cached: 0 }
+    end
+  end
+end
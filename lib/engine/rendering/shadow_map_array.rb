@@ -13,13 +13,31 @@ module Rendering
       check_framebuffer_complete
     end
 
-    def bind_layer(layer_index)
+    def bind_layer(layer_index, clear: true)
       raise "Layer index #{layer_index} out of bounds (max: #{@layer_count - 1})" if layer_index >= @layer_count
 
       Engine::GL.BindFramebuffer(Engine::GL::FRAMEBUFFER, @framebuffer)
       Engine::GL.FramebufferTextureLayer(Engine::GL::FRAMEBUFFER, Engine::GL::DEPTH_ATTACHMENT, @depth_texture, 0, layer_index)
       Engine::GL.Viewport(0, 0, @width, @height)
-      Engine::GL.Clear(Engine::GL::DEPTH_BUFFER_BIT)
+      Engine::GL.Clear(Engine::GL::DEPTH_BUFFER_BIT) if clear
+    end
+
+    # Same-sized array holding static casters' depth (see ShadowCache)
+    def static_cache
+      @static_cache ||= ShadowMapArray.new(width: @width, height: @height, layer_count: @layer_count)
+    end
+
+    def copy_layer_from(source, layer_index)
+      ShadowMapArray.blit_depth_layer(source.framebuffer, source.depth_texture, @framebuffer, @depth_texture, layer_index, @width, @height)
+    end
+
+    # Depth copies go through a blit, which GL 4.1 supports (CopyImageSubData is 4.3)
+    def self.blit_depth_layer(source_framebuffer, source_texture, framebuffer, texture, layer, width, height)
+      Engine::GL.BindFramebuffer(Engine::GL::READ_FRAMEBUFFER, source_framebuffer)
+      Engine::GL.FramebufferTextureLayer(Engine::GL::READ_FRAMEBUFFER, Engine::GL::DEPTH_ATTACHMENT, source_texture, 0, layer)
+      Engine::GL.BindFramebuffer(Engine::GL::DRAW_FRAMEBUFFER, framebuffer)
+      Engine::GL.FramebufferTextureLayer(Engine::GL::DRAW_FRAMEBUFFER, Engine::GL::DEPTH_ATTACHMENT, texture, 0, layer)
+      Engine::GL.BlitFramebuffer(0, 0, width, height, 0, 0, width, height, Engine::GL::DEPTH_BUFFER_BIT, Engine::GL::NEAREST)
     end
 
     private
@@ -0,0 +1,196 @@
+# frozen_string_literal: true
+
+module Rendering
+  # All text drawn with one font in one pass (:world or :ui), kept in a
+  # single growable InstanceBuffer: per glyph its atlas index, offset within
+  # the string and the string's model matrix (GLYPH_BYTES).
+  #
+  # prepare runs once per frame after transforms are resolved. Each font
+  # renderer rebuilds its glyph instances only when its string or model
+  # matrix changed (layouts come from Font#layout's cache), and the batch
+  # re-packs and uploads only when one of them did or the draw order moved.
+  #
+  # World text is drawn with one instanced call per font in the main pass.
+  # UI text has to stay in Rect z order with sprites and stencil masks, so
+  # UI batches are prepared in Rect order by UI::Batcher, and
+  # UI::FontRenderer#draw queues its glyph range there, merging with the
+  # range before it when nothing else was drawn in between.
+  class TextBatch
+    GLYPH_BYTES = Fiddle::SIZEOF_INT + 18 * Fiddle::SIZEOF_FLOAT
+
+    class << self
+      def for(font, pass)
+        batches[[font, pass]] ||= new(font, pass)
+      end
+
+      def batches
+        @batches ||= {}
+      end
+
+      # UI batches are prepared by UI::Batcher, in Rect order
+      def prepare_world
+        batches.each_value { |batch| batch.prepare(batch.members) if batch.pass == :world }
+      end
+
+      def draw_world
+        batches.each_value { |batch| batch.draw_all if batch.pass == :world }
+      end
+    end
+
+    attr_reader :font, :pass, :members
+
+    def initialize(font, pass)
+      @font = font
+      @pass = pass
+      @members = []
+      @renderers = []
+      @ranges = {}
+      @glyph_count = 0
+      @instance_buffer = InstanceBuffer.new
+      @mesh = Engine::PolygonMesh.new(
+        [Vector[-0.5, 0.5], Vector[0.5, 0.5], Vector[0.5, -0.5], Vector[-0.5, -0.5]],
+        [[0, 0], [1, 0], [1, 1], [0, 1]]
+      )
+
+      setup_vertex_attribute_buffer
+      setup_vertex_buffer
+      setup_index_buffer
+      enable_instance_attributes
+      Engine::GL.BindVertexArray(0)
+    end
+
+    def add(renderer)
+      @members << renderer
+    end
+
+    def remove(renderer)
+      @members.delete(renderer)
+    end
+
+    def prepare(renderers)
+      changed = false
+      renderers.each { |renderer| changed = true if renderer.refresh_text_instances }
+      rebuild(renderers) if changed || renderers != @renderers
+      @instance_buffer.upload
+    end
+
+    def draw_all
+      draw_range(0, @glyph_count)
+    end
+
+    def queue(renderer)
+      start = @ranges[renderer]
+      UI::Batcher.queue(self, start, renderer.glyph_count) if start
+    end
+
+    # Nothing is drawn until a streaming atlas arrives, rather than the
+    # white placeholder filling every glyph quad
+    def draw_range(first_glyph, count)
+      return if count.zero? || !Engine::AssetStreamer.ready?(@font.texture)
+
+      shader.use
+      Engine::GL.BindVertexArray(@vao)
+      point_instances_at(@instance_buffer.offset + first_glyph * GLYPH_BYTES)
+      Engine::GL.BindBuffer(Engine::GL::ELEMENT_ARRAY_BUFFER, @ebo)
+      shader.set_mat4("camera", camera_matrix)
+      Engine::Material.bind_texture(0, Engine::GL::TEXTURE_2D, @font.texture.texture)
+      shader.set_int("fontTexture", 0)
+
+      Engine::GL.DrawElementsInstanced(Engine::GL::TRIANGLES, @mesh.index_data.length, Engine::GL::UNSIGNED_INT, 0, count)
+    end
+
+    private
+
+    def rebuild(renderers)
+      @renderers = renderers.dup
+      @ranges = {}
+      data = @instance_buffer.data
+      data.clear
+      @glyph_count = 0
+      renderers.each do |renderer|
+        @ranges[renderer] = @glyph_count
+        data << renderer.text_instances
+        @glyph_count += renderer.glyph_count
+      end
+      @instance_buffer.mark_dirty(0, data.bytesize)
+    end
+
+    def shader
+      @pass == :ui ? Engine::Shader.ui_text : Engine::Shader.text
+    end
+
+    def camera_matrix
+      return Engine::Camera.instance.matrix if @pass == :world
+
+      # Y-down coordinate system: (0,0) at top-left, Y increases downward
+      Matrix[
+        [2.0 / Engine::Window.framebuffer_width, 0, 0, 0],
+        [0, -2.0 / Engine::Window.framebuffer_height, 0, 0],
+        [0, 0, 1, 0],
+        [-1, 1, 0, 1]
+      ]
+    end
+
+    # Instanced draws always start at instance 0, so a range starting
+    # further in is drawn by offsetting the attribute pointers (stored in the VAO)
+    def point_instances_at(byte_offset)
+      binding = [@instance_buffer.buffer, byte_offset]
+      return if @instance_binding == binding
+
+      Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, @instance_buffer.buffer)
+      Engine::GL.VertexAttribIPointer(2, 1, Engine::GL::INT, GLYPH_BYTES, byte_offset)
+      Engine::GL.VertexAttribPointer(3, 2, Engine::GL::FLOAT, Engine::GL::FALSE, GLYPH_BYTES, byte_offset + Fiddle::SIZEOF_INT)
+      vec4_size = 4 * Fiddle::SIZEOF_FLOAT
+      model_offset = byte_offset + Fiddle::SIZEOF_INT + 2 * Fiddle::SIZEOF_FLOAT
+      4.times do |column|
+        Engine::GL.VertexAttribPointer(4 + column, 4, Engine::GL::FLOAT, Engine::GL::FALSE, GLYPH_BYTES, model_offset + column * vec4_size)
+      end
+      @instance_binding = binding
+    end
+
+    def setup_vertex_attribute_buffer
+      vao_buf = ' ' * 4
+      Engine::GL.GenVertexArrays(1, vao_buf)
+      @vao = vao_buf.unpack1('L')
+      Engine::GL.BindVertexArray(@vao)
+    end
+
+    def setup_vertex_buffer
+      vbo_buf = ' ' * 4
+      Engine::GL.GenBuffers(1, vbo_buf)
+      vbo = vbo_buf.unpack1('L')
+      points = @mesh.vertex_data
+
+      Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, vbo)
+      Engine::GL.BufferData(
+        Engine::GL::ARRAY_BUFFER, points.length * Fiddle::SIZEOF_FLOAT,
+        points.pack('F*'), Engine::GL::STATIC_DRAW
+      )
+
+      Engine::GL.VertexAttribPointer(0, 3, Engine::GL::FLOAT, Engine::GL::FALSE, 5 * Fiddle::SIZEOF_FLOAT, 0)
+      Engine::GL.VertexAttribPointer(1, 2, Engine::GL::FLOAT, Engine::GL::FALSE, 5 * Fiddle::SIZEOF_FLOAT, 3 * Fiddle::SIZEOF_FLOAT)
+      Engine::GL.EnableVertexAttribArray(0)
+      Engine::GL.EnableVertexAttribArray(1)
+    end
+
+    def setup_index_buffer
+      indices = @mesh.index_data
+
+      ebo_buf = ' ' * 4
+      Engine::GL.GenBuffers(1, ebo_buf)
+      @ebo = ebo_buf.unpack1('L')
+      Engine::GL.BindBuffer(Engine::GL::ELEMENT_ARRAY_BUFFER, @ebo)
+      Engine::GL.BufferData(
+        Engine::GL::ELEMENT_ARRAY_BUFFER, indices.length * Fiddle::SIZEOF_INT,
+        indices.pack('I*'), Engine::GL::STATIC_DRAW
+      )
+    end
+
+    def enable_instance_attributes
+      (2..7).each do |index|
+        Engine::GL.EnableVertexAttribArray(index)
+        Engine::GL.VertexAttribDivisor(index, 1)
+      end
+    end
+  end
+end
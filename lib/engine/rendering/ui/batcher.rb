@@ -0,0 +1,67 @@
+# frozen_string_literal: true
+
+module Rendering
+  module UI
+    # Merges the UI pass into as few instanced draws as z order allows.
+    #
+    # prepare runs once per frame after transforms are resolved and walks
+    # Rect.rects in draw order, handing each UI TextBatch its renderers and
+    # SpriteBatch its sprites, so every batch's instances sit in the order
+    # they are drawn.
+    #
+    # While Rect.draw_all runs, batched renderers queue a [first, count]
+    # range of their batch. A range starting where the pending one ends in
+    # the same batch extends it; anything else draws the pending range
+    # first. Rect.draw_all flushes before renderers that draw directly and
+    # StencilManager before the mask set changes, so a run of sprites (or
+    # labels of one font) under the same masks is one draw call.
+    module Batcher
+      class << self
+        def prepare
+          text_order = Hash.new { |hash, batch| hash[batch] = [] }
+          sprites = []
+          Engine::Components::UI::Rect.rects.each do |rect|
+            rect.game_object.ui_renderers.each do |renderer|
+              next if renderer.destroyed?
+
+              case renderer
+              when Engine::Components::FontRendererBase
+                text_order[renderer.text_batch] << renderer if renderer.text_batch
+              when Engine::Components::UI::SpriteRenderer
+                sprites << renderer
+              end
+            end
+          end
+
+          TextBatch.batches.each_value do |batch|
+            batch.prepare(text_order[batch]) if batch.pass == :ui
+          end
+          SpriteBatch.instance.prepare(sprites)
+        end
+
+        def queue(batch, first, count)
+          return if count.zero?
+
+          if @batch.equal?(batch) && @first + @count == first
+            @count += count
+          else
+            flush
+            @batch = batch
+            @first = first
+            @count = count
+          end
+        end
+
+        # Draws the pending range; called before anything that must land on
+        # top of it or under different stencil state
+        def flush
+          return unless @batch
+
+          batch = @batch
+          @batch = nil
+          batch.draw_range(@first, @count)
+        end
+      end
+    end
+  end
+end
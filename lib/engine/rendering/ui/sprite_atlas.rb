@@ -0,0 +1,133 @@
+# frozen_string_literal: true
+
+module Rendering
+  module UI
+    # One RGBA texture holding the images of batched UI sprites, so sprites
+    # with different images can share a SpriteBatch draw.
+    #
+    # Images are packed on shelves the first time a sprite asks for them
+    # (sprites ask in start, so mostly while a scene loads), copied from
+    # the Image TextureCache already holds for the Texture. A white block
+    # stands in for the default white texture. Images larger than
+    # MAX_IMAGE_SIZE, compressed ones, runtime textures other than white and
+    # anything arriving once the atlas is full get nil, and their sprites
+    # draw on their own. Regions are never freed.
+    #
+    # The atlas has no mipmaps: UI images are drawn close to their size.
+    class SpriteAtlas
+      SIZE = 2048
+      MAX_IMAGE_SIZE = 512
+      # Transparent texels between images, so filtering never reaches a neighbour
+      PADDING = 2
+      WHITE_SIZE = 4
+
+      def self.instance
+        @instance ||= new
+      end
+
+      attr_reader :size
+
+      def initialize(size = SIZE)
+        @size = size
+        @regions = {}
+        @shelf_x = 0
+        @shelf_y = 0
+        @shelf_height = 0
+      end
+
+      # [u0, v0, u1, v1] of image in the atlas, or nil when it isn't in it.
+      # image is what the sprite material's "image" is set to: a Texture, a
+      # runtime texture id, or nil for the shader's white fallback.
+      def region_for(image)
+        case image
+        when Engine::Texture
+          return @regions[image] if @regions.key?(image)
+          # Until streaming uploads it the sprite draws the placeholder alone
+          return unless Engine::AssetStreamer.ready?(image)
+
+          @regions[image] = add_texture(image)
+        when nil, Engine::Material.default_white_texture
+          @white_region ||= add_white
+        end
+      end
+
+      # Reserves width x height texels, returning the [x, y] of its corner,
+      # or nil when the atlas is full
+      def allocate(width, height)
+        return if width + PADDING > @size || height + PADDING > @size
+
+        if @shelf_x + width + PADDING > @size
+          @shelf_y += @shelf_height
+          @shelf_x = 0
+          @shelf_height = 0
+        end
+        return if @shelf_y + height + PADDING > @size
+
+        position = [@shelf_x + PADDING, @shelf_y + PADDING]
+        @shelf_x += width + PADDING
+        @shelf_height = [@shelf_height, height + PADDING].max
+        position
+      end
+
+      def texture
+        @texture ||= create_texture
+      end
+
+      private
+
+      def add_texture(image_texture)
+        image = Engine::TextureCache.fetch(image_texture.file_path)
+        return if image.compressed? || image.width > MAX_IMAGE_SIZE || image.height > MAX_IMAGE_SIZE
+
+        level = image.levels.first
+        place(level.width, level.height, level.bytes)
+      end
+
+      def add_white
+        # Sampled only at its centre, so the quad is flat white
+        x, y = allocate(WHITE_SIZE, WHITE_SIZE)
+        return unless x
+
+        upload(x, y, WHITE_SIZE, WHITE_SIZE, "\xFF".b * (WHITE_SIZE * WHITE_SIZE * 4))
+        u = (x + WHITE_SIZE / 2.0) / @size
+        v = (y + WHITE_SIZE / 2.0) / @size
+        [u, v, u, v].freeze
+      end
+
+      def place(width, height, bytes)
+        x, y = allocate(width, height)
+        return unless x
+
+        upload(x, y, width, height, bytes)
+        # Half a texel in from each edge, so linear filtering stays inside the image
+        [
+          (x + 0.5) / @size, (y + 0.5) / @size,
+          (x + width - 0.5) / @size, (y + height - 0.5) / @size
+        ].freeze
+      end
+
+      def upload(x, y, width, height, bytes)
+        Engine::GL.BindTexture(Engine::GL::TEXTURE_2D, texture)
+        Engine::GL.TexSubImage2D(Engine::GL::TEXTURE_2D, 0, x, y, width, height, Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, bytes)
+      end
+
+      def create_texture
+        tex = ' ' * 4
+        Engine::GL.GenTextures(1, tex)
+        texture_id = tex.unpack1('L')
+        Engine::GL.BindTexture(Engine::GL::TEXTURE_2D, texture_id)
+        # Zeroed, so padding is transparent and discarded by the shader
+        Engine::GL.TexImage2D(
+          Engine::GL::TEXTURE_2D, 0, Engine::GL::RGBA8, @size, @size, 0,
+          Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, "\0".b * (@size * @size * 4)
+        )
+        Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_WRAP_S, Engine::GL::CLAMP_TO_EDGE)
+        Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_WRAP_T, Engine::GL::CLAMP_TO_EDGE)
+        Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_MIN_FILTER, Engine::GL::LINEAR)
+        Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_MAG_FILTER, Engine::GL::LINEAR)
+        Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_MAX_LEVEL, 0)
+        texture_id
+      end
+    end
+  end
+end
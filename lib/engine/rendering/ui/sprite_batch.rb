@@ -0,0 +1,149 @@
+# frozen_string_literal: true
+
+module Rendering
+  module UI
+    # Every batchable UI::SpriteRenderer, in one growable InstanceBuffer of
+    # SPRITE_BYTES per sprite: its rect in pixels, its SpriteAtlas region
+    # and its colour.
+    #
+    # Batcher.prepare hands over the frame's sprites in Rect order. Each
+    # re-packs its instance only when its rect, image region or colour
+    # changed, and the buffer is rebuilt and uploaded only when one did or
+    # the order moved. UI::SpriteRenderer#draw then queues its one-instance
+    # range with Batcher, so neighbouring sprites under the same masks are
+    # drawn together with one instanced quad.
+    class SpriteBatch
+      SPRITE_BYTES = 12 * Fiddle::SIZEOF_FLOAT
+
+      def self.instance
+        @instance ||= new
+      end
+
+      def initialize
+        @renderers = []
+        @ranges = {}
+        @instance_buffer = InstanceBuffer.new
+
+        setup_vertex_attribute_buffer
+        setup_vertex_buffer
+        setup_index_buffer
+        enable_instance_attributes
+        Engine::GL.BindVertexArray(0)
+      end
+
+      def prepare(renderers)
+        changed = false
+        batched = renderers.select do |renderer|
+          changed = true if renderer.refresh_sprite_instance
+          renderer.sprite_instance
+        end
+        rebuild(batched) if changed || batched != @renderers
+        @instance_buffer.upload
+      end
+
+      # False when the renderer has to draw itself
+      def queue(renderer)
+        index = @ranges[renderer]
+        return false unless index
+
+        Batcher.queue(self, index, 1)
+        true
+      end
+
+      def draw_range(first, count)
+        shader = Engine::Shader.ui_sprite_batch
+        shader.use
+        Engine::GL.BindVertexArray(@vao)
+        point_instances_at(@instance_buffer.offset + first * SPRITE_BYTES)
+        Engine::GL.BindBuffer(Engine::GL::ELEMENT_ARRAY_BUFFER, @ebo)
+        shader.set_mat4("camera", camera_matrix)
+        Engine::Material.bind_texture(0, Engine::GL::TEXTURE_2D, SpriteAtlas.instance.texture)
+        shader.set_int("atlas", 0)
+
+        Engine::GL.DrawElementsInstanced(Engine::GL::TRIANGLES, 6, Engine::GL::UNSIGNED_INT, 0, count)
+      end
+
+      private
+
+      def rebuild(renderers)
+        @renderers = renderers
+        @ranges = {}
+        data = @instance_buffer.data
+        data.clear
+        renderers.each_with_index do |renderer, index|
+          @ranges[renderer] = index
+          data << renderer.sprite_instance
+        end
+        @instance_buffer.mark_dirty(0, data.bytesize)
+      end
+
+      def camera_matrix
+        # Y-down coordinate system: (0,0) at top-left, Y increases downward
+        Matrix[
+          [2.0 / Engine::Window.framebuffer_width, 0, 0, 0],
+          [0, -2.0 / Engine::Window.framebuffer_height, 0, 0],
+          [0, 0, 1, 0],
+          [-1, 1, 0, 1]
+        ]
+      end
+
+      # Instanced draws always start at instance 0, so a range starting
+      # further in is drawn by offsetting the attribute pointers (stored in the VAO)
+      def point_instances_at(byte_offset)
+        binding = [@instance_buffer.buffer, byte_offset]
+        return if @instance_binding == binding
+
+        Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, @instance_buffer.buffer)
+        vec4_size = 4 * Fiddle::SIZEOF_FLOAT
+        3.times do |i|
+          Engine::GL.VertexAttribPointer(1 + i, 4, Engine::GL::FLOAT, Engine::GL::FALSE, SPRITE_BYTES, byte_offset + i * vec4_size)
+        end
+        @instance_binding = binding
+      end
+
+      def setup_vertex_attribute_buffer
+        vao_buf = ' ' * 4
+        Engine::GL.GenVertexArrays(1, vao_buf)
+        @vao = vao_buf.unpack1('L')
+        Engine::GL.BindVertexArray(@vao)
+      end
+
+      # Unit quad corners: v0=bottom-left, v1=bottom-right, v2=top-right, v3=top-left
+      def setup_vertex_buffer
+        vbo_buf = ' ' * 4
+        Engine::GL.GenBuffers(1, vbo_buf)
+        vbo = vbo_buf.unpack1('L')
+        corners = [0, 0, 1, 0, 1, 1, 0, 1]
+
+        Engine::GL.BindBuffer(Engine::GL::ARRAY_BUFFER, vbo)
+        Engine::GL.BufferData(
+          Engine::GL::ARRAY_BUFFER, corners.length * Fiddle::SIZEOF_FLOAT,
+          corners.pack('F*'), Engine::GL::STATIC_DRAW
+        )
+
+        Engine::GL.VertexAttribPointer(0, 2, Engine::GL::FLOAT, Engine::GL::FALSE, 2 * Fiddle::SIZEOF_FLOAT, 0)
+        Engine::GL.EnableVertexAttribArray(0)
+      end
+
+      def setup_index_buffer
+        indices = [0, 1, 2, 0, 2, 3]
+
+        ebo_buf = ' ' * 4
+        Engine::GL.GenBuffers(1, ebo_buf)
+        @ebo = ebo_buf.unpack1('L')
+        Engine::GL.BindBuffer(Engine::GL::ELEMENT_ARRAY_BUFFER, @ebo)
+        Engine::GL.BufferData(
+          Engine::GL::ELEMENT_ARRAY_BUFFER, indices.length * Fiddle::SIZEOF_INT,
+          indices.pack('I*'), Engine::GL::STATIC_DRAW
+        )
+      end
+
+      def enable_instance_attributes
+        (1..3).each do |index|
+          Engine::GL.EnableVertexAttribArray(index)
+          Engine::GL.VertexAttribDivisor(index, 1)
+        end
+      end
+    end
+  end
+end
@@ -4,8 +4,15 @@ module Rendering
   module UI
     module StencilManager
       class << self
+        # Rects under the same masks as the previous one keep its stencil
+        # state, so their queued draws can merge
         def setup_for_rect(rect)
           chain = rect.ancestor_masks
+          return if chain == @active_chain
+
+          # Draws queued so far were meant for the previous stencil state
+          Batcher.flush
+          @active_chain = chain
 
           if chain.empty?
             Engine::GL.Disable(Engine::GL::STENCIL_TEST)
@@ -27,6 +34,7 @@ module Rendering
         def reset
           Engine::GL.Disable(Engine::GL::STENCIL_TEST)
           @current_chain = nil
+          @active_chain = nil
         end
 
         private
@@ -59,6 +67,7 @@ module Rendering
 
           # Draw the mask shape
           mask_rect.game_object.ui_renderers.each(&:draw)
+          Batcher.flush
 
           # Re-enable color writes
           Engine::GL.ColorMask(Engine::GL::TRUE, Engine::GL::TRUE, Engine::GL::TRUE, Engine::GL::TRUE)
@@ -1,34 +1,175 @@
+# frozen_string_literal: true
+
+require "asset_native"
+require "chunky_png"
+require "fileutils"
+
 module Engine
+  # Framebuffer captures that don't stall the frame.
+  #
+  # screenshot schedules a capture of the next drawn frame. The pixels come
+  # back through Rendering::FrameReadback a frame or two later, a worker
+  # thread turns them into a ChunkyPNG::Image, and the block runs on the
+  # main thread from update. finish, at the end of the game loop, waits for
+  # anything still in flight.
+  #
+  # record writes a frame to directory every interval seconds of game time,
+  # either as PNG (frame_000001.png) or as raw top-down RGBA
+  # (frame_000001_<width>x<height>.rgba). Encoding and writing happen on the
+  # worker; when it falls behind, frames are dropped and counted in
+  # dropped_frames rather than held up.
   class Screenshoter
-    def self.screenshot(&block)
-      @after_screenshot = block
-    end
+    FORMATS = %i[png raw].freeze
+    PNG_LEVEL = 1
+    MAX_QUEUED_FRAMES = 8
 
-    def self.scheduled_screenshot
-      @after_screenshot != nil
-    end
+    # Shared with the worker, so created up front rather than on first use
+    @scheduled = []
+    @work = Thread::SizedQueue.new(MAX_QUEUED_FRAMES)
+    @completed = Thread::Queue.new
+
+    class << self
+      def screenshot(&block)
+        @scheduled << block
+      end
+
+      def scheduled_screenshot
+        @scheduled.any?
+      end
+
+      def record(directory, interval: 1.0 / 30, format: :png)
+        raise ArgumentError, "format must be one of #{FORMATS.join(', ')}" unless FORMATS.include?(format)
+
+        FileUtils.mkdir_p(directory)
+        # elapsed starts full so the first frame after this is captured
+        @recording = { directory:, interval:, format:, elapsed: interval, frame: 0 }
+        @dropped_frames = 0
+      end
+
+      def stop_recording
+        @recording = nil
+      end
 
-    def self.take_screenshot
-      @scheduled_screenshot = nil
-      width = Engine::Window.framebuffer_width
-      height = Engine::Window.framebuffer_height
-      pixels = ' ' * (width * height * 3)
-      Engine::GL.ReadPixels(0, 0, width, height, Engine::GL::RGB, Engine::GL::UNSIGNED_BYTE, pixels)
-      png = ChunkyPNG::Image.new(width, height, ChunkyPNG::Color::TRANSPARENT)
-      pixels = pixels.bytes.map { |b| b.to_i }
-      x = 0
-      y = 0
-      pixels.each_slice(3) do |r, g, b|
-        png[x, height - y - 1] = ChunkyPNG::Color.rgb(r, g, b)
-        x += 1
-        if x >= width
-          x = 0
-          y += 1
+      def recording?
+        !@recording.nil?
+      end
+
+      def dropped_frames
+        @dropped_frames || 0
+      end
+
+      # Called once per frame, after drawing
+      def update(delta_time)
+        @readback&.poll { |*read| dispatch(*read) }
+        take_screenshot if scheduled_screenshot
+        capture_frame(delta_time) if recording?
+        deliver
+      end
+
+      def take_screenshot
+        blocks = @scheduled
+        @scheduled = []
+        request([:screenshot, blocks])
+      end
+
+      # Waits for every capture in flight and runs the screenshot blocks
+      def finish
+        return unless @readback
+
+        @readback.finish { |*read| dispatch(*read) }
+        if @worker
+          done = Thread::Queue.new
+          @work << [:flush, nil, nil, nil, done]
+          done.pop
         end
+        deliver
+      end
+
+      # Forgets scheduled screenshots, the recording and reads in flight
+      def reset
+        @scheduled = []
+        @recording = nil
+        @readback&.dispose
+        @readback = nil
+        @completed.clear
+      end
+
+      private
+
+      def readback
+        @readback ||= Rendering::FrameReadback.new
+      end
+
+      def request(payload)
+        start_worker
+        readback.request(Window.framebuffer_width, Window.framebuffer_height, payload) { |*read| dispatch(*read) }
+      end
+
+      def capture_frame(delta_time)
+        @recording[:elapsed] += delta_time
+        return if @recording[:elapsed] < @recording[:interval]
+
+        @recording[:elapsed] = [@recording[:elapsed] - @recording[:interval], @recording[:interval]].min
+        @recording[:frame] += 1
+        return @dropped_frames += 1 if readback.full?
+
+        request([@recording[:format], File.join(@recording[:directory], format("frame_%06d", @recording[:frame]))])
+      end
+
+      # Screenshots always reach the worker; recorded frames are dropped
+      # when its queue is full
+      def dispatch(pixels, width, height, payload)
+        kind, target = payload
+        job = [kind, pixels, width, height, target]
+        return @work << job if kind == :screenshot
+
+        @work.push(job, true)
+      rescue ThreadError
+        @dropped_frames += 1
+      end
+
+      def deliver
+        until @completed.empty?
+          blocks, result = @completed.pop
+          raise result if result.is_a?(Exception)
+
+          blocks.each { |block| block.call(result) }
+        end
+      end
+
+      def start_worker
+        @worker ||= Thread.new do
+          Thread.current.name = "screenshoter"
+          while (job = @work.pop)
+            process(job)
+          end
+        end
+      end
+
+      # Errors are handed to the main thread and raised from deliver
+      def process(job)
+        kind, pixels, width, height, target = job
+        case kind
+        when :screenshot
+          rgba = AssetNative.flip_rgba(pixels, width, height, true)
+          @completed << [target, ChunkyPNG::Image.from_rgba_stream(width, height, rgba)]
+        when :png
+          File.binwrite("#{target}.png", encode_png(pixels, width, height))
+        when :raw
+          File.binwrite("#{target}_#{width}x#{height}.rgba", AssetNative.flip_rgba(pixels, width, height, true))
+        when :flush
+          target << true
+        end
+      rescue StandardError => e
+        @completed << [nil, e]
+      end
+
+      def encode_png(pixels, width, height)
+        return AssetNative.encode_png(pixels, width, height, false, PNG_LEVEL) if AssetNative.respond_to?(:encode_png)
+
+        rgba = AssetNative.flip_rgba(pixels, width, height, true)
+        ChunkyPNG::Image.from_rgba_stream(width, height, rgba).to_blob(:fast_rgb)
       end
-      block = @after_screenshot
-      @after_screenshot = nil
-      block.call(png)
     end
   end
 end
@@ -39,6 +39,34 @@ module Engine
           end
           GraphSerializer.deserialize(data_array)
         end
+
+        # Starts loading the assets the files refer to (meshes, textures,
+        # fonts, shaders) without building any objects, so a later load_all
+        # of the same files finds them streamed or on their way. Returns the
+        # assets, for AssetStreamer.ready? checks on a loading screen.
+        def prefetch(paths)
+          assets = {}.compare_by_identity
+          paths.each do |path|
+            collect_assets(YAML.load_file(path, permitted_classes: [Symbol]), assets)
+          end
+          assets.keys
+        end
+
+        private
+
+        def collect_assets(data, assets)
+          case data
+          when Array
+            data.each { |value| collect_assets(value, assets) }
+          when Hash
+            klass = Serializable.get_class(data[:_class]) if data[:_class].is_a?(String)
+            if klass&.method_defined?(:load_asset)
+              assets[klass.from_serializable_data(data)] = true
+            else
+              data.each_value { |value| collect_assets(value, assets) }
+            end
+          end
+        end
       end
     end
   end
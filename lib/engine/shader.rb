@@ -6,9 +6,9 @@ module Engine
 
     @cache = {}
 
-    def self.for(vertex_path, fragment_path, source: :game)
-      key = [vertex_path, fragment_path, source]
-      @cache[key] ||= create(vertex_path: vertex_path, fragment_path: fragment_path, source: source)
+    def self.for(vertex_path, fragment_path, source: :game, geometry_path: nil)
+      key = [vertex_path, fragment_path, source, geometry_path]
+      @cache[key] ||= create(vertex_path: vertex_path, fragment_path: fragment_path, source: source, geometry_path: geometry_path)
     end
 
     def self.from_file(vertex_path, fragment_path, source: :game)
@@ -16,11 +16,23 @@ module Engine
     end
 
     def self.from_serializable_data(data)
-      self.for(data[:vertex_path], data[:fragment_path], source: (data[:source] || :game).to_sym)
+      self.for(data[:vertex_path], data[:fragment_path], source: (data[:source] || :game).to_sym, geometry_path: data[:geometry_path])
     end
 
     def serializable_data
-      { vertex_path: @vertex_path, fragment_path: @fragment_path, source: @source }
+      data = { vertex_path: @vertex_path, fragment_path: @fragment_path, source: @source }
+      data[:geometry_path] = @geometry_path if @geometry_path
+      data
+    end
+
+    # Uniforms sent to and skipped by every program, reset by whoever reports them
+    def self.uniform_stats
+      @uniform_stats ||= { sent: 0, skipped: 0 }
+    end
+
+    def self.reset_uniform_stats
+      uniform_stats[:sent] = 0
+      uniform_stats[:skipped] = 0
     end
 
     def self.default
@@ -55,6 +67,10 @@ module Engine
       @ui_sprite ||= Engine::Shader.for('ui_sprite_vertex.glsl', 'ui_sprite_frag.glsl', source: :engine)
     end
 
+    def self.ui_sprite_batch
+      @ui_sprite_batch ||= Engine::Shader.for('ui_sprite_batch_vertex.glsl', 'ui_sprite_batch_frag.glsl', source: :engine)
+    end
+
     def self.fullscreen
       @fullscreen ||= Engine::Shader.for('fullscreen_vertex.glsl', 'fullscreen_frag.glsl', source: :engine)
     end
@@ -67,17 +83,42 @@ module Engine
       @shadow ||= Engine::Shader.for('shadow_vertex.glsl', 'shadow_frag.glsl', source: :engine)
     end
 
+    # Renders all six cube faces in one pass; the geometry shader picks each face's layer
     def self.point_shadow
-      @point_shadow ||= Engine::Shader.for('point_shadow_vertex.glsl', 'point_shadow_frag.glsl', source: :engine)
+      @point_shadow ||= Engine::Shader.for(
+        'point_shadow_vertex.glsl', 'point_shadow_frag.glsl',
+        source: :engine, geometry_path: 'point_shadow_geometry.glsl'
+      )
     end
 
+    # While streaming, the sources are read off the main thread and the
+    # program compiles within the upload budget. A program can't be swapped
+    # under a material's uniform plan, so the first use of a shader that
+    # hasn't arrived finishes it on the spot instead of standing in.
     def awake
       @texture_fallbacks = {}
       @cubemap_fallbacks = {}
-      @vertex_shader = compile_shader(@vertex_path, Engine::GL::VERTEX_SHADER)
-      @fragment_shader = compile_shader(@fragment_path, Engine::GL::FRAGMENT_SHADER)
+      AssetStreamer.stream(self)
+    end
+
+    # Preprocessed sources by shader type
+    def load_asset
+      sources = {
+        Engine::GL::VERTEX_SHADER => preprocess_shader(resolve_shader_path(@vertex_path)),
+        Engine::GL::FRAGMENT_SHADER => preprocess_shader(resolve_shader_path(@fragment_path))
+      }
+      sources[Engine::GL::GEOMETRY_SHADER] = preprocess_shader(resolve_shader_path(@geometry_path)) if @geometry_path
+      sources
+    end
+
+    # Returns the bytes of source compiled
+    def upload_asset(sources)
+      @vertex_shader = compile_shader(sources[Engine::GL::VERTEX_SHADER], Engine::GL::VERTEX_SHADER)
+      @fragment_shader = compile_shader(sources[Engine::GL::FRAGMENT_SHADER], Engine::GL::FRAGMENT_SHADER)
+      @geometry_shader = compile_shader(sources[Engine::GL::GEOMETRY_SHADER], Engine::GL::GEOMETRY_SHADER) if @geometry_path
       @program = Engine::GL.CreateProgram
       Engine::GL.AttachShader(@program, @vertex_shader)
+      Engine::GL.AttachShader(@program, @geometry_shader) if @geometry_shader
       Engine::GL.AttachShader(@program, @fragment_shader)
       Engine::GL.LinkProgram(@program)
 
@@ -95,15 +136,22 @@ module Engine
         puts compile_log.strip
         puts vertex_log.strip
         puts fragment_log.strip
+        if @geometry_shader
+          geometry_log = ' ' * 1024
+          Engine::GL.GetShaderInfoLog(@geometry_shader, 1023, nil, geometry_log)
+          puts geometry_log.strip
+        end
       end
+      Rendering::FrameUniformBuffer.bind_program(@program)
       @uniform_cache = {}
       @uniform_locations = {}
+      @packed_uniforms = {}
+      @applied_plan = nil
+      sources.values.sum(&:bytesize)
     end
 
-    def compile_shader(shader, type)
+    def compile_shader(source, type)
       handle = Engine::GL.CreateShader(type)
-      path = resolve_shader_path(shader)
-      source = preprocess_shader(path)
       parse_texture_fallbacks(source)
       s_srcs = [source].pack('p')
       s_lens = [source.bytesize].pack('I')
@@ -121,14 +169,17 @@ module Engine
     end
 
     def texture_fallback(name)
+      AssetStreamer.finish(self) unless @program
       @texture_fallbacks[name] || :white
     end
 
     def expected_textures
+      AssetStreamer.finish(self) unless @program
       @texture_fallbacks.keys
     end
 
     def cubemap_fallback(name)
+      AssetStreamer.finish(self) unless @program
       @cubemap_fallbacks[name]
     end
 
@@ -146,13 +197,14 @@ module Engine
     end
 
     def use
+      AssetStreamer.finish(self) unless @program
       Engine::GL.UseProgram(@program)
     end
 
     def set_vec2(name, vec)
-      return if @uniform_cache[name] == vec
+      return skip_uniforms(1) if @uniform_cache[name] == vec
       @uniform_cache[name] = vec
-      Engine::GL.Uniform2f(uniform_location(name), vec[0], vec[1])
+      Engine::GL.Uniform2f(direct_uniform_location(name), vec[0], vec[1])
     end
 
     def set_vec3(name, vec)
@@ -162,19 +214,19 @@ module Engine
                  Vector[vec[:r], vec[:g], vec[:b]]
                end
       cache_key = [vector[0], vector[1], vector[2]]
-      return if @uniform_cache[name] == cache_key
+      return skip_uniforms(1) if @uniform_cache[name] == cache_key
       @uniform_cache[name] = cache_key
-      Engine::GL.Uniform3f(uniform_location(name), vector[0], vector[1], vector[2])
+      Engine::GL.Uniform3f(direct_uniform_location(name), vector[0], vector[1], vector[2])
     end
 
     def set_vec4(name, vec)
-      return if @uniform_cache[name] == vec
+      return skip_uniforms(1) if @uniform_cache[name] == vec
       @uniform_cache[name] = vec
-      Engine::GL.Uniform4f(uniform_location(name), vec[0], vec[1], vec[2], vec[3])
+      Engine::GL.Uniform4f(direct_uniform_location(name), vec[0], vec[1], vec[2], vec[3])
     end
 
     def set_mat4(name, mat)
-      return if @uniform_cache[name] == mat
+      return skip_uniforms(1) if @uniform_cache[name] == mat
       @uniform_cache[name] = mat
       mat_array = [
         mat[0, 0], mat[0, 1], mat[0, 2], mat[0, 3],
@@ -182,19 +234,58 @@ module Engine
         mat[2, 0], mat[2, 1], mat[2, 2], mat[2, 3],
         mat[3, 0], mat[3, 1], mat[3, 2], mat[3, 3]
       ]
-      Engine::GL.UniformMatrix4fv(uniform_location(name), 1, Engine::GL::FALSE, mat_array.pack('F*'))
+      Engine::GL.UniformMatrix4fv(direct_uniform_location(name), 1, Engine::GL::FALSE, mat_array.pack('F*'))
     end
 
     def set_int(name, int)
-      return if @uniform_cache[name] == int
+      return skip_uniforms(1) if @uniform_cache[name] == int
       @uniform_cache[name] = int
-      Engine::GL.Uniform1i(uniform_location(name), int)
+      Engine::GL.Uniform1i(direct_uniform_location(name), int)
     end
 
     def set_float(name, float)
-      return if @uniform_cache[name] == float
+      return skip_uniforms(1) if @uniform_cache[name] == float
       @uniform_cache[name] = float
-      Engine::GL.Uniform1f(uniform_location(name), float)
+      Engine::GL.Uniform1f(direct_uniform_location(name), float)
+    end
+
+    # Sends a uniform packed by a UniformPlan unless the program already holds
+    # exactly these bytes at that location
+    def apply_packed_uniform(name, kind, location, packed)
+      return skip_uniforms(1) if @packed_uniforms[location] == packed
+
+      @packed_uniforms[location] = packed
+      @uniform_cache.delete(name)
+      Shader.uniform_stats[:sent] += 1
+
+      case kind
+      when :mat4 then Engine::GL.UniformMatrix4fv(location, 1, Engine::GL::FALSE, packed)
+      when :vec2 then Engine::GL.Uniform2fv(location, 1, packed)
+      when :vec3 then Engine::GL.Uniform3fv(location, 1, packed)
+      when :vec4 then Engine::GL.Uniform4fv(location, 1, packed)
+      when :float then Engine::GL.Uniform1fv(location, 1, packed)
+      when :int then Engine::GL.Uniform1iv(location, 1, packed)
+      end
+    end
+
+    # True when this plan was the last thing to set uniforms on the program and
+    # its material has not changed since
+    def applied?(plan, revision)
+      @applied_plan.equal?(plan) && @applied_revision == revision
+    end
+
+    def mark_applied(plan, revision)
+      @applied_plan = plan
+      @applied_revision = revision
+    end
+
+    def skip_uniforms(count)
+      Shader.uniform_stats[:skipped] += count
+      nil
+    end
+
+    def uniform_location(name)
+      @uniform_locations[name] ||= Engine::GL.GetUniformLocation(@program, name)
     end
 
     private
@@ -208,8 +299,13 @@ module Engine
       end
     end
 
-    def uniform_location(name)
-      @uniform_locations[name] ||= Engine::GL.GetUniformLocation(@program, name)
+    # A direct set_* call makes any packed value (and applied plan) stale
+    def direct_uniform_location(name)
+      location = uniform_location(name)
+      @packed_uniforms.delete(location)
+      @applied_plan = nil
+      Shader.uniform_stats[:sent] += 1
+      location
     end
   end
 end
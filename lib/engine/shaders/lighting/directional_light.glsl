@@ -1,15 +1,8 @@
-// Directional light structure and calculation functions
+// Directional light calculation functions (structs live in frame_uniforms.glsl)
 
 #include "lighting_common.glsl"
+#include "frame_uniforms.glsl"
 
-struct DirectionalLight {
-    vec3 direction;
-    vec3 colour;
-    mat4 lightSpaceMatrix;
-    bool castsShadows;
-};
-#define NR_DIRECTIONAL_LIGHTS 4
-uniform DirectionalLight directionalLights[NR_DIRECTIONAL_LIGHTS];
 uniform sampler2DArray directionalShadowMaps;
 
 float CalcDirectionalShadow(DirectionalLight light, int lightIndex, vec3 fragPos)
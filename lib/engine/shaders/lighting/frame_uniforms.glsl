@@ -0,0 +1,46 @@
+// Per-frame camera and light data shared by every lit shader.
+// Filled once per frame by Rendering::FrameUniformBuffer, which packs this
+// exact std140 layout - keep the two in step.
+
+struct PointLight {
+    vec3 position;
+    float sqrRange;
+    vec3 colour;
+    bool castsShadows;
+    int shadowLayerIndex;
+    float shadowFar;
+};
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 colour;
+    mat4 lightSpaceMatrix;
+    bool castsShadows;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float sqrRange;
+    vec3 colour;
+    float innerCutoff;
+    float outerCutoff;
+    mat4 lightSpaceMatrix;
+    bool castsShadows;
+    float shadowNear;
+    float shadowFar;
+};
+
+#define NR_POINT_LIGHTS 16
+#define NR_SHADOW_CASTING_POINT_LIGHTS 4
+#define NR_DIRECTIONAL_LIGHTS 4
+#define NR_SPOT_LIGHTS 8
+#define NR_SHADOW_CASTING_SPOT_LIGHTS 4
+
+layout(std140) uniform FrameUniforms {
+    mat4 camera;
+    vec3 cameraPos;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    DirectionalLight directionalLights[NR_DIRECTIONAL_LIGHTS];
+    SpotLight spotLights[NR_SPOT_LIGHTS];
+};
@@ -1,18 +1,8 @@
-// Point light structure and calculation functions
+// Point light calculation functions (structs live in frame_uniforms.glsl)
 
 #include "lighting_common.glsl"
+#include "frame_uniforms.glsl"
 
-struct PointLight {
-    vec3 position;
-    float sqrRange;
-    vec3 colour;
-    bool castsShadows;
-    int shadowLayerIndex;
-    float shadowFar;
-};
-#define NR_POINT_LIGHTS 16
-#define NR_SHADOW_CASTING_POINT_LIGHTS 4
-uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform samplerCubeArray pointShadowMaps;
 
 float CalcPointShadow(PointLight light, int lightIndex, vec3 fragPos)
@@ -1,22 +1,8 @@
-// Spot light structure and calculation functions
+// Spot light calculation functions (structs live in frame_uniforms.glsl)
 
 #include "lighting_common.glsl"
+#include "frame_uniforms.glsl"
 
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float sqrRange;
-    vec3 colour;
-    float innerCutoff;
-    float outerCutoff;
-    mat4 lightSpaceMatrix;
-    bool castsShadows;
-    float shadowNear;
-    float shadowFar;
-};
-#define NR_SPOT_LIGHTS 8
-#define NR_SHADOW_CASTING_SPOT_LIGHTS 4
-uniform SpotLight spotLights[NR_SPOT_LIGHTS];
 uniform sampler2DArray spotShadowMaps;
 
 // Convert non-linear depth buffer value to linear depth
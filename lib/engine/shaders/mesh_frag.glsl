@@ -10,7 +10,6 @@ in vec3 FragPos;
 
 uniform sampler2D image; // @fallback white
 uniform sampler2D normalMap; // @fallback normal
-uniform vec3 cameraPos;
 
 // Material properties with sensible defaults
 uniform vec3 baseColour = vec3(1.0, 1.0, 1.0);
@@ -6,7 +6,7 @@ layout (location = 2) in vec3 normal;
 layout (location = 3) in vec3 tangent;
 layout (location = 7) in mat4 model;
 
-uniform mat4 camera;
+#include "lighting/frame_uniforms.glsl"
 
 out vec2 TexCoord;
 out vec3 Normal;
@@ -0,0 +1,36 @@
+#version 410 core
+
+// One invocation per cube face: every triangle is projected by that face's
+// matrix and routed to its layer of the cubemap array.
+layout (triangles, invocations = 6) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec3 WorldPos[];
+
+uniform mat4 faceMatrices[6];
+uniform int cubemapLayer;
+
+out vec3 FragPos;
+
+void main()
+{
+    mat4 faceMatrix = faceMatrices[gl_InvocationID];
+    vec4 clip[3];
+    for (int i = 0; i < 3; i++) {
+        clip[i] = faceMatrix * vec4(WorldPos[i], 1.0);
+    }
+
+    // Skip triangles entirely outside one side of this face's frustum
+    for (int axis = 0; axis < 3; axis++) {
+        if (all(greaterThan(vec3(clip[0][axis], clip[1][axis], clip[2][axis]), vec3(clip[0].w, clip[1].w, clip[2].w)))) return;
+        if (all(lessThan(vec3(clip[0][axis], clip[1][axis], clip[2][axis]), -vec3(clip[0].w, clip[1].w, clip[2].w)))) return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        gl_Layer = cubemapLayer * 6 + gl_InvocationID;
+        FragPos = WorldPos[i];
+        gl_Position = clip[i];
+        EmitVertex();
+    }
+    EndPrimitive();
+}
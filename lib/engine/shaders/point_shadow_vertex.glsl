@@ -3,13 +3,12 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 7) in mat4 model;
 
-uniform mat4 lightSpaceMatrix;
-
-out vec3 FragPos;
+out vec3 WorldPos;
 
+// Projected per cube face in point_shadow_geometry.glsl
 void main()
 {
     vec4 worldPos = model * vec4(vertex, 1.0);
-    FragPos = worldPos.xyz;
-    gl_Position = lightSpaceMatrix * worldPos;
+    WorldPos = worldPos.xyz;
+    gl_Position = worldPos;
 }
@@ -5,9 +5,10 @@ layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec2 texCoords;
 layout (location = 2) in int textIndex;
 layout (location = 3) in vec2 offset;
+// Per glyph, so every string using a font can share one instanced draw
+layout (location = 4) in mat4 model;
 
 uniform mat4 camera;
-uniform mat4 model;
 
 out vec2 TexCoords;
 
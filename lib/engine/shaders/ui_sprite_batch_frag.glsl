@@ -0,0 +1,15 @@
+#version 330 core
+in vec2 TexCoords;
+in vec4 SpriteColor;
+out vec4 color;
+
+uniform sampler2D atlas;
+
+void main()
+{
+    vec4 texColor = texture(atlas, TexCoords);
+    if(texColor.a < 0.05)
+        discard;
+    else
+        color = SpriteColor * texColor;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+// Unit quad corner: (0, 0) bottom-left to (1, 1) top-right
+layout (location = 0) in vec2 corner;
+// Per sprite <left, top, right, bottom> in pixels, atlas <u0, v0, u1, v1>, colour
+layout (location = 1) in vec4 rect;
+layout (location = 2) in vec4 uvRect;
+layout (location = 3) in vec4 color;
+
+out vec2 TexCoords;
+out vec4 SpriteColor;
+
+uniform mat4 camera;
+
+void main()
+{
+    vec2 position = vec2(mix(rect.x, rect.z, corner.x), mix(rect.w, rect.y, corner.y));
+    TexCoords = mix(uvRect.xy, uvRect.zw, corner);
+    SpriteColor = color;
+    gl_Position = camera * vec4(position, 0.0, 1.0);
+}
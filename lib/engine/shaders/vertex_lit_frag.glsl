@@ -10,7 +10,6 @@ in vec3 Albedo;
 layout(location = 0) out vec4 FragColour;
 layout(location = 1) out vec4 normalRoughness;
 
-uniform vec3 cameraPos;
 uniform float roughness;
 uniform float diffuseStrength;
 uniform float specularStrength;
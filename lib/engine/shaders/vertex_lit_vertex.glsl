@@ -14,7 +14,7 @@ out vec3 Diffuse;
 out vec3 Specular;
 out vec3 Albedo;
 
-uniform mat4 camera;
+#include "lighting/frame_uniforms.glsl"
 
 void main()
 {
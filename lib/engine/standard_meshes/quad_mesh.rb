@@ -22,5 +22,58 @@ module Engine
         2, 0, 3
       ]
     end
+
+    def vertex_bytes
+      @vertex_bytes ||= vertex_data.pack('F*')
+    end
+
+    def index_bytes
+      @index_bytes ||= index_data.pack('I*')
+    end
+
+    def index_type
+      MeshFile::UNSIGNED_INT
+    end
+
+    def index_count
+      index_data.length
+    end
+
+    def depth_vertex_bytes
+      depth_stream[0]
+    end
+
+    def depth_index_bytes
+      depth_stream[1]
+    end
+
+    def depth_index_type
+      MeshFile::UNSIGNED_INT
+    end
+
+    def depth_index_count
+      depth_stream[1].bytesize / 4
+    end
+
+    def lods
+      @lods ||= [MeshFile::Lod.new(0, index_count, 0, depth_index_count, 0.0)]
+    end
+
+    def aabb
+      @aabb ||= [Vector[-0.5, -0.5, 0], Vector[0.5, 0.5, 0]]
+    end
+
+    def bounding_sphere
+      @bounding_sphere ||= [Vector[0, 0, 0], Math.sqrt(0.5)]
+    end
+
+    private
+
+    def depth_stream
+      @depth_stream ||= begin
+        positions, (indices,) = AssetNative.depth_stream(vertex_bytes, [index_bytes], 20)
+        [positions, indices]
+      end
+    end
   end
 end
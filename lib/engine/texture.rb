@@ -4,7 +4,7 @@ module Engine
   class Texture
     include Serializable
 
-    attr_reader :texture, :source
+    attr_reader :texture, :source, :file_path
 
     def self.from_serializable_data(data)
       self.for(data[:path], source: (data[:source] || :game).to_sym)
@@ -14,9 +14,10 @@ module Engine
       { path: @relative_path, source: @source }
     end
 
+    # While streaming, binds a white texel until the PNG is uploaded
     def awake
-      @texture = ' ' * 4
-      load_texture
+      @texture = Material.default_white_texture if AssetStreamer.enabled
+      AssetStreamer.stream(self)
     end
 
     def self.for(path, source: :game)
@@ -32,7 +33,13 @@ module Engine
       @texture_cache ||= {}
     end
 
-    def load_texture
+    # Decoding and mipmaps, off the main thread when streaming
+    def load_asset
+      TextureCache.fetch(@file_path)
+    end
+
+    # Returns the bytes uploaded
+    def upload_asset(image)
       tex = ' ' * 4
       Engine::GL.GenTextures(1, tex)
       @texture = tex.unpack('L')[0]
@@ -42,20 +49,16 @@ module Engine
       Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_MIN_FILTER, Engine::GL::LINEAR)
       Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_MAG_FILTER, Engine::GL::LINEAR)
 
-      image = ChunkyPNG::Image.from_file(@file_path)
-      image_data = image.to_rgba_stream
-      image_width = image.width
-      image_height = image.height
-
-      # Flip rows vertically so textures follow OpenGL convention (V=0 at bottom)
-      row_size = image_width * 4
-      flipped = String.new(capacity: image_data.bytesize)
-      (image_height - 1).downto(0) do |row|
-        flipped << image_data.byteslice(row * row_size, row_size)
+      # Levels come decoded, flipped (V=0 at the bottom) and mipmapped
+      image.levels.each_with_index do |level, index|
+        if image.compressed?
+          Engine::GL.CompressedTexImage2D(Engine::GL::TEXTURE_2D, index, image.format, level.width, level.height, 0, level.bytes)
+        else
+          Engine::GL.TexImage2D(Engine::GL::TEXTURE_2D, index, image.format, level.width, level.height, 0, Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, level.bytes)
+        end
       end
-
-      Engine::GL.TexImage2D(Engine::GL::TEXTURE_2D, 0, Engine::GL::RGBA32F, image_width, image_height, 0, Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, flipped)
-      Engine::GL.GenerateMipmap(Engine::GL::TEXTURE_2D)
+      Engine::GL.TexParameteri(Engine::GL::TEXTURE_2D, Engine::GL::TEXTURE_MAX_LEVEL, image.levels.length - 1)
+      image.levels.sum { |level| level.bytes.bytesize }
     end
   end
 end
@@ -0,0 +1,176 @@
+# frozen_string_literal: true
+
+require "asset_native"
+require "chunky_png"
+require "digest"
+require "fileutils"
+
+module Engine
+  # Upload-ready texture levels for Texture, cached on disk between runs.
+  #
+  # The first load of a PNG decodes it (AssetNative.decode_png, or ChunkyPNG
+  # for files the native decoder can't read), builds the mip chain and,
+  # when compress is on, encodes every level as BC1 or BC3. The result is
+  # written to directory under the SHA-256 of the PNG, so an edited file
+  # just misses. Later loads map the entry and hand its levels straight to
+  # TexImage2D.
+  #
+  # Entry layout, all little-endian:
+  #   header (32 bytes)
+  #     magic "RTEX", version (uint32)
+  #     format (uint32, the GL internal format: RGBA8, BC1 or BC3)
+  #     width, height, level_count (uint32)
+  #   levels, largest first, rows bottom-up
+  #     RGBA8: width * height * 4 bytes
+  #     BC1/BC3: an 8/16 byte block per 4x4 texels, edges rounded up
+  #
+  # Compression is off by default: the blocks are lossy, and font atlases
+  # in particular show it. Opaque images use BC1, the rest BC3.
+  module TextureCache
+    MAGIC = "RTEX"
+    VERSION = 1
+    HEADER_FORMAT = 'a4V5'
+    HEADER_SIZE = 32
+
+    # GL enums, so the value can be passed straight to TexImage2D
+    RGBA8 = 0x8058
+    BC1 = 0x83F0
+    BC3 = 0x83F3
+    BLOCK_SIZES = { BC1 => 8, BC3 => 16 }.freeze
+
+    class FormatError < StandardError; end
+
+    Level = Struct.new(:width, :height, :bytes)
+
+    # mapped_file backs the level bytes of images read from the cache
+    Image = Struct.new(:format, :levels, :mapped_file) do
+      def width
+        levels.first.width
+      end
+
+      def height
+        levels.first.height
+      end
+
+      def compressed?
+        BLOCK_SIZES.key?(format)
+      end
+    end
+
+    class << self
+      attr_writer :directory, :compress
+
+      def directory
+        @directory ||= ENV.fetch("RUBY_RPG_TEXTURE_CACHE") do
+          File.join(ENV.fetch("XDG_CACHE_HOME") { File.join(Dir.home, ".cache") }, "ruby_rpg", "textures")
+        end
+      end
+
+      def compress
+        @compress || false
+      end
+
+      # The Image for the PNG at png_path, built and cached on a miss
+      def fetch(png_path)
+        png = File.binread(png_path)
+        cache_path = File.join(directory, "#{Digest::SHA256.hexdigest(png)}-#{compress ? 'bc' : 'rgba'}.rtex")
+        if File.exist?(cache_path)
+          begin
+            return read(cache_path)
+          rescue FormatError
+            # Written by another version; rebuild it below
+          end
+        end
+
+        build(png, compress:).tap { |image| store(cache_path, image) }
+      end
+
+      def build(png, compress: false)
+        width, height, rgba = decode(png)
+        format = if !compress then RGBA8
+                 elsif AssetNative.opaque?(rgba) then BC1
+                 else BC3
+                 end
+
+        levels = [rgba, *AssetNative.mipmaps(rgba, width, height)].each_with_index.map do |bytes, level|
+          level_width = level_size(width, level)
+          level_height = level_size(height, level)
+          bytes = AssetNative.compress_bc(bytes, level_width, level_height, format == BC3) unless format == RGBA8
+          Level.new(level_width, level_height, bytes)
+        end
+        Image.new(format, levels)
+      end
+
+      def write(path, image)
+        File.open(path, "wb") do |file|
+          file.write([MAGIC, VERSION, image.format, image.width, image.height, image.levels.length]
+                       .pack(HEADER_FORMAT).ljust(HEADER_SIZE, "\0"))
+          image.levels.each { |level| file.write(level.bytes) }
+        end
+      end
+
+      def read(path)
+        mapped_file = AssetNative::MappedFile.new(path)
+        raise FormatError, "#{path} is too short for a texture header" if mapped_file.size < HEADER_SIZE
+
+        magic, version, format, width, height, level_count = mapped_file.slice(0, HEADER_SIZE).unpack(HEADER_FORMAT)
+        raise FormatError, "#{path} is not a texture cache entry" unless magic == MAGIC
+        raise FormatError, "#{path} is version #{version}, expected #{VERSION}" unless version == VERSION
+        raise FormatError, "#{path} has unknown format 0x#{format.to_s(16)}" unless format == RGBA8 || BLOCK_SIZES.key?(format)
+
+        sizes = Array.new(level_count) do |level|
+          level_bytesize(format, level_size(width, level), level_size(height, level))
+        end
+        expected_size = HEADER_SIZE + sizes.sum
+        raise FormatError, "#{path} is #{mapped_file.size} bytes, expected #{expected_size}" unless mapped_file.size == expected_size
+
+        offset = HEADER_SIZE
+        levels = sizes.each_with_index.map do |size, level|
+          Level.new(level_size(width, level), level_size(height, level), mapped_file.slice(offset, size)).tap { offset += size }
+        end
+        Image.new(format, levels, mapped_file)
+      end
+
+      private
+
+      # [width, height, rgba] with rows bottom-up
+      def decode(png)
+        if AssetNative.respond_to?(:decode_png)
+          begin
+            return AssetNative.decode_png(png)
+          rescue ArgumentError
+            # Interlaced PNGs; ChunkyPNG reads those
+          end
+        end
+
+        image = ChunkyPNG::Image.from_blob(png)
+        stream = image.to_rgba_stream
+        row_size = image.width * 4
+        flipped = String.new(capacity: stream.bytesize)
+        (image.height - 1).downto(0) { |row| flipped << stream.byteslice(row * row_size, row_size) }
+        [image.width, image.height, flipped]
+      end
+
+      # Written to a temporary name first, so a concurrent run never maps a
+      # half-written entry. A read-only cache just means decoding every time.
+      def store(path, image)
+        FileUtils.mkdir_p(File.dirname(path))
+        temporary_path = "#{path}.#{Process.pid}.tmp"
+        write(temporary_path, image)
+        File.rename(temporary_path, path)
+      rescue SystemCallError
+        FileUtils.rm_f(temporary_path) if temporary_path
+      end
+
+      def level_size(size, level)
+        [size >> level, 1].max
+      end
+
+      def level_bytesize(format, width, height)
+        return width * height * 4 if format == RGBA8
+
+        ((width + 3) / 4) * ((height + 3) / 4) * BLOCK_SIZES[format]
+      end
+    end
+  end
+end
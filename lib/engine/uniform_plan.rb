@@ -0,0 +1,85 @@
+# frozen_string_literal: true
+
+module Engine
+  # A Material's uniforms compiled against one Shader: resolved locations,
+  # fixed texture slots and values packed into the bytes glUniform* takes.
+  #
+  # Values are only repacked when the material holds a different object for a
+  # uniform, or an unfrozen one that may have changed in place (Material stores
+  # frozen copies; values loaded from a scene aren't), and
+  # Shader#apply_packed_uniform only sends bytes the program does not already
+  # have. When the same plan is re-applied with no changes in between, nothing
+  # is compared at all.
+  class UniformPlan
+    Uniform = Struct.new(:name, :kind, :location, :values, :value, :packed)
+    Sampler = Struct.new(:name, :kind, :target, :slot)
+
+    PACKERS = {
+      mat4: ->(value) { value.to_a.flatten.pack('F16') },
+      vec2: ->(value) { [value[0], value[1]].pack('F2') },
+      vec3: ->(value) { (value.is_a?(Hash) ? [value[:r], value[:g], value[:b]] : [value[0], value[1], value[2]]).pack('F3') },
+      vec4: ->(value) { [value[0], value[1], value[2], value[3]].pack('F4') },
+      float: ->(value) { [value].pack('F') },
+      int: ->(value) { [value].pack('l') }
+    }.freeze
+
+    SAMPLER_TARGETS = {
+      texture: Engine::GL::TEXTURE_2D,
+      cubemap: Engine::GL::TEXTURE_CUBE_MAP,
+      texture_array: Engine::GL::TEXTURE_2D_ARRAY,
+      cubemap_array: Engine::GL::TEXTURE_CUBE_MAP_ARRAY
+    }.freeze
+
+    attr_reader :shader, :samplers
+
+    # uniforms: { kind => { name => value } }, the material's live hashes
+    # samplers: { kind => [name, ...] } in slot order
+    def initialize(shader, uniforms, samplers)
+      @shader = shader
+      @uniforms = []
+      @samplers = []
+
+      uniforms.each do |kind, values|
+        values.each_key { |name| add_uniform(name, kind, values) }
+      end
+
+      slot = 0
+      samplers.each do |kind, names|
+        names.each do |name|
+          @samplers << Sampler.new(name, kind, SAMPLER_TARGETS[kind], slot)
+          add_uniform(name, :int, { name => slot }.freeze)
+          slot += 1
+        end
+      end
+    end
+
+    def upload(revision)
+      if shader.applied?(self, revision)
+        shader.skip_uniforms(@uniforms.length)
+        return
+      end
+
+      @uniforms.each do |uniform|
+        value = uniform.values[uniform.name]
+        next if value.nil?
+
+        unless value.equal?(uniform.value) && value.frozen?
+          uniform.value = value
+          uniform.packed = PACKERS[uniform.kind].call(value)
+        end
+        shader.apply_packed_uniform(uniform.name, uniform.kind, uniform.location, uniform.packed)
+      end
+      shader.mark_applied(self, revision)
+    end
+
+    private
+
+    # Names the program does not use (location -1) are dropped up front
+    def add_uniform(name, kind, values)
+      location = shader.uniform_location(name)
+      return if location < 0
+
+      @uniforms << Uniform.new(name, kind, location, values, nil, nil)
+    end
+  end
+end
@@ -8,6 +8,8 @@ if RUBY_PLATFORM =~ /mingw|mswin/
 end
 
 require_relative 'engine/gl'
+require_relative 'engine/gl_command_buffer'
+require_relative 'engine/gl_stats'
 require_relative 'engine/glfw'
 require 'concurrent'
 require 'os'
@@ -24,6 +26,7 @@ require_relative "engine/debug"
 require_relative 'engine/rendering/render_texture'
 require_relative 'engine/rendering/shadow_map_array'
 require_relative 'engine/rendering/cubemap_shadow_map_array'
+require_relative 'engine/rendering/shadow_cache'
 require_relative 'engine/rendering/screen_quad'
 require_relative 'engine/rendering/post_processing/post_processing_effect'
 require_relative 'engine/rendering/post_processing/effect'
@@ -40,13 +43,27 @@ require_relative 'engine/rendering/gpu_timer'
 require_relative 'engine/rendering/debug_draw'
 require_relative 'engine/rendering/render_pipeline'
 require_relative 'engine/rendering/ui/stencil_manager'
+require_relative 'engine/rendering/culling'
+require_relative 'engine/rendering/lod'
+require_relative 'engine/rendering/instance_buffer'
+require_relative 'engine/rendering/frame_uniform_buffer'
 require_relative 'engine/rendering/instance_renderer'
+require_relative 'engine/rendering/text_batch'
+require_relative 'engine/rendering/ui/batcher'
+require_relative 'engine/rendering/ui/sprite_atlas'
+require_relative 'engine/rendering/ui/sprite_batch'
+require_relative 'engine/rendering/frame_readback'
 require_relative 'engine/screenshoter'
+require_relative 'engine/frame_profiler'
 require_relative 'engine/input'
 require_relative "engine/quaternion"
 require_relative 'engine/game_object'
+require_relative 'engine/asset_streamer'
+require_relative 'engine/texture_cache'
 require_relative 'engine/texture'
+require_relative 'engine/uniform_plan'
 require_relative 'engine/material'
+require_relative 'engine/mesh_file'
 require_relative 'engine/mesh'
 require_relative 'engine/standard_meshes/quad_mesh'
 require_relative 'engine/standard_objects/default_material'
@@ -74,6 +91,7 @@ require_relative "engine/components/orthographic_camera"
 require_relative "engine/components/perspective_camera"
 require_relative "engine/components/renderers/sprite_renderer"
 require_relative "engine/components/sprite_animator"
+require_relative "engine/components/frame_profiler_overlay"
 require_relative "engine/components/renderers/mesh_renderer"
 require_relative "engine/components/renderers/font_renderer_base"
 require_relative "engine/components/renderers/font_renderer"
@@ -83,8 +101,11 @@ require_relative "engine/components/direction_light"
 require_relative "engine/components/spot_light"
 require_relative "engine/components/audio_source"
 
+require_relative "engine/physics/spatial_hash"
 require_relative "engine/physics/physics_resolver"
+require_relative "engine/physics/physics_world"
 require_relative 'engine/physics/collision'
+require_relative "engine/physics/components/collider"
 require_relative "engine/physics/components/sphere_collider"
 require_relative "engine/physics/components/cube_collider"
 require_relative "engine/physics/components/rigidbody"
@@ -0,0 +1,271 @@
+# frozen_string_literal: true
+
+require "zlib"
+
+describe AssetNative do
+  # A w x h grid of quads, two triangles each, with rows emitted in an order
+  # that wastes the cache: every other row, then the rest
+  def grid(w, h, stride: 3)
+    vertices = (0..h).flat_map { |y| (0..w).flat_map { |x| [x.to_f, y.to_f, 0.0] + Array.new(stride - 3, 0.0) } }
+    rows = (0...h).step(2).to_a + (1...h).step(2).to_a
+    indices = rows.flat_map do |y|
+      (0...w).flat_map do |x|
+        a = y * (w + 1) + x
+        [a, a + 1, a + w + 2, a, a + w + 2, a + w + 1]
+      end
+    end
+    [vertices.pack('e*'), indices.pack('V*')]
+  end
+
+  def triangles(vertex_bytes, index_bytes, stride)
+    index_bytes.unpack('V*').each_slice(3).map do |triangle|
+      corners = triangle.map { |index| vertex_bytes.byteslice(index * stride * 4, stride * 4) }
+      corners.rotate(corners.index(corners.min))
+    end.sort
+  end
+
+  describe ".acmr" do
+    it "is 3 when no vertex is reused" do
+      expect(described_class.acmr([0, 1, 2, 3, 4, 5].pack('V*'))).to eq(3)
+    end
+
+    it "counts vertices still in the FIFO cache as hits" do
+      expect(described_class.acmr([0, 1, 2, 0, 2, 3].pack('V*'))).to eq(2)
+      expect(described_class.acmr([0, 1, 2, 0, 2, 3].pack('V*'), 2)).to eq(2.5)
+    end
+  end
+
+  describe ".optimize_mesh" do
+    it "keeps the same triangles with fewer cache misses" do
+      vertex_bytes, index_bytes = grid(16, 16)
+      optimized_vertices, optimized_indices = described_class.optimize_mesh(vertex_bytes, index_bytes, 3)
+
+      expect(triangles(optimized_vertices, optimized_indices, 3)).to eq(triangles(vertex_bytes, index_bytes, 3))
+      expect(described_class.acmr(optimized_indices)).to be < described_class.acmr(index_bytes) * 0.8
+    end
+
+    it "numbers vertices in the order they are first used and drops unused ones" do
+      vertex_bytes, index_bytes = grid(4, 4, stride: 5)
+      vertex_bytes += Array.new(5, 9.0).pack('e*')
+      optimized_vertices, optimized_indices = described_class.optimize_mesh(vertex_bytes, index_bytes, 5)
+
+      first_uses = optimized_indices.unpack('V*').uniq
+      expect(first_uses).to eq((0...25).to_a)
+      expect(optimized_vertices.bytesize).to eq(25 * 5 * 4)
+    end
+
+    it "rejects indices past the last vertex" do
+      expect { described_class.optimize_mesh(Array.new(9, 0.0).pack('e*'), [0, 1, 3].pack('V*'), 3) }
+        .to raise_error(ArgumentError, /index 3/)
+    end
+  end
+
+  describe ".simplify" do
+    def bounds(vertex_bytes, index_bytes, stride)
+      used = index_bytes.unpack('V*').uniq.map { |index| vertex_bytes.unpack("e#{stride}", offset: index * stride * 4) }
+      [used.map(&:first).minmax, used.map { |vertex| vertex[1] }.minmax]
+    end
+
+    it "halves a flat grid without error or moving its border" do
+      vertex_bytes, index_bytes = grid(16, 16)
+      simplified, error = described_class.simplify(vertex_bytes, index_bytes, 3, index_bytes.bytesize / 8, 0.1)
+
+      expect(simplified.bytesize).to be <= index_bytes.bytesize / 2
+      expect(simplified.unpack('V*').max).to be < 17 * 17
+      expect(error).to be_within(1e-4).of(0)
+      expect(bounds(vertex_bytes, simplified, 3)).to eq([[0, 16], [0, 16]])
+    end
+
+    it "stops at max_error" do
+      # A curved grid, where every collapse moves the surface
+      vertex_bytes, index_bytes = grid(8, 8)
+      curved = vertex_bytes.unpack('e*').each_slice(3).flat_map { |x, y, _| [x, y, Math.sin(x) * Math.cos(y)] }.pack('e*')
+      strict, strict_error = described_class.simplify(curved, index_bytes, 3, 0, 0.01)
+      loose, loose_error = described_class.simplify(curved, index_bytes, 3, 0, 0.05)
+
+      expect(strict_error).to be <= 0.01
+      expect(loose_error).to be <= 0.05
+      expect(loose.bytesize).to be < strict.bytesize
+      expect(strict.bytesize).to be < index_bytes.bytesize
+    end
+  end
+
+  describe ".depth_stream" do
+    it "welds vertices that only differ past the position" do
+      # Two triangles sharing an edge, split by a uv seam
+      vertices = [
+        [0, 0, 0, 0, 0], [1, 0, 0, 1, 0], [0, 1, 0, 0, 1],
+        [1, 0, 0, 0.5, 0.5], [1, 1, 0, 1, 1], [0, 1, 0, 0.5, 0.5]
+      ].flatten.pack('e*')
+      index_bytes = [0, 1, 2, 3, 4, 5].pack('V*')
+      positions, (indices,) = described_class.depth_stream(vertices, [index_bytes], 5)
+      unwelded = vertices.unpack('e*').each_slice(5).flat_map { |vertex| vertex[0, 3] }.pack('e*')
+
+      expect(positions.bytesize).to eq(4 * 12)
+      expect(triangles(positions, indices, 3)).to eq(triangles(unwelded, index_bytes, 3))
+    end
+  end
+
+  describe ".decode_png" do
+    def png(width, height, pixels, **options)
+      ChunkyPNG::Image.new(width, height, pixels).to_blob(**options)
+    end
+
+    let(:red) { ChunkyPNG::Color.rgba(255, 0, 0, 255) }
+    let(:green) { ChunkyPNG::Color.rgba(0, 255, 0, 128) }
+    let(:blue) { ChunkyPNG::Color.rgba(0, 0, 255, 255) }
+    let(:white) { ChunkyPNG::Color.rgba(255, 255, 255, 0) }
+
+    it "returns RGBA rows bottom-up" do
+      width, height, rgba = described_class.decode_png(png(2, 2, [red, green, blue, white], color_mode: ChunkyPNG::COLOR_TRUECOLOR_ALPHA))
+
+      expect([width, height]).to eq([2, 2])
+      expect(rgba.unpack('C*').each_slice(4).to_a).to eq([[0, 0, 255, 255], [255, 255, 255, 0], [255, 0, 0, 255], [0, 255, 0, 128]])
+    end
+
+    it "expands palettes, grey and 16 bit channels to the same bytes" do
+      pixels = [red, green, blue, white, red, blue]
+      expected = described_class.decode_png(png(3, 2, pixels, color_mode: ChunkyPNG::COLOR_TRUECOLOR_ALPHA))
+
+      expect(described_class.decode_png(png(3, 2, pixels, color_mode: ChunkyPNG::COLOR_INDEXED))).to eq(expected)
+      expect(described_class.decode_png(png(3, 2, pixels, color_mode: ChunkyPNG::COLOR_TRUECOLOR_ALPHA, bit_depth: 16)))
+        .to eq(expected)
+
+      grey = [0, 85, 170, 255].map { |value| ChunkyPNG::Color.grayscale(value) }
+      _, _, rgba = described_class.decode_png(png(4, 1, grey, color_mode: ChunkyPNG::COLOR_GRAYSCALE, bit_depth: 2))
+      expect(rgba.unpack('C*').each_slice(4).map(&:first)).to eq([0, 85, 170, 255])
+    end
+
+    it "rejects interlaced and broken files" do
+      expect { described_class.decode_png(png(2, 2, [red] * 4, interlace: true)) }.to raise_error(ArgumentError, /interlaced/)
+      expect { described_class.decode_png("not a png") }.to raise_error(ArgumentError, /not a PNG/)
+      expect { described_class.decode_png(png(8, 8, [red] * 64).byteslice(0, 60)) }.to raise_error(ArgumentError)
+    end
+
+    describe "malformed chunks" do
+      def chunk(type, data)
+        [data.bytesize].pack('N') + type + data.b + [Zlib.crc32(type + data.b)].pack('N')
+      end
+
+      def raw_png(*chunks)
+        "\x89PNG\r\n\x1A\n".b + chunks.map { |type, data| chunk(type, data) }.join + chunk("IEND", "")
+      end
+
+      def ihdr(width, height, depth: 8, color_type: 6)
+        ["IHDR", [width, height, depth, color_type, 0, 0, 0].pack('NNC5')]
+      end
+
+      let(:idat) { ["IDAT", Zlib::Deflate.deflate(("\0" + "\xFF\0\0\xFF".b * 2) * 2)] }
+
+      it "rejects truncated image data" do
+        truncated = ["IDAT", idat[1].byteslice(0, idat[1].bytesize / 2)]
+
+        expect { described_class.decode_png(raw_png(ihdr(2, 2), truncated)) }.to raise_error(ArgumentError, /incomplete/)
+        expect { described_class.decode_png(raw_png(ihdr(2, 2))) }.to raise_error(ArgumentError, /incomplete/)
+      end
+
+      it "rejects bad IHDR dimensions and layouts" do
+        expect { described_class.decode_png(raw_png(ihdr(0, 2), idat)) }.to raise_error(ArgumentError, /size out of range/)
+        expect { described_class.decode_png(raw_png(ihdr(40_000, 1), idat)) }.to raise_error(ArgumentError, /size out of range/)
+        expect { described_class.decode_png(raw_png(ihdr(32_768, 32_768, depth: 16), idat)) }
+          .to raise_error(ArgumentError, /size out of range/)
+        expect { described_class.decode_png(raw_png(["IHDR", "\0" * 12], idat)) }.to raise_error(ArgumentError, /malformed IHDR/)
+        expect { described_class.decode_png(raw_png(ihdr(2, 2), ihdr(2, 2), idat)) }.to raise_error(ArgumentError, /duplicate IHDR/)
+      end
+
+      it "treats short PLTE and tRNS chunks as covering only the entries they hold" do
+        palette_rows = Zlib::Deflate.deflate(("\0" + "\x00\x05".b) * 2)
+        _, _, rgba = described_class.decode_png(
+          raw_png(ihdr(2, 2, color_type: 3), ["PLTE", "\xFF\0\0\0".b], ["tRNS", "\x80".b], ["IDAT", palette_rows])
+        )
+
+        expect(rgba.unpack('C*').first(8)).to eq([255, 0, 0, 128, 0, 0, 0, 255])
+
+        _, _, rgba = described_class.decode_png(
+          raw_png(ihdr(1, 1, color_type: 2), ["tRNS", "\0\0"], ["IDAT", Zlib::Deflate.deflate("\0\0\0\0")])
+        )
+        expect(rgba.unpack('C*')).to eq([0, 0, 0, 255])
+      end
+
+      it "rejects chunks running past the end of the file and unknown row filters" do
+        overrun = raw_png(ihdr(2, 2)).byteslice(0, 33) + [1_000].pack('N') + "IDATxx"
+        bad_filter = ["IDAT", Zlib::Deflate.deflate(("\x09" + "\0" * 8) * 2)]
+
+        expect { described_class.decode_png(overrun) }.to raise_error(ArgumentError)
+        expect { described_class.decode_png(raw_png(ihdr(2, 2), bad_filter)) }.to raise_error(ArgumentError, /row filter/)
+      end
+    end
+  end
+
+  describe ".mipmaps" do
+    it "halves each level down to 1x1" do
+      levels = described_class.mipmaps("\xFF".b * (8 * 2 * 4), 8, 2)
+
+      expect(levels.map(&:bytesize)).to eq([4 * 1 * 4, 2 * 1 * 4, 1 * 1 * 4])
+    end
+
+    it "keeps transparent texels from bleeding into the colour" do
+      rgba = [[255, 0, 0, 255], [0, 0, 0, 0], [255, 0, 0, 255], [0, 0, 0, 0]].flatten.pack('C*')
+
+      expect(described_class.mipmaps(rgba, 2, 2).first.unpack('C*')).to eq([255, 0, 0, 128])
+    end
+
+    it "checks the size against the dimensions" do
+      expect { described_class.mipmaps("\0" * 12, 2, 2) }.to raise_error(ArgumentError, /2x2 RGBA/)
+    end
+  end
+
+  describe ".compress_bc" do
+    it "writes a block per 4x4 texels, rounding edges up" do
+      rgba = "\x80".b * (6 * 5 * 4)
+
+      expect(described_class.compress_bc(rgba, 6, 5, false).bytesize).to eq(2 * 2 * 8)
+      expect(described_class.compress_bc(rgba, 6, 5, true).bytesize).to eq(2 * 2 * 16)
+    end
+
+    it "encodes a solid colour exactly" do
+      block = described_class.compress_bc([255, 0, 0, 255].pack('C*') * 16, 4, 4, false)
+
+      expect(block.unpack('vvV')).to eq([0xF800, 0xF800, 0])
+    end
+
+    it "keeps both alpha extremes" do
+      rgba = ([0, 0, 0, 0].pack('C*') * 8) + ([0, 0, 0, 255].pack('C*') * 8)
+      block = described_class.compress_bc(rgba, 4, 4, true)
+
+      expect(block.unpack('CC')).to eq([255, 0])
+    end
+  end
+
+  describe ".opaque?" do
+    it "is true only when every alpha is 255" do
+      expect(described_class.opaque?(([1, 2, 3, 255] * 4).pack('C*'))).to be(true)
+      expect(described_class.opaque?(([1, 2, 3, 255] * 3 + [1, 2, 3, 254]).pack('C*'))).to be(false)
+    end
+  end
+
+  describe ".encode_png" do
+    # two rows bottom-up, as ReadPixels returns them
+    let(:rgba) { [255, 0, 0, 10, 0, 255, 0, 20, 0, 0, 255, 30, 9, 8, 7, 40].pack('C*') }
+
+    it "writes a PNG ChunkyPNG reads top-down" do
+      image = ChunkyPNG::Image.from_blob(described_class.encode_png(rgba, 2, 2, false, 6))
+
+      expect(image.pixels).to eq([ChunkyPNG::Color.rgb(0, 0, 255), ChunkyPNG::Color.rgb(9, 8, 7),
+                                  ChunkyPNG::Color.rgb(255, 0, 0), ChunkyPNG::Color.rgb(0, 255, 0)])
+    end
+
+    it "round-trips through decode_png with alpha" do
+      expect(described_class.decode_png(described_class.encode_png(rgba, 2, 2, true, 1))).to eq([2, 2, rgba])
+    end
+  end
+
+  describe ".flip_rgba" do
+    it "reverses the rows and can force alpha to 255" do
+      rgba = [1, 2, 3, 4, 5, 6, 7, 8].pack('C*')
+
+      expect(described_class.flip_rgba(rgba, 1, 2, false).unpack('C*')).to eq([5, 6, 7, 8, 1, 2, 3, 4])
+      expect(described_class.flip_rgba(rgba, 1, 2, true).unpack('C*')).to eq([5, 6, 7, 255, 1, 2, 3, 255])
+    end
+  end
+end
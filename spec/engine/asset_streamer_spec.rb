@@ -0,0 +1,158 @@
+# frozen_string_literal: true
+
+require "timeout"
+
+describe Engine::AssetStreamer do
+  let(:asset_class) do
+    Class.new do
+      attr_reader :loaded_on, :uploads
+
+      def initialize(bytes: 100, gate: nil, error: nil)
+        @bytes = bytes
+        @gate = gate
+        @error = error
+        @uploads = []
+      end
+
+      def load_asset
+        @gate&.pop
+        raise @error if @error
+
+        @loaded_on = Thread.current
+        "payload"
+      end
+
+      def upload_asset(payload)
+        @uploads << [payload, Thread.current]
+        @bytes
+      end
+    end
+  end
+
+  def wait_until_loaded(count)
+    Timeout.timeout(5) { sleep 0.001 until described_class.send(:upload_queue).size >= count }
+  end
+
+  before { described_class.enabled = true }
+
+  after do
+    described_class.reset
+    described_class.enabled = nil
+    described_class.upload_budget_bytes = nil
+    described_class.upload_budget_ms = nil
+  end
+
+  it "loads and uploads straight away when disabled" do
+    described_class.enabled = false
+    asset = asset_class.new
+    described_class.stream(asset)
+
+    expect(asset.uploads).to eq([["payload", Thread.current]])
+    expect(described_class.ready?(asset)).to be(true)
+  end
+
+  it "loads on a worker and uploads on the next update" do
+    asset = asset_class.new
+    described_class.stream(asset)
+    wait_until_loaded(1)
+
+    expect(asset.loaded_on).not_to eq(Thread.current)
+    expect(asset.uploads).to be_empty
+    expect(described_class.ready?(asset)).to be(false)
+
+    expect(described_class.update).to eq(1)
+    expect(asset.uploads).to eq([["payload", Thread.current]])
+    expect(described_class.ready?(asset)).to be(true)
+  end
+
+  it "stops uploading once the byte budget is spent, but always uploads one" do
+    described_class.upload_budget_bytes = 150
+    assets = Array.new(3) { asset_class.new(bytes: 100) }
+    assets.each { |asset| described_class.stream(asset) }
+    wait_until_loaded(3)
+
+    expect(described_class.update).to eq(2)
+    expect(described_class.update).to eq(1)
+    expect(assets.map { |asset| asset.uploads.length }).to eq([1, 1, 1])
+
+    described_class.upload_budget_bytes = 10
+    big = asset_class.new(bytes: 1_000)
+    described_class.stream(big)
+    wait_until_loaded(1)
+    expect(described_class.update).to eq(1)
+  end
+
+  it "runs when_ready blocks after the upload" do
+    asset = asset_class.new
+    calls = []
+    described_class.stream(asset)
+    described_class.when_ready(asset) { calls << asset.uploads.length }
+    wait_until_loaded(1)
+
+    expect(calls).to be_empty
+    described_class.update
+    expect(calls).to eq([1])
+
+    described_class.when_ready(asset) { calls << :again }
+    expect(calls).to eq([1, :again])
+  end
+
+  it "finishes a pending asset on demand" do
+    gate = Queue.new
+    blocked = asset_class.new(gate:)
+    described_class.stream(blocked)
+    queued = asset_class.new
+
+    described_class.stream(queued)
+    described_class.finish(queued)
+    expect(queued.uploads.length).to eq(1)
+
+    gate << :go
+    described_class.finish(blocked)
+    expect(blocked.uploads.length).to eq(1)
+    expect(described_class.update).to eq(0)
+    expect(described_class.pending_count).to eq(0)
+  end
+
+  it "drops jobs still loading when reset" do
+    gate = Queue.new
+    asset = asset_class.new(gate:)
+    calls = []
+    described_class.stream(asset)
+    described_class.when_ready(asset) { calls << :ready }
+    Timeout.timeout(5) { sleep 0.001 until described_class.send(:jobs)[asset]&.state == :loading }
+
+    described_class.reset
+    gate << :go
+    Timeout.timeout(5) { sleep 0.001 until asset.loaded_on }
+    sleep 0.01
+
+    expect(described_class.update).to eq(0)
+    expect(asset.uploads).to be_empty
+    expect(calls).to be_empty
+  end
+
+  it "raises load errors on the main thread" do
+    asset = asset_class.new(error: Errno::ENOENT.new("missing.png"))
+    described_class.stream(asset)
+    wait_until_loaded(1)
+
+    expect { described_class.update }.to raise_error(Errno::ENOENT, /missing.png/)
+    expect(described_class.ready?(asset)).to be(false)
+  end
+
+  it "keeps an asset that failed to upload pending" do
+    asset = asset_class.new
+    calls = []
+    allow(asset).to receive(:upload_asset).and_raise(ArgumentError, "bad image")
+    described_class.stream(asset)
+    described_class.when_ready(asset) { calls << :ready }
+    wait_until_loaded(1)
+
+    expect { described_class.update }.to raise_error(ArgumentError, /bad image/)
+    expect(described_class.ready?(asset)).to be(false)
+    expect(described_class.update).to eq(0)
+    expect { described_class.finish(asset) }.to raise_error(ArgumentError, /bad image/)
+    expect(calls).to be_empty
+  end
+end
@@ -39,4 +39,37 @@ describe Engine::Components::FontRendererBase do
       expect(serialized[:font][:source]).to eq(:game)
     end
   end
+
+  describe "#refresh_text_instances" do
+    let(:model) { (1..16).map(&:to_f).pack("F16") }
+    let(:renderer) do
+      renderer_class = Class.new(described_class)
+      renderer_class.define_method(:packed_model_matrix) { @model }
+      renderer_class.create(font: mock_font, string: "ab").tap { |renderer| renderer.instance_variable_set(:@model, model) }
+    end
+
+    before do
+      allow(mock_font).to receive(:layout) do |string|
+        Engine::Font::Layout.new(string.length, string.chars.each_with_index.flat_map { |_, i| [i, i * 0.5, 0.0] }.pack("lFF" * string.length))
+      end
+    end
+
+    it "interleaves each glyph with the model matrix" do
+      expect(renderer.refresh_text_instances).to be(true)
+
+      expect(renderer.glyph_count).to eq(2)
+      expect(renderer.text_instances.bytesize).to eq(2 * Rendering::TextBatch::GLYPH_BYTES)
+      expect(renderer.text_instances.byteslice(Rendering::TextBatch::GLYPH_BYTES, 12).unpack("lFF")).to eq([1, 0.5, 0.0])
+      expect(renderer.text_instances.byteslice(12, 64)).to eq(model)
+    end
+
+    it "only rebuilds when the string or model matrix changes" do
+      renderer.refresh_text_instances
+
+      expect(renderer.refresh_text_instances).to be(false)
+      renderer.update_string("abc")
+      expect(renderer.refresh_text_instances).to be(true)
+      expect(renderer.glyph_count).to eq(3)
+    end
+  end
 end
@@ -37,4 +37,27 @@ describe Engine::Font do
             )
     end
   end
+
+  describe "#layout" do
+    before do
+      stub_const("GAME_DIR", "spec")
+      allow(File).to receive(:read).and_return(JSON.dump("71" => { "width" => 100 }, "100" => { "width" => 80 }))
+    end
+
+    let(:font) { Engine::Font.create(font_file_path: "spec/fixtures/UbuntuMono-R.ttf") }
+
+    it "packs each glyph's atlas index and offset, skipping newlines" do
+      layout = font.layout("He\nH")
+
+      expect(layout.glyph_count).to eq(3)
+      expect(layout.instance_data.unpack("lFF" * 3)).to eq([72, 0.0, 0.0, 107, 1.46484375, 0.0, 72, 0.0, -1.0])
+    end
+
+    it "reads the metrics once and caches layouts by string" do
+      expect(font.layout("He")).to be(font.layout(+"He"))
+      font.layout("eH")
+
+      expect(File).to have_received(:read).once
+    end
+  end
 end
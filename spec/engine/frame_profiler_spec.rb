@@ -0,0 +1,90 @@
+# frozen_string_literal: true
+
+require "tmpdir"
+
+describe Engine::FrameProfiler do
+  let(:component_class) do
+    stub_const("ProfiledComponent", Class.new do
+      attr_reader :updates
+
+      def update(delta_time)
+        @updates = (@updates || 0) + 1
+      end
+    end)
+  end
+
+  before { described_class.enable }
+  after { described_class.disable }
+
+  def frame
+    described_class.begin_frame
+    yield if block_given?
+    described_class.end_frame
+  end
+
+  it "does nothing but yield while disabled" do
+    described_class.disable
+    expect(described_class.phase(:draw) { :drawn }).to eq(:drawn)
+    frame
+
+    expect(described_class.frames).to be_empty
+  end
+
+  it "times nested phases" do
+    recorded = frame do
+      described_class.phase(:physics) do
+        described_class.phase(:physics_resolve) { sleep 0.002 }
+      end
+    end
+
+    expect(recorded.phases.keys).to eq([:physics_resolve, :physics])
+    expect(recorded.phases[:physics]).to be >= recorded.phases[:physics_resolve]
+    expect(recorded.phases[:physics_resolve]).to be >= 2
+    expect(recorded.frame_ms).to be >= recorded.phases[:physics]
+  end
+
+  it "sums component updates per class" do
+    components = Array.new(3) { component_class.new }
+    recorded = frame { components.each { |component| described_class.component_update(component, 0.1) } }
+
+    expect(components.map(&:updates)).to eq([1, 1, 1])
+    expect(recorded.components[component_class][1]).to eq(3)
+    expect(described_class.summary[:components]["ProfiledComponent"][:calls]).to eq(3.0)
+  end
+
+  it "counts allocations and GC runs per frame" do
+    recorded = frame do
+      10_000.times { Object.new }
+      GC.start
+    end
+
+    expect(recorded.allocated_objects).to be >= 10_000
+    expect(recorded.major_gc).to be >= 1
+  end
+
+  it "reports nearest-rank percentiles over the kept frames" do
+    stub_const("#{described_class}::HISTORY", 100)
+    101.times { frame }
+    described_class.frames.each_with_index { |recorded, index| recorded.frame_ms = index + 1.0 }
+
+    expect(described_class.frames.length).to eq(100)
+    expect(described_class.summary[:frame_ms]).to eq(p50: 50.0, p95: 95.0, p99: 99.0, max: 100.0)
+  end
+
+  it "dumps frames as CSV or JSON" do
+    2.times { frame { described_class.phase(:draw) {} } }
+
+    Dir.mktmpdir do |dir|
+      described_class.dump(File.join(dir, "frames.csv"))
+      described_class.dump(File.join(dir, "frames.json"))
+
+      csv = File.readlines(File.join(dir, "frames.csv"), chomp: true)
+      expect(csv.first).to eq("frame,frame_ms,draw,allocated_objects,minor_gc,major_gc")
+      expect(csv.length).to eq(3)
+
+      json = JSON.parse(File.read(File.join(dir, "frames.json")))
+      expect(json["frames"].map { |recorded| recorded["number"] }).to eq([1, 2])
+      expect(json["summary"]["frames"]).to eq(2)
+    end
+  end
+end
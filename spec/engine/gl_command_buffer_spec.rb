@@ -0,0 +1,37 @@
+# frozen_string_literal: true
+
+describe Engine::GL::CommandBuffer do
+  let(:commands) { described_class.new }
+
+  it "packs each command as an opcode followed by 32-bit arguments" do
+    commands.BindVertexArray(3)
+    commands.Uniform1f(2, 0.5)
+    commands.DrawElementsInstanced(Engine::GL::TRIANGLES, 36, Engine::GL::UNSIGNED_INT, 0, 10)
+
+    words = commands.data.unpack('L*')
+    expect(words[0, 2]).to eq([described_class::BIND_VERTEX_ARRAY, 3])
+    expect(words[2, 2]).to eq([described_class::UNIFORM1F, 2])
+    expect(commands.data.unpack1('F', offset: 16)).to eq(0.5)
+    expect(words[5..]).to eq([described_class::DRAW_ELEMENTS_INSTANCED, Engine::GL::TRIANGLES, 36, Engine::GL::UNSIGNED_INT, 0, 10])
+    expect(commands.command_count).to eq(3)
+  end
+
+  it "rejects matrices that are not 16 floats" do
+    expect { commands.UniformMatrix4fv(0, [1.0].pack('F')) }.to raise_error(ArgumentError)
+  end
+
+  describe "Engine::GL.Execute" do
+    it "replays the buffer in one native call and updates the binding caches" do
+      allow(GLNative).to receive(:execute).and_return(2)
+      commands.BindVertexArray(42)
+      commands.BindBuffer(Engine::GL::ELEMENT_ARRAY_BUFFER, 7)
+
+      expect(Engine::GL.Execute(commands)).to eq(2)
+      expect(Engine::GL.bound_buffers[Engine::GL::ELEMENT_ARRAY_BUFFER]).to eq(7)
+      expect(Engine::GL.instance_variable_get(:@current_vertex_array)).to eq(42)
+    ensure
+      Engine::GL.bound_buffers.delete(Engine::GL::ELEMENT_ARRAY_BUFFER)
+      Engine::GL.instance_variable_set(:@current_vertex_array, nil)
+    end
+  end
+end
@@ -0,0 +1,74 @@
+# frozen_string_literal: true
+
+describe Engine::GL::Stats do
+  before { described_class.enable }
+  after { described_class.disable }
+
+  it "counts draw calls, instances and triangles" do
+    described_class.issued(:draw_elements, [Engine::GL::TRIANGLES, 36, Engine::GL::UNSIGNED_INT, 0])
+    described_class.issued(:draw_elements_instanced, [Engine::GL::TRIANGLES, 6, Engine::GL::UNSIGNED_INT, 0, 10])
+    described_class.issued(:draw_arrays, [Engine::GL::LINES, 0, 8])
+    stats = described_class.end_frame
+
+    expect(stats.draw_calls).to eq(3)
+    expect(stats.instances).to eq(12)
+    expect(stats.triangles).to eq(32)
+    expect(stats.calls[:draw_elements_instanced]).to eq(1)
+  end
+
+  it "counts uploaded bytes but not allocations" do
+    described_class.issued(:buffer_data, [Engine::GL::ARRAY_BUFFER, 256, nil, Engine::GL::DYNAMIC_DRAW])
+    described_class.issued(:buffer_data, [Engine::GL::ARRAY_BUFFER, 64, "\0" * 64, Engine::GL::STATIC_DRAW])
+    described_class.issued(:buffer_sub_data, [Engine::GL::ARRAY_BUFFER, 0, 16, "\0" * 16])
+    described_class.issued(:tex_image_2d, [Engine::GL::TEXTURE_2D, 0, Engine::GL::RGBA, 2, 2, 0, Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, "\0" * 16])
+    stats = described_class.end_frame
+
+    expect(stats.buffer_bytes).to eq(80)
+    expect(stats.texture_bytes).to eq(16)
+  end
+
+  it "counts calls the state caches skip as redundant" do
+    Engine::GL.instance_variable_set(:@current_program, 9)
+    Engine::GL.UseProgram(9)
+    stats = described_class.end_frame
+
+    expect(stats.redundant).to eq(UseProgram: 1)
+    expect(stats.redundant_state_changes).to eq(1)
+  ensure
+    Engine::GL.instance_variable_set(:@current_program, nil)
+  end
+
+  it "counts commands replayed by Execute" do
+    allow(GLNative).to receive(:execute).and_return(4)
+    commands = Engine::GL::CommandBuffer.new
+    commands.BindTexture(Engine::GL::TEXTURE0, Engine::GL::TEXTURE_2D, 5)
+    commands.Uniform1f(2, 0.5)
+    commands.DrawElementsInstanced(Engine::GL::TRIANGLES, 36, Engine::GL::UNSIGNED_INT, 0, 10)
+    commands.DrawElementsInstanced(Engine::GL::TRIANGLES, 6, Engine::GL::UNSIGNED_INT, 0, 1)
+
+    Engine::GL.Execute(commands)
+    stats = described_class.end_frame
+
+    expect(stats.calls).to include(active_texture: 1, bind_texture: 1, uniform1f: 1, draw_elements_instanced: 2)
+    expect(stats.state_changes).to eq(2)
+    expect(stats.uniform_uploads).to eq(1)
+    expect(stats.draw_calls).to eq(2)
+    expect(stats.triangles).to eq(122)
+  ensure
+    Engine::GL.bound_textures.delete([Engine::GL::TEXTURE0, Engine::GL::TEXTURE_2D])
+    Engine::GL.instance_variable_set(:@current_texture_unit, nil)
+  end
+
+  it "sums frames until reset" do
+    described_class.issued(:clear, [Engine::GL::COLOR_BUFFER_BIT])
+    described_class.end_frame
+    described_class.issued(:clear, [Engine::GL::COLOR_BUFFER_BIT])
+    described_class.end_frame
+
+    expect(described_class.frames).to eq(2)
+    expect(described_class.totals.calls[:clear]).to eq(2)
+
+    described_class.reset
+    expect(described_class.totals.call_count).to eq(0)
+  end
+end
@@ -0,0 +1,130 @@
+# frozen_string_literal: true
+
+require "tmpdir"
+require_relative "../../../lib/engine/importers/obj_importer"
+
+describe Engine::ObjImporter do
+  def import(source)
+    Dir.mktmpdir do |dir|
+      destination = File.join(dir, "nested", "mesh.mesh")
+      described_class.new(source, destination).import
+      mesh_file = Engine::MeshFile.read(destination)
+      [mesh_file.vertex_data.each_slice(20).to_a, mesh_file.index_data]
+    end
+  end
+
+  # Triangles as their corners' positions, uvs, normals and colours (everything
+  # but tangents) rounded to float32 precision, sorted so order doesn't matter
+  def triangles(corners)
+    corners.map { |vertex| (vertex[0, 8] + vertex[11, 9]).map { |value| value.round(5) } }.each_slice(3).sort
+  end
+
+  context "with the cube" do
+    let(:source) { File.join(__dir__, "cube") }
+
+    it "welds shared corners into an index buffer" do
+      vertices, indices = import(source)
+
+      expect(vertices.length).to eq(24)
+      expect(indices.length).to eq(36)
+    end
+
+    it "matches ObjFile's triangles" do
+      vertices, indices = import(source)
+      expected = Engine::ObjFile.new(source).vertex_data.each_slice(20).to_a
+
+      expect(triangles(indices.map { |index| vertices[index] })).to eq(triangles(expected))
+    end
+
+    it "gives every vertex a unit tangent perpendicular to its normal" do
+      vertices, = import(source)
+
+      vertices.each do |vertex|
+        normal = Vector[*vertex[5, 3]]
+        tangent = Vector[*vertex[8, 3]]
+        expect(tangent.magnitude).to be_within(1e-5).of(1)
+        expect(tangent.dot(normal)).to be_within(1e-5).of(0)
+      end
+    end
+  end
+
+  describe "the teapot" do
+    around do |example|
+      Dir.mktmpdir do |dir|
+        @path = File.join(dir, "teapot.mesh")
+        example.run
+      end
+    end
+
+    let(:importer) do
+      source = File.join(__dir__, "..", "..", "..", "samples", "cubes", "assets", "teapot")
+      described_class.new(source, @path).tap(&:import)
+    end
+
+    it "is reordered for fewer vertex cache misses" do
+      expect(importer.acmr_after).to be < importer.acmr_before * 0.8
+      expect(Engine::MeshFile.read(@path).index_type).to eq(Engine::GL::UNSIGNED_SHORT)
+    end
+
+    it "gets LOD levels with roughly half the triangles of the one before" do
+      counts = importer.triangle_counts
+      lods = Engine::MeshFile.read(@path).lods
+
+      expect(counts.length).to eq(described_class::LOD_COUNT + 1)
+      counts.each_cons(2) { |finer, coarser| expect(coarser).to be_within(finer / 10).of(finer / 2) }
+      expect(lods.map { |lod| lod.index_count / 3 }).to eq(counts)
+      expect(lods.map(&:error)).to eq(lods.map(&:error).sort)
+      expect(lods.last.error).to be < described_class::MAX_LOD_ERROR
+    end
+  end
+
+  it "keeps the obj's order without optimize" do
+    Dir.mktmpdir do |dir|
+      importer = described_class.new(File.join(__dir__, "cube"), File.join(dir, "cube.mesh"), optimize: false)
+      importer.import
+
+      expect(importer.acmr_after).to eq(importer.acmr_before)
+    end
+  end
+
+  it "reads material colours from the mtl" do
+    vertices, = import(File.join(__dir__, "obj_with_mtl"))
+    expected = Engine::ObjFile.new(File.join(__dir__, "obj_with_mtl")).vertex_data.each_slice(20).map { |v| v[11, 9] }.uniq
+
+    expect(vertices.map { |vertex| vertex[11, 9] }.uniq).to match_array(expected)
+  end
+
+  it "triangulates polygons, resolves negative indices and fills in missing normals" do
+    Dir.mktmpdir do |dir|
+      source = File.join(dir, "l_shape")
+      File.write("#{source}.obj", <<~OBJ)
+        v 0 0 0
+        v 2 0 0
+        v 2 1 0
+        v 1 1 0
+        v 1 2 0
+        v 0 2 0
+        f 1 2 3 4 5 -1
+      OBJ
+
+      vertices, indices = import(source)
+
+      expect(vertices.length).to eq(6)
+      expect(indices.length).to eq(12)
+      vertices.each { |vertex| expect(vertex[5, 3]).to eq([0, 0, 1]) }
+      area = indices.each_slice(3).sum do |a, b, c|
+        (Vector[*vertices[b][0, 3]] - Vector[*vertices[a][0, 3]]).cross(Vector[*vertices[c][0, 3]] - Vector[*vertices[a][0, 3]])[2] / 2
+      end
+      expect(area).to be_within(1e-6).of(3)
+    end
+  end
+
+  it "reports faces that refer to missing vertices" do
+    Dir.mktmpdir do |dir|
+      source = File.join(dir, "broken")
+      File.write("#{source}.obj", "v 0 0 0\nf 1 2 3\n")
+
+      expect { import(source) }.to raise_error(ArgumentError, /missing vertex/)
+    end
+  end
+end
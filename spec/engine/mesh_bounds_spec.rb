@@ -0,0 +1,31 @@
+# frozen_string_literal: true
+
+describe Engine::Mesh do
+  describe "#aabb" do
+    it "spans the vertex positions" do
+      min, max = Engine::Mesh.for("cube", source: :engine).aabb
+
+      expect(min).to eq(Vector[-0.5, -0.5, -0.5])
+      expect(max).to eq(Vector[0.5, 0.5, 0.5])
+    end
+  end
+
+  describe "#bounding_sphere" do
+    it "is centred on the bounds and reaches the furthest vertex" do
+      center, radius = Engine::Mesh.for("cube", source: :engine).bounding_sphere
+
+      expect(center).to eq(Vector[0, 0, 0])
+      expect(radius).to be_within(1e-6).of(Math.sqrt(0.75))
+    end
+
+    it "only reads positions from the 20 float vertex layout" do
+      mesh = Engine::Mesh.allocate
+      mesh.instance_variable_set(:@vertex_data, [2, 0, 0, *Array.new(17, 99.0), 4, 0, 0, *Array.new(17, 99.0)])
+
+      center, radius = mesh.bounding_sphere
+
+      expect(center).to eq(Vector[3, 0, 0])
+      expect(radius).to eq(1)
+    end
+  end
+end
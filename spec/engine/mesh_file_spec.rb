@@ -0,0 +1,154 @@
+# frozen_string_literal: true
+
+require "tmpdir"
+
+describe Engine::MeshFile do
+  let(:dir) { Dir.mktmpdir }
+  let(:path) { File.join(dir, "triangle.mesh") }
+  let(:vertex_data) do
+    [
+      [-1.0, 0.0, 0.0, *Array.new(17, 0.5)],
+      [1.0, 0.0, 0.0, *Array.new(17, 0.5)],
+      [0.0, 2.0, -1.0, *Array.new(17, 0.5)]
+    ].flatten
+  end
+
+  after { FileUtils.remove_entry(dir) }
+
+  it "reads back what it wrote" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+    mesh_file = described_class.read(path)
+
+    expect(mesh_file.vertex_count).to eq(3)
+    expect(mesh_file.vertex_stride).to eq(20)
+    expect(mesh_file.vertex_data).to eq(vertex_data)
+    expect(mesh_file.index_data).to eq([0, 1, 2])
+  end
+
+  it "hands out the raw float32 vertex bytes" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+
+    expect(described_class.read(path).vertex_bytes).to eq(vertex_data.pack('e*'))
+  end
+
+  it "keeps the mapping alive while a slice is reachable" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+    vertex_bytes = described_class.read(path).vertex_bytes
+    copy = vertex_bytes.dup
+    GC.start(full_mark: true, immediate_sweep: true)
+
+    expect(vertex_bytes).to eq(vertex_data.pack('e*'))
+    expect(copy).to eq(vertex_data.pack('e*'))
+  end
+
+  it "stores bounds in the header" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+    mesh_file = described_class.read(path)
+
+    expect(mesh_file.aabb).to eq([Vector[-1, 0, -1], Vector[1, 2, 0]])
+    expect(mesh_file.bounding_sphere[0]).to eq(Vector[0, 1, -0.5])
+    expect(mesh_file.bounding_sphere[1]).to be_within(1e-6).of(1.5)
+  end
+
+  it "uses 16 bit indices when they fit" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+    mesh_file = described_class.read(path)
+
+    expect(mesh_file.index_type).to eq(Engine::GL::UNSIGNED_SHORT)
+    expect(mesh_file.index_bytes.bytesize).to eq(6)
+  end
+
+  it "falls back to 32 bit indices for large meshes" do
+    large_vertex_data = vertex_data + Array.new(70_000 * 20) { |i| (i / 20).to_f }
+    described_class.write(path, large_vertex_data, [0, 1, 70_000], vertex_stride: 20)
+    mesh_file = described_class.read(path)
+
+    expect(mesh_file.index_type).to eq(Engine::GL::UNSIGNED_INT)
+    expect(mesh_file.index_data).to eq([0, 1, 70_000])
+  end
+
+  it "stores a position-only depth stream" do
+    quad = [
+      [0, 0, 0, 0, 0, *Array.new(15, 0)], [1, 0, 0, 1, 0, *Array.new(15, 0)], [1, 1, 0, 1, 1, *Array.new(15, 0)],
+      [0, 0, 0, 0.5, 0, *Array.new(15, 0)], [1, 1, 0, 0.5, 1, *Array.new(15, 0)], [0, 1, 0, 0, 1, *Array.new(15, 0)]
+    ].flatten.map(&:to_f)
+    described_class.write(path, quad, [0, 1, 2, 3, 4, 5], vertex_stride: 20)
+    mesh_file = described_class.read(path)
+
+    expect(mesh_file.depth_vertex_count).to eq(4)
+    expect(mesh_file.depth_index_count).to eq(6)
+    expect(mesh_file.depth_index_type).to eq(Engine::GL::UNSIGNED_SHORT)
+    expect(mesh_file.depth_vertex_bytes.unpack('e*').each_slice(3).to_a)
+      .to match_array([[0, 0, 0], [1, 0, 0], [1, 1, 0], [0, 1, 0]])
+  end
+
+  it "stores coarser levels as index ranges after the full mesh" do
+    quad = [[0, 0, 0], [1, 0, 0], [1, 1, 0], [0, 1, 0], [0.5, 0.5, 0]].flat_map { |position| position + Array.new(17, 0) }
+    fan = [0, 1, 4, 1, 2, 4, 2, 3, 4, 3, 0, 4]
+    described_class.write_packed(path, quad.pack('e*'), fan.pack('V*'), vertex_stride: 20,
+                                 lods: [[[0, 1, 2, 0, 2, 3].pack('V*'), 0.125]])
+    mesh_file = described_class.read(path)
+
+    expect(mesh_file.lods.map(&:to_a)).to eq([[0, 12, 0, 12, 0], [12, 6, 12, 6, 0.125]])
+    expect(mesh_file.index_data.drop(12)).to eq([0, 1, 2, 0, 2, 3])
+    expect(mesh_file.depth_index_count).to eq(18)
+  end
+
+  it "rejects files that aren't meshes" do
+    File.binwrite(path, "1.0\n" * 20)
+
+    expect { described_class.read(path) }.to raise_error(Engine::MeshFile::FormatError, /not a mesh file/)
+  end
+
+  it "rejects other versions" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+    bytes = File.binread(path)
+    bytes[4, 4] = [1].pack('V')
+    File.binwrite(path, bytes)
+
+    expect { described_class.read(path) }.to raise_error(Engine::MeshFile::FormatError, /version 1, expected 3/)
+  end
+
+  it "rejects truncated files" do
+    described_class.write(path, vertex_data, [0, 1, 2], vertex_stride: 20)
+    File.binwrite(path, File.binread(path)[0...-2])
+
+    expect { described_class.read(path) }.to raise_error(Engine::MeshFile::FormatError, /expected/)
+  end
+
+  describe "loading through Engine::Mesh" do
+    let(:mesh_file) { "binary_mesh_#{SecureRandom.hex(4)}" }
+    let(:base_path) { File.join(GAME_DIR, "_imported", mesh_file) }
+
+    before { FileUtils.mkdir_p(File.dirname(base_path)) }
+
+    after do
+      %w[.mesh .vertex_data .index_data].each { |ext| File.delete(base_path + ext) if File.exist?(base_path + ext) }
+      Engine::Mesh.mesh_cache.delete([mesh_file, :game])
+      Engine::Mesh.binary_cache.delete(base_path + ".mesh")
+    end
+
+    it "prefers the binary file" do
+      described_class.write(base_path + ".mesh", vertex_data, [0, 1, 2], vertex_stride: 20)
+      mesh = Engine::Mesh.for(mesh_file)
+
+      expect(mesh.vertex_bytes).to eq(vertex_data.pack('e*'))
+      expect(mesh.index_type).to eq(Engine::GL::UNSIGNED_SHORT)
+      expect(mesh.index_count).to eq(3)
+      expect(mesh.aabb).to eq([Vector[-1, 0, -1], Vector[1, 2, 0]])
+    end
+
+    it "still reads the legacy text format" do
+      File.write(base_path + ".vertex_data", vertex_data.join("\n"))
+      File.write(base_path + ".index_data", "0\n1\n2\n")
+      mesh = Engine::Mesh.for(mesh_file)
+
+      expect(mesh.vertex_bytes).to eq(vertex_data.pack('F*'))
+      expect(mesh.index_bytes).to eq([0, 1, 2].pack('I*'))
+      expect(mesh.index_type).to eq(Engine::GL::UNSIGNED_INT)
+      expect(mesh.index_count).to eq(3)
+      expect(mesh.depth_vertex_bytes.bytesize).to eq(3 * 12)
+      expect(mesh.depth_index_count).to eq(3)
+    end
+  end
+end
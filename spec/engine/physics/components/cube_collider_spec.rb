@@ -1,5 +1,120 @@
 # frozen_string_literal: true
 
 describe Engine::Physics::Components::CubeCollider do
+  def body(pos, collider, velocity: nil, rotation: Vector[0, 0, 0])
+    components = [collider]
+    components << Engine::Physics::Components::Rigidbody.create(velocity:, gravity: Vector[0, 0, 0]) if velocity
+    Engine::GameObject.create(name: "body", pos:, rotation:, components:)
+  end
 
+  describe '#collision_for' do
+    let(:collider) { described_class.create(size: Vector[2, 2, 2]) }
+    let!(:collider_object) { body(Vector[0, 0, 0], collider, velocity: Vector[1, 0, 0]) }
+
+    context 'when overlapping a static box face on' do
+      let(:other_collider) { described_class.create(size: Vector[2, 2, 2]) }
+      let!(:other_object) { body(Vector[1.5, 0, 0], other_collider) }
+
+      it 'pushes back along the face normal, halfway through the overlap' do
+        collision = collider.collision_for(other_collider)
+
+        expect(collision.impulse).to be_vector(Vector[-2, 0, 0])
+        expect(collision.point).to be_vector(Vector[0.75, 0, 0])
+      end
+    end
+
+    context 'when the boxes are apart' do
+      let(:other_collider) { described_class.create(size: Vector[2, 2, 2]) }
+      let!(:other_object) { body(Vector[2.5, 0, 0], other_collider) }
+
+      it 'returns nil' do
+        expect(collider.collision_for(other_collider)).to be_nil
+      end
+    end
+
+    context 'when a rotated box is inside the bounds but not touching' do
+      let(:other_collider) { described_class.create(size: Vector[2, 2, 2]) }
+      let!(:other_object) { body(Vector[2.5, 0, 0], other_collider, rotation: Vector[0, 45, 0]) }
+
+      it 'returns nil' do
+        expect(collider.collision_for(other_collider)).to be_nil
+      end
+    end
+
+    context 'when a rotated box corner digs into a face' do
+      let(:other_collider) { described_class.create(size: Vector[2, 2, 2]) }
+      let!(:other_object) { body(Vector[2.3, 0, 0], other_collider, rotation: Vector[0, 45, 0]) }
+
+      it 'uses the face normal and the corner edge as the contact' do
+        collision = collider.collision_for(other_collider)
+        depth = 1 + Math.sqrt(2) - 2.3
+
+        expect(collision.impulse).to be_vector(Vector[-2, 0, 0])
+        expect(collision.point).to be_vector(Vector[1 - depth / 2, 0, 0])
+      end
+    end
+
+    context 'when crossed edges meet' do
+      let!(:collider_object) { body(Vector[0, 0, 0], collider, velocity: Vector[1, 0, 0], rotation: Vector[0, 0, 45]) }
+      let(:other_collider) { described_class.create(size: Vector[2, 2, 2]) }
+      let!(:other_object) { body(Vector[2.7, 0, 0], other_collider, rotation: Vector[0, 45, 0]) }
+
+      it 'contacts between the two edges' do
+        collision = collider.collision_for(other_collider)
+
+        expect(collision.impulse).to be_vector(Vector[-2, 0, 0])
+        expect(collision.point).to be_vector(Vector[1.35, 0, 0])
+      end
+    end
+
+    context 'when moving away from the other box' do
+      let!(:collider_object) { body(Vector[0, 0, 0], collider, velocity: Vector[-1, 0, 0]) }
+      let(:other_collider) { described_class.create(size: Vector[2, 2, 2]) }
+      let!(:other_object) { body(Vector[1.5, 0, 0], other_collider) }
+
+      it 'returns nil' do
+        expect(collider.collision_for(other_collider)).to be_nil
+      end
+    end
+
+    context 'when overlapping a sphere' do
+      let(:other_collider) { Engine::Physics::Components::SphereCollider.create(radius: 1) }
+      let!(:other_object) { body(Vector[1.5, 0, 0], other_collider) }
+
+      it 'pushes back from the closest point on the box' do
+        collision = collider.collision_for(other_collider)
+
+        expect(collision.impulse).to be_vector(Vector[-2, 0, 0])
+        expect(collision.point).to be_vector(Vector[0.75, 0, 0])
+      end
+    end
+  end
+
+  describe 'a sphere hitting a box' do
+    let(:box) { described_class.create(size: Vector[2, 2, 2]) }
+    let!(:box_object) { body(Vector[0, 0, 0], box) }
+    let(:sphere) { Engine::Physics::Components::SphereCollider.create(radius: 1) }
+    let!(:sphere_object) { body(Vector[1.5, 0, 0], sphere, velocity: Vector[-1, 0, 0]) }
+
+    it 'bounces the sphere off the face' do
+      collision = sphere.collision_for(box)
+
+      expect(collision.impulse).to be_vector(Vector[2, 0, 0])
+      expect(collision.point).to be_vector(Vector[0.75, 0, 0])
+    end
+  end
+
+  describe '#bounding_radius' do
+    it 'covers the corners' do
+      expect(described_class.create(size: Vector[2, 2, 2]).bounding_radius).to be_within(1e-9).of(Math.sqrt(3))
+    end
+  end
+
+  it 'is picked up by its rigidbody' do
+    collider = described_class.create
+    rigidbody = Engine::Physics::Components::Rigidbody.create(gravity: Vector[0, 0, 0])
+    Engine::GameObject.create(name: "crate", components: [collider, rigidbody])
+
+    expect(rigidbody.colliders).to eq([collider])
+  end
 end
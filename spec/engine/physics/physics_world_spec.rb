@@ -0,0 +1,145 @@
+# frozen_string_literal: true
+
+describe Engine::Physics::PhysicsWorld do
+  let(:velocity) { Vector[1, 0, 0] }
+  let(:gravity) { Vector[0, 0, 0] }
+  let(:rigidbody) { Engine::Physics::Components::Rigidbody.create(velocity:, gravity:) }
+  let!(:body_object) { Engine::GameObject.create(name: "body", components: [rigidbody]) }
+
+  before { described_class.fixed_timestep = 0.25 }
+
+  after do
+    described_class.fixed_timestep = described_class::DEFAULT_TIMESTEP
+    described_class.sub_steps = 1
+    described_class.interpolate = false
+    described_class.max_steps_per_frame = described_class::DEFAULT_MAX_STEPS_PER_FRAME
+  end
+
+  describe ".simulate" do
+    it "takes as many fixed steps as the frame time covers" do
+      expect(described_class.simulate(0.5)).to eq(2)
+      expect(body_object.pos).to be_vector(Vector[0.5, 0, 0])
+    end
+
+    it "banks time that doesn't fill a step" do
+      expect(described_class.simulate(0.125)).to eq(0)
+      expect(body_object.pos).to eq(Vector[0, 0, 0])
+
+      expect(described_class.simulate(0.125)).to eq(1)
+      expect(body_object.pos).to be_vector(Vector[0.25, 0, 0])
+    end
+
+    it "drops time beyond max_steps_per_frame" do
+      described_class.max_steps_per_frame = 2
+
+      expect(described_class.simulate(10)).to eq(2)
+      expect(described_class.accumulator).to be < 0.25
+    end
+
+    it "moves bodies from where they were teleported" do
+      described_class.simulate(0.25)
+      body_object.pos = Vector[10, 0, 0]
+      described_class.simulate(0.25)
+
+      expect(body_object.pos).to be_vector(Vector[10.25, 0, 0])
+    end
+
+    it "leaves stepping to the world once running" do
+      described_class.simulate(0.25)
+      rigidbody.update(0.25)
+
+      expect(body_object.pos).to be_vector(Vector[0.25, 0, 0])
+    end
+
+    context "with gravity" do
+      let(:velocity) { Vector[0, 0, 0] }
+      let(:gravity) { Vector[0, -8, 0] }
+
+      it "gets closer to the exact fall with more sub-steps" do
+        described_class.sub_steps = 4
+        described_class.simulate(0.25)
+
+        # Semi-implicit Euler over n sub-steps falls g * t^2 * (n + 1) / 2n
+        expect(body_object.pos).to be_vector(Vector[0, -8 * 0.0625 * 5 / 8.0, 0])
+        expect(rigidbody.velocity).to be_vector(Vector[0, -2, 0])
+      end
+    end
+
+    context "with angular velocity" do
+      let(:velocity) { Vector[0, 0, 0] }
+
+      it "rotates at the same rate as Rigidbody#update" do
+        rigidbody.angular_velocity = Vector[0, 40, 0]
+        described_class.simulate(0.25)
+
+        expect(body_object.rotation.to_euler).to be_vector(Vector[0, 10, 0])
+      end
+    end
+
+    context "with a sphere dropped onto a box" do
+      before { described_class.fixed_timestep = 1.0 / 60 }
+
+      # Final [position, velocity] after two seconds at frame_rate
+      def drop_sphere(frame_rate)
+        ball = Engine::Physics::Components::Rigidbody.create(coefficient_of_restitution: 0.5)
+        ball_object = Engine::GameObject.create(
+          pos: Vector[0, 2, 0],
+          components: [ball, Engine::Physics::Components::SphereCollider.create(radius: 0.5)]
+        )
+        box_object = Engine::GameObject.create(
+          components: [Engine::Physics::Components::CubeCollider.create(size: Vector[4, 1, 4])]
+        )
+
+        (frame_rate * 2).times { described_class.simulate(1.0 / frame_rate) }
+        result = [ball_object.pos, ball.velocity]
+
+        [ball_object, box_object].each(&:destroy!)
+        described_class.reset
+        result
+      end
+
+      it "ends the same at 30 and 60 fps" do
+        at_60 = drop_sphere(60)
+
+        expect(at_60[0][1]).to be > 0
+        expect(drop_sphere(30)).to eq(at_60)
+      end
+
+      it "ends the same at 30 and 60 fps when interpolating" do
+        described_class.interpolate = true
+
+        expect(drop_sphere(30)).to eq(drop_sphere(60))
+      end
+    end
+
+    context "with interpolation" do
+      before { described_class.interpolate = true }
+
+      it "blends transforms between the last two steps" do
+        described_class.simulate(0.25)
+        described_class.simulate(0.125)
+
+        # Halfway between the steps at 0 and 0.25
+        expect(body_object.pos).to be_vector(Vector[0.125, 0, 0])
+      end
+
+      it "steps from the simulated position, not the blended one" do
+        described_class.simulate(0.375)
+        described_class.simulate(0.125)
+
+        # Steps at 0.25 and 0.5, with no time left to blend forward
+        expect(body_object.pos).to be_vector(Vector[0.25, 0, 0])
+      end
+    end
+  end
+
+  describe ".reset" do
+    it "stops the world and clears banked time" do
+      described_class.simulate(0.125)
+      described_class.reset
+
+      expect(described_class.running?).to be(false)
+      expect(described_class.accumulator).to eq(0)
+    end
+  end
+end
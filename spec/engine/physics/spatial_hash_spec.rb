@@ -0,0 +1,85 @@
+# frozen_string_literal: true
+
+describe Engine::Physics::SpatialHash do
+  let(:collider_class) { Struct.new(:center, :bounding_radius) }
+  let(:hash) { described_class.new(2.0) }
+
+  def collider(x, y = 0, z = 0, radius: 0.5)
+    collider_class.new(Vector[x, y, z], radius).tap { |c| hash.update(c) }
+  end
+
+  it "pairs colliders that share a cell" do
+    a = collider(0.2)
+    b = collider(1.0)
+
+    expect(hash.candidates(a)).to eq([b])
+    expect(hash.candidates(b)).to eq([a])
+  end
+
+  it "skips colliders in distant cells" do
+    a = collider(0)
+    collider(50)
+
+    expect(hash.candidates(a)).to be_empty
+  end
+
+  it "pairs colliders whose boxes straddle a cell boundary once" do
+    a = collider(1.9, radius: 1.5)
+    b = collider(2.1, radius: 1.5)
+
+    expect(hash.candidates(a)).to eq([b])
+  end
+
+  it "works across negative coordinates" do
+    a = collider(-1.0)
+    b = collider(-1.9)
+    collider(-30)
+
+    expect(hash.candidates(a)).to eq([b])
+  end
+
+  it "re-buckets colliders that moved" do
+    a = collider(0)
+    b = collider(50)
+
+    b.center = Vector[0.5, 0, 0]
+    hash.update(b)
+
+    expect(hash.candidates(a)).to eq([b])
+  end
+
+  it "pairs oversized colliders with everything" do
+    ground = collider(0, radius: 1000)
+    a = collider(400)
+
+    expect(hash.candidates(a)).to eq([ground])
+    expect(hash.candidates(ground)).to eq([a])
+  end
+
+  it "forgets removed colliders" do
+    a = collider(0)
+    b = collider(0.5)
+
+    hash.remove(b)
+
+    expect(hash.candidates(a)).to be_empty
+    expect(hash.size).to eq(1)
+  end
+
+  it "finds every overlapping pair of a seeded scene while checking far fewer than n squared" do
+    random = Random.new(7)
+    colliders = Array.new(500) do
+      collider(random.rand(-24.0..24.0), random.rand(-24.0..24.0), random.rand(-24.0..24.0), radius: random.rand(0.2..1.0))
+    end
+
+    candidate_pairs = colliders.flat_map { |c| hash.candidates(c).map { |other| [c.object_id, other.object_id] } }
+    overlapping_pairs = colliders.combination(2).select do |a, b|
+      (a.center - b.center).norm < a.bounding_radius + b.bounding_radius
+    end
+    overlapping_pairs = overlapping_pairs.flat_map { |a, b| [[a.object_id, b.object_id], [b.object_id, a.object_id]] }
+
+    expect(overlapping_pairs).not_to be_empty
+    expect(overlapping_pairs - candidate_pairs).to be_empty
+    expect(candidate_pairs.length).to be < colliders.length**2 / 100
+  end
+end
@@ -0,0 +1,94 @@
+# frozen_string_literal: true
+
+describe Rendering::Culling do
+  include Engine::MatrixHelpers
+
+  # Row-major float32 model matrices in the engine's row-vector convention
+  def packed_matrices(positions, scale: 1)
+    positions.map do |x, y, z|
+      [scale, 0, 0, 0, 0, scale, 0, 0, 0, 0, scale, 0, x, y, z, 1]
+    end.flatten.pack('F*')
+  end
+
+  def cull(positions, planes, radius: 1, scale: 1)
+    out = String.new(encoding: Encoding::BINARY)
+    visible = CullingNative.cull_spheres(packed_matrices(positions, scale: scale), positions.length, 0, 0, 0, radius, planes, out)
+    [visible, out.unpack('F*').each_slice(16).map { |m| m[12] }]
+  end
+
+  # Looking down -z from the origin, visible z from -1 to -100, x and y within +/-10
+  let(:view_projection) { ortho(-10.0, 10.0, -10.0, 10.0, 1.0, 100.0).transpose }
+
+  describe ".frustum_planes" do
+    it "keeps instances inside the frustum in their original order" do
+      planes = described_class.frustum_planes(view_projection)
+
+      visible, xs = cull([[0, 0, -50], [30, 0, -50], [5, 0, -10], [0, 0, 50]], planes)
+
+      expect(visible).to eq(2)
+      expect(xs).to eq([0, 5])
+    end
+
+    it "keeps instances whose sphere only overlaps a plane" do
+      planes = described_class.frustum_planes(view_projection)
+
+      expect(cull([[10.5, 0, -50]], planes).first).to eq(1)
+      expect(cull([[11.5, 0, -50]], planes).first).to eq(0)
+    end
+
+    it "scales the radius with the instance" do
+      planes = described_class.frustum_planes(view_projection)
+
+      expect(cull([[14, 0, -50]], planes, scale: 5).first).to eq(1)
+    end
+  end
+
+  describe ".box_planes" do
+    it "culls everything outside the box around a point" do
+      planes = described_class.box_planes(Vector[100, 0, 0], 10)
+
+      visible, xs = cull([[95, 0, 0], [0, 0, 0], [100, 10.5, 0]], planes)
+
+      expect(visible).to eq(2)
+      expect(xs).to eq([95, 100])
+    end
+  end
+
+  describe "CullingNative.cull_spheres" do
+    it "rejects more instances than the data holds" do
+      expect {
+        CullingNative.cull_spheres(packed_matrices([[0, 0, 0]]), 2, 0, 0, 0, 1, "", String.new)
+      }.to raise_error(ArgumentError)
+    end
+
+    it "culls 50k instances in well under a millisecond" do
+      positions = Array.new(50_000) { |i| [(i % 200) - 100, 0, -(i / 200) - 1] }
+      matrices = packed_matrices(positions)
+      planes = described_class.frustum_planes(view_projection)
+      out = String.new(encoding: Encoding::BINARY)
+
+      CullingNative.cull_spheres(matrices, positions.length, 0, 0, 0, 1, planes, out)
+      best = Array.new(10) do
+        start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        CullingNative.cull_spheres(matrices, positions.length, 0, 0, 0, 1, planes, out)
+        Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+      end.min
+
+      expect(best).to be < 0.001
+    end
+  end
+
+  describe ".record" do
+    it "only counts while the GPU timer is enabled" do
+      described_class.reset_stats
+      allow(Rendering::GpuTimer).to receive(:enabled?).and_return(false)
+      described_class.record(:main_3d, 1, 2)
+      expect(described_class.stats).to be_empty
+
+      allow(Rendering::GpuTimer).to receive(:enabled?).and_return(true)
+      described_class.record(:main_3d, 1, 2)
+      described_class.record(:main_3d, 3, 4)
+      expect(described_class.stats).to eq(main_3d: { visible: 4, total: 6 })
+    end
+  end
+end
@@ -0,0 +1,56 @@
+# frozen_string_literal: true
+
+describe Rendering::FrameUniformBuffer do
+  let(:buffer) { described_class.new }
+  let(:camera) { double("camera", matrix: Matrix.identity(4), game_object: double("camera object", pos: Vector[1, 2, 3])) }
+
+  before do
+    %i[GenBuffers BindBuffer BufferData BindBufferBase].each do |name|
+      allow(Engine::GL).to receive(name)
+    end
+  end
+
+  def floats_at(data, offset, count)
+    data.unpack("F#{count}", offset: offset)
+  end
+
+  it "matches the std140 size of the FrameUniforms block" do
+    expect(buffer.pack(camera).bytesize).to eq(described_class::SIZE)
+    expect(described_class::SIZE).to eq(2448)
+  end
+
+  it "packs the camera ahead of the lights" do
+    data = buffer.pack(camera)
+
+    expect(floats_at(data, 0, 16)).to eq(Matrix.identity(4).to_a.flatten)
+    expect(floats_at(data, 64, 3)).to eq([1, 2, 3])
+  end
+
+  it "packs point lights at their std140 offsets" do
+    light = Engine::Components::PointLight.create(range: 10, colour: [0.5, 0.25, 1.0])
+    Engine::GameObject.create(pos: Vector[4, 5, 6], components: [light])
+
+    data = buffer.pack(camera)
+    offset = described_class::HEADER_SIZE
+
+    expect(floats_at(data, offset, 4)).to eq([4, 5, 6, 100])
+    expect(floats_at(data, offset + 16, 3)).to eq([0.5, 0.25, 1.0])
+    expect(data.unpack1('l', offset: offset + 28)).to eq(0)
+    expect(floats_at(data, offset + described_class::POINT_LIGHT_SIZE, 4)).to eq([0, 0, 0, 0])
+  end
+
+  it "packs spot lights after the point and directional arrays" do
+    light = Engine::Components::SpotLight.create(range: 2, colour: [1.0, 0.0, 0.0])
+    Engine::GameObject.create(pos: Vector[7, 8, 9], components: [light])
+
+    data = buffer.pack(camera)
+    offset = described_class::HEADER_SIZE +
+             described_class::MAX_POINT_LIGHTS * described_class::POINT_LIGHT_SIZE +
+             described_class::MAX_DIRECTION_LIGHTS * described_class::DIRECTION_LIGHT_SIZE
+
+    expect(floats_at(data, offset, 3)).to eq([7, 8, 9])
+    expect(floats_at(data, offset + 28, 1)).to eq([4])
+    expect(floats_at(data, offset + 32, 3)).to eq([1, 0, 0])
+    expect(floats_at(data, offset + 44, 2).map { |f| f.round(5) }).to eq([light.inner_cutoff, light.outer_cutoff].map { |f| f.round(5) })
+  end
+end
@@ -0,0 +1,86 @@
+# frozen_string_literal: true
+
+require "tmpdir"
+
+describe Rendering::GpuTimer do
+  # Fake GPU clock: every timestamp query lands 1ms after the previous one
+  let(:gpu) { { clock: 0, next_query: 0, results: {}, available: false } }
+
+  before do
+    allow(Engine::GL).to receive(:GenQueries) { |_, buf| buf.replace([gpu[:next_query] += 1].pack('L')) }
+    allow(Engine::GL).to receive(:QueryCounter) { |query, _| gpu[:results][query] = gpu[:clock] += 1_000_000 }
+    allow(Engine::GL).to receive(:GetInteger64v) { |_, buf| buf.replace([gpu[:clock]].pack('q')) }
+    allow(Engine::GL).to receive(:GetQueryObjectui64v) do |query, pname, buf|
+      value = pname == Engine::GL::QUERY_RESULT_AVAILABLE ? (gpu[:available] ? 1 : 0) : gpu[:results].fetch(query)
+      buf.replace([value].pack('Q'))
+    end
+    described_class.enable(report: false)
+  end
+
+  after { described_class.disable }
+
+  def draw_frame
+    described_class.measure(:main_3d) do
+      described_class.measure(:shadows) { :drawn }
+    end
+    described_class.end_frame
+  end
+
+  it "doesn't read results until the queries are available" do
+    draw_frame
+    draw_frame
+
+    expect(Engine::GL).not_to have_received(:GetQueryObjectui64v).with(anything, Engine::GL::QUERY_RESULT, anything)
+    expect(described_class.trace_events).to be_empty
+
+    gpu[:available] = true
+    described_class.end_frame
+    expect(described_class.trace_events.map(&:frame).uniq).to eq([1, 2])
+  end
+
+  it "records nested scopes on both tracks" do
+    gpu[:available] = true
+    result = described_class.measure(:outer) { described_class.measure(:inner) { 42 } }
+    described_class.end_frame
+
+    expect(result).to eq(42)
+    events = described_class.trace_events
+    expect(events.map { |event| [event.name, event.track, event.depth] }).to eq(
+      [[:outer, :cpu, 0], [:outer, :gpu, 0], [:inner, :cpu, 1], [:inner, :gpu, 1]]
+    )
+    expect(events.select { |event| event.track == :gpu }.map(&:duration_ns)).to eq([3_000_000, 1_000_000])
+  end
+
+  it "drops frames that stay pending and reuses their queries" do
+    (described_class::MAX_PENDING_FRAMES + 2).times { draw_frame }
+    expect(described_class.dropped_frames).to eq(2)
+
+    queries = gpu[:next_query]
+    draw_frame
+    expect(gpu[:next_query]).to eq(queries)
+  end
+
+  it "keeps only the newest events" do
+    stub_const("#{described_class}::TRACE_CAPACITY", 4)
+    described_class.enable(report: false)
+    gpu[:available] = true
+    3.times { draw_frame }
+
+    expect(described_class.trace_events.map(&:frame)).to eq([3, 3, 3, 3])
+  end
+
+  it "exports Chrome trace JSON" do
+    gpu[:available] = true
+    draw_frame
+
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, "trace.json")
+      described_class.export_trace(path)
+      events = JSON.parse(File.read(path))["traceEvents"]
+
+      expect(events.select { |event| event["ph"] == "M" }.map { |event| event["args"]["name"] }).to eq(%w[CPU GPU])
+      gpu_event = events.find { |event| event["cat"] == "gpu" && event["name"] == "main_3d" }
+      expect(gpu_event).to include("ph" => "X", "tid" => 2, "dur" => 3000.0, "args" => { "frame" => 1 })
+    end
+  end
+end
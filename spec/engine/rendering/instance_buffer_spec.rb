@@ -0,0 +1,52 @@
+# frozen_string_literal: true
+
+describe Rendering::InstanceBuffer do
+  let(:buffer) { described_class.new }
+  let(:fence_status) { Engine::GL::ALREADY_SIGNALED }
+  let(:writes) { [] }
+
+  before do
+    %i[BindBuffer BufferStorage DeleteSync DeleteBuffers].each do |name|
+      allow(Engine::GL).to receive(name)
+    end
+    buffer_ids = (1..).each
+    allow(Engine::GL).to receive(:GenBuffers) { |_, buf| buf.replace([buffer_ids.next].pack('L')) }
+    allow(Engine::GL).to receive(:BufferStorageSupported).and_return(true)
+    allow(Engine::GL).to receive(:MapBufferRange).and_return(1)
+    allow(Engine::GL).to receive(:FenceSync).and_return(1)
+    allow(Engine::GL).to receive(:ClientWaitSync) { fence_status }
+    allow(Engine::GL).to receive(:WriteMappedBuffer) { |_, offset, _, _, length| writes << [offset, length] }
+  end
+
+  def upload_frames(count)
+    count.times do
+      buffer.data << "x" * 16
+      buffer.mark_dirty(buffer.data.bytesize - 16, 16)
+      buffer.upload
+    end
+  end
+
+  it "writes each frame into the next region of the ring" do
+    upload_frames(4)
+
+    capacity = described_class::MIN_CAPACITY
+    expect(buffer.buffer).to eq(2)
+    expect(writes).to eq([[capacity, 16], [2 * capacity, 32], [0, 48], [capacity + 16, 48]])
+  end
+
+  { "times out" => Engine::GL::TIMEOUT_EXPIRED, "fails" => Engine::GL::WAIT_FAILED }.each do |outcome, status|
+    context "when the wait for a region #{outcome}" do
+      let(:fence_status) { status }
+
+      it "orphans the buffer instead of writing into the busy region" do
+        upload_frames(3)
+
+        # The third frame wraps back to region 0, still fenced by the first
+        expect(Engine::GL).to have_received(:DeleteBuffers).with(1, [2].pack('L'))
+        expect(buffer.buffer).to eq(3)
+        expect(buffer.offset).to eq(0)
+        expect(writes.last).to eq([0, 48])
+      end
+    end
+  end
+end
@@ -0,0 +1,168 @@
+# frozen_string_literal: true
+
+describe Rendering::InstanceRenderer do
+  let(:lods) do
+    [Engine::MeshFile::Lod.new(0, 36, 0, 36, 0.0), Engine::MeshFile::Lod.new(36, 12, 36, 12, 0.1)]
+  end
+  let(:mesh) do
+    double("mesh", vertex_bytes: "", index_bytes: "", depth_vertex_bytes: "", depth_index_bytes: "", lods: lods,
+                   bounding_sphere: [Vector[0, 0, 0], 1], index_type: Engine::MeshFile::UNSIGNED_SHORT,
+                   depth_index_type: Engine::MeshFile::UNSIGNED_SHORT)
+  end
+  let(:material) { double("material") }
+  let(:renderer) { described_class.new(mesh, material) }
+
+  before do
+    %i[GenVertexArrays BindVertexArray GenBuffers BindBuffer BufferData
+       VertexAttribPointer EnableVertexAttribArray VertexAttribDivisor].each do |name|
+      allow(Engine::GL).to receive(name)
+    end
+    allow(Engine::GL).to receive(:BufferStorageSupported).and_return(false)
+  end
+
+  def mesh_renderer(x)
+    Engine::Components::MeshRenderer.create(mesh: mesh, material: material).tap do |mesh_renderer|
+      mesh_renderer.set_game_object(Engine::GameObject.create(pos: Vector[x, 0, 0]))
+    end
+  end
+
+  def packed_x(index)
+    renderer.instance_variable_get(:@packed_data).unpack1('F', offset: index * described_class::BYTES_PER_MATRIX + 12 * 4)
+  end
+
+  def packed_index(mesh_renderer)
+    renderer.instance_variable_get(:@instance_indices)[mesh_renderer.instance_handle]
+  end
+
+  describe "#remove_instance" do
+    it "moves the last instance into the freed index" do
+      a, b, c = mesh_renderer(1), mesh_renderer(2), mesh_renderer(3)
+      [a, b, c].each { |mesh_renderer| renderer.add_instance(mesh_renderer) }
+
+      renderer.remove_instance(a)
+
+      expect(renderer.instance_count).to eq(2)
+      expect(a.instance_handle).to be_nil
+      expect(packed_x(packed_index(c))).to eq(3)
+      expect(packed_x(packed_index(b))).to eq(2)
+    end
+
+    it "reuses freed handles" do
+      a, b = mesh_renderer(1), mesh_renderer(2)
+      renderer.add_instance(a)
+      renderer.add_instance(b)
+      handle = a.instance_handle
+
+      renderer.remove_instance(a)
+      renderer.add_instance(c = mesh_renderer(3))
+
+      expect(c.instance_handle).to eq(handle)
+    end
+  end
+
+  describe "LOD levels" do
+    # Camera at the origin looking down -z, 100 pixels per unit at distance 1
+    let(:view) { [0, 0, 0, 100, 1].pack('F5') }
+    let(:planes) { Rendering::Culling.box_planes(Vector[0, 0, 0], 1000) }
+
+    # Records the draws instead of issuing them
+    let(:commands) do
+      Class.new do
+        attr_reader :draws
+
+        def initialize = @draws = []
+        def BindVertexArray(*) = nil
+        def BindBuffer(*) = nil
+        def DrawElementsInstanced(_mode, count, _type, offset, instances) = @draws << [count, offset, instances]
+      end.new
+    end
+
+    before do
+      Rendering::Lod.hysteresis = 0
+      Rendering::Lod.pixel_error = 1
+    end
+
+    after do
+      Rendering::Lod.hysteresis = nil
+      Rendering::Lod.pixel_error = nil
+    end
+
+    it "keeps each instance's level with it when another is removed" do
+      a, b, c = mesh_renderer(1), mesh_renderer(2), mesh_renderer(50)
+      [a, b, c].each { |mesh_renderer| renderer.add_instance(mesh_renderer) }
+      renderer.select_lods(view)
+      expect(renderer.lod_levels).to eq([0, 0, 1])
+
+      renderer.remove_instance(a)
+
+      expect(renderer.lod_levels).to eq([1, 0])
+    end
+
+    it "draws each level's visible instances with that level's index range" do
+      [1, 2, 50].each { |x| renderer.add_instance(mesh_renderer(x)) }
+      renderer.select_lods(view)
+      renderer.cull(planes)
+
+      renderer.record_culled_draw(commands)
+
+      expect(commands.draws).to eq([[36, 0, 2], [12, 72, 1]])
+    end
+
+    it "draws shadows a level coarser with the shadow bias" do
+      [1, 2].each { |x| renderer.add_instance(mesh_renderer(x)) }
+      renderer.select_lods(view)
+      renderer.cull(planes, 1)
+
+      renderer.record_culled_depth_draw(commands)
+
+      expect(commands.draws).to eq([[12, 72, 2]])
+    end
+  end
+
+  describe "#update_instance" do
+    it "writes to the moved instance after a removal" do
+      a, b = mesh_renderer(1), mesh_renderer(2)
+      renderer.add_instance(a)
+      renderer.add_instance(b)
+      renderer.remove_instance(a)
+
+      b.game_object.pos = Vector[7, 0, 0]
+      renderer.update_instance(b)
+
+      expect(packed_x(packed_index(b))).to eq(7)
+    end
+  end
+
+  it "removes by moving only the last instance and dirtying one range" do
+    instances = Array.new(100) { |i| mesh_renderer(i) }
+    instances.each { |mesh_renderer| renderer.add_instance(mesh_renderer) }
+    removed = instances[10]
+    indices = instances.to_h { |mesh_renderer| [mesh_renderer, packed_index(mesh_renderer)] }
+    instance_buffer = renderer.instance_variable_get(:@instance_buffer)
+    allow(instance_buffer).to receive(:mark_dirty).and_call_original
+
+    renderer.remove_instance(removed)
+
+    moved = (instances - [removed]).reject { |mesh_renderer| packed_index(mesh_renderer) == indices[mesh_renderer] }
+    expect(moved).to eq([instances.last])
+    expect(packed_index(instances.last)).to eq(10)
+    expect(packed_x(10)).to eq(99)
+    expect(instance_buffer).to have_received(:mark_dirty).once
+      .with(10 * described_class::BYTES_PER_MATRIX, described_class::BYTES_PER_MATRIX)
+  end
+
+  it "appends re-added instances without shifting the others" do
+    instances = Array.new(100) { |i| mesh_renderer(i) }
+    instances.each { |mesh_renderer| renderer.add_instance(mesh_renderer) }
+    re_added = instances[10]
+    renderer.remove_instance(re_added)
+    others = instances - [re_added]
+    indices = others.to_h { |mesh_renderer| [mesh_renderer, packed_index(mesh_renderer)] }
+
+    renderer.add_instance(re_added)
+
+    expect(packed_index(re_added)).to eq(99)
+    expect(others.all? { |mesh_renderer| packed_index(mesh_renderer) == indices[mesh_renderer] }).to eq(true)
+    expect(instances.each_with_index.all? { |mesh_renderer, i| packed_x(packed_index(mesh_renderer)) == i }).to eq(true)
+  end
+end
@@ -0,0 +1,72 @@
+# frozen_string_literal: true
+
+describe Rendering::Lod do
+  def packed_matrices(positions)
+    positions.map { |x, y, z| [1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1] }.flatten.pack('F*')
+  end
+
+  # Camera at the origin where one world unit at distance 1 covers 100 pixels
+  let(:view) { [0, 0, 0, 100, 1].pack('F5') }
+  # Levels lose 0%, 1% and 4% of the radius
+  let(:lod_errors) { [0, 0.01, 0.04].pack('F*') }
+
+  # Updates the current levels in place, like InstanceRenderer#lod_levels
+  def select(distances, current = [0] * distances.length, hysteresis: 0)
+    positions = distances.map { |distance| [0, 0, -distance] }
+    levels = current.pack('C*')
+    CullingNative.select_lods(packed_matrices(positions), positions.length, 0, 0, 0, 1,
+                              view, lod_errors, 1.0, hysteresis, levels)
+    levels.bytes
+  end
+
+  describe "CullingNative.select_lods" do
+    it "takes the coarsest level whose error covers under a pixel" do
+      # 1% of a 100 pixel radius is one pixel at distance 1; 4% needs distance 4
+      expect(select([0.5, 2, 8])).to eq([0, 1, 2])
+    end
+
+    it "keeps full detail with the camera inside the bounds" do
+      expect(select([0.5], [2])).to eq([0])
+    end
+
+    it "only switches coarser past the hysteresis band" do
+      expect(select([1.1, 1.5], hysteresis: 0.25)).to eq([0, 1])
+    end
+
+    it "keeps a coarser level until it is actually too coarse" do
+      expect(select([1.1, 0.9], [1, 1], hysteresis: 0.25)).to eq([1, 0])
+    end
+  end
+
+  describe "CullingNative.cull_spheres with levels" do
+    let(:planes) { Rendering::Culling.box_planes(Vector[0, 0, 0], 100) }
+    let(:outs) { Array.new(3) { String.new(encoding: Encoding::BINARY) } }
+
+    def xs(out)
+      out.unpack('F*').each_slice(16).map { |m| m[12] }
+    end
+
+    it "splits the visible instances by level" do
+      matrices = packed_matrices([[1, 0, 0], [2, 0, 0], [500, 0, 0], [3, 0, 0]])
+      visible = CullingNative.cull_spheres(matrices, 4, 0, 0, 0, 1, planes, outs, "\0\2\0\1")
+
+      expect(visible).to eq(3)
+      expect(outs.map { |out| xs(out) }).to eq([[1], [3], [2]])
+    end
+
+    it "biases levels coarser, clamped to the last" do
+      matrices = packed_matrices([[1, 0, 0], [2, 0, 0], [3, 0, 0]])
+      CullingNative.cull_spheres(matrices, 3, 0, 0, 0, 1, planes, outs, "\0\1\2", 1)
+
+      expect(outs.map { |out| xs(out) }).to eq([[], [1], [2, 3]])
+    end
+  end
+
+  describe ".view" do
+    it "packs the camera position and scale" do
+      camera = double("camera", position: Vector[1, 2, 3], screen_scale: 540.0, perspective?: true)
+
+      expect(described_class.view(camera).unpack('F5')).to eq([1, 2, 3, 540, 1])
+    end
+  end
+end
@@ -0,0 +1,106 @@
+# frozen_string_literal: true
+
+describe Rendering::ShadowCache do
+  describe "#stale?" do
+    it "is only stale when the signature changes" do
+      cache = described_class.new
+
+      expect(cache.stale?(:layer, [1, 2])).to be true
+      expect(cache.stale?(:layer, [1, 2])).to be false
+      expect(cache.stale?(:layer, [1, 3])).to be true
+    end
+
+    it "forgets every layer when the static split is toggled" do
+      cache = described_class.new
+      cache.stale?(:layer, [1])
+
+      cache.split_static = true
+
+      expect(cache.stale?(:layer, [1])).to be true
+    end
+  end
+
+  describe "Rendering::RenderPipeline.render_cached_shadow" do
+    let(:pipeline) { Rendering::RenderPipeline }
+    let(:shadow_map_array_class) do
+      Class.new do
+        attr_reader :copies
+
+        def initialize
+          @copies = []
+        end
+
+        def static_cache
+          :static_cache
+        end
+
+        def copy_layer_from(source, layer_index)
+          @copies << [source, layer_index]
+        end
+      end
+    end
+    let(:shadow_map_array) { shadow_map_array_class.new }
+    let(:static_batch) { caster(static: true) }
+    let(:dynamic_batch) { caster(static: false) }
+    let(:planes) { "" }
+
+    def caster(static:)
+      double("instance renderer", static: static, cull: 1, instance_count: 1, visible_signature: 1, record_culled_depth_draw: nil)
+    end
+
+    def render(light_state = [:light])
+      targets = []
+      pipeline.render_cached_shadow(shadow_map_array, 0, light_state, planes) { |target, clear| targets << [target, clear] }
+      targets
+    end
+
+    before do
+      pipeline.instance_variable_set(:@shadow_cache, nil)
+      allow(pipeline).to receive(:instance_renderers).and_return({ static: static_batch, dynamic: dynamic_batch })
+    end
+
+    after do
+      pipeline.instance_variable_set(:@shadow_cache, nil)
+    end
+
+    it "skips a layer when neither the light nor its casters changed" do
+      expect(render.length).to eq(1)
+      expect(render).to be_empty
+    end
+
+    it "re-renders when a visible caster moves" do
+      render
+      allow(dynamic_batch).to receive(:visible_signature).and_return(2)
+
+      expect(render).to eq([[shadow_map_array, true]])
+    end
+
+    it "re-renders when the light changes" do
+      render
+
+      expect(render([:moved_light]).length).to eq(1)
+    end
+
+    it "ignores casters that are culled away" do
+      render
+      allow(dynamic_batch).to receive(:cull).and_return(0)
+      render
+      allow(dynamic_batch).to receive(:visible_signature).and_return(3)
+
+      expect(render).to be_empty
+    end
+
+    context "with split_static" do
+      before { pipeline.split_static_shadows = true }
+
+      it "keeps static depth cached and composites dynamic casters over it" do
+        expect(render).to eq([[:static_cache, true], [shadow_map_array, false]])
+
+        allow(dynamic_batch).to receive(:visible_signature).and_return(2)
+
+        expect(render).to eq([[shadow_map_array, false]])
+        expect(shadow_map_array.copies).to eq([[:static_cache, 0], [:static_cache, 0]])
+      end
+    end
+  end
+end
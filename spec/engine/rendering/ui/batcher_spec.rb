@@ -0,0 +1,44 @@
+# frozen_string_literal: true
+
+describe Rendering::UI::Batcher do
+  let(:sprites) { double("sprites", draw_range: nil) }
+  let(:text) { double("text", draw_range: nil) }
+
+  after { described_class.flush }
+
+  it "merges consecutive ranges of the same batch into one draw" do
+    described_class.queue(sprites, 0, 1)
+    described_class.queue(sprites, 1, 1)
+    described_class.queue(sprites, 2, 3)
+    described_class.flush
+
+    expect(sprites).to have_received(:draw_range).once.with(0, 5)
+  end
+
+  it "draws the pending range before another batch's" do
+    described_class.queue(sprites, 0, 2)
+    described_class.queue(text, 0, 4)
+    described_class.queue(sprites, 2, 1)
+    described_class.flush
+
+    expect(sprites).to have_received(:draw_range).with(0, 2).ordered
+    expect(text).to have_received(:draw_range).with(0, 4).ordered
+    expect(sprites).to have_received(:draw_range).with(2, 1).ordered
+  end
+
+  it "does not merge ranges with a gap" do
+    described_class.queue(sprites, 0, 1)
+    described_class.queue(sprites, 3, 1)
+    described_class.flush
+
+    expect(sprites).to have_received(:draw_range).with(0, 1)
+    expect(sprites).to have_received(:draw_range).with(3, 1)
+  end
+
+  it "ignores empty ranges" do
+    described_class.queue(sprites, 0, 0)
+    described_class.flush
+
+    expect(sprites).not_to have_received(:draw_range)
+  end
+end
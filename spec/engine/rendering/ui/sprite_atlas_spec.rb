@@ -0,0 +1,34 @@
+# frozen_string_literal: true
+
+describe Rendering::UI::SpriteAtlas do
+  let(:atlas) { described_class.new(16) }
+
+  describe "#allocate" do
+    it "packs images along a shelf with padding" do
+      expect(atlas.allocate(6, 6)).to eq([2, 2])
+      expect(atlas.allocate(6, 4)).to eq([10, 2])
+    end
+
+    it "starts a new shelf above the tallest image when a row is full" do
+      atlas.allocate(6, 6)
+      atlas.allocate(6, 4)
+
+      expect(atlas.allocate(4, 4)).to eq([2, 10])
+    end
+
+    it "returns nil for images that no longer fit" do
+      atlas.allocate(6, 6)
+
+      expect(atlas.allocate(20, 1)).to be_nil
+      expect(atlas.allocate(12, 8)).to be_nil
+    end
+  end
+
+  describe "#region_for" do
+    it "leaves runtime textures other than white out of the atlas" do
+      allow(Engine::Material).to receive(:default_white_texture).and_return(1)
+
+      expect(atlas.region_for(42)).to be_nil
+    end
+  end
+end
@@ -0,0 +1,103 @@
+# frozen_string_literal: true
+
+require "timeout"
+require "tmpdir"
+
+describe Engine::Screenshoter do
+  let(:dir) { Dir.mktmpdir }
+  # one row, so flipping leaves the order alone
+  let(:pixels) { [10, 20, 30, 0, 40, 50, 60, 128].pack('C*') }
+  let(:fence_status) { [Engine::GL::TIMEOUT_EXPIRED] }
+
+  before do
+    %i[GenBuffers BindBuffer BufferData ReadPixels DeleteSync DeleteBuffers UnmapBuffer].each do |name|
+      allow(Engine::GL).to receive(name)
+    end
+    allow(Engine::GL).to receive(:FenceSync).and_return(1)
+    allow(Engine::GL).to receive(:MapBufferRange).and_return(1)
+    allow(Engine::GL).to receive(:ReadMappedBuffer) { pixels }
+    allow(Engine::GL).to receive(:ClientWaitSync) { |_, _, timeout| timeout > 0 ? Engine::GL::CONDITION_SATISFIED : fence_status.first }
+    allow(Engine::Window).to receive(:framebuffer_width).and_return(2)
+    allow(Engine::Window).to receive(:framebuffer_height).and_return(1)
+  end
+
+  after do
+    described_class.reset
+    FileUtils.remove_entry(dir)
+  end
+
+  def update_until(timeout: 5)
+    Timeout.timeout(timeout) do
+      until yield
+        described_class.update(0)
+        sleep 0.001
+      end
+    end
+  end
+
+  it "reads into a pixel buffer and runs the block once the fence signals" do
+    images = []
+    described_class.screenshot { |image| images << image }
+    described_class.update(0)
+
+    expect(Engine::GL).to have_received(:ReadPixels).with(0, 0, 2, 1, Engine::GL::RGBA, Engine::GL::UNSIGNED_BYTE, 0)
+    expect(described_class.scheduled_screenshot).to be(false)
+    described_class.update(0)
+    expect(images).to be_empty
+
+    fence_status[0] = Engine::GL::ALREADY_SIGNALED
+    update_until { images.any? }
+    expect(images.first.pixels).to eq([ChunkyPNG::Color.rgb(10, 20, 30), ChunkyPNG::Color.rgb(40, 50, 60)])
+  end
+
+  it "waits for reads in flight on finish" do
+    images = []
+    described_class.screenshot { |image| images << image }
+    described_class.update(0)
+    described_class.finish
+
+    expect(images.map(&:width)).to eq([2])
+    expect(Engine::GL).to have_received(:ClientWaitSync).with(1, anything, Rendering::FrameReadback::FENCE_TIMEOUT_NS)
+  end
+
+  it "records PNG frames at the interval" do
+    fence_status[0] = Engine::GL::ALREADY_SIGNALED
+    described_class.record(dir, interval: 0.5)
+    4.times { described_class.update(0.25) }
+    described_class.finish
+
+    frames = Dir.children(dir).sort
+    expect(frames).to eq(%w[frame_000001.png frame_000002.png frame_000003.png])
+    expect(ChunkyPNG::Image.from_file(File.join(dir, frames.first)).pixels.last).to eq(ChunkyPNG::Color.rgb(40, 50, 60))
+  end
+
+  it "records raw frames as top-down opaque RGBA" do
+    described_class.record(dir, interval: 0, format: :raw)
+    described_class.update(0)
+    described_class.stop_recording
+    described_class.finish
+
+    expect(File.binread(File.join(dir, "frame_000001_2x1.rgba")).unpack('C*')).to eq([10, 20, 30, 255, 40, 50, 60, 255])
+  end
+
+  it "drops recorded frames while every pixel buffer is in flight" do
+    described_class.record(dir, interval: 0, format: :raw)
+    (Rendering::FrameReadback::RING_SIZE + 2).times { described_class.update(0) }
+
+    expect(described_class.dropped_frames).to eq(2)
+  end
+
+  it "frees the pixel buffers and pending fences on reset" do
+    described_class.screenshot { |_image| nil }
+    described_class.update(0)
+
+    described_class.reset
+
+    expect(Engine::GL).to have_received(:DeleteSync).with(1)
+    expect(Engine::GL).to have_received(:DeleteBuffers).with(Rendering::FrameReadback::RING_SIZE, anything)
+  end
+
+  it "rejects unknown formats" do
+    expect { described_class.record(dir, format: :gif) }.to raise_error(ArgumentError, /png, raw/)
+  end
+end
@@ -19,6 +19,35 @@ class YamlTestEmpty
   include Engine::Serializable
 end
 
+# Stands in for Texture and friends: inline data, one instance per name
+class YamlTestAsset
+  include Engine::Serializable
+
+  attr_reader :name
+
+  def self.for(name)
+    instances[name] ||= allocate.tap { |asset| asset.instance_variable_set(:@name, name) }
+  end
+
+  def self.instances
+    @instances ||= {}
+  end
+
+  def self.from_serializable_data(data)
+    self.for(data[:name])
+  end
+
+  def serializable_data
+    { name: @name }
+  end
+
+  def load_asset; end
+
+  def upload_asset(_payload)
+    0
+  end
+end
+
 describe Engine::Serialization::YamlPersistence do
   let(:temp_dir) { File.join(Dir.tmpdir, "yaml_persistence_test_#{SecureRandom.hex(4)}") }
 
@@ -161,6 +190,24 @@ describe Engine::Serialization::YamlPersistence do
     end
   end
 
+  describe ".prefetch" do
+    after { YamlTestAsset.instances.clear }
+
+    it "creates the assets the files refer to without building any objects" do
+      path = "#{temp_dir}/scene.yaml"
+      described_class.save_all([
+        YamlTestWithRef.create(child: YamlTestAsset.for("rock")),
+        YamlTestWithRef.create(child: [YamlTestAsset.for("tree"), YamlTestAsset.for("rock")])
+      ], path)
+      YamlTestAsset.instances.clear
+
+      expect(Engine::Serialization::ObjectSerializer).not_to receive(:deserialize)
+      assets = described_class.prefetch([path])
+
+      expect(assets).to contain_exactly(YamlTestAsset.instances["rock"], YamlTestAsset.instances["tree"])
+    end
+  end
+
   describe "round trip" do
     it "saves and loads preserving data" do
       original = YamlTestSimple.create(name: "round trip", value: 123)
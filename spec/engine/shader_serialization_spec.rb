@@ -18,6 +18,12 @@ describe "Shader serialization" do
         source: :game
       })
     end
+
+    it "includes the geometry shader path when there is one" do
+      mock_shader.instance_variable_set(:@geometry_path, "test_geometry.glsl")
+
+      expect(mock_shader.serializable_data[:geometry_path]).to eq("test_geometry.glsl")
+    end
   end
 
   describe "serialization round-trip" do
@@ -0,0 +1,90 @@
+# frozen_string_literal: true
+
+require "tmpdir"
+
+describe Engine::TextureCache do
+  let(:dir) { Dir.mktmpdir }
+  let(:png_path) { File.join(dir, "image.png") }
+  let(:opaque) { ChunkyPNG::Color.rgba(200, 100, 50, 255) }
+  let(:translucent) { ChunkyPNG::Color.rgba(200, 100, 50, 100) }
+
+  def write_png(pixels, width: 8, height: 4, **options)
+    File.binwrite(png_path, ChunkyPNG::Image.new(width, height, pixels).to_blob(**options))
+  end
+
+  def entries
+    Dir.glob(File.join(dir, "cache", "*.rtex"))
+  end
+
+  before { described_class.directory = File.join(dir, "cache") }
+
+  after do
+    described_class.directory = nil
+    described_class.compress = nil
+    FileUtils.remove_entry(dir)
+  end
+
+  it "builds the full mip chain as RGBA8" do
+    write_png([opaque] * 32)
+    image = described_class.fetch(png_path)
+
+    expect(image.format).to eq(described_class::RGBA8)
+    expect(image.levels.map { |level| [level.width, level.height] }).to eq([[8, 4], [4, 2], [2, 1], [1, 1]])
+    expect(image.levels.first.bytes).to eq([200, 100, 50, 255].pack('C*') * 32)
+  end
+
+  it "maps the cached entry on the next fetch" do
+    write_png([opaque] * 16 + [translucent] * 16)
+    built = described_class.fetch(png_path)
+    cached = described_class.fetch(png_path)
+
+    expect(entries.length).to eq(1)
+    expect(built.mapped_file).to be_nil
+    expect(cached.mapped_file).to be_a(AssetNative::MappedFile)
+    expect(cached.levels.map(&:bytes)).to eq(built.levels.map(&:bytes))
+  end
+
+  it "keys entries by the PNG's contents" do
+    write_png([opaque] * 32)
+    described_class.fetch(png_path)
+    write_png([translucent] * 32)
+
+    expect(described_class.fetch(png_path).levels.first.bytes.getbyte(3)).to eq(100)
+    expect(entries.length).to eq(2)
+  end
+
+  it "rebuilds entries written by another version" do
+    write_png([opaque] * 32)
+    described_class.fetch(png_path)
+    File.binwrite(entries.first, [0].pack('V'), 4)
+
+    expect(described_class.fetch(png_path).mapped_file).to be_nil
+    expect(described_class.fetch(png_path).mapped_file).not_to be_nil
+  end
+
+  it "compresses opaque images to BC1 and the rest to BC3" do
+    described_class.compress = true
+    write_png([opaque] * 32)
+    expect(described_class.fetch(png_path).format).to eq(described_class::BC1)
+
+    write_png([translucent] * 32)
+    image = described_class.fetch(png_path)
+    expect(image.format).to eq(described_class::BC3)
+    expect(image.levels.map { |level| level.bytes.bytesize }).to eq([2 * 16, 16, 16, 16])
+  end
+
+  it "falls back to ChunkyPNG for interlaced files" do
+    write_png([opaque] * 16 + [translucent] * 16, interlace: true)
+    rgba = described_class.fetch(png_path).levels.first.bytes
+
+    expect(rgba.byteslice(0, 4).unpack('C*')).to eq([200, 100, 50, 100])
+    expect(rgba.byteslice(-4, 4).unpack('C*')).to eq([200, 100, 50, 255])
+  end
+
+  it "still loads when the cache can't be written" do
+    described_class.directory = File.join(png_path, "cache")
+    write_png([opaque] * 32)
+
+    expect(described_class.fetch(png_path).width).to eq(8)
+  end
+end
@@ -0,0 +1,96 @@
+# frozen_string_literal: true
+
+describe TransformNative do
+  def world_matrix(slot)
+    Matrix.rows(TransformNative.world_matrix(slot).each_slice(4).to_a)
+  end
+
+  describe ".update_all" do
+    it "resolves parents before children regardless of allocation order" do
+      child = TransformNative.alloc
+      parent = TransformNative.alloc
+      TransformNative.set_parent(child, parent)
+      TransformNative.set_position(parent, 100, 0, 0)
+      TransformNative.set_position(child, 10, 0, 0)
+
+      TransformNative.update_all
+
+      expect(world_matrix(child)[3, 0]).to eq(110)
+    ensure
+      TransformNative.release(child)
+      TransformNative.release(parent)
+    end
+
+    it "only recomputes matrices that changed" do
+      slots = Array.new(3) { TransformNative.alloc }
+      TransformNative.update_all
+
+      TransformNative.set_position(slots[1], 1, 2, 3)
+
+      expect(TransformNative.update_all).to eq(1)
+      expect(TransformNative.update_all).to eq(0)
+    ensure
+      slots.each { |slot| TransformNative.release(slot) }
+    end
+  end
+
+  describe ".world_version" do
+    it "changes when an ancestor moves" do
+      grandparent = TransformNative.alloc
+      parent = TransformNative.alloc
+      child = TransformNative.alloc
+      TransformNative.set_parent(parent, grandparent)
+      TransformNative.set_parent(child, parent)
+      version = TransformNative.world_version(child)
+
+      TransformNative.set_scale(grandparent, 2, 2, 2)
+
+      expect(TransformNative.world_version(child)).not_to eq(version)
+    ensure
+      [child, parent, grandparent].each { |slot| TransformNative.release(slot) }
+    end
+  end
+
+  describe ".set_parent" do
+    it "rejects cycles" do
+      parent = TransformNative.alloc
+      child = TransformNative.alloc
+      TransformNative.set_parent(child, parent)
+
+      expect { TransformNative.set_parent(parent, child) }.to raise_error(ArgumentError)
+    ensure
+      TransformNative.release(child)
+      TransformNative.release(parent)
+    end
+  end
+
+  describe ".write_world_matrix" do
+    it "writes packed float32 matrices in place" do
+      object = Engine::GameObject.create(pos: Vector[1, 2, 3], rotation: Vector[10, 20, 30])
+      buffer = "\0".b * 128
+
+      TransformNative.write_world_matrix(object.transform_slot, buffer, 64)
+
+      expect(buffer.byteslice(64, 64).unpack('F*')).to eq(object.model_matrix.to_a.flatten.pack('F*').unpack('F*'))
+    end
+  end
+
+  it "matches the model matrix built from euler angles" do
+    parent = Engine::GameObject.create(pos: Vector[5, -2, 1], rotation: Vector[30, 45, 60], scale: Vector[2, 1, 0.5])
+    child = Engine::GameObject.create(pos: Vector[1, 2, 3], rotation: Vector[-15, 80, 5], parent: parent)
+
+    expected = child.rotation.to_euler.then do |euler|
+      rot = euler * Math::PI / 180
+      cx, cy, cz = rot.map { |a| Math.cos(a) }.to_a
+      sx, sy, sz = rot.map { |a| Math.sin(a) }.to_a
+      Matrix[
+        [cy * cz, -cy * sz, sy, 0],
+        [cx * sz + sx * sy * cz, cx * cz - sx * sy * sz, -sx * cy, 0],
+        [sx * sz - cx * sy * cz, sx * cz + cx * sy * sz, cx * cy, 0],
+        [1, 2, 3, 1]
+      ] * parent.model_matrix
+    end
+
+    expect((child.model_matrix - expected).to_a.flatten.map(&:abs).max).to be < 1e-9
+  end
+end
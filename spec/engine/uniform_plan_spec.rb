@@ -0,0 +1,95 @@
+# frozen_string_literal: true
+
+describe Engine::UniformPlan do
+  let(:locations) { { "camera" => 0, "roughness" => 1, "baseColour" => 2, "image" => 3 } }
+  let(:shader) do
+    shader = Engine::Shader.allocate
+    shader.instance_variable_set(:@program, 1)
+    shader.instance_variable_set(:@texture_fallbacks, { "image" => :white })
+    shader.instance_variable_set(:@cubemap_fallbacks, {})
+    shader.instance_variable_set(:@uniform_cache, {})
+    shader.instance_variable_set(:@uniform_locations, {})
+    shader.instance_variable_set(:@packed_uniforms, {})
+    shader
+  end
+  let(:material) { Engine::Material.create(shader: shader) }
+
+  before do
+    allow(Engine::GL).to receive(:GetUniformLocation) { |_program, name| locations.fetch(name, -1) }
+    %i[UseProgram ActiveTexture BindTexture UniformMatrix4fv Uniform1fv Uniform3fv Uniform1iv].each do |name|
+      allow(Engine::GL).to receive(name)
+    end
+    allow(Engine::Material).to receive(:default_white_texture).and_return(7)
+    Engine::Shader.reset_uniform_stats
+  end
+
+  def sent_and_skipped
+    stats = Engine::Shader.uniform_stats.dup
+    Engine::Shader.reset_uniform_stats
+    [stats[:sent], stats[:skipped]]
+  end
+
+  it "sends every uniform the first time and none when nothing changed" do
+    camera = Matrix.identity(4)
+    material.set_mat4("camera", camera)
+    material.set_float("roughness", 0.5)
+    material.set_vec3("baseColour", Vector[1, 0, 0])
+
+    material.update_shader
+    expect(sent_and_skipped).to eq([4, 0]) # three values plus the image sampler slot
+
+    material.set_mat4("camera", camera)
+    material.update_shader
+    expect(sent_and_skipped).to eq([0, 4])
+  end
+
+  it "only re-sends the values that changed" do
+    material.set_float("roughness", 0.5)
+    material.set_vec3("baseColour", Vector[1, 0, 0])
+    material.update_shader
+    sent_and_skipped
+
+    material.set_float("roughness", 0.8)
+    material.set_vec3("baseColour", Vector[1, 0, 0])
+    material.update_shader
+
+    expect(sent_and_skipped).to eq([1, 2])
+  end
+
+  it "sees a value mutated in place and set again" do
+    colour = [1.0, 0.0, 0.0]
+    material.set_vec3("baseColour", colour)
+    material.update_shader
+    sent_and_skipped
+
+    colour[1] = 1.0
+    material.set_vec3("baseColour", colour)
+    material.update_shader
+
+    expect(sent_and_skipped).to eq([1, 1])
+    expect(Engine::GL).to have_received(:Uniform3fv).with(2, 1, [1.0, 1.0, 0.0].pack('F3')).once
+  end
+
+  it "skips values another material already left on the program" do
+    other = Engine::Material.create(shader: shader)
+    [material, other].each do |m|
+      m.set_float("roughness", 0.5)
+      m.set_vec3("baseColour", Vector[0, 1, 0])
+    end
+    other.set_float("roughness", 0.9)
+
+    material.update_shader
+    sent_and_skipped
+    other.update_shader
+
+    expect(sent_and_skipped).to eq([1, 2])
+  end
+
+  it "ignores names the program does not use" do
+    material.set_float("pointLights[0].sqrRange", 4.0)
+
+    material.update_shader
+
+    expect(sent_and_skipped).to eq([1, 0])
+  end
+end